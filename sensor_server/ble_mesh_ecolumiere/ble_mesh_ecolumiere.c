@@ -16,6 +16,10 @@
 #include "esp_log.h"        // Sistema di logging (ESP_LOGI, ESP_LOGE, etc.)
 #include "nvs_flash.h"      // Gestione memoria non volatile (NVS)
 #include "esp_timer.h"      // Timer ad alta risoluzione
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"  // Task delle letture della matrice di stanza e della scoperta ottica
+#include <stdlib.h>
+#include <string.h>
 
 // 2. CORE BLE MESH (Dipendenze esterne primarie)
 #include "esp_ble_mesh_defs.h"                     // Definizioni base BLE Mesh
@@ -42,6 +46,12 @@
 #include "slave_role.h"                            // Gestione ruolo slave
 #include "ecolumiere_system.h"                     // Sistema principale Ecolumiere
 #include "datarecorder.h"                          // Registrazione dati/log
+#include "commissioning.h"                         // Scansione automatica della lampada
+#include "offset_cal_task.h"                      // Calibrazione degli offset del luxmeter
+#include "ecolumiere.h"                            // Nodi della stanza
+#include "storage.h"                               // Riga della matrice di stanza
+#include "lightcode.h"                             // Acquisizioni della scoperta ottica
+#include "esp_rom_crc.h"                           // CRC della riga salvata
 
 // 7. HEADER LOCALE (Questo file stesso - sempre ultimo)
 #include "ble_mesh_ecolumiere.h"
@@ -50,19 +60,14 @@
 static const char *TAG = "BLE_MESH_ECOLUMIERE";
 
 // ---------------------------------------------------------------------------------
-// SEZIONE 1: DATI DI SENSORI SIMULATI/STATICI
+// SEZIONE 1: DATI DI SENSORI STATICI
 // ---------------------------------------------------------------------------------
-// Questi valori rappresentano dati di sensori fittizi utilizzati per il
-// prototipo del sistema. In un'implementazione reale verrebbero sostituiti
-// con letture da sensori fisici.
-static int8_t indoor_temp = 40;                 /* Temperatura interna: 20°C (risoluzione 0.5) */
-static uint16_t potenza_istantanea_assorbita = 2410; /* Potenza assorbita in Watt (BIG ENDIAN) */
+// Temperatura, potenza, codice errore, illuminamento, tensione e corrente
+// arrivano dalla fotografia della scansione ADC (luxmeter_get_snapshot).
+// Umidità e pressione non hanno un sensore sulla scheda: valori fissi.
 static uint16_t humidity_sensor = 10000;        /* Umidità: 100% con risoluzione 0.01% */
 static uint16_t pressure_sensor = 10000;        /* Pressione: 1000.00 hPa con risoluzione 0.01 hPa */
-static uint8_t error_code = 0;                  /* Codice errore: 0 = nessun errore */
-static uint32_t illuminance_sensor = 300;       /* Illuminamento: 300 lux */
-static uint16_t voltage_sensor = 2300;          /* Tensione: 23.00 V con risoluzione 0.01 V */
-static uint16_t current_sensor = 100;           /* Corrente: 1.00 A con risoluzione 0.01 A */
+static uint32_t sensor_snapshot_seq = 0;        /* Ultima fotografia copiata nei buffer */
 
 // ---------------------------------------------------------------------------------
 // SEZIONE 2: CONFIGURAZIONE SERVER BLE MESH
@@ -294,10 +299,12 @@ static esp_ble_mesh_sensor_state_t sensor_states[8] = {
 ESP_BLE_MESH_MODEL_PUB_DEFINE(hsl_pub, 2 + 9, ROLE_NODE);
 
 // Istanza del server HSL con configurazione delle risposte automatiche
+// I SET passano all'applicazione: Transition Time e Delay guidano il fade LEDC
+// (con la risposta automatica lo stack esegue la transizione e notifica solo la fine)
 static esp_ble_mesh_light_hsl_srv_t hsl_server = {
     .rsp_ctrl = {
         .get_auto_rsp = ESP_BLE_MESH_SERVER_AUTO_RSP,  // Risponde automaticamente ai GET
-        .set_auto_rsp = ESP_BLE_MESH_SERVER_AUTO_RSP,  // Risponde automaticamente ai SET
+        .set_auto_rsp = ESP_BLE_MESH_SERVER_RSP_BY_APP, // SET gestiti in RECV_SET_MSG_EVT
     },
     .state = &hsl_state,  // Puntatore allo stato HSL globale (definito sopra)
 };
@@ -338,6 +345,13 @@ static esp_ble_mesh_light_hsl_setup_srv_t hsl_setup_server = {
 // Ogni entry specifica: (opcode, lunghezza_minima_messaggio)
 static esp_ble_mesh_model_op_t vnd_op[] = {
     ESP_BLE_MESH_MODEL_OP(ESP_BLE_MESH_VND_MODEL_OP_SEND, 2),  // Opcode principale custom
+    ESP_BLE_MESH_MODEL_OP(ESP_BLE_MESH_VND_MODEL_OP_LUX_SHARE, sizeof(ecl_lux_share_t)), // Misure lux dei vicini
+    ESP_BLE_MESH_MODEL_OP(ESP_BLE_MESH_VND_MODEL_OP_COMMISSION, 1), // Commissioning della lampada
+    ESP_BLE_MESH_MODEL_OP(ESP_BLE_MESH_VND_MODEL_OP_ROOM_TOKEN, sizeof(ecl_room_token_t)), // Gettone matrice di stanza
+    ESP_BLE_MESH_MODEL_OP(ESP_BLE_MESH_VND_MODEL_OP_ROOM_MATRIX, 1), // Matrice di stanza dal gateway
+    ESP_BLE_MESH_MODEL_OP(ESP_BLE_MESH_VND_MODEL_OP_OFFSET_CAL, 1), // Calibrazione offset del luxmeter
+    ESP_BLE_MESH_MODEL_OP(ESP_BLE_MESH_VND_MODEL_OP_OPTICAL_TOKEN, sizeof(ecl_optical_token_t)), // Gettone scoperta ottica
+    ESP_BLE_MESH_MODEL_OP(ESP_BLE_MESH_VND_MODEL_OP_OPTICAL_DISC, 1), // Vicini ottici dal gateway
     ESP_BLE_MESH_MODEL_OP_END,  // Marcatore di fine array
 };
 
@@ -416,19 +430,860 @@ static esp_ble_mesh_prov_t provision = {
 // SEZIONE 10: FUNZIONI INTERNE
 // ---------------------------------------------------------------------------------
 
+// Stato della condivisione lux nella stanza
+static uint16_t lux_share_net_idx = ESP_BLE_MESH_KEY_PRIMARY;  // Rete mesh (da provisioning)
+static uint16_t lux_share_app_idx = ESP_BLE_MESH_KEY_UNUSED;   // AppKey legata al modello vendor
+static uint16_t lux_share_group = 0x0000;                      // Gruppo stanza sottoscritto
+static esp_timer_handle_t lux_share_timer = NULL;
+
+/**
+ * @brief Calcola l'indirizzo di gruppo della stanza dalla posizione del nodo
+ */
+static uint16_t lux_share_room_group(void)
+{
+    const NodoLampada *lampada = slave_node_get_lampada_data();
+
+    return ECL_ROOM_GROUP_BASE | ((lampada->piano.numero & 0x0F) << 8) |
+           (lampada->stanza.numero & 0xFF);
+}
+
+/**
+ * @brief Pubblica le misure filtrate sul gruppo della stanza
+ *
+ * Chiamata dal timer a bassa frequenza. Sottoscrive il modello vendor al
+ * gruppo stanza la prima volta o quando la posizione del nodo cambia.
+ */
+static void lux_share_timer_callback(void *arg)
+{
+    if (!esp_ble_mesh_node_is_provisioned()) {
+        return;
+    }
+
+    // Dopo un riavvio l'AppKey legata è già nel modello
+    if (lux_share_app_idx == ESP_BLE_MESH_KEY_UNUSED) {
+        lux_share_app_idx = vnd_models[0].keys[0];
+        if (lux_share_app_idx == ESP_BLE_MESH_KEY_UNUSED) {
+            return;
+        }
+    }
+
+    uint16_t group = lux_share_room_group();
+    if (group != lux_share_group) {
+        esp_err_t err = esp_ble_mesh_model_subscribe_group_addr(
+            esp_ble_mesh_get_primary_element_address(), CID_ESP,
+            ESP_BLE_MESH_VND_MODEL_ID_SERVER, group);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "❌ Sottoscrizione gruppo stanza 0x%04x fallita", group);
+            return;
+        }
+        lux_share_group = group;
+        ESP_LOGI(TAG, "🏠 Sottoscritto gruppo stanza 0x%04x", group);
+    }
+
+    uint32_t natural, env;
+    ecolumiere_get_filtered_lux(&natural, &env);
+
+    ecl_lux_share_t msg = {
+        .room_group = group,
+        .natural_lux = (natural > 0xFFFF) ? 0xFFFF : (uint16_t)natural,
+        .env_lux = (env > 0xFFFF) ? 0xFFFF : (uint16_t)env
+    };
+
+    esp_ble_mesh_msg_ctx_t ctx = {
+        .net_idx = lux_share_net_idx,
+        .app_idx = lux_share_app_idx,
+        .addr = group,
+        .send_ttl = DEFAULT_TTL,
+        .send_rel = false
+    };
+
+    esp_err_t err = esp_ble_mesh_server_model_send_msg(&vnd_models[0], &ctx,
+        ESP_BLE_MESH_VND_MODEL_OP_LUX_SHARE, sizeof(msg), (uint8_t *)&msg);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "⚠️ Pubblicazione lux stanza fallita: %s", esp_err_to_name(err));
+    }
+}
+
+/**
+ * @brief Avvia la pubblicazione periodica delle misure verso la stanza
+ *
+ * Il periodo è sfasato in base all'indirizzo unicast per evitare che tutti
+ * i nodi di una stanza trasmettano nello stesso istante.
+ */
+static void lux_share_start(void)
+{
+    if (lux_share_timer != NULL) {
+        return;
+    }
+
+    const esp_timer_create_args_t timer_args = {
+        .callback = &lux_share_timer_callback,
+        .name = "lux_share"
+    };
+
+    if (esp_timer_create(&timer_args, &lux_share_timer) != ESP_OK) {
+        ESP_LOGE(TAG, "❌ Creazione timer lux stanza fallita");
+        lux_share_timer = NULL;
+        return;
+    }
+
+    uint32_t period_ms = ECL_LUX_SHARE_PERIOD_MS +
+                         (slave_node_get_unicast_addr() % 8) * ECL_LUX_SHARE_JITTER_MS;
+    esp_timer_start_periodic(lux_share_timer, (uint64_t)period_ms * 1000);
+
+    ESP_LOGI(TAG, "🏠 Condivisione lux stanza ogni %lu ms", period_ms);
+}
+
+/**
+ * @brief Gestisce le misure ricevute da un nodo della stanza
+ */
+static void lux_share_handle_msg(esp_ble_mesh_model_cb_param_t *param)
+{
+    const ecl_lux_share_t *msg = (const ecl_lux_share_t *)param->model_operation.msg;
+    uint16_t src = param->model_operation.ctx->addr;
+
+    // Scarta i propri messaggi e quelli di altre stanze
+    if (src == slave_node_get_unicast_addr() || msg->room_group != lux_share_room_group()) {
+        return;
+    }
+
+    scheduler_put_neighbor_lux_event(src, msg->natural_lux, msg->env_lux,
+                                     param->model_operation.ctx->recv_rssi);
+}
+
+// Destinatario dell'esito del commissioning
+static esp_ble_mesh_msg_ctx_t commission_ctx;
+
+/**
+ * @brief Invia l'esito del commissioning al richiedente
+ */
+static void commission_send_status(const commissioning_result_t *result)
+{
+    ecl_commission_status_t msg = { .status = 0xFF };
+
+    if (result) {
+        msg.status = (uint8_t)result->fit.status;
+        msg.gain_x100 = (uint16_t)(result->fit.gain * 100.0f);
+        msg.distance_mm = (uint16_t)(result->fit.distance * 1000.0f);
+        msg.rms_x10 = (uint16_t)(result->fit.rms * 10.0f);
+        msg.rms_prior_x10 = (uint16_t)(result->fit.rms_prior * 10.0f);
+        msg.duration_ds = (uint16_t)(result->duration_ms / 100);
+    }
+
+    esp_err_t err = esp_ble_mesh_server_model_send_msg(&vnd_models[0], &commission_ctx,
+        ESP_BLE_MESH_VND_MODEL_OP_COMMISSION_STATUS, sizeof(msg), (uint8_t *)&msg);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "⚠️ Invio esito commissioning fallito: %s", esp_err_to_name(err));
+    }
+}
+
+/**
+ * @brief Gestisce una richiesta di commissioning dal gateway
+ *
+ * START avvia la scansione e risponde subito con stato 0xFF; l'esito arriva
+ * a fine scansione. GET restituisce l'esito dell'ultima scansione.
+ */
+static void commission_handle_msg(esp_ble_mesh_model_cb_param_t *param)
+{
+    uint8_t action = param->model_operation.msg[0];
+    commissioning_result_t result;
+
+    commission_ctx = *param->model_operation.ctx;
+    commission_ctx.send_ttl = DEFAULT_TTL;
+
+    if (action == ECL_COMMISSION_START) {
+        if (commissioning_start(commission_send_status) == ESP_OK) {
+            commission_send_status(NULL);
+        } else {
+            memset(&result, 0, sizeof(result));
+            result.fit.status = COMMISSIONING_ERR_BUSY;
+            commission_send_status(&result);
+        }
+    } else if (action == ECL_COMMISSION_GET) {
+        commission_send_status(commissioning_get_last_result(&result) ? &result : NULL);
+    }
+}
+
+// Destinatario dell'esito della calibrazione degli offset
+static esp_ble_mesh_msg_ctx_t offset_cal_ctx;
+
+/**
+ * @brief Invia al richiedente la tabella in uso e l'esito della calibrazione
+ */
+static void offset_cal_send_status(const offset_cal_run_t *result)
+{
+    ecl_offset_cal_status_t msg = { .status = 0xFF };
+    int16_t offsets[LUXMETER_OFFSET_LEVELS];
+
+    msg.calibrated = luxmeter_get_offsets(offsets) ? 1 : 0;
+    memcpy(msg.offset, offsets, sizeof(offsets));
+    if (result) {
+        msg.status = (uint8_t)result->cal.status;
+        msg.gain_x100 = (uint16_t)(result->cal.gain * 100.0f);
+        msg.rms_x100 = (uint16_t)(result->cal.rms * 100.0f);
+        msg.rms_prior_x100 = (uint16_t)(result->cal.rms_prior * 100.0f);
+    }
+
+    esp_err_t err = esp_ble_mesh_server_model_send_msg(&vnd_models[0], &offset_cal_ctx,
+        ESP_BLE_MESH_VND_MODEL_OP_OFFSET_CAL_STATUS, sizeof(msg), (uint8_t *)&msg);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "⚠️ Invio tabella offset fallito: %s", esp_err_to_name(err));
+    }
+}
+
+/**
+ * @brief Gestisce una richiesta di calibrazione degli offset dal gateway
+ *
+ * START avvia la scansione al buio e risponde subito con stato 0xFF; la
+ * nuova tabella arriva a fine scansione. GET restituisce la tabella in uso
+ * con l'esito dell'ultima calibrazione.
+ */
+static void offset_cal_handle_msg(esp_ble_mesh_model_cb_param_t *param)
+{
+    uint8_t action = param->model_operation.msg[0];
+    offset_cal_run_t result;
+
+    offset_cal_ctx = *param->model_operation.ctx;
+    offset_cal_ctx.send_ttl = DEFAULT_TTL;
+
+    if (action == ECL_OFFSET_CAL_START) {
+        if (offset_cal_start(offset_cal_send_status) == ESP_OK) {
+            offset_cal_send_status(NULL);
+        } else {
+            memset(&result, 0, sizeof(result));
+            result.cal.status = OFFSET_CAL_ERR_BUSY;
+            offset_cal_send_status(&result);
+        }
+    } else if (action == ECL_OFFSET_CAL_GET) {
+        offset_cal_send_status(offset_cal_get_last_result(&result) ? &result : NULL);
+    }
+}
+
+// Stato della scoperta dei vicini ottici (modificato solo dal task scheduler)
+static optical_discovery_t optical_disc;
+static volatile bool optical_disc_active = false;    // Acquisizioni periodiche in corso
+static TaskHandle_t optical_disc_task_handle = NULL;
+static bool optical_disc_reply = false;              // Tabella da inviare al gateway a fine scoperta
+static esp_ble_mesh_msg_ctx_t optical_disc_ctx;      // Destinatario della tabella
+
+// Stato della misura della matrice di stanza (modificato solo dal task scheduler)
+static room_matrix_t room_matrix;
+static volatile bool room_matrix_active = false;     // Letture periodiche in corso
+static TaskHandle_t room_matrix_task_handle = NULL;
+static bool room_matrix_reply = false;               // Esito da inviare al gateway a fine misura
+static esp_ble_mesh_msg_ctx_t room_matrix_ctx;       // Destinatario dell'esito
+
+static uint32_t room_matrix_now_ms(void)
+{
+    return (uint32_t)(esp_timer_get_time() / 1000);
+}
+
+/**
+ * @brief Inizializza lo stato al primo uso (l'indirizzo è noto dopo il provisioning)
+ */
+static void room_matrix_prepare(void)
+{
+    uint16_t self = slave_node_get_unicast_addr();
+
+    if (room_matrix.self != self) {
+        room_matrix_init(&room_matrix, self);
+    }
+}
+
+/**
+ * @brief Invia il gettone del passo corrente al gruppo stanza
+ */
+static void room_matrix_send_token(void)
+{
+    if (lux_share_app_idx == ESP_BLE_MESH_KEY_UNUSED) {
+        lux_share_app_idx = vnd_models[0].keys[0];
+    }
+
+    ecl_room_token_t msg = {
+        .room_group = lux_share_room_group(),
+        .session = room_matrix.session,
+        .index = room_matrix.index,
+        .count = room_matrix.count,
+        .lit_ms = room_matrix.lit
+    };
+    memcpy(msg.members, room_matrix.members, sizeof(msg.members));
+
+    esp_ble_mesh_msg_ctx_t ctx = {
+        .net_idx = lux_share_net_idx,
+        .app_idx = lux_share_app_idx,
+        .addr = msg.room_group,
+        .send_ttl = DEFAULT_TTL,
+        .send_rel = false
+    };
+
+    esp_err_t err = esp_ble_mesh_server_model_send_msg(&vnd_models[0], &ctx,
+        ESP_BLE_MESH_VND_MODEL_OP_ROOM_TOKEN, sizeof(msg), (uint8_t *)&msg);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "⚠️ Invio gettone matrice fallito: %s", esp_err_to_name(err));
+    }
+}
+
+/**
+ * @brief Carica l'ultima riga salvata verificandone il CRC
+ */
+static bool room_matrix_load_row(room_matrix_row_t *row)
+{
+    if (storage_load_room_matrix(row) &&
+        row->crc == esp_rom_crc16_le(0xFFFF, (uint8_t *)row, sizeof(room_matrix_row_t) - sizeof(uint16_t))) {
+        return true;
+    }
+
+    memset(row, 0, sizeof(room_matrix_row_t));
+    return false;
+}
+
+/**
+ * @brief Ricava la fase di regolazione del nodo
+ *
+ * Con una matrice di stanza salvata la fase è la posizione del nodo fra i
+ * membri (turni senza collisioni fino a PWM_CONTROL_PHASES lampade),
+ * altrimenti deriva dall'indirizzo unicast.
+ */
+static void control_phase_update(void)
+{
+    uint16_t self = slave_node_get_unicast_addr();
+    uint8_t phase = (uint8_t)(self % PWM_CONTROL_PHASES);
+    room_matrix_row_t row;
+
+    if (room_matrix_load_row(&row)) {
+        for (uint8_t k = 0; k < row.count && k < ROOM_MATRIX_MAX_MEMBERS; k++) {
+            if (row.addr[k] == self) phase = k % PWM_CONTROL_PHASES;
+        }
+    }
+
+    pwm_set_control_phase(phase);
+}
+
+/**
+ * @brief Invia lo stato e l'ultima riga salvata al richiedente
+ */
+static void room_matrix_send_status(const esp_ble_mesh_msg_ctx_t *ctx)
+{
+    ecl_room_matrix_status_t msg = { .state = (uint8_t)room_matrix.state };
+    esp_ble_mesh_msg_ctx_t reply = *ctx;
+
+    room_matrix_load_row(&msg.row);
+
+    reply.send_ttl = DEFAULT_TTL;
+    esp_err_t err = esp_ble_mesh_server_model_send_msg(&vnd_models[0], &reply,
+        ESP_BLE_MESH_VND_MODEL_OP_ROOM_MATRIX_STATUS, sizeof(msg), (uint8_t *)&msg);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "⚠️ Invio matrice di stanza fallito: %s", esp_err_to_name(err));
+    }
+}
+
+/**
+ * @brief Chiude la misura: rilascia la lampada e salva la riga
+ */
+static void room_matrix_finish(void)
+{
+    pwm_hold_level(-1);
+    room_matrix_active = false;
+
+    if (room_matrix.state == ROOM_MATRIX_DONE) {
+        room_matrix_row_t row;
+        room_matrix_get_row(&room_matrix, &row);
+        row.crc = esp_rom_crc16_le(0xFFFF, (uint8_t *)&row, sizeof(room_matrix_row_t) - sizeof(uint16_t));
+        storage_save_room_matrix(&row);
+        control_phase_update();
+
+        ESP_LOGI(TAG, "🏠 Matrice di stanza: %u/%u coefficienti, sessione 0x%02X",
+                 __builtin_popcount(row.valid_mask), row.count, row.session);
+        for (uint8_t k = 0; k < row.count; k++) {
+            ESP_LOGI(TAG, "   0x%04X: %d.%02d lux/livello%s", row.addr[k],
+                     row.coef_x100[k] / 100, abs(row.coef_x100[k] % 100),
+                     (row.valid_mask & (1U << k)) ? "" : " (non misurato)");
+        }
+    } else {
+        ESP_LOGW(TAG, "⚠️ Matrice di stanza fallita: nessuna misura di base");
+    }
+
+    if (room_matrix_reply) {
+        room_matrix_reply = false;
+        room_matrix_send_status(&room_matrix_ctx);
+    }
+}
+
+static void room_matrix_apply(uint8_t actions)
+{
+    if (actions & ROOM_MATRIX_ACT_LEVEL) pwm_hold_level(room_matrix.level);
+    if (actions & ROOM_MATRIX_ACT_SEND) room_matrix_send_token();
+    if (actions & ROOM_MATRIX_ACT_DONE) room_matrix_finish();
+}
+
 /**
- * @brief Inizializza i dati dei sensori con valori reali dal sistema
+ * @brief Passo del protocollo con la lettura appena acquisita
+ */
+static void room_matrix_tick_handler(void *p_event_data, uint16_t event_size)
+{
+    if (event_size != sizeof(float)) return;
+
+    room_matrix_apply(room_matrix_tick(&room_matrix, room_matrix_now_ms(), *(float *)p_event_data));
+}
+
+/**
+ * @brief Letture periodiche del luxmeter durante la misura
+ *
+ * La lettura blocca per la finestra ADC: resta fuori dal task scheduler,
+ * che riceve solo il valore.
+ */
+static void room_matrix_task(void *arg)
+{
+    while (room_matrix_active) {
+        vTaskDelay(pdMS_TO_TICKS(ECL_ROOM_MATRIX_TICK_MS));
+
+        uint32_t lux, index;
+        luxmeter_pickup(LUX_MEASURE_ENVIRONMENT, room_matrix.level, &lux, &index);
+
+        float value = (float)lux;
+        scheduler_put_event(&value, sizeof(value), SCH_EVT_ROOM_MATRIX, room_matrix_tick_handler);
+    }
+
+    room_matrix_task_handle = NULL;
+    vTaskDelete(NULL);
+}
+
+/**
+ * @brief Avvia le letture periodiche se la misura è in corso
+ */
+static void room_matrix_run(void)
+{
+    if (room_matrix.state != ROOM_MATRIX_RUNNING) return;
+
+    room_matrix_active = true;
+    if (room_matrix_task_handle == NULL &&
+        xTaskCreate(room_matrix_task, "room_matrix", 3072, NULL, 5, &room_matrix_task_handle) != pdPASS) {
+        ESP_LOGE(TAG, "❌ Creazione task matrice di stanza fallita");
+        room_matrix_task_handle = NULL;
+        room_matrix_active = false;
+        pwm_hold_level(-1);
+    }
+}
+
+/**
+ * @brief Gettone ricevuto da un nodo della stanza
+ */
+static void room_matrix_token_handler(void *p_event_data, uint16_t event_size)
+{
+    const ecl_room_token_t *msg = (const ecl_room_token_t *)p_event_data;
+    uint16_t members[ROOM_MATRIX_MAX_MEMBERS];
+
+    if (event_size != sizeof(ecl_room_token_t) || commissioning_is_running() || optical_disc_active) return;
+
+    // Membri copiati fuori dalla struttura packed (allineamento)
+    memcpy(members, msg->members, sizeof(members));
+
+    room_matrix_prepare();
+    room_matrix_apply(room_matrix_on_token(&room_matrix, msg->session, members, msg->count,
+                                           msg->index, msg->lit_ms, room_matrix_now_ms()));
+    room_matrix_run();
+}
+
+/**
+ * @brief Avvia la misura come promotore con i vicini noti
+ * @param p_event_data: uint8_t, 1 se l'esito va inviato al gateway
+ */
+static void room_matrix_start_handler(void *p_event_data, uint16_t event_size)
+{
+    bool reply = (event_size == sizeof(uint8_t)) && *(uint8_t *)p_event_data;
+    uint16_t members[ROOM_MATRIX_MAX_MEMBERS];
+
+    room_matrix_prepare();
+
+    if (room_matrix.state == ROOM_MATRIX_RUNNING || commissioning_is_running() || optical_disc_active) {
+        ESP_LOGW(TAG, "⚠️ Matrice di stanza: misura o commissioning già in corso");
+    } else {
+        uint8_t count = ecolumiere_get_room_members(room_matrix.self, members, ROOM_MATRIX_MAX_MEMBERS);
+        uint8_t session = (uint8_t)((esp_timer_get_time() >> 10) ^ room_matrix.self);
+
+        if (room_matrix_start(&room_matrix, members, count, session, room_matrix_now_ms())) {
+            ESP_LOGI(TAG, "🏠 Matrice di stanza avviata: %u nodi, %u s stimati", count,
+                     (count + 2) * ROOM_MATRIX_STEP_MS / 1000);
+            room_matrix_reply = reply;
+            room_matrix_apply(ROOM_MATRIX_ACT_LEVEL | ROOM_MATRIX_ACT_SEND);
+            room_matrix_run();
+        }
+    }
+
+    if (reply) {
+        room_matrix_send_status(&room_matrix_ctx);
+    }
+}
+
+/**
+ * @brief Gestisce i gettoni dei nodi della stanza
+ */
+static void room_matrix_handle_token(esp_ble_mesh_model_cb_param_t *param)
+{
+    const ecl_room_token_t *msg = (const ecl_room_token_t *)param->model_operation.msg;
+    uint16_t src = param->model_operation.ctx->addr;
+
+    // Scarta i propri gettoni e quelli di altre stanze
+    if (src == slave_node_get_unicast_addr() || msg->room_group != lux_share_room_group() ||
+        msg->count == 0 || msg->count > ROOM_MATRIX_MAX_MEMBERS) {
+        return;
+    }
+
+    ecl_room_token_t token;
+    memcpy(&token, msg, sizeof(token));
+    scheduler_put_event(&token, sizeof(token), SCH_EVT_ROOM_MATRIX, room_matrix_token_handler);
+}
+
+/**
+ * @brief Gestisce una richiesta del gateway sulla matrice di stanza
+ *
+ * START rende il nodo promotore: risponde subito con lo stato e invia la
+ * propria riga a fine misura. Le righe degli altri nodi si leggono con GET.
+ */
+static void room_matrix_handle_msg(esp_ble_mesh_model_cb_param_t *param)
+{
+    uint8_t action = param->model_operation.msg[0];
+
+    if (action == ECL_ROOM_MATRIX_START) {
+        uint8_t reply = 1;
+        room_matrix_ctx = *param->model_operation.ctx;
+        scheduler_put_event(&reply, sizeof(reply), SCH_EVT_ROOM_MATRIX, room_matrix_start_handler);
+    } else if (action == ECL_ROOM_MATRIX_GET) {
+        room_matrix_send_status(param->model_operation.ctx);
+    }
+}
+
+/**
+ * @brief Avvia la misura della matrice di stanza da questo nodo
+ */
+esp_err_t ble_mesh_ecolumiere_room_matrix_start(void)
+{
+    uint8_t reply = 0;
+
+    if (!esp_ble_mesh_node_is_provisioned()) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    return scheduler_put_event(&reply, sizeof(reply), SCH_EVT_ROOM_MATRIX, room_matrix_start_handler);
+}
+
+/**
+ * @brief Esito di un'acquisizione del task, passato allo scheduler
+ */
+typedef struct {
+    bool captured;
+    uint16_t payload;
+    uint8_t confidence;
+} optical_disc_capture_t;
+
+/**
+ * @brief Inizializza lo stato al primo uso (l'indirizzo è noto dopo il provisioning)
+ */
+static void optical_disc_prepare(void)
+{
+    uint16_t self = slave_node_get_unicast_addr();
+
+    if (optical_disc.self != self) {
+        optical_discovery_init(&optical_disc, self);
+    }
+}
+
+/**
+ * @brief Invia il gettone del passo corrente al gruppo stanza
+ */
+static void optical_disc_send_token(void)
+{
+    if (lux_share_app_idx == ESP_BLE_MESH_KEY_UNUSED) {
+        lux_share_app_idx = vnd_models[0].keys[0];
+    }
+
+    ecl_optical_token_t msg = {
+        .room_group = lux_share_room_group(),
+        .session = optical_disc.session,
+        .index = optical_disc.index,
+        .count = optical_disc.count
+    };
+    memcpy(msg.members, optical_disc.members, sizeof(msg.members));
+
+    esp_ble_mesh_msg_ctx_t ctx = {
+        .net_idx = lux_share_net_idx,
+        .app_idx = lux_share_app_idx,
+        .addr = msg.room_group,
+        .send_ttl = DEFAULT_TTL,
+        .send_rel = false
+    };
+
+    esp_err_t err = esp_ble_mesh_server_model_send_msg(&vnd_models[0], &ctx,
+        ESP_BLE_MESH_VND_MODEL_OP_OPTICAL_TOKEN, sizeof(msg), (uint8_t *)&msg);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "⚠️ Invio gettone scoperta ottica fallito: %s", esp_err_to_name(err));
+    }
+}
+
+/**
+ * @brief Invia stato e tabella dei vicini ottici al richiedente
+ */
+static void optical_disc_send_status(const esp_ble_mesh_msg_ctx_t *ctx)
+{
+    ecl_optical_disc_status_t msg = { .state = (uint8_t)optical_disc.state };
+    esp_ble_mesh_msg_ctx_t reply = *ctx;
+
+    if (optical_disc.state == OPTICAL_DISCOVERY_DONE) {
+        optical_discovery_get_table(&optical_disc, &msg.table);
+    }
+
+    reply.send_ttl = DEFAULT_TTL;
+    esp_err_t err = esp_ble_mesh_server_model_send_msg(&vnd_models[0], &reply,
+        ESP_BLE_MESH_VND_MODEL_OP_OPTICAL_DISC_STATUS, sizeof(msg), (uint8_t *)&msg);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "⚠️ Invio vicini ottici fallito: %s", esp_err_to_name(err));
+    }
+}
+
+/**
+ * @brief Chiude la scoperta: ricezione, lampada rilasciata, tabella nel log
+ */
+static void optical_disc_finish(void)
+{
+    optical_discovery_table_t table;
+
+    optical_disc_active = false;
+    pwm_set_id_role(ROLE_ID_RECEIVER);
+    pwm_hold_level(-1);
+
+    optical_discovery_get_table(&optical_disc, &table);
+    ESP_LOGI(TAG, "🔦 Vicini ottici: %u/%u membri visti, sessione 0x%02X",
+             __builtin_popcount(table.neighbor_mask), table.count ? table.count - 1 : 0, table.session);
+    for (uint8_t k = 0; k < table.count; k++) {
+        if (table.addr[k] == optical_disc.self) continue;
+        ESP_LOGI(TAG, "   0x%04X: %u%% di %u acquisizioni, confidenza %u%s", table.addr[k],
+                 table.strength[k], table.captures[k], table.confidence[k],
+                 (table.neighbor_mask & (1U << k)) ? "" : " (non visto)");
+    }
+
+    if (optical_disc_reply) {
+        optical_disc_reply = false;
+        optical_disc_send_status(&optical_disc_ctx);
+    }
+}
+
+static void optical_disc_apply(uint8_t actions)
+{
+    if (actions & OPTICAL_DISCOVERY_ACT_ROLE) {
+        pwm_set_id_role(optical_disc.transmit ? ROLE_ID_BROADCASTER : ROLE_ID_RECEIVER);
+    }
+    if (actions & OPTICAL_DISCOVERY_ACT_SEND) optical_disc_send_token();
+    if (actions & OPTICAL_DISCOVERY_ACT_DONE) optical_disc_finish();
+}
+
+/**
+ * @brief Passo del protocollo con l'esito dell'ultima acquisizione
+ */
+static void optical_disc_tick_handler(void *p_event_data, uint16_t event_size)
+{
+    const optical_disc_capture_t *capture = (const optical_disc_capture_t *)p_event_data;
+
+    if (event_size != sizeof(optical_disc_capture_t)) return;
+
+    optical_disc_apply(optical_discovery_tick(&optical_disc, room_matrix_now_ms(), capture->captured,
+                                              capture->payload, capture->confidence));
+}
+
+/**
+ * @brief Acquisizioni periodiche del codice ottico durante la scoperta
+ *
+ * L'uscita è bloccata: lo scheduler degli slot non arma il sensore e la
+ * finestra delle trame resta a questo task. Mentre il nodo trasmette il
+ * sensore vedrebbe solo la propria lampada e non viene letto.
+ */
+static void optical_disc_task(void *arg)
+{
+    while (optical_disc_active) {
+        vTaskDelay(pdMS_TO_TICKS(ECL_OPTICAL_DISC_TICK_MS));
+
+        optical_disc_capture_t capture = { .payload = LIGHT_FRAME_ID_NONE };
+        if (pwm_get_id_role() == ROLE_ID_RECEIVER) {
+            light_frame_t frame;
+
+            light_code_reset_queue();
+            // Almeno la finestra delle trame: la ISR si disarma da sola alla scadenza
+            vTaskDelay(pdMS_TO_TICKS(LIGHT_CODE_FRAME_WINDOW_US / 1000) + 2);
+            light_code_pickup();
+
+            capture.captured = true;
+            if (light_code_get_frame(&frame)) {
+                capture.payload = frame.payload;
+                capture.confidence = frame.confidence;
+            }
+        }
+
+        scheduler_put_event(&capture, sizeof(capture), SCH_EVT_OPTICAL_DISCOVERY, optical_disc_tick_handler);
+    }
+
+    optical_disc_task_handle = NULL;
+    vTaskDelete(NULL);
+}
+
+/**
+ * @brief Blocca l'uscita e avvia le acquisizioni se la scoperta è in corso
+ */
+static void optical_disc_run(void)
+{
+    if (optical_disc.state != OPTICAL_DISCOVERY_RUNNING || optical_disc_active) return;
+
+    pwm_set_device_code(optical_disc.self);
+    pwm_hold_level((int16_t)pwmcontroller_get_current_level());
+
+    optical_disc_active = true;
+    if (optical_disc_task_handle == NULL &&
+        xTaskCreate(optical_disc_task, "optical_disc", 3072, NULL, 5, &optical_disc_task_handle) != pdPASS) {
+        ESP_LOGE(TAG, "❌ Creazione task scoperta ottica fallita");
+        optical_disc_task_handle = NULL;
+        optical_disc_active = false;
+        pwm_set_id_role(ROLE_ID_RECEIVER);
+        pwm_hold_level(-1);
+    }
+}
+
+/**
+ * @brief Gettone ricevuto da un nodo della stanza
+ */
+static void optical_disc_token_handler(void *p_event_data, uint16_t event_size)
+{
+    const ecl_optical_token_t *msg = (const ecl_optical_token_t *)p_event_data;
+    uint16_t members[OPTICAL_DISCOVERY_MAX_MEMBERS];
+
+    if (event_size != sizeof(ecl_optical_token_t) || commissioning_is_running() ||
+        room_matrix.state == ROOM_MATRIX_RUNNING) {
+        return;
+    }
+
+    // Membri copiati fuori dalla struttura packed (allineamento)
+    memcpy(members, msg->members, sizeof(members));
+
+    optical_disc_prepare();
+    uint8_t actions = optical_discovery_on_token(&optical_disc, msg->session, members, msg->count,
+                                                 msg->index, room_matrix_now_ms());
+    optical_disc_run();
+    optical_disc_apply(actions);
+}
+
+/**
+ * @brief Avvia la scoperta come promotore con i vicini noti
+ * @param p_event_data: uint8_t, 1 se la tabella va inviata al gateway
+ */
+static void optical_disc_start_handler(void *p_event_data, uint16_t event_size)
+{
+    bool reply = (event_size == sizeof(uint8_t)) && *(uint8_t *)p_event_data;
+    uint16_t members[OPTICAL_DISCOVERY_MAX_MEMBERS];
+
+    optical_disc_prepare();
+
+    if (optical_disc.state == OPTICAL_DISCOVERY_RUNNING || commissioning_is_running() ||
+        room_matrix.state == ROOM_MATRIX_RUNNING) {
+        ESP_LOGW(TAG, "⚠️ Scoperta ottica: scoperta, matrice o commissioning già in corso");
+    } else {
+        uint8_t count = ecolumiere_get_room_members(optical_disc.self, members, OPTICAL_DISCOVERY_MAX_MEMBERS);
+        uint8_t session = (uint8_t)((esp_timer_get_time() >> 10) ^ optical_disc.self);
+
+        if (optical_discovery_start(&optical_disc, members, count, session, room_matrix_now_ms())) {
+            ESP_LOGI(TAG, "🔦 Scoperta ottica avviata: %u nodi, %u s stimati", count,
+                     count * OPTICAL_DISCOVERY_STEP_MS / 1000);
+            optical_disc_reply = reply;
+            optical_disc_run();
+            optical_disc_apply(OPTICAL_DISCOVERY_ACT_ROLE | OPTICAL_DISCOVERY_ACT_SEND);
+        }
+    }
+
+    if (reply) {
+        optical_disc_send_status(&optical_disc_ctx);
+    }
+}
+
+/**
+ * @brief Gestisce i gettoni della scoperta dei nodi della stanza
+ */
+static void optical_disc_handle_token(esp_ble_mesh_model_cb_param_t *param)
+{
+    const ecl_optical_token_t *msg = (const ecl_optical_token_t *)param->model_operation.msg;
+    uint16_t src = param->model_operation.ctx->addr;
+
+    // Scarta i propri gettoni e quelli di altre stanze
+    if (src == slave_node_get_unicast_addr() || msg->room_group != lux_share_room_group() ||
+        msg->count == 0 || msg->count > OPTICAL_DISCOVERY_MAX_MEMBERS) {
+        return;
+    }
+
+    ecl_optical_token_t token;
+    memcpy(&token, msg, sizeof(token));
+    scheduler_put_event(&token, sizeof(token), SCH_EVT_OPTICAL_DISCOVERY, optical_disc_token_handler);
+}
+
+/**
+ * @brief Gestisce una richiesta del gateway sui vicini ottici
+ *
+ * START rende il nodo promotore: risponde subito con lo stato e invia la
+ * propria tabella a fine scoperta. Le tabelle degli altri nodi si leggono
+ * con GET: insieme danno il grafo di adiacenza ottica della stanza.
+ */
+static void optical_disc_handle_msg(esp_ble_mesh_model_cb_param_t *param)
+{
+    uint8_t action = param->model_operation.msg[0];
+
+    if (action == ECL_OPTICAL_DISC_START) {
+        uint8_t reply = 1;
+        optical_disc_ctx = *param->model_operation.ctx;
+        scheduler_put_event(&reply, sizeof(reply), SCH_EVT_OPTICAL_DISCOVERY, optical_disc_start_handler);
+    } else if (action == ECL_OPTICAL_DISC_GET) {
+        optical_disc_send_status(param->model_operation.ctx);
+    }
+}
+
+/**
+ * @brief Avvia la scoperta dei vicini ottici da questo nodo
+ */
+esp_err_t ble_mesh_ecolumiere_optical_discovery_start(void)
+{
+    uint8_t reply = 0;
+
+    if (!esp_ble_mesh_node_is_provisioned()) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    return scheduler_put_event(&reply, sizeof(reply), SCH_EVT_OPTICAL_DISCOVERY, optical_disc_start_handler);
+}
+
+/**
+ * @brief Copia la fotografia dei sensori nei buffer del Sensor Server
  * 
- * Questa funzione riempie i buffer dei dati dei sensori con i valori
- * delle variabili statiche definite all'inizio del file.
+ * I buffer vengono riscritti solo quando la scansione ADC ha pubblicato una
+ * fotografia nuova; prima della prima pubblicazione la temperatura è
+ * "sconosciuta" e il codice errore segnala l'assenza di dati.
  */
-static void sensor_data_initialize(void)
+void ble_mesh_ecolumiere_update_sensor_data(void)
 {
-    // Temperatura (1 byte)
-    net_buf_simple_add_u8(&sensor_data_0, indoor_temp);
+    analog_snapshot_t snapshot;
+    uint32_t seq = luxmeter_get_snapshot(&snapshot);
+
+    if (seq == sensor_snapshot_seq && sensor_data_0.len > 0) {
+        return;
+    }
+    sensor_snapshot_seq = seq;
+
+    net_buf_simple_reset(&sensor_data_0);
+    net_buf_simple_reset(&sensor_data_1);
+    net_buf_simple_reset(&sensor_data_2);
+    net_buf_simple_reset(&sensor_data_3);
+    net_buf_simple_reset(&sensor_data_4);
+    net_buf_simple_reset(&sensor_data_5);
+    net_buf_simple_reset(&sensor_data_6);
+    net_buf_simple_reset(&sensor_data_7);
+
+    // Temperatura (1 byte, risoluzione 0.5 °C)
+    net_buf_simple_add_u8(&sensor_data_0, (uint8_t)snapshot.temp_half_c);
     
-    // Potenza istantanea (2 byte, little-endian)
-    net_buf_simple_add_le16(&sensor_data_1, potenza_istantanea_assorbita);
+    // Potenza istantanea (2 byte, little-endian, risoluzione 0.01 W)
+    net_buf_simple_add_le16(&sensor_data_1, snapshot.power_cw);
     
     // Umidità (2 byte, little-endian)
     net_buf_simple_add_le16(&sensor_data_2, humidity_sensor);
@@ -436,17 +1291,25 @@ static void sensor_data_initialize(void)
     // Pressione (2 byte, little-endian)
     net_buf_simple_add_le16(&sensor_data_3, pressure_sensor);
     
-    // Codice errore (1 byte)
-    net_buf_simple_add_u8(&sensor_data_4, error_code);
+    // Codice errore (1 byte, bit ANALOG_FAULT_*)
+    net_buf_simple_add_u8(&sensor_data_4, snapshot.faults);
     
-    // Illuminamento (4 byte, little-endian)
-    net_buf_simple_add_le32(&sensor_data_5, illuminance_sensor);
+    // Illuminamento (2 byte come lo stato del sensore, saturato)
+    net_buf_simple_add_le16(&sensor_data_5, snapshot.lux > UINT16_MAX ? UINT16_MAX : (uint16_t)snapshot.lux);
     
     // Tensione (2 byte, little-endian)
-    net_buf_simple_add_le16(&sensor_data_6, voltage_sensor);
+    net_buf_simple_add_le16(&sensor_data_6, snapshot.voltage_cv);
     
     // Corrente (2 byte, little-endian)
-    net_buf_simple_add_le16(&sensor_data_7, current_sensor);
+    net_buf_simple_add_le16(&sensor_data_7, snapshot.current_ca);
+}
+
+/**
+ * @brief Inizializza i dati dei sensori al termine del provisioning
+ */
+static void sensor_data_initialize(void)
+{
+    ble_mesh_ecolumiere_update_sensor_data();
 
 // ?? CODICE COMMENTATO DA VERIFICARE/COMPLETARE:
 // Questo codice tenta di ri-abilitare esplicitamente il relay dopo il provisioning,
@@ -479,6 +1342,9 @@ static void prov_complete(uint16_t net_idx, uint16_t addr, uint8_t flags, uint32
 {
     ESP_LOGI(TAG, "net_idx 0x%03x, addr 0x%04x", net_idx, addr);
     ESP_LOGI(TAG, "flags 0x%02x, iv_index 0x%08" PRIx32, flags, iv_index);
+
+    // Rete usata per la condivisione lux nella stanza
+    lux_share_net_idx = net_idx;
     
     // Spegne LED verde (indicatore di provisioning in corso)
     board_led_operation(LED_G, LED_OFF);
@@ -486,6 +1352,9 @@ static void prov_complete(uint16_t net_idx, uint16_t addr, uint8_t flags, uint32
     // Notifica al modulo slave che il provisioning è completato
     slave_node_on_provisioned(addr);
 
+    // Regolazione a turno con le altre lampade della stanza
+    control_phase_update();
+
     // Avvia l'acquisizione del luxmeter (sensore di luminosità)
     luxmeter_start_acquisition();
 
@@ -581,6 +1450,12 @@ static void example_ble_mesh_config_server_cb(esp_ble_mesh_cfg_server_cb_event_t
                 param->value.state_change.mod_app_bind.app_idx,
                 param->value.state_change.mod_app_bind.company_id,
                 param->value.state_change.mod_app_bind.model_id);
+
+            // AppKey del modello vendor: usata per le misure condivise nella stanza
+            if (param->value.state_change.mod_app_bind.company_id == CID_ESP &&
+                param->value.state_change.mod_app_bind.model_id == ESP_BLE_MESH_VND_MODEL_ID_SERVER) {
+                lux_share_app_idx = param->value.state_change.mod_app_bind.app_idx;
+            }
             break;
             
         case ESP_BLE_MESH_MODEL_OP_MODEL_SUB_ADD: // Aggiunge modello alla lista di ascolto di un gruppo
@@ -611,7 +1486,47 @@ static void example_ble_mesh_custom_model_cb(esp_ble_mesh_model_cb_event_t event
                                              esp_ble_mesh_model_cb_param_t *param)
 {
     switch (event) {
-    // Ricevuto messaggio destinato a un modello
+    case ESP_BLE_MESH_MODEL_OPERATION_EVT:  // Ricevuto messaggio destinato a un modello
+
+    // Misure lux condivise da un nodo della stessa stanza
+    if (param->model_operation.opcode == ESP_BLE_MESH_VND_MODEL_OP_LUX_SHARE) {
+        lux_share_handle_msg(param);
+        break;
+    }
+
+    // Commissioning richiesto dal gateway
+    if (param->model_operation.opcode == ESP_BLE_MESH_VND_MODEL_OP_COMMISSION) {
+        commission_handle_msg(param);
+        break;
+    }
+
+    // Matrice di stanza: gettoni fra i nodi e richieste del gateway
+    if (param->model_operation.opcode == ESP_BLE_MESH_VND_MODEL_OP_ROOM_TOKEN) {
+        room_matrix_handle_token(param);
+        break;
+    }
+
+    if (param->model_operation.opcode == ESP_BLE_MESH_VND_MODEL_OP_ROOM_MATRIX) {
+        room_matrix_handle_msg(param);
+        break;
+    }
+
+    // Calibrazione degli offset del luxmeter richiesta dal gateway
+    if (param->model_operation.opcode == ESP_BLE_MESH_VND_MODEL_OP_OFFSET_CAL) {
+        offset_cal_handle_msg(param);
+        break;
+    }
+
+    // Scoperta dei vicini ottici: gettoni fra i nodi e richieste del gateway
+    if (param->model_operation.opcode == ESP_BLE_MESH_VND_MODEL_OP_OPTICAL_TOKEN) {
+        optical_disc_handle_token(param);
+        break;
+    }
+
+    if (param->model_operation.opcode == ESP_BLE_MESH_VND_MODEL_OP_OPTICAL_DISC) {
+        optical_disc_handle_msg(param);
+        break;
+    }
 
     // Verifica se è un messaggio per il nostro modello vendor personalizzato
     if (param->model_operation.opcode == ESP_BLE_MESH_VND_MODEL_OP_SEND) {
@@ -646,6 +1561,7 @@ static void example_ble_mesh_custom_model_cb(esp_ble_mesh_model_cb_event_t event
                     .hue = 0,
                     .saturation = 0,
                     .is_override = true,
+                    .transition_ms = PWM_FADE_DEFAULT_MS,
                     .timestamp = esp_timer_get_time()
                 };
 
@@ -765,6 +1681,9 @@ static void example_ble_mesh_send_sensor_status(esp_ble_mesh_sensor_server_cb_pa
     esp_err_t err;
     int i;
 
+    // Valori dell'ultima fotografia della scansione ADC
+    ble_mesh_ecolumiere_update_sensor_data();
+
     // Calcola dimensione totale necessaria per tutti i dati dei sensori
     for (i = 0; i < ARRAY_SIZE(sensor_states); i++) {
         esp_ble_mesh_sensor_state_t *state = &sensor_states[i];
@@ -891,59 +1810,76 @@ static uint8_t convert_lightness_to_pwm(uint16_t lightness)
     return (uint8_t)pwm_level;
 }
 
+/**
+ * @brief Converte un Transition Time BLE Mesh in millisecondi
+ *
+ * @param trans_time Bit 0-5 numero di passi, bit 6-7 risoluzione (100 ms, 1 s, 10 s, 10 min)
+ * @return uint32_t Durata in ms (PWM_FADE_DEFAULT_MS se il valore è sconosciuto)
+ */
+static uint32_t transition_time_to_ms(uint8_t trans_time)
+{
+    static const uint32_t resolution_ms[4] = { 100, 1000, 10000, 600000 };
+    uint8_t steps = trans_time & 0x3F;
+
+    if (steps == 0x3F) {
+        return PWM_FADE_DEFAULT_MS;
+    }
+
+    return steps * resolution_ms[trans_time >> 6];
+}
+
+/**
+ * @brief Invia lo stato HSL con la luminosità corrente dell'uscita
+ *
+ * @param remaining_time Transition Time residuo (0 = campo omesso)
+ */
+static void send_hsl_status(esp_ble_mesh_model_t *model, esp_ble_mesh_msg_ctx_t *ctx,
+                            uint8_t remaining_time)
+{
+    // Legge livello PWM corrente dall'hardware
+    uint16_t current_pwm_level = pwmcontroller_get_current_level();
+
+    // Converte PWM in lightness percentuale (0-100%)
+    uint16_t current_lightness = (current_pwm_level * 100) / LIGHT_MAX_LEVEL;
+
+    // Struttura dati per lo status response
+    struct __attribute__((packed)) {
+        uint16_t lightness;
+        uint16_t hue;
+        uint16_t saturation;
+        uint8_t remaining_time;
+    } status = {
+        current_lightness,
+        hsl_state.hue,
+        hsl_state.saturation,
+        remaining_time
+    };
+
+    // Invia risposta di status
+    esp_ble_mesh_server_model_send_msg(
+        model,
+        ctx,
+        ESP_BLE_MESH_MODEL_OP_LIGHT_HSL_STATUS,
+        remaining_time ? sizeof(status) : sizeof(status) - 1,
+        (uint8_t *)&status
+    );
+
+    ESP_LOGI(TAG, "📤 BLE Status Sent: %u/100 (from PWM: %u/32)",
+        current_lightness, current_pwm_level);
+}
+
 /**
  * @brief Callback per eventi del Lighting Server (HSL)
  * 
  * Gestisce tutte le operazioni sul modello HSL:
- * - SET/GET di hue, saturation, lightness
- * - Transizioni di stato
+ * - SET di hue, saturation, lightness con Transition Time e Delay (RSP_BY_APP:
+ *   nessun STATE_CHANGE, il fade LEDC esegue la transizione)
+ * - GET dello stato corrente
  */
 static void example_ble_mesh_light_server_cb(esp_ble_mesh_lighting_server_cb_event_t event,
                                              esp_ble_mesh_lighting_server_cb_param_t *param)
 {
     switch (event) {
-    case ESP_BLE_MESH_LIGHTING_SERVER_STATE_CHANGE_EVT: // Stato HSL cambiato (dopo transizione)
-        if (param->ctx.recv_op == ESP_BLE_MESH_MODEL_OP_LIGHT_HSL_SET) {
-            uint16_t hue = hsl_state.hue;
-            uint16_t sat = hsl_state.saturation;
-            uint16_t lightness = hsl_state.lightness;  // ✅ già 0-100
-
-            ESP_LOGI(TAG, "🎨 HSL Received: H:%u S:%u L:%u", hue, sat, lightness);
-
-            // Converte lightness in livello PWM
-            uint8_t pwm_level = convert_lightness_to_pwm(lightness);
-
-            ESP_LOGI(TAG, "🎛️ BLE HSL → PWM: %u → %u/32", lightness, pwm_level);
-
-            // Crea evento per lo scheduler
-            ble_mesh_event_t mesh_event = {
-                .brightness = lightness,
-                .pwm_level = pwm_level,
-                .hue = hue,
-                .saturation = sat,
-                .is_override = true,
-                .timestamp = esp_timer_get_time()
-            };
-
-            // Invia allo scheduler per elaborazione asincrona
-            esp_err_t sched_err = scheduler_put_event(&mesh_event, sizeof(mesh_event),
-                                                     SCH_EVT_BLE_MESH_RX, handle_ble_mesh_event);
-
-            if (sched_err == ESP_OK) { // Controllo del successo dell'invio
-                ESP_LOGI(TAG, "📨 HSL Event queued to scheduler");
-            } else {
-                ESP_LOGE(TAG, "❌ Failed to queue HSL event");
-            }
-
-            // Feedback LED immediato
-            if (pwm_level > 0) {
-                board_led_operation(LED_R, LED_ON);
-            } else {
-                board_led_operation(LED_R, LED_OFF);
-            }
-        }
-        break;
-
     case ESP_BLE_MESH_LIGHTING_SERVER_RECV_SET_MSG_EVT: // Ricevuto messaggio SET (con o senza ack)
         if (param->ctx.recv_op == ESP_BLE_MESH_MODEL_OP_LIGHT_HSL_SET ||
             param->ctx.recv_op == ESP_BLE_MESH_MODEL_OP_LIGHT_HSL_SET_UNACK) {
@@ -962,19 +1898,44 @@ static void example_ble_mesh_light_server_cb(esp_ble_mesh_lighting_server_cb_eve
             hsl_state.target_saturation = sat;
             hsl_state.target_lightness = lightness;
 
-            ESP_LOGI(TAG, "HSL Set: H:%u S:%u L:%u", hue, sat, lightness);
+            // Transizione del messaggio (campi opzionali) o durata di default
+            uint32_t transition_ms = PWM_FADE_DEFAULT_MS;
+            uint32_t delay_ms = 0;
+            uint8_t remaining_time = 0;
+            if (param->value.set.hsl.op_en) {
+                transition_ms = transition_time_to_ms(param->value.set.hsl.trans_time);
+                delay_ms = param->value.set.hsl.delay * 5;  // Passi da 5 ms
+                remaining_time = param->value.set.hsl.trans_time;
+            }
+
+            ESP_LOGI(TAG, "HSL Set: H:%u S:%u L:%u, transizione %lu ms (ritardo %lu ms)",
+                     hue, sat, lightness, transition_ms, delay_ms);
 
-            // Converte in PWM e aggiorna hardware
+            // Converte in PWM: override e fade passano dallo scheduler
             uint8_t pwm_level = convert_lightness_to_pwm(lightness);
-            pwmcontroller_set_level(pwm_level);
 
             ESP_LOGI(TAG, "🎛️ BLE Set → PWM: %u → %u/32", lightness, pwm_level);
 
-            // ?? Aggiorna lampadina fisica
-            // board_set_led_hsl(hue, sat, lightness);
+            ble_mesh_event_t mesh_event = {
+                .brightness = lightness,
+                .pwm_level = pwm_level,
+                .hue = hue,
+                .saturation = sat,
+                .is_override = true,
+                .transition_ms = transition_ms,
+                .delay_ms = delay_ms,
+                .timestamp = esp_timer_get_time()
+            };
+
+            if (scheduler_put_event(&mesh_event, sizeof(mesh_event),
+                                    SCH_EVT_BLE_MESH_RX, handle_ble_mesh_event) != ESP_OK) {
+                ESP_LOGE(TAG, "❌ Failed to queue HSL event");
+            }
 
-            // Sincronizza lo stato del nodo lampada con i nuovi valori HSL
-            sync_nodo_lampada_with_hsl(hue, sat, lightness);
+            // Risposta dello stato per il SET con ack
+            if (param->ctx.recv_op == ESP_BLE_MESH_MODEL_OP_LIGHT_HSL_SET) {
+                send_hsl_status(param->model, &param->ctx, remaining_time);
+            }
 
             // Controllo LED fisico
             if (pwm_level > 0) {
@@ -989,35 +1950,7 @@ static void example_ble_mesh_light_server_cb(esp_ble_mesh_lighting_server_cb_eve
 
     case ESP_BLE_MESH_LIGHTING_SERVER_RECV_GET_MSG_EVT: // Ricevuta richiesta GET per stato HSL
         if (param->ctx.recv_op == ESP_BLE_MESH_MODEL_OP_LIGHT_HSL_GET) {
-
-            // Legge livello PWM corrente dall'hardware
-            uint16_t current_pwm_level = pwmcontroller_get_current_level();
-
-            // Converte PWM in lightness percentuale (0-100%)
-            uint16_t current_lightness = (current_pwm_level * 100) / LIGHT_MAX_LEVEL;
-
-            // Struttura dati per lo status response
-            struct __attribute__((packed)) {
-                uint16_t lightness;
-                uint16_t hue;
-                uint16_t saturation;
-            } status = {
-                current_lightness,
-                hsl_state.hue,
-                hsl_state.saturation
-            };
-
-            // Invia risposta di status
-            esp_ble_mesh_server_model_send_msg(
-                param->model,
-                &param->ctx,
-                ESP_BLE_MESH_MODEL_OP_LIGHT_HSL_STATUS,
-                sizeof(status),
-                (uint8_t *)&status
-            );
-
-            ESP_LOGI(TAG, "📤 BLE Status Sent: %u/100 (from PWM: %u/32)",
-                current_lightness, current_pwm_level);
+            send_hsl_status(param->model, &param->ctx, 0);
         }
         break;
 
@@ -1078,6 +2011,9 @@ esp_err_t ble_mesh_ecolumiere_init(void)
 
     // Accende LED verde per indicare che il dispositivo è in attesa di provisioning
     board_led_operation(LED_G, LED_ON);
+
+    // Condivisione periodica delle misure con la stanza (attiva solo da provisionato)
+    lux_share_start();
     ESP_LOGI(TAG, "✅ BLE Mesh Ecolumiere initialized with global scheduler");
 
     return ESP_OK;
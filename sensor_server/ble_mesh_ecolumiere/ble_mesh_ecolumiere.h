@@ -8,6 +8,9 @@
 #define BLE_MESH_ECOLUMIERE_H
 
 #include "esp_ble_mesh_defs.h"
+#include "room_matrix.h"
+#include "optical_discovery.h"
+#include "luxmeter.h"
 
 /* Sensor Property ID */
 #define SENSOR_PROPERTY_ID_0        0x0056  /* Temperatura */
@@ -29,6 +32,22 @@
 
 #define ESP_BLE_MESH_VND_MODEL_OP_SEND      ESP_BLE_MESH_MODEL_OP_3(0x00, CID_ESP)
 #define ESP_BLE_MESH_VND_MODEL_OP_STATUS    ESP_BLE_MESH_MODEL_OP_3(0x01, CID_ESP)
+#define ESP_BLE_MESH_VND_MODEL_OP_LUX_SHARE ESP_BLE_MESH_MODEL_OP_3(0x02, CID_ESP)
+#define ESP_BLE_MESH_VND_MODEL_OP_COMMISSION        ESP_BLE_MESH_MODEL_OP_3(0x03, CID_ESP)
+#define ESP_BLE_MESH_VND_MODEL_OP_COMMISSION_STATUS ESP_BLE_MESH_MODEL_OP_3(0x04, CID_ESP)
+#define ESP_BLE_MESH_VND_MODEL_OP_ROOM_TOKEN         ESP_BLE_MESH_MODEL_OP_3(0x05, CID_ESP)
+#define ESP_BLE_MESH_VND_MODEL_OP_ROOM_MATRIX        ESP_BLE_MESH_MODEL_OP_3(0x06, CID_ESP)
+#define ESP_BLE_MESH_VND_MODEL_OP_ROOM_MATRIX_STATUS ESP_BLE_MESH_MODEL_OP_3(0x07, CID_ESP)
+#define ESP_BLE_MESH_VND_MODEL_OP_OFFSET_CAL         ESP_BLE_MESH_MODEL_OP_3(0x08, CID_ESP)
+#define ESP_BLE_MESH_VND_MODEL_OP_OFFSET_CAL_STATUS  ESP_BLE_MESH_MODEL_OP_3(0x09, CID_ESP)
+#define ESP_BLE_MESH_VND_MODEL_OP_OPTICAL_TOKEN      ESP_BLE_MESH_MODEL_OP_3(0x0A, CID_ESP)
+#define ESP_BLE_MESH_VND_MODEL_OP_OPTICAL_DISC       ESP_BLE_MESH_MODEL_OP_3(0x0B, CID_ESP)
+#define ESP_BLE_MESH_VND_MODEL_OP_OPTICAL_DISC_STATUS ESP_BLE_MESH_MODEL_OP_3(0x0C, CID_ESP)
+
+/* Condivisione lux nella stanza */
+#define ECL_ROOM_GROUP_BASE         0xC000  /* Gruppo stanza: 0xC000 | piano << 8 | stanza */
+#define ECL_LUX_SHARE_PERIOD_MS     30000   /* Periodo di pubblicazione delle misure */
+#define ECL_LUX_SHARE_JITTER_MS     250     /* Sfasamento per nodo (da indirizzo unicast) */
 
 
 
@@ -42,6 +61,82 @@ typedef struct {
  int32_t off_delay;
 } configdata_t;
 
+// Misure filtrate condivise con i nodi della stessa stanza
+typedef struct __attribute__((packed)) {
+ uint16_t room_group;   // Gruppo stanza del mittente
+ uint16_t natural_lux;  // Luce naturale filtrata (saturata a 0xFFFF)
+ uint16_t env_lux;      // Luce ambiente filtrata (saturata a 0xFFFF)
+} ecl_lux_share_t;
+
+// Richiesta di commissioning (scansione della risposta della lampada)
+#define ECL_COMMISSION_START        0x01
+#define ECL_COMMISSION_GET          0x02
+
+// Esito del commissioning inviato al richiedente
+typedef struct __attribute__((packed)) {
+ uint8_t status;         // commissioning_status_t, 0xFF = avviato/mai eseguito
+ uint16_t gain_x100;     // Lux per livello x 100
+ uint16_t distance_mm;   // Distanza efficace scritta in configurazione
+ uint16_t rms_x10;       // Residuo della retta (lux x 10)
+ uint16_t rms_prior_x10; // Residuo con la configurazione precedente (lux x 10)
+ uint16_t duration_ds;   // Durata della scansione (decimi di secondo)
+} ecl_commission_status_t;
+
+// Richiesta di misura della matrice di stanza
+#define ECL_ROOM_MATRIX_START       0x01
+#define ECL_ROOM_MATRIX_GET         0x02
+#define ECL_ROOM_MATRIX_TICK_MS     500     /* Periodo delle letture durante la misura */
+
+// Gettone passato fra i nodi della stanza durante la misura
+typedef struct __attribute__((packed)) {
+ uint16_t room_group;   // Gruppo stanza del mittente
+ uint8_t session;       // Sessione di misura
+ uint8_t index;         // Passo (ROOM_MATRIX_INDEX_BASELINE = buio iniziale)
+ uint8_t count;         // Numero di membri
+ uint16_t lit_ms;       // Durata di accensione della lampada del passo precedente
+ uint16_t members[ROOM_MATRIX_MAX_MEMBERS]; // Indirizzi dei membri
+} ecl_room_token_t;
+
+// Riga della matrice inviata al gateway
+typedef struct __attribute__((packed)) {
+ uint8_t state;          // room_matrix_state_t del nodo
+ room_matrix_row_t row;  // Ultima riga valida (count = 0 se assente)
+} ecl_room_matrix_status_t;
+
+// Richiesta di calibrazione degli offset del luxmeter
+#define ECL_OFFSET_CAL_START        0x01
+#define ECL_OFFSET_CAL_GET          0x02
+
+// Tabella di compensazione in uso e esito dell'ultima calibrazione
+typedef struct __attribute__((packed)) {
+ uint8_t status;          // offset_cal_status_t, 0xFF = avviata/mai eseguita
+ uint8_t calibrated;      // 1 = tabella del dispositivo, 0 = offset_map di fabbrica
+ uint16_t gain_x100;      // Lux per livello della retta di riferimento x 100
+ uint16_t rms_x100;       // Scarto dalla retta con la nuova tabella (lux x 100)
+ uint16_t rms_prior_x100; // Scarto con la tabella precedente (lux x 100)
+ int16_t offset[LUXMETER_OFFSET_LEVELS]; // Tabella in uso (lux)
+} ecl_offset_cal_status_t;
+
+// Richiesta di scoperta dei vicini ottici
+#define ECL_OPTICAL_DISC_START      0x01
+#define ECL_OPTICAL_DISC_GET        0x02
+#define ECL_OPTICAL_DISC_TICK_MS    500     /* Periodo delle acquisizioni durante la scoperta */
+
+// Gettone passato fra i nodi della stanza durante la scoperta
+typedef struct __attribute__((packed)) {
+ uint16_t room_group;   // Gruppo stanza del mittente
+ uint8_t session;       // Sessione di scoperta
+ uint8_t index;         // Passo: trasmette members[index], count = fine
+ uint8_t count;         // Numero di membri
+ uint16_t members[OPTICAL_DISCOVERY_MAX_MEMBERS]; // Indirizzi dei membri
+} ecl_optical_token_t;
+
+// Tabella dei vicini ottici inviata al gateway
+typedef struct __attribute__((packed)) {
+ uint8_t state;                     // optical_discovery_state_t del nodo
+ optical_discovery_table_t table;   // Ultima scoperta (count = 0 se mai eseguita)
+} ecl_optical_disc_status_t;
+
 /**
  * @brief Inizializza BLE Mesh per sistema Ecolumiere
  * @return esp_err_t
@@ -56,9 +151,29 @@ void ble_mesh_ecolumiere_get_dev_uuid(uint8_t *uuid);
 
 /**
  * @brief Aggiorna dati sensori in tempo reale
+ * @desc Copia nei buffer del Sensor Server l'ultima fotografia della
+ *       scansione ADC, se ne è stata pubblicata una nuova.
  */
 void ble_mesh_ecolumiere_update_sensor_data(void);
 
+/**
+ * @brief Avvia la misura della matrice di stanza con questo nodo come promotore
+ * @desc Ogni nodo della stanza accende a turno la propria lampada e salva in
+ *       NVS la riga dei contributi misurati dal proprio sensore.
+ * @return ESP_ERR_INVALID_STATE se il nodo non è provisionato
+ */
+esp_err_t ble_mesh_ecolumiere_room_matrix_start(void);
+
+/**
+ * @brief Avvia la scoperta dei vicini ottici con questo nodo come promotore
+ * @desc Ogni nodo della stanza trasmette a turno in luce il proprio indirizzo
+ *       mentre gli altri decodificano; ogni nodo tiene la tabella dei membri
+ *       che il proprio sensore vede, letta dal gateway con
+ *       ESP_BLE_MESH_VND_MODEL_OP_OPTICAL_DISC.
+ * @return ESP_ERR_INVALID_STATE se il nodo non è provisionato
+ */
+esp_err_t ble_mesh_ecolumiere_optical_discovery_start(void);
+
 
 void sync_nodo_lampada_with_hsl(uint16_t hue, uint16_t saturation, uint16_t lightness);
 
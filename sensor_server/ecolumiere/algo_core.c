@@ -0,0 +1,113 @@
+/**
+ * Autore: DJITSOP FUOGOUK LOIC STEVE
+ * Firmware: ECOLUMIERE BLE MESH ESP32
+ * Implementazione: Algo Core - Passo di controllo dell'algoritmo Nordic
+ */
+
+#include "algo_core.h"
+#include "config.h"
+
+/************************************************
+ * PUBLIC FUNCTIONS IMPLEMENTATION              *
+ ************************************************/
+
+bool algo_core_measure_push(measure_avg_t *avg, uint32_t sample)
+{
+    avg->sum += sample;
+    if (++avg->count < avg->size) {
+        return false;
+    }
+
+    avg->measure = avg->sum / avg->size;
+    avg->sum = 0;
+    avg->count = 0;
+    return true;
+}
+
+bool algo_core_avg_add(algo_avg_t *avg, uint32_t natural, uint32_t env)
+{
+    avg->natural_sum += natural;
+    avg->env_sum += env;
+    return ++avg->count >= avg->size;
+}
+
+/**
+ * @brief Medie dell'algoritmo (ecolumiuere_avg_calulator originale)
+ */
+void algo_core_avg_compute(algo_avg_t *avg, const algo_data_t *data, uint8_t divider)
+{
+    avg->enatural = (float)(avg->natural_sum / divider) / data->transparency;
+
+    if (data->in_pl == 2) {
+        avg->eenv = (float)(avg->env_sum / divider) / ((data->distance * data->distance) * data->transparency);
+    } else {
+        avg->eenv = (float)(avg->env_sum / divider) * ((data->distance * data->distance) / data->transparency);
+    }
+
+    #if defined SUSPEND_DEVICE_ID_NATURAL_SLOTS
+    avg->enatural = avg->eenv;
+    #endif
+
+    avg->count = 0;
+    avg->natural_sum = 0;
+    avg->env_sum = 0;
+}
+
+void algo_core_avg_load(algo_data_t *data, const algo_avg_t *avg)
+{
+    data->enatural = avg->enatural;
+    data->eenv = avg->eenv;
+
+    if (data->eenv < data->enatural) {
+        data->eenv = data->enatural;
+    }
+}
+
+/**
+ * @brief Esegue un passo di controllo (modello fisico ORIGINALE Nordic)
+ */
+void algo_core_step(algo_data_t *data)
+{
+    // A. Limite minimo
+    data->emin = data->perc_min * data->emax;
+
+    // B. Lux attuali prodotti dalla lampada
+    data->elamp = ((float)data->pnew * data->power_efficiency * data->transparency) /
+                  (data->distance * data->distance);
+
+    // C. Calcola variazione necessaria (formula ORIGINALE Nordic)
+    #if defined SUSPEND_DEVICE_ID_NATURAL_SLOTS
+    if (data->eenv) {
+        data->variation = (float)(data->target_lux - (data->elamp + data->eenv)) *
+                          ((data->eenv / (float)data->target_lux) * data->dimm_step);
+    } else {
+        data->variation = (float)(data->target_lux - (data->elamp + data->eenv)) *
+                          (data->dimm_step);
+    }
+    #else
+    if (data->enatural) {
+        data->variation = (float)(data->target_lux - (data->elamp + data->eenv)) *
+                          ((data->enatural / (float)data->target_lux) * data->dimm_step);
+    } else {
+        data->variation = (float)(data->target_lux - (data->elamp + data->eenv)) *
+                          (data->dimm_step);
+    }
+    #endif
+
+    // D. Nuovi lux desiderati
+    data->enew = data->elamp + data->variation;
+
+    // Applica limite minimo
+    if (data->enew < data->emin) {
+        data->enew = data->emin;
+    }
+
+    // E. Converti lux → PWM (modello fisico inverso - ORIGINALE)
+    data->pnew = (data->enew * data->distance * data->distance) /
+                 (data->power_efficiency * data->transparency);
+
+    // F. Applica limite massimo
+    if (data->pnew > LIGHT_MAX_LEVEL) {
+        data->pnew = LIGHT_MAX_LEVEL;
+    }
+}
@@ -0,0 +1,112 @@
+/**
+ * Autore: DJITSOP FUOGOUK LOIC STEVE
+ * Firmware: ECOLUMIERE BLE MESH ESP32
+ * Modulo: Algo Core - Passo di controllo dell'algoritmo Nordic
+ * Descrizione: Modello fisico lampada/ambiente e catena delle medie
+ *              (finestre delle misure, medie dell'algoritmo, divisore
+ *              ALGO_AVG_LAST) senza dipendenze ESP-IDF, compilabile anche
+ *              sui tool di simulazione host
+ */
+
+#ifndef ALGO_CORE_H
+#define ALGO_CORE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @brief Stato completo dell'algoritmo di regolazione
+ * @field target_lux: Illuminamento desiderato
+ * @field perc_min: Frazione minima di emax sempre garantita
+ * @field distance: Distanza lampada/piano di lavoro (m)
+ * @field in_pl: Modalità di scala della luce ambiente (1 o 2)
+ * @field power_efficiency: Lux per livello PWM a 1 m
+ * @field transparency: Trasparenza dell'ottica
+ * @field dimm_step: Guadagno del passo di regolazione
+ * @field variation/elamp/enew/pnew/emin: Grandezze del passo di controllo
+ * @field emax: Lux massimi della lampada sul piano
+ * @field enatural/eenv: Medie di luce naturale e ambiente in ingresso
+ */
+typedef struct algo_data_t
+{
+  uint32_t target_lux;
+  float perc_min;
+  float distance;
+  uint32_t in_pl;
+  float power_efficiency;
+  float transparency;
+  float dimm_step;
+  float variation;
+  float elamp;
+  float emax;
+  float enew;
+  float pnew;
+  float emin;
+  float enatural;
+  float eenv;
+} algo_data_t;
+
+/**
+ * @brief Media a blocchi di una sorgente di luce (naturale o ambiente)
+ * @field sum/count: Accumulo della finestra in corso
+ * @field size: Campioni per finestra
+ * @field measure: Media dell'ultima finestra completa
+ */
+typedef struct measure_avg_t
+{
+  uint32_t sum;
+  uint8_t size;
+  uint8_t count;
+  int32_t measure;
+} measure_avg_t;
+
+/**
+ * @brief Media delle misure in ingresso all'algoritmo
+ * @field natural_sum/env_sum/count: Accumulo in corso
+ * @field size: Medie accumulate prima del calcolo
+ * @field enatural/eenv: Risultato dell'ultimo calcolo (lux sul piano)
+ */
+typedef struct algo_avg_t
+{
+  uint32_t natural_sum;
+  uint32_t env_sum;
+  uint8_t count;
+  uint8_t size;
+  float enatural;
+  float eenv;
+} algo_avg_t;
+
+/**
+ * @brief Aggiunge un campione alla finestra della sorgente
+ * @return true se la finestra si è chiusa e measure è stato aggiornato
+ */
+bool algo_core_measure_push(measure_avg_t *avg, uint32_t sample);
+
+/**
+ * @brief Accumula le medie delle sorgenti per l'algoritmo
+ * @return true se sono state accumulate almeno size medie
+ */
+bool algo_core_avg_add(algo_avg_t *avg, uint32_t natural, uint32_t env);
+
+/**
+ * @brief Calcola enatural/eenv dall'accumulo e lo azzera
+ * @desc Somme divise per divider (come ALGO_AVG_LAST Nordic, anche diverso
+ *       dal numero di medie accumulate), scalate con trasparenza, distanza e
+ *       in_pl di data.
+ */
+void algo_core_avg_compute(algo_avg_t *avg, const algo_data_t *data, uint8_t divider);
+
+/**
+ * @brief Copia le medie in ingresso all'algoritmo (eenv almeno enatural)
+ */
+void algo_core_avg_load(algo_data_t *data, const algo_avg_t *avg);
+
+/**
+ * @brief Esegue un passo di controllo (punti A-F dell'algoritmo Nordic)
+ * @desc Calcola emin, elamp, variation, enew e il nuovo livello pnew a partire
+ *       da enatural/eenv già mediati. pnew viene limitato a LIGHT_MAX_LEVEL.
+ * @param data: Stato algoritmo da aggiornare
+ */
+void algo_core_step(algo_data_t *data);
+
+#endif //ALGO_CORE_H
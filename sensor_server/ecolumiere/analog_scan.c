@@ -0,0 +1,194 @@
+/**
+ * Autore: DJITSOP FUOGOUK LOIC STEVE
+ * Firmware: ECOLUMIERE BLE MESH ESP32
+ * Implementazione: Analog Scan - Acquisizione multicanale e fotografia dei sensori
+ */
+
+#include "analog_scan.h"
+
+#include <string.h>
+#include <math.h>
+
+/************************************************
+ * PRIVATE DEFINES AND CONSTANTS               *
+ ************************************************/
+
+#define ANALOG_TEMP_UNKNOWN             INT8_MAX        // Temperature 8: 0x7F = valore sconosciuto
+
+static const uint8_t analog_ema_shift[ANALOG_CH_COUNT] = {
+  0, ANALOG_NTC_EMA_SHIFT, ANALOG_VSUPPLY_EMA_SHIFT, ANALOG_ILED_EMA_SHIFT
+};
+
+static const char *analog_channel_names[ANALOG_CH_COUNT] = {
+  "LUX", "NTC", "VSUPPLY", "ILED"
+};
+
+/************************************************
+ * PRIVATE FUNCTIONS IMPLEMENTATION           *
+ ************************************************/
+
+/**
+ * @brief Millivolt al pin dal codice ADC (retta nominale)
+ */
+static uint32_t analog_code_mv(uint16_t code)
+{
+  return ((uint32_t)code * ANALOG_SCAN_FULL_SCALE_MV + ANALOG_SCAN_MAX_CODE / 2) / ANALOG_SCAN_MAX_CODE;
+}
+
+/**
+ * @brief Passo del filtro esponenziale di un canale
+ * @return Codice filtrato arrotondato
+ */
+static uint16_t analog_filter(analog_scan_t *scan, analog_channel_t ch, uint16_t mean)
+{
+  int32_t target = (int32_t)mean << ANALOG_SCAN_EMA_FRAC;
+
+  if (!(scan->primed & (1u << ch))) {
+    scan->ema[ch] = (uint32_t)target;
+    scan->primed |= (uint8_t)(1u << ch);
+  } else {
+    int32_t state = (int32_t)scan->ema[ch];
+    state += (target - state) >> analog_ema_shift[ch];
+    scan->ema[ch] = (uint32_t)state;
+  }
+
+  return (uint16_t)((scan->ema[ch] + (1u << (ANALOG_SCAN_EMA_FRAC - 1))) >> ANALOG_SCAN_EMA_FRAC);
+}
+
+/************************************************
+ * PUBLIC FUNCTIONS IMPLEMENTATION             *
+ ************************************************/
+
+void analog_scan_init(analog_scan_t *scan, uint16_t publish_frames)
+{
+  memset(scan, 0, sizeof(*scan));
+  scan->publish_frames = publish_frames ? publish_frames : 1;
+
+  for (int i = 0; i < 2; i++) {
+    scan->buffer[i].temp_half_c = ANALOG_TEMP_UNKNOWN;
+    scan->buffer[i].faults = ANALOG_FAULT_NO_DATA;
+  }
+}
+
+bool analog_scan_merge(analog_scan_t *scan, const analog_acc_t *frame)
+{
+  for (int ch = 0; ch < ANALOG_CH_COUNT; ch++) {
+    scan->acc[ch].sum += frame[ch].sum;
+    scan->acc[ch].count += frame[ch].count;
+  }
+
+  if (++scan->frames < scan->publish_frames) {
+    return false;
+  }
+
+  scan->frames = 0;
+  return true;
+}
+
+void analog_scan_latch(analog_scan_t *scan, analog_acc_t *acc)
+{
+  memcpy(acc, scan->acc, sizeof(scan->acc));
+  memset(scan->acc, 0, sizeof(scan->acc));
+}
+
+void analog_scan_publish(analog_scan_t *scan, const analog_acc_t *acc, uint32_t lux, uint16_t lux_code)
+{
+  const analog_snapshot_t *prev = &scan->buffer[scan->front];
+  analog_snapshot_t *next = &scan->buffer[scan->front ^ 1];
+
+  // Media del periodo e filtro esponenziale per canale
+  next->faults = 0;
+  next->code[ANALOG_CH_LUX] = lux_code;
+  for (int ch = ANALOG_CH_NTC; ch < ANALOG_CH_COUNT; ch++) {
+    if (acc[ch].count == 0) {
+      next->code[ch] = prev->code[ch];
+      if (!(scan->primed & (1u << ch))) {
+        next->faults |= ANALOG_FAULT_NO_DATA;
+      }
+      continue;
+    }
+
+    uint16_t mean = (uint16_t)((acc[ch].sum + acc[ch].count / 2) / acc[ch].count);
+    next->code[ch] = analog_filter(scan, (analog_channel_t)ch, mean);
+  }
+
+  // Conversione nelle unità del Sensor Server
+  next->lux = lux;
+
+  uint16_t ntc = next->code[ANALOG_CH_NTC];
+  if (!(scan->primed & (1u << ANALOG_CH_NTC))) {
+    next->temp_half_c = ANALOG_TEMP_UNKNOWN;
+  } else if (ntc >= ANALOG_NTC_OPEN_CODE) {
+    next->temp_half_c = ANALOG_TEMP_UNKNOWN;
+    next->faults |= ANALOG_FAULT_NTC_OPEN;
+  } else if (ntc <= ANALOG_NTC_SHORT_CODE) {
+    next->temp_half_c = ANALOG_TEMP_UNKNOWN;
+    next->faults |= ANALOG_FAULT_NTC_SHORT;
+  } else {
+    float half = roundf(2.0f * analog_ntc_celsius(ntc));
+    if (half < INT8_MIN) half = INT8_MIN;
+    if (half > INT8_MAX - 1) half = INT8_MAX - 1;
+    next->temp_half_c = (int8_t)half;
+  }
+
+  next->voltage_cv = analog_vsupply_cv(next->code[ANALOG_CH_VSUPPLY]);
+  next->current_ca = analog_iled_ca(next->code[ANALOG_CH_ILED]);
+  if ((scan->primed & (1u << ANALOG_CH_VSUPPLY)) && next->voltage_cv < ANALOG_VSUPPLY_MIN_CV) {
+    next->faults |= ANALOG_FAULT_VSUPPLY_LOW;
+  }
+  if (next->current_ca > ANALOG_ILED_MAX_CA) {
+    next->faults |= ANALOG_FAULT_ILED_OVER;
+  }
+
+  uint32_t power = ((uint32_t)next->voltage_cv * next->current_ca + 50) / 100;
+  next->power_cw = (power > UINT16_MAX) ? UINT16_MAX : (uint16_t)power;
+
+  // Scambio: la fotografia completa diventa visibile in un solo passo
+  next->seq = prev->seq + 1;
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  scan->front ^= 1;
+  scan->seq = next->seq;
+}
+
+uint32_t analog_scan_read(const analog_scan_t *scan, analog_snapshot_t *out)
+{
+  uint32_t seq;
+
+  do {
+    seq = scan->seq;
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    *out = scan->buffer[scan->front];
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  } while (seq != scan->seq || seq != out->seq);
+
+  return seq;
+}
+
+float analog_ntc_celsius(uint16_t code)
+{
+  if (code == 0) code = 1;
+  if (code >= ANALOG_SCAN_MAX_CODE) code = ANALOG_SCAN_MAX_CODE - 1;
+
+  // NTC verso massa: R = Rs * code / (max - code)
+  float r = ANALOG_NTC_SERIES_OHM * (float)code / (float)(ANALOG_SCAN_MAX_CODE - code);
+  float inv_t = 1.0f / ANALOG_NTC_T0_K + logf(r / ANALOG_NTC_R0_OHM) / ANALOG_NTC_BETA;
+
+  return 1.0f / inv_t - 273.15f;
+}
+
+uint16_t analog_vsupply_cv(uint16_t code)
+{
+  // mV * (rapporto x100) / 1000 = centesimi di volt
+  uint32_t cv = (analog_code_mv(code) * ANALOG_VSUPPLY_DIVIDER_X100 + 500) / 1000;
+  return (cv > UINT16_MAX) ? UINT16_MAX : (uint16_t)cv;
+}
+
+uint16_t analog_iled_ca(uint16_t code)
+{
+  return (uint16_t)((analog_code_mv(code) * 100 + ANALOG_ILED_MV_PER_A / 2) / ANALOG_ILED_MV_PER_A);
+}
+
+const char *analog_channel_name(analog_channel_t ch)
+{
+  return (ch < ANALOG_CH_COUNT) ? analog_channel_names[ch] : "?";
+}
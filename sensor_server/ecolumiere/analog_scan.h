@@ -0,0 +1,200 @@
+/**
+ * Autore: DJITSOP FUOGOUK LOIC STEVE
+ * Firmware: ECOLUMIERE BLE MESH ESP32
+ * Modulo: Analog Scan - Acquisizione multicanale e fotografia dei sensori
+ * Descrizione: Un solo passaggio di scansione ADC serve tutti i canali
+ *              analogici del nodo: luce (finestra del luxmeter), NTC della
+ *              temperatura interna, tensione di alimentazione e corrente dei
+ *              LED. La sorgente accumula in ISR le conversioni dei canali
+ *              ausiliari (solo somme intere); a ogni pubblicazione il task
+ *              scheduler filtra ogni canale (media del periodo e filtro
+ *              esponenziale), lo converte in unità fisiche e scrive la
+ *              fotografia nel buffer nascosto di una coppia. Il Sensor Server
+ *              legge sempre la fotografia pubblicata, senza lock condivisi con
+ *              la ISR. Nessuna dipendenza ESP-IDF.
+ */
+
+#ifndef ANALOG_SCAN_H
+#define ANALOG_SCAN_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/************************************************
+ * PUBLIC DEFINES AND MACRO                     *
+ ************************************************/
+
+#define ANALOG_SCAN_MAX_CODE            4095    // ADC a 12 bit
+#define ANALOG_SCAN_FULL_SCALE_MV       3300    // ADC_ATTEN_DB_12 nominale, come il luxmeter
+#define ANALOG_SCAN_PUBLISH_MS          500     // Una fotografia per tick di slot
+
+// NTC 10k B3950 verso massa, resistenza serie 10k verso 3.3 V
+#define ANALOG_NTC_SERIES_OHM           10000.0f
+#define ANALOG_NTC_R0_OHM               10000.0f
+#define ANALOG_NTC_T0_K                 298.15f
+#define ANALOG_NTC_BETA                 3950.0f
+#define ANALOG_NTC_OPEN_CODE            4055    // Sopra: NTC scollegato (< -40 °C)
+#define ANALOG_NTC_SHORT_CODE           40      // Sotto: NTC in corto (> 150 °C)
+
+// Alimentazione: partitore 100k / 10k
+#define ANALOG_VSUPPLY_DIVIDER_X100     1100    // Rapporto x11.00
+#define ANALOG_VSUPPLY_MIN_CV           1800    // Sotto 18.00 V: alimentazione bassa
+
+// Corrente LED: shunt 0.1 ohm con amplificatore x20
+#define ANALOG_ILED_MV_PER_A            2000
+#define ANALOG_ILED_MAX_CA              150     // Sopra 1.50 A: sovracorrente
+
+// Filtro esponenziale per canale: alfa = 1 / 2^shift a ogni pubblicazione
+#define ANALOG_SCAN_EMA_FRAC            4       // Bit frazionari dello stato del filtro
+#define ANALOG_NTC_EMA_SHIFT            3       // Temperatura: costante di tempo ~4 s
+#define ANALOG_VSUPPLY_EMA_SHIFT        1
+#define ANALOG_ILED_EMA_SHIFT           1
+
+// Bit di guasto della fotografia (Sensor Server: codice errore)
+#define ANALOG_FAULT_NTC_OPEN           0x01
+#define ANALOG_FAULT_NTC_SHORT          0x02
+#define ANALOG_FAULT_VSUPPLY_LOW        0x04
+#define ANALOG_FAULT_ILED_OVER          0x08
+#define ANALOG_FAULT_NO_DATA            0x10    // Un canale senza conversioni nel periodo
+
+/************************************************
+ * PUBLIC TYPES                                 *
+ ************************************************/
+
+/**
+ * @brief Canali della scansione
+ */
+typedef enum {
+  ANALOG_CH_LUX,          ///< Sensore luce (stimato dalla finestra del luxmeter)
+  ANALOG_CH_NTC,          ///< Temperatura interna
+  ANALOG_CH_VSUPPLY,      ///< Tensione di alimentazione
+  ANALOG_CH_ILED,         ///< Corrente dei LED (media sul periodo PWM)
+  ANALOG_CH_COUNT
+} analog_channel_t;
+
+/**
+ * @brief Accumulo intero di un canale fra due pubblicazioni
+ */
+typedef struct analog_acc_t
+{
+  uint32_t sum;
+  uint32_t count;
+} analog_acc_t;
+
+/**
+ * @brief Fotografia dei sensori nelle unità del Sensor Server
+ * @field seq: Pubblicazioni dall'inizializzazione (0 = nessuna)
+ * @field lux: Illuminamento compensato al livello PWM corrente
+ * @field temp_half_c: Temperatura interna, risoluzione 0.5 °C
+ * @field voltage_cv: Tensione di alimentazione, risoluzione 0.01 V
+ * @field current_ca: Corrente dei LED, risoluzione 0.01 A
+ * @field power_cw: Potenza assorbita, risoluzione 0.01 W
+ * @field faults: Bit ANALOG_FAULT_*
+ * @field code: Codici filtrati per canale (diagnostica)
+ */
+typedef struct analog_snapshot_t
+{
+  uint32_t seq;
+  uint32_t lux;
+  int8_t temp_half_c;
+  uint16_t voltage_cv;
+  uint16_t current_ca;
+  uint16_t power_cw;
+  uint8_t faults;
+  uint16_t code[ANALOG_CH_COUNT];
+} analog_snapshot_t;
+
+/**
+ * @brief Stato della scansione
+ * @field acc: Accumulo della ISR per canale
+ * @field frames: Frame di scansione dall'ultima pubblicazione richiesta
+ * @field publish_frames: Frame per pubblicazione
+ * @field ema: Stato dei filtri (codice << ANALOG_SCAN_EMA_FRAC)
+ * @field primed: Bit per canale: filtro inizializzato
+ * @field buffer: Coppia di fotografie, una pubblicata e una in scrittura
+ * @field front: Indice della fotografia pubblicata
+ * @field seq: Copia di buffer[front].seq per il controllo dei lettori
+ */
+typedef struct analog_scan_t
+{
+  analog_acc_t acc[ANALOG_CH_COUNT];
+  uint16_t frames;
+  uint16_t publish_frames;
+  uint32_t ema[ANALOG_CH_COUNT];
+  uint8_t primed;
+  analog_snapshot_t buffer[2];
+  volatile uint8_t front;
+  volatile uint32_t seq;
+} analog_scan_t;
+
+/************************************************
+ * PUBLIC PROTOTYPES                           *
+ ************************************************/
+
+/**
+ * @brief Inizializza la scansione
+ * @param publish_frames: Frame (o passaggi oneshot) per pubblicazione, almeno 1
+ */
+void analog_scan_init(analog_scan_t *scan, uint16_t publish_frames);
+
+/**
+ * @brief Accumula una conversione nell'accumulo locale di un frame
+ * @desc Solo somme intere: utilizzabile in ISR.
+ * @param acc: ANALOG_CH_COUNT accumuli del frame in corso
+ */
+static inline void analog_scan_add(analog_acc_t *acc, analog_channel_t ch, uint16_t code)
+{
+  acc[ch].sum += code;
+  acc[ch].count++;
+}
+
+/**
+ * @brief Aggiunge gli accumuli di un frame di scansione completo
+ * @desc Da chiamare con analog_scan_latch escluso (sezione critica).
+ * @return true se è il momento di pubblicare (ogni publish_frames frame)
+ */
+bool analog_scan_merge(analog_scan_t *scan, const analog_acc_t *frame);
+
+/**
+ * @brief Copia e azzera gli accumuli (da chiamare con la ISR esclusa)
+ */
+void analog_scan_latch(analog_scan_t *scan, analog_acc_t *acc);
+
+/**
+ * @brief Filtra, converte e pubblica una nuova fotografia
+ * @desc Contesto task (floating point). I canali senza conversioni nel
+ *       periodo mantengono il valore filtrato precedente.
+ * @param acc: Accumuli del periodo (analog_scan_latch)
+ * @param lux: Illuminamento del canale luce, già stimato dal luxmeter
+ * @param lux_code: Codice ADC stimato del canale luce (diagnostica)
+ */
+void analog_scan_publish(analog_scan_t *scan, const analog_acc_t *acc, uint32_t lux, uint16_t lux_code);
+
+/**
+ * @brief Copia la fotografia pubblicata
+ * @desc Ripete la copia se una pubblicazione la sovrappone.
+ * @return Numero di sequenza della fotografia (0 = nessuna pubblicazione)
+ */
+uint32_t analog_scan_read(const analog_scan_t *scan, analog_snapshot_t *out);
+
+/**
+ * @brief Temperatura dell'NTC dal codice ADC (equazione Beta)
+ */
+float analog_ntc_celsius(uint16_t code);
+
+/**
+ * @brief Tensione di alimentazione in centesimi di volt dal codice ADC
+ */
+uint16_t analog_vsupply_cv(uint16_t code);
+
+/**
+ * @brief Corrente dei LED in centesimi di ampere dal codice ADC
+ */
+uint16_t analog_iled_ca(uint16_t code);
+
+/**
+ * @brief Nome del canale per i log
+ */
+const char *analog_channel_name(analog_channel_t ch);
+
+#endif // ANALOG_SCAN_H
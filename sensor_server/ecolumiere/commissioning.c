@@ -0,0 +1,169 @@
+/**
+ * Autore: DJITSOP FUOGOUK LOIC STEVE
+ * Firmware: ECOLUMIERE BLE MESH ESP32
+ * Implementazione: Commissioning - Scansione automatica della risposta della lampada
+ */
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+
+#include "commissioning.h"
+#include "pwmcontroller.h"
+#include "luxmeter.h"
+#include "ecolumiere.h"
+
+#include <string.h>
+
+/************************************************
+ * PRIVATE DEFINES AND MACRO                   *
+ ************************************************/
+static const char *TAG = "COMMISSIONING";
+
+#define COMMISSIONING_TASK_STACK        4096
+#define COMMISSIONING_TASK_PRIORITY     3
+
+/************************************************
+ * PRIVATE GLOBAL VARIABLES                    *
+ ************************************************/
+static volatile bool commissioning_running = false;
+static portMUX_TYPE commissioning_lock = portMUX_INITIALIZER_UNLOCKED;  // Console, BLE Mesh
+static bool commissioning_has_result = false;
+static commissioning_result_t last_result;
+static commissioning_done_cb_t done_callback = NULL;
+
+/************************************************
+ * PRIVATE FUNCTIONS IMPLEMENTATION           *
+ ************************************************/
+
+/**
+ * @brief Porta la lampada al livello e media le letture del luxmeter
+ */
+static float commissioning_measure(uint8_t level) {
+    uint32_t lux, index;
+    float sum = 0.0f;
+
+    pwm_hold_level(level);
+    vTaskDelay(pdMS_TO_TICKS(COMMISSIONING_SETTLE_MS));
+
+    for (int i = 0; i < COMMISSIONING_SAMPLES; i++) {
+        vTaskDelay(pdMS_TO_TICKS(COMMISSIONING_SAMPLE_MS));
+        luxmeter_pickup(LUX_MEASURE_ENVIRONMENT, level, &lux, &index);
+        sum += (float)lux;
+    }
+
+    return sum / COMMISSIONING_SAMPLES;
+}
+
+/**
+ * @brief Task di scansione: misura, stima, salva e notifica
+ */
+static void commissioning_task(void *pvParameters) {
+    commissioning_result_t result;
+    algo_config_data_t config;
+    int64_t start = esp_timer_get_time();
+
+    memset(&result, 0, sizeof(result));
+    ecolumiere_get_algo_config(&config);
+
+    float prior_gain = config.efficiency * config.transparency /
+                       (config.distance * config.distance);
+
+    for (uint8_t step = 0; step < COMMISSIONING_POINTS; step++) {
+        uint8_t level = commissioning_level_at(step);
+        result.points[step].level = level;
+        result.points[step].lux = commissioning_measure(level);
+
+        ESP_LOGI(TAG, "📐 Livello %2u/32: %.1f lux", level, result.points[step].lux);
+    }
+
+    pwm_hold_level(-1);
+
+    commissioning_fit(result.points, COMMISSIONING_POINTS, config.efficiency,
+                      prior_gain, &result.fit);
+    result.duration_ms = (uint32_t)((esp_timer_get_time() - start) / 1000);
+
+    if (result.fit.status == COMMISSIONING_OK) {
+        config.efficiency = result.fit.efficiency;
+        config.transparency = result.fit.transparency;
+        config.distance = result.fit.distance;
+        ecolumiere_set_algo_config(&config);
+
+        ESP_LOGI(TAG, "✅ Commissioning in %lu ms - %.2f lux/livello, distanza %.2f m, R² %.3f",
+                 result.duration_ms, result.fit.gain, result.fit.distance, result.fit.r2);
+        ESP_LOGI(TAG, "📊 Residuo %.1f lux (configurazione precedente %.1f lux)",
+                 result.fit.rms, result.fit.rms_prior);
+    } else {
+        ESP_LOGW(TAG, "❌ Commissioning fallito: %s - configurazione invariata",
+                 commissioning_status_name(result.fit.status));
+    }
+
+    last_result = result;
+    commissioning_has_result = true;
+
+    if (done_callback) {
+        done_callback(&result);
+    }
+
+    commissioning_release();
+    vTaskDelete(NULL);
+}
+
+/************************************************
+ * PUBLIC FUNCTIONS IMPLEMENTATION             *
+ ************************************************/
+
+esp_err_t commissioning_start(commissioning_done_cb_t done) {
+    if (!is_pwm_initialized()) {
+        ESP_LOGE(TAG, "PWM not initialized");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (!commissioning_claim()) {
+        ESP_LOGW(TAG, "Commissioning already running");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    done_callback = done;
+
+    if (xTaskCreate(commissioning_task, "commissioning", COMMISSIONING_TASK_STACK,
+                    NULL, COMMISSIONING_TASK_PRIORITY, NULL) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create commissioning task");
+        commissioning_release();
+        return ESP_ERR_NO_MEM;
+    }
+
+    ESP_LOGI(TAG, "🚀 Commissioning started - %d levels, about %d s",
+             COMMISSIONING_POINTS,
+             COMMISSIONING_POINTS * (COMMISSIONING_SETTLE_MS +
+                                     COMMISSIONING_SAMPLES * COMMISSIONING_SAMPLE_MS) / 1000);
+    return ESP_OK;
+}
+
+bool commissioning_is_running(void) {
+    return commissioning_running;
+}
+
+bool commissioning_claim(void) {
+    bool claimed = false;
+
+    portENTER_CRITICAL(&commissioning_lock);
+    if (!commissioning_running) {
+        commissioning_running = true;
+        claimed = true;
+    }
+    portEXIT_CRITICAL(&commissioning_lock);
+
+    return claimed;
+}
+
+void commissioning_release(void) {
+    commissioning_running = false;
+}
+
+bool commissioning_get_last_result(commissioning_result_t *result) {
+    if (!commissioning_has_result || result == NULL) return false;
+    *result = last_result;
+    return true;
+}
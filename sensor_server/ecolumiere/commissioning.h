@@ -0,0 +1,69 @@
+/**
+ * Autore: DJITSOP FUOGOUK LOIC STEVE
+ * Firmware: ECOLUMIERE BLE MESH ESP32
+ * Modulo: Commissioning - Scansione automatica della risposta della lampada
+ * Descrizione: Porta la lampada sui livelli della scansione in una stanza buia,
+ *              misura la risposta con il luxmeter e scrive in algo_config_data_t
+ *              i parametri stimati da commissioning_fit (con CRC). Gestisce
+ *              anche l'esclusione fra le scansioni che bloccano l'uscita
+ *              (commissioning e calibrazione degli offset, offset_cal_task).
+ */
+
+#ifndef COMMISSIONING_H
+#define COMMISSIONING_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "commissioning_fit.h"
+
+/**
+ * @brief Esito completo di una scansione
+ * @field fit: Stima e verifica della retta
+ * @field points: Punti misurati
+ * @field duration_ms: Durata della scansione
+ */
+typedef struct {
+    commissioning_fit_t fit;
+    commissioning_point_t points[COMMISSIONING_POINTS];
+    uint32_t duration_ms;
+} commissioning_result_t;
+
+/**
+ * @brief Notifica di fine scansione (chiamata dal task di commissioning)
+ */
+typedef void (*commissioning_done_cb_t)(const commissioning_result_t *result);
+
+/**
+ * @brief Avvia la scansione in un task dedicato
+ * @desc Per la durata della scansione l'uscita PWM è bloccata e l'algoritmo
+ *       non riceve misure. Se la stima è valida la configurazione viene
+ *       aggiornata e salvata, altrimenti resta invariata.
+ * @param done: Notifica di fine scansione (può essere NULL)
+ * @return ESP_ERR_INVALID_STATE se una scansione è già in corso
+ */
+esp_err_t commissioning_start(commissioning_done_cb_t done);
+
+/**
+ * @brief Indica se una scansione è in corso
+ */
+bool commissioning_is_running(void);
+
+/**
+ * @brief Prenota l'uscita per una scansione (commissioning o offset)
+ * @return false se un'altra scansione è già in corso
+ */
+bool commissioning_claim(void);
+
+/**
+ * @brief Libera l'uscita a fine scansione (dal task della scansione)
+ */
+void commissioning_release(void);
+
+/**
+ * @brief Restituisce l'esito dell'ultima scansione
+ * @return false se nessuna scansione è stata completata dall'avvio
+ */
+bool commissioning_get_last_result(commissioning_result_t *result);
+
+#endif // COMMISSIONING_H
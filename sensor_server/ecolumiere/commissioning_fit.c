@@ -0,0 +1,114 @@
+/**
+ * Autore: DJITSOP FUOGOUK LOIC STEVE
+ * Firmware: ECOLUMIERE BLE MESH ESP32
+ * Implementazione: Commissioning Fit - Stima dei parametri ottici dalla risposta della lampada
+ */
+
+#include "commissioning_fit.h"
+
+#include <string.h>
+#include <math.h>
+
+/************************************************
+ * PRIVATE VARIABLES                           *
+ ************************************************/
+
+static const char *commissioning_status_names[COMMISSIONING_STATUS_COUNT] = {
+  "OK", "PUNTI INSUFFICIENTI", "STANZA NON BUIA", "DERIVA DEL BUIO",
+  "NESSUNA RISPOSTA", "RETTA SCADENTE", "DISTANZA FUORI LIMITI", "OCCUPATO"
+};
+
+/************************************************
+ * PUBLIC FUNCTIONS IMPLEMENTATION              *
+ ************************************************/
+
+uint8_t commissioning_level_at(uint8_t step)
+{
+  if (step >= COMMISSIONING_POINTS - 1) return 0;
+  return step * COMMISSIONING_LEVEL_STEP;
+}
+
+bool commissioning_fit(const commissioning_point_t *points, int count, float efficiency,
+                       float prior_gain, commissioning_fit_t *fit)
+{
+  memset(fit, 0, sizeof(commissioning_fit_t));
+
+  if (count < 3) {
+    fit->status = COMMISSIONING_ERR_TOO_FEW_POINTS;
+    return false;
+  }
+
+  float dark_start = points[0].lux;
+  float dark_end = points[count - 1].lux;
+
+  if (dark_start > COMMISSIONING_MAX_DARK_LUX) {
+    fit->status = COMMISSIONING_ERR_NOT_DARK;
+    return false;
+  }
+  if (fabsf(dark_end - dark_start) > COMMISSIONING_MAX_DRIFT_LUX) {
+    fit->status = COMMISSIONING_ERR_DRIFT;
+    return false;
+  }
+
+  // Retta ai minimi quadrati su tutti i punti
+  double sum_l = 0.0, sum_y = 0.0, sum_ll = 0.0, sum_ly = 0.0;
+  for (int i = 0; i < count; i++) {
+    sum_l += points[i].level;
+    sum_y += points[i].lux;
+    sum_ll += (double)points[i].level * points[i].level;
+    sum_ly += (double)points[i].level * points[i].lux;
+  }
+
+  double den = count * sum_ll - sum_l * sum_l;
+  if (den <= 0.0) {
+    fit->status = COMMISSIONING_ERR_TOO_FEW_POINTS;
+    return false;
+  }
+
+  fit->gain = (float)((count * sum_ly - sum_l * sum_y) / den);
+  fit->offset = (float)((sum_y - fit->gain * sum_l) / count);
+
+  // Residui della retta e del guadagno precedente (offset = buio misurato)
+  double mean_y = sum_y / count;
+  double ss_res = 0.0, ss_tot = 0.0, ss_prior = 0.0;
+  float dark = 0.5f * (dark_start + dark_end);
+  for (int i = 0; i < count; i++) {
+    double r = points[i].lux - (fit->gain * points[i].level + fit->offset);
+    double p = points[i].lux - (prior_gain * points[i].level + dark);
+    double t = points[i].lux - mean_y;
+    ss_res += r * r;
+    ss_prior += p * p;
+    ss_tot += t * t;
+  }
+
+  fit->rms = (float)sqrt(ss_res / count);
+  fit->rms_prior = (float)sqrt(ss_prior / count);
+  fit->r2 = (ss_tot > 0.0) ? (float)(1.0 - ss_res / ss_tot) : 0.0f;
+
+  if (fit->gain < COMMISSIONING_MIN_GAIN) {
+    fit->status = COMMISSIONING_ERR_NO_RESPONSE;
+    return false;
+  }
+  if (fit->r2 < COMMISSIONING_MIN_R2) {
+    fit->status = COMMISSIONING_ERR_POOR_FIT;
+    return false;
+  }
+
+  fit->efficiency = efficiency;
+  fit->transparency = COMMISSIONING_TRANSPARENCY;
+  fit->distance = sqrtf(efficiency * fit->transparency / fit->gain);
+
+  if (fit->distance < COMMISSIONING_MIN_DISTANCE_M || fit->distance > COMMISSIONING_MAX_DISTANCE_M) {
+    fit->status = COMMISSIONING_ERR_DISTANCE;
+    return false;
+  }
+
+  fit->status = COMMISSIONING_OK;
+  return true;
+}
+
+const char *commissioning_status_name(commissioning_status_t status)
+{
+  if (status >= COMMISSIONING_STATUS_COUNT) return "?";
+  return commissioning_status_names[status];
+}
@@ -0,0 +1,102 @@
+/**
+ * Autore: DJITSOP FUOGOUK LOIC STEVE
+ * Firmware: ECOLUMIERE BLE MESH ESP32
+ * Modulo: Commissioning Fit - Stima dei parametri ottici dalla risposta della lampada
+ * Descrizione: Retta ai minimi quadrati lux = guadagno * livello + offset sui
+ *              punti della scansione di commissioning e conversione del guadagno
+ *              nei parametri di algo_config_data_t. Nessuna dipendenza ESP-IDF.
+ */
+
+#ifndef COMMISSIONING_FIT_H
+#define COMMISSIONING_FIT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Scansione: livelli visitati in salita, poi di nuovo al buio per la deriva
+#define COMMISSIONING_LEVEL_STEP        4
+#define COMMISSIONING_POINTS            ((32 / COMMISSIONING_LEVEL_STEP) + 2)
+#define COMMISSIONING_SETTLE_MS         700     // Lampada a regime + finestra ADC da 450 ms
+#define COMMISSIONING_SAMPLES           3       // Letture mediate per livello
+#define COMMISSIONING_SAMPLE_MS         500
+
+// Limiti di accettazione
+#define COMMISSIONING_MAX_DARK_LUX      50.0f   // Luce a lampada spenta oltre cui la stanza non è buia
+#define COMMISSIONING_MAX_DRIFT_LUX     10.0f   // Variazione del buio tra inizio e fine scansione
+#define COMMISSIONING_MIN_GAIN          0.5f    // Lux per livello minimi (sensore che vede la lampada)
+#define COMMISSIONING_MIN_R2            0.95f
+#define COMMISSIONING_MIN_DISTANCE_M    0.3f
+#define COMMISSIONING_MAX_DISTANCE_M    6.0f
+#define COMMISSIONING_TRANSPARENCY      1.0f    // Non separabile dall'efficienza: resta unitaria
+
+/**
+ * @brief Esito della stima
+ */
+typedef enum commissioning_status_t
+{
+  COMMISSIONING_OK = 0,
+  COMMISSIONING_ERR_TOO_FEW_POINTS,
+  COMMISSIONING_ERR_NOT_DARK,
+  COMMISSIONING_ERR_DRIFT,
+  COMMISSIONING_ERR_NO_RESPONSE,
+  COMMISSIONING_ERR_POOR_FIT,
+  COMMISSIONING_ERR_DISTANCE,
+  COMMISSIONING_ERR_BUSY,
+  COMMISSIONING_STATUS_COUNT
+} commissioning_status_t;
+
+/**
+ * @brief Punto misurato della scansione
+ */
+typedef struct commissioning_point_t
+{
+  uint8_t level;
+  float lux;
+} commissioning_point_t;
+
+/**
+ * @brief Risultato della stima
+ * @desc Dal solo sensore è osservabile il guadagno
+ *       efficiency * transparency / distance^2: l'efficienza resta quella
+ *       configurata, la trasparenza unitaria e la distanza è quella efficace
+ *       che riproduce il guadagno misurato.
+ * @field gain/offset: Retta lux = gain * livello + offset
+ * @field rms/r2: Residuo e coefficiente di determinazione della retta
+ * @field rms_prior: Residuo con il guadagno della configurazione precedente
+ * @field efficiency/transparency/distance: Parametri per algo_config_data_t
+ */
+typedef struct commissioning_fit_t
+{
+  commissioning_status_t status;
+  float gain;
+  float offset;
+  float rms;
+  float r2;
+  float rms_prior;
+  float efficiency;
+  float transparency;
+  float distance;
+} commissioning_fit_t;
+
+/**
+ * @brief Livello della lampada al passo step della scansione
+ * @desc 0, STEP, 2*STEP, ..., 32 e infine di nuovo 0 per la deriva.
+ */
+uint8_t commissioning_level_at(uint8_t step);
+
+/**
+ * @brief Stima i parametri dalla scansione
+ * @param points: COMMISSIONING_POINTS punti nell'ordine di commissioning_level_at
+ * @param efficiency: Efficienza configurata (lux per livello a 1 m)
+ * @param prior_gain: Guadagno della configurazione precedente, per il confronto
+ * @return true se status == COMMISSIONING_OK
+ */
+bool commissioning_fit(const commissioning_point_t *points, int count, float efficiency,
+                       float prior_gain, commissioning_fit_t *fit);
+
+/**
+ * @brief Nome leggibile dell'esito
+ */
+const char *commissioning_status_name(commissioning_status_t status);
+
+#endif //COMMISSIONING_FIT_H
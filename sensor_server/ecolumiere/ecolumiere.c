@@ -17,10 +17,14 @@
 #include "config.h"
 #include "datarecorder.h"
 #include "scheduler.h"
+#include "algo_core.h"
+#include "neighbor.h"
+#include "occupancy.h"
 
 #include <string.h>
 #include <stdlib.h>
 #include <math.h>
+#include <time.h>
 
 // Macro stampe condizionate
 #ifdef CONFIG_ECO_DEBUG
@@ -38,8 +42,6 @@ static const char* TAG = "ECOLUMIERE";
 
 // Configurazioni
 #define ECO_DEBUG_OUTPUT                5
-#define NATURAL_LUX_AVG_ORDER           50
-#define ENV_LUX_AVG_ORDER               50
 #define SLAVE_LIGHT_MAX_LEVEL           32
 #define SLAVE_LIGHT_MIN_LEVEL           3
 #define FOLLOW_UP_TIMEOUT_MS            (3 * 60 * 1000)
@@ -56,19 +58,20 @@ static uint8_t mesh_override_level = 0;
 
 ///////////////////////////////////////////////////////////
 
-#if defined SLAVE
- #define ALGO_AVG                        10
-#else
- #if 0
-  #define ALGO_AVG                      10
- #else
-  #define ALGO_AVG                      240
- #endif
- #define LAST_ALGO_AVG                  10
-#endif
+// Adattamento medie: soglie per riconoscere una variazione di luce
+#define ADAPT_DEVIATION_ABS_LUX         15      // Scostamento minimo assoluto (lux)
+#define ADAPT_DEVIATION_PERC            10      // Scostamento minimo relativo (% della media)
+#define ADAPT_DEVIATION_COUNT           2       // Campioni consecutivi fuori soglia
+#define ADAPT_FAST_HOLD_MS              (60 * 1000) // Permanenza in FAST dopo l'ultimo disturbo
+
+// Ripartenza a caldo
+#define WARM_STATE_VERSION              1
+#define WARM_SAVE_INTERVAL_MS           (10 * 60 * 1000) // Snapshot al massimo ogni 10 minuti
+#define WARM_START_MAX_AGE_S            (30 * 60)   // Età massima snapshot con orologio valido
+#define WARM_CLOCK_VALID_EPOCH          1704067200  // 01/01/2024: prima è orologio non impostato
+#define WARM_VALIDATE_ABS_LUX           30          // Tolleranza prima misura vs stato ripristinato
+#define WARM_VALIDATE_PERC              30
 
-#define ALGO_AVG_LIVE                   10
-#define ALGO_AVG_LAST                   20
 #define LAMP_MAX_LUX                    600
 #define POWER_EFFICIENCY                18.75
 #define LAMP_DISTANCE_M                 1
@@ -98,42 +101,73 @@ static uint8_t mesh_override_level = 0;
   #define DEFALUT_TARGET_TRANSPARENCY        1
 #endif
 
-typedef struct measure_avg_t
+/**
+ * @brief Modalità di media dell'algoritmo
+ * @desc FAST: finestre corte e slot frequenti dopo boot, cambio target o
+ *       variazione di luce. STABLE: finestre lunghe e campionamento lento a regime.
+ */
+typedef enum algo_avg_mode_t
 {
-  uint32_t sum;
-  uint8_t size;
-  uint8_t count;
-  int32_t measure;
-} measure_avg_t;
+  ALGO_AVG_MODE_FAST = 0,
+  ALGO_AVG_MODE_STABLE,
+  ALGO_AVG_MODE_COUNT
+} algo_avg_mode_t;
 
-typedef struct algo_avg_t
+/**
+ * @brief Parametri di media associati ad una modalità
+ * @field natural_order: Campioni per la media della luce naturale
+ * @field env_order: Campioni per la media della luce ambiente
+ * @field algo_avg: Medie accumulate prima di eseguire l'algoritmo
+ * @field algo_avg_live: Medie accumulate per i dati live
+ * @field algo_avg_last: Divisore della media algoritmo (come ALGO_AVG_LAST Nordic)
+ * @field slot_rate: Cadenza di elaborazione degli slot PWM
+ */
+typedef struct algo_avg_profile_t
 {
-  uint32_t natural_sum;
-  uint32_t env_sum;
-  uint8_t count;
-  uint8_t size;
-  float enatural;
-  float eenv;
-} algo_avg_t;
-
-typedef struct algo_data_t
+  uint8_t natural_order;
+  uint8_t env_order;
+  uint8_t algo_avg;
+  uint8_t algo_avg_live;
+  uint8_t algo_avg_last;
+  pwm_slot_rate_t slot_rate;
+} algo_avg_profile_t;
+
+/**
+ * @brief Stato dell'adattamento delle medie
+ * @field natural_deviations/env_deviations: Campioni consecutivi fuori soglia
+ *        per sorgente (le due sequenze si alternano e non vanno mescolate)
+ */
+typedef struct algo_adapt_t
 {
-  uint32_t target_lux;
-  float perc_min;
-  float distance;
-  uint32_t in_pl;
-  float power_efficiency;
-  float transparency;
-  float dimm_step;
-  float variation;
-  float elamp;
-  float emax;
-  float enew;
-  float pnew;
-  float emin;
-  float enatural;
-  float eenv;
-} algo_data_t;
+  algo_avg_mode_t mode;
+  uint8_t natural_deviations;
+  uint8_t env_deviations;
+  uint32_t last_disturbance_ms;
+  uint32_t mode_since_ms;
+  uint32_t switch_count;
+} algo_adapt_t;
+
+// STABLE mantiene i valori storici (50/50/10/10, divisore 20, slot /2)
+static const algo_avg_profile_t algo_avg_profiles[ALGO_AVG_MODE_COUNT] = {
+  [ALGO_AVG_MODE_FAST] = {
+    .natural_order = 5,
+    .env_order = 5,
+    .algo_avg = 2,
+    .algo_avg_live = 2,
+    .algo_avg_last = 4,
+    .slot_rate = { .tick_divider = 1, .device_id_divider = 4, .natural_divider = 1, .env_divider = 1 }
+  },
+  [ALGO_AVG_MODE_STABLE] = {
+    .natural_order = 50,
+    .env_order = 50,
+    .algo_avg = 10,
+    .algo_avg_live = 10,
+    .algo_avg_last = 20,
+    .slot_rate = { .tick_divider = 2, .device_id_divider = 4, .natural_divider = 2, .env_divider = 1 }
+  }
+};
+
+static const char *algo_avg_mode_names[ALGO_AVG_MODE_COUNT] = { "FAST", "STABLE" };
 
 static measure_avg_t natural_avg;
 static measure_avg_t env_avg;
@@ -142,8 +176,21 @@ static algo_avg_t algo_avg;
 static algo_data_t algo_data;
 static algo_config_data_t algo_config_data;
 static ecl_registry_t ecl_registry;
-static uint8_t code_window[CODE_WINDOW_SIZE];
+static uint16_t code_window[CODE_WINDOW_SIZE];    // Identificativi ottici validati
 static bool test_on = false;
+static algo_adapt_t algo_adapt;
+static neighbor_table_t neighbor_table;
+static portMUX_TYPE neighbor_lock = portMUX_INITIALIZER_UNLOCKED;  // Scheduler, slot timer e BLE Mesh
+static neighbor_fusion_t neighbor_fusion_mode = NEIGHBOR_FUSION_OFF;  // FUSION 1/2 da console
+static uint32_t fused_natural = 0;
+static uint32_t fused_env = 0;
+static uint8_t fused_neighbors = 0;
+static ecl_warm_state_t warm_state;
+static uint32_t warm_last_save_ms = 0;
+static uint8_t warm_pending_sources = 0;     // Bit (1 << LUX_SOURCE_*) ancora da confermare
+static bool warm_started = false;
+static occupancy_sm_t occupancy_sm;
+static float occupancy_occupied_level = 0;
 
 #if defined SLAVE
 static esp_timer_handle_t follow_up_timer_id;
@@ -152,6 +199,8 @@ static esp_timer_handle_t follow_up_timer_id;
 static QueueHandle_t scheduler_queue;
 
 static float calculate_initial_pwm(void);
+static void ecolumiere_adapt_kick(const char *reason);
+static void ecolumiere_warm_snapshot(void);
 
 /**
  * @brief Gestione degli eventi nel main loop
@@ -240,24 +289,272 @@ static void ecolumiere_update_algo_data(void)
 }
 
 
-static void ecolumiuere_avg_calulator(algo_avg_t *algo_avg)
+/**
+ * @brief Applica i parametri di media della modalità indicata
+ * @desc Azzera le somme parziali ma conserva le uscite filtrate, così
+ *       l'algoritmo continua a lavorare sull'ultima stima valida.
+ */
+static void ecolumiere_apply_avg_mode(algo_avg_mode_t mode)
 {
-  algo_avg->enatural = (float)(algo_avg->natural_sum / algo_avg->count) / algo_data.transparency;
+  const algo_avg_profile_t *profile = &algo_avg_profiles[mode];
 
-  if (algo_data.in_pl == 2)
-  {
-    algo_avg->eenv = (float)(algo_avg->env_sum / algo_avg->count) / ((algo_data.distance * algo_data.distance) * algo_data.transparency);
+  if (mode != algo_adapt.mode) {
+    algo_adapt.switch_count++;
   }
-  else
-  {
-    algo_avg->eenv = (float)(algo_avg->env_sum / algo_avg->count) * ((algo_data.distance * algo_data.distance) / algo_data.transparency);
+  algo_adapt.mode = mode;
+  algo_adapt.mode_since_ms = esp_timer_get_time() / 1000;
+  algo_adapt.natural_deviations = 0;
+  algo_adapt.env_deviations = 0;
+
+  natural_avg.size = profile->natural_order;
+  natural_avg.sum = 0;
+  natural_avg.count = 0;
+
+  // Il blocco ambiente riparte avanzato della quota di fase, riempita con
+  // l'ultima media: dopo un disturbo comune i nodi chiudono i blocchi a turno
+  uint8_t skew = (env_avg.measure > 0) ?
+                 (uint8_t)(pwm_get_control_phase() * profile->env_order / PWM_CONTROL_PHASES) : 0;
+  env_avg.size = profile->env_order;
+  env_avg.count = skew;
+  env_avg.sum = (uint32_t)env_avg.measure * skew;
+
+  // In modalità TEST la dimensione è imposta da ecolumiere_set_target
+  if (!test_on) {
+    algo_avg.size = profile->algo_avg;
   }
+  algo_avg.count = 0;
+  algo_avg.natural_sum = 0;
+  algo_avg.env_sum = 0;
 
-  algo_avg->count = 0;
-  algo_avg->natural_sum = 0;
-  algo_avg->env_sum = 0;
+  algo_avg_live.size = profile->algo_avg_live;
+  algo_avg_live.count = 0;
+  algo_avg_live.natural_sum = 0;
+  algo_avg_live.env_sum = 0;
+
+  pwm_set_slot_rate(&profile->slot_rate);
+
+  ESP_LOGI(TAG, "📐 Medie in modalità %s - Nat: %u, Env: %u, Algo: %u, Live: %u",
+           algo_avg_mode_names[mode], profile->natural_order, profile->env_order,
+           algo_avg.size, profile->algo_avg_live);
 }
 
+/**
+ * @brief Forza la modalità FAST (boot, cambio target, variazione di luce)
+ */
+static void ecolumiere_adapt_kick(const char *reason)
+{
+  algo_adapt.last_disturbance_ms = esp_timer_get_time() / 1000;
+
+  if (algo_adapt.mode != ALGO_AVG_MODE_FAST) {
+    ESP_LOGI(TAG, "⚡ Medie veloci: %s", reason);
+    ecolumiere_apply_avg_mode(ALGO_AVG_MODE_FAST);
+  }
+}
+
+/**
+ * @brief Verifica se un campione si discosta dalla media filtrata
+ * @desc Servono ADAPT_DEVIATION_COUNT campioni consecutivi fuori soglia per
+ *       ignorare i singoli picchi; in FAST ogni disturbo prolunga la permanenza.
+ * @param deviations: Contatore della sorgente del campione
+ */
+static void ecolumiere_adapt_check_sample(const measure_avg_t *measure_avg, uint32_t sample,
+                                          uint8_t *deviations)
+{
+  // Nessuna media ancora disponibile
+  if (measure_avg->measure <= 0) return;
+
+  uint32_t reference = (uint32_t)measure_avg->measure;
+  uint32_t delta = (sample > reference) ? (sample - reference) : (reference - sample);
+  uint32_t threshold = (reference * ADAPT_DEVIATION_PERC) / 100;
+
+  if (threshold < ADAPT_DEVIATION_ABS_LUX) {
+    threshold = ADAPT_DEVIATION_ABS_LUX;
+  }
+
+  if (delta <= threshold) {
+    *deviations = 0;
+    return;
+  }
+
+  if (++(*deviations) >= ADAPT_DEVIATION_COUNT) {
+    *deviations = 0;
+    ecolumiere_adapt_kick("variazione lux");
+  }
+}
+
+/**
+ * @brief Salva periodicamente lo stato di filtri e controllo
+ * @desc Bassa frequenza per limitare l'usura della flash; nessuna scrittura
+ *       finché lo stato ripristinato non è stato confermato da una misura.
+ */
+static void ecolumiere_warm_snapshot(void)
+{
+  uint32_t now = esp_timer_get_time() / 1000;
+
+  if (warm_pending_sources) return;
+  if (now - warm_last_save_ms < WARM_SAVE_INTERVAL_MS) return;
+
+  time_t wall = time(NULL);
+
+  warm_state.version = WARM_STATE_VERSION;
+  warm_state.mode = (uint8_t)algo_adapt.mode;
+  warm_state.saved_at = (wall >= WARM_CLOCK_VALID_EPOCH) ? (uint32_t)wall : 0;
+  warm_state.natural_measure = natural_avg.measure;
+  warm_state.env_measure = env_avg.measure;
+  warm_state.enatural = algo_avg.enatural;
+  warm_state.eenv = algo_avg.eenv;
+  warm_state.live_enatural = algo_avg_live.enatural;
+  warm_state.live_eenv = algo_avg_live.eenv;
+  warm_state.pnew = algo_data.pnew;
+  warm_state.enew = algo_data.enew;
+  warm_state.target_lux = algo_data.target_lux;
+  warm_state.crc = esp_rom_crc16_le(CONFIG_CRC_INIT_VALUE, (uint8_t *)&warm_state,
+                                    sizeof(ecl_warm_state_t) - sizeof(uint16_t));
+
+  if (storage_save_warm_state(&warm_state)) {
+    warm_last_save_ms = now;
+    ESP_LOGI(TAG, "💾 Warm state salvato - Nat: %ld, Env: %ld, PWM: %.1f",
+             warm_state.natural_measure, warm_state.env_measure, warm_state.pnew);
+  }
+}
+
+/**
+ * @brief Riempie le finestre di media con le misure ripristinate
+ * @desc Ogni finestra resta a un campione dalla chiusura: la prima misura
+ *       ambiente chiude il blocco e avvia subito un passo di controllo, con
+ *       il campione nuovo pesato come uno su size.
+ */
+static void ecolumiere_warm_prefill(void)
+{
+  uint32_t natural = (warm_state.natural_measure > 0) ? (uint32_t)warm_state.natural_measure : 0;
+  uint32_t env = (warm_state.env_measure > 0) ? (uint32_t)warm_state.env_measure : 0;
+
+  natural_avg.count = natural_avg.size - 1;
+  natural_avg.sum = natural * natural_avg.count;
+  env_avg.count = env_avg.size - 1;
+  env_avg.sum = env * env_avg.count;
+
+  algo_avg.count = algo_avg.size - 1;
+  algo_avg.natural_sum = natural * algo_avg.count;
+  algo_avg.env_sum = env * algo_avg.count;
+
+  algo_avg_live.count = algo_avg_live.size - 1;
+  algo_avg_live.natural_sum = natural * algo_avg_live.count;
+  algo_avg_live.env_sum = env * algo_avg_live.count;
+}
+
+/**
+ * @brief Ripristina lo stato salvato all'avvio
+ * @desc Con orologio valido scarta snapshot più vecchi di WARM_START_MAX_AGE_S;
+ *       senza orologio lo stato viene accettato in prova e confermato dalle
+ *       prime misure naturale e ambiente (ecolumiere_warm_validate). Il
+ *       livello ripristinato viene applicato subito all'uscita e le finestre
+ *       di media partono piene, così il primo passo segue la prima misura.
+ */
+static void ecolumiere_warm_restore(void)
+{
+  if (!storage_load_warm_state(&warm_state)) {
+    ESP_LOGI(TAG, "❄️ Nessun warm state - partenza a freddo");
+    return;
+  }
+
+  uint16_t crc = esp_rom_crc16_le(CONFIG_CRC_INIT_VALUE, (uint8_t *)&warm_state,
+                                  sizeof(ecl_warm_state_t) - sizeof(uint16_t));
+  if (crc != warm_state.crc || warm_state.version != WARM_STATE_VERSION) {
+    ESP_LOGW(TAG, "⚠️ Warm state non valido (CRC/versione) - partenza a freddo");
+    return;
+  }
+
+  time_t wall = time(NULL);
+  bool clock_valid = (wall >= WARM_CLOCK_VALID_EPOCH) && (warm_state.saved_at != 0);
+
+  if (clock_valid && ((uint32_t)wall < warm_state.saved_at ||
+                      (uint32_t)wall - warm_state.saved_at > WARM_START_MAX_AGE_S)) {
+    ESP_LOGW(TAG, "⚠️ Warm state scaduto (%lu s) - partenza a freddo",
+             (uint32_t)wall - warm_state.saved_at);
+    return;
+  }
+
+  natural_avg.measure = warm_state.natural_measure;
+  env_avg.measure = warm_state.env_measure;
+  algo_avg.enatural = warm_state.enatural;
+  algo_avg.eenv = warm_state.eenv;
+  algo_avg_live.enatural = warm_state.live_enatural;
+  algo_avg_live.eenv = warm_state.live_eenv;
+  algo_data.enatural = warm_state.live_enatural;
+  algo_data.eenv = warm_state.live_eenv;
+  algo_data.enew = warm_state.enew;
+  ecolumiere_warm_prefill();
+
+  if (warm_state.pnew >= 0 && warm_state.pnew <= LIGHT_MAX_LEVEL) {
+    algo_data.pnew = warm_state.pnew;
+    if (is_pwm_initialized()) {
+      pwm_set_duty_cycle((uint32_t)lroundf(algo_data.pnew));
+    }
+  }
+
+  warm_started = true;
+  warm_pending_sources = clock_valid ? 0 :
+                         (uint8_t)((1 << LUX_SOURCE_NATURAL) | (1 << LUX_SOURCE_ENVIRONMENT));
+
+  ESP_LOGI(TAG, "🔥 Warm start - Nat: %ld, Env: %ld, PWM: %.1f (%s)",
+           natural_avg.measure, env_avg.measure, algo_data.pnew,
+           warm_pending_sources ? "da confermare" : "età verificata");
+}
+
+/**
+ * @brief Conferma o scarta lo stato ripristinato con la prima misura di una sorgente
+ * @desc Senza orologio l'età dello snapshot è ignota: servono sia la prima
+ *       misura naturale sia la prima ambiente in accordo con i filtri
+ *       ripristinati. Basta un disaccordo per scartare lo stato.
+ */
+static void ecolumiere_warm_validate(uint8_t source, uint32_t sample)
+{
+  uint8_t bit = (uint8_t)(1 << source);
+  if (!(warm_pending_sources & bit)) return;
+
+  warm_pending_sources &= (uint8_t)~bit;
+
+  const measure_avg_t *restored = (source == LUX_SOURCE_NATURAL) ? &natural_avg : &env_avg;
+  const char *name = (source == LUX_SOURCE_NATURAL) ? "Nat" : "Env";
+  uint32_t reference = (restored->measure > 0) ? (uint32_t)restored->measure : 0;
+  uint32_t delta = (sample > reference) ? (sample - reference) : (reference - sample);
+  uint32_t threshold = (reference * WARM_VALIDATE_PERC) / 100;
+
+  if (threshold < WARM_VALIDATE_ABS_LUX) {
+    threshold = WARM_VALIDATE_ABS_LUX;
+  }
+
+  if (delta <= threshold) {
+    ESP_LOGI(TAG, "✅ Warm state %s - %s: %lu lux (atteso %lu)",
+             warm_pending_sources ? "in accordo" : "confermato", name, sample, reference);
+    return;
+  }
+
+  // Lo stato non descrive più la stanza: riparti dalle sole misure nuove
+  warm_pending_sources = 0;
+  natural_avg.measure = 0;
+  natural_avg.sum = 0;
+  natural_avg.count = 0;
+  env_avg.measure = 0;
+  env_avg.sum = 0;
+  env_avg.count = 0;
+  algo_avg.natural_sum = 0;
+  algo_avg.env_sum = 0;
+  algo_avg.count = 0;
+  algo_avg_live.natural_sum = 0;
+  algo_avg_live.env_sum = 0;
+  algo_avg_live.count = 0;
+  algo_avg.enatural = 0;
+  algo_avg.eenv = 0;
+  algo_avg_live.enatural = 0;
+  algo_avg_live.eenv = 0;
+  algo_data.enatural = 0;
+  algo_data.eenv = 0;
+  warm_started = false;
+
+  ESP_LOGW(TAG, "⚠️ Warm state scartato - %s: %lu lux, atteso %lu", name, sample, reference);
+}
 
 void ecolumiere_algo_process(void) {
 
@@ -274,37 +571,32 @@ void ecolumiere_algo_process(void) {
         }
     }
 
-    // ✅ 2. INIZIALIZZA E CONTROLLA TARGET
+    // ✅ 2. INIZIALIZZA E CONTROLLA TARGET (ridotto se la stanza è vuota)
     ecolumiere_update_algo_data();
+    occupancy_modulate(&occupancy_sm, &algo_data.target_lux, &algo_data.perc_min);
 
     // Slave può funzionare anche con target_lux = 0 (autonomia)
     // if (algo_data.target_lux == 0) return; // ❌ RIMOSSO per Slave
 
-    // ✅ 3. ACCUMULA DATI PER MEDIE (originale Nordic)
-    algo_avg.natural_sum += natural_avg.measure;
-    algo_avg.env_sum += env_avg.measure;
-
-    algo_avg_live.natural_sum += natural_avg.measure;
-    algo_avg_live.env_sum += env_avg.measure;
+    // ✅ 3. FONDE LA LUCE NATURALE CON I VICINI DELLA STANZA (copia della
+    // tabella sotto lock; l'ambiente contiene la lampada del nodo e resta locale)
+    neighbor_table_t neighbors;
+    portENTER_CRITICAL(&neighbor_lock);
+    neighbors = neighbor_table;
+    portEXIT_CRITICAL(&neighbor_lock);
 
-    // ✅ 4. MEDIE LIVE (notifiche BLE - originale Nordic)
-    if (++algo_avg_live.count == algo_avg_live.size) {
-        ecolumiuere_avg_calulator(&algo_avg_live);
+    fused_neighbors = neighbor_fuse(&neighbors, neighbor_fusion_mode,
+                                    (uint32_t)natural_avg.measure,
+                                    (uint32_t)(esp_timer_get_time() / 1000), &fused_natural);
+    fused_env = (uint32_t)env_avg.measure;
 
-        #if defined SUSPEND_DEVICE_ID_NATURAL_SLOTS
-        algo_avg_live.enatural = algo_avg_live.eenv;
-        #endif
+    // ✅ 4. ACCUMULA DATI PER MEDIE (originale Nordic, algo_core)
+    bool algo_ready = algo_core_avg_add(&algo_avg, fused_natural, fused_env);
 
-        algo_data.enatural = algo_avg_live.enatural;
-        algo_data.eenv = algo_avg_live.eenv;
-
-        #if !defined SUSPEND_DEVICE_ID_NATURAL_SLOTS
-        if (algo_data.eenv < algo_data.enatural) {
-            algo_data.eenv = algo_data.enatural;
-        }
-        #else
-        algo_data.enatural = algo_data.eenv;
-        #endif
+    // ✅ 5. MEDIE LIVE (notifiche BLE - originale Nordic)
+    if (algo_core_avg_add(&algo_avg_live, fused_natural, fused_env)) {
+        algo_core_avg_compute(&algo_avg_live, &algo_data, algo_avg_live.count);
+        algo_core_avg_load(&algo_data, &algo_avg_live);
 
         // Notifica dati live (se implementato)
         // ecolumiere_service_notify_algo_status((void *)&algo_data, sizeof(algo_data_t));
@@ -315,76 +607,20 @@ void ecolumiere_algo_process(void) {
         // app_sched_event_put(...);
     }
 
-    // ✅ 5. ATTENDI CAMPIONI SUFFICIENTI (originale Nordic)
-    if (++algo_avg.count < algo_avg.size) {
+    // ✅ 6. ATTENDI CAMPIONI SUFFICIENTI (originale Nordic)
+    if (!algo_ready) {
         ESP_LOGD(TAG, "📊 Accumulo campioni: %d/%d", algo_avg.count, algo_avg.size);
         return;
     }
 
-    // ✅ 6. CALCOLA MEDIE PRINCIPALI (originale Nordic)
-    #if defined ALGO_AVG_LAST
-    algo_avg.count = ALGO_AVG_LAST;
-    #endif
-
-    ecolumiuere_avg_calulator(&algo_avg);
+    // ✅ 7. CALCOLA MEDIE PRINCIPALI (originale Nordic, divisore ALGO_AVG_LAST)
+    algo_core_avg_compute(&algo_avg, &algo_data, algo_avg_profiles[algo_adapt.mode].algo_avg_last);
+    algo_core_avg_load(&algo_data, &algo_avg);
 
-    #if defined SUSPEND_DEVICE_ID_NATURAL_SLOTS
-    algo_avg.enatural = algo_avg.eenv;
-    #endif
+    // ✅ 8. ALGORITMO ORIGINALE NORDIC (MODELO FISICO)
+    algo_core_step(&algo_data);
 
-    algo_data.enatural = algo_avg.enatural;
-    algo_data.eenv = algo_avg.eenv;
-
-    if (algo_data.eenv < algo_data.enatural) {
-        algo_data.eenv = algo_data.enatural;
-    }
-
-    // ✅ 7. ALGORITMO ORIGINALE NORDIC (MODELO FISICO)
-
-    // A. Limite minimo
-    algo_data.emin = algo_data.perc_min * algo_data.emax;
-
-    // B. Lux attuali prodotti dalla lampada
-    algo_data.elamp = ((float)algo_data.pnew * algo_data.power_efficiency * algo_data.transparency) /
-                     (algo_data.distance * algo_data.distance);
-
-    // C. Calcola variazione necessaria (formula ORIGINALE Nordic)
-    #if defined SUSPEND_DEVICE_ID_NATURAL_SLOTS
-    if (algo_data.eenv) {
-        algo_data.variation = (float)(algo_data.target_lux - (algo_data.elamp + algo_data.eenv)) *
-                            ((algo_data.eenv / (float)algo_data.target_lux) * algo_data.dimm_step);
-    } else {
-        algo_data.variation = (float)(algo_data.target_lux - (algo_data.elamp + algo_data.eenv)) *
-                            (algo_data.dimm_step);
-    }
-    #else
-    if (algo_data.enatural) {
-        algo_data.variation = (float)(algo_data.target_lux - (algo_data.elamp + algo_data.eenv)) *
-                            ((algo_data.enatural / (float)algo_data.target_lux) * algo_data.dimm_step);
-    } else {
-        algo_data.variation = (float)(algo_data.target_lux - (algo_data.elamp + algo_data.eenv)) *
-                            (algo_data.dimm_step);
-    }
-    #endif
-
-    // D. Nuovi lux desiderati
-    algo_data.enew = algo_data.elamp + algo_data.variation;
-
-    // Applica limite minimo
-    if (algo_data.enew < algo_data.emin) {
-        algo_data.enew = algo_data.emin;
-    }
-
-    // E. Converti lux → PWM (modello fisico inverso - ORIGINALE)
-    algo_data.pnew = (algo_data.enew * algo_data.distance * algo_data.distance) /
-                    (algo_data.power_efficiency * algo_data.transparency);
-
-    // F. Applica limite massimo
-    if (algo_data.pnew > LIGHT_MAX_LEVEL) {
-        algo_data.pnew = LIGHT_MAX_LEVEL;
-    }
-
-    // ✅ 8. APPLICA NUOVO PWM
+    // ✅ 9. APPLICA NUOVO PWM
     ESP_LOGI(TAG, "🔧 ALGO NORDIC - Target: %lu, Natural: %.1f, Env: %.1f, PWM: %.1f→%.1f",
              algo_data.target_lux, algo_data.enatural, algo_data.eenv,
              algo_data.pnew, (float)algo_data.pnew);
@@ -392,7 +628,7 @@ void ecolumiere_algo_process(void) {
     pwm_set_duty_cycle((uint32_t)algo_data.pnew);
     ecolumiere_save_current_pwm((uint16_t)algo_data.pnew);
 
-    // ✅ 9. AGGIORNA NOTIFICHE FINALI (originale Nordic)
+    // ✅ 10. AGGIORNA NOTIFICHE FINALI (originale Nordic)
     algo_data.enatural = algo_avg_live.enatural;
     algo_data.eenv = algo_avg_live.eenv;
 
@@ -406,12 +642,22 @@ void ecolumiere_algo_process(void) {
     ecl_live.duty_cycle = (uint32_t)algo_data.pnew;
     // app_sched_event_put(...);
 
-    // ✅ 10. RESETTA CONTATORI MEDIE
+    // ✅ 11. RESETTA CONTATORI MEDIE
     algo_avg.count = 0;
     algo_avg.natural_sum = 0;
     algo_avg.env_sum = 0;
 
     ESP_LOGI(TAG, "✅ Algoritmo Nordic ORIGINALE completato");
+
+    ecolumiere_warm_snapshot();
+
+    // ✅ 12. RITORNO A REGIME: nessun disturbo per ADAPT_FAST_HOLD_MS
+    if (algo_adapt.mode == ALGO_AVG_MODE_FAST) {
+        uint32_t now = esp_timer_get_time() / 1000;
+        if (now - algo_adapt.last_disturbance_ms > ADAPT_FAST_HOLD_MS) {
+            ecolumiere_apply_avg_mode(ALGO_AVG_MODE_STABLE);
+        }
+    }
 }
 
 
@@ -444,7 +690,9 @@ void ecolumiere_update_lux(void *p_event_data, uint16_t event_size)
       {
         code_window[i - 1] = code_window[i];
       }
-      code_window[CODE_WINDOW_SIZE - 1] = algo_sched_event->code;
+      // Solo trame con CRC valido e margine di temporizzazione sufficiente
+      code_window[CODE_WINDOW_SIZE - 1] = (algo_sched_event->confidence >= CODE_MIN_CONFIDENCE) ?
+                                          algo_sched_event->device_id : LIGHT_FRAME_ID_NONE;
       code_prescaler = CODE_WINDOW_PRESCALER;
       counter++;
     }
@@ -452,15 +700,18 @@ void ecolumiere_update_lux(void *p_event_data, uint16_t event_size)
 
   if (measure_avg == NULL) return;
 
-  measure_avg->sum += algo_sched_event->measure;
-  if (++measure_avg->count == measure_avg->size)
+  if (warm_pending_sources)
   {
-    measure_avg->measure = measure_avg->sum / measure_avg->size;
-    measure_avg->sum = 0;
-    measure_avg->count = 0;
+    ecolumiere_warm_validate(algo_sched_event->source, algo_sched_event->measure);
   }
 
-  if (algo_sched_event->source == LUX_SOURCE_ENVIRONMENT && measure_avg->count == 0)
+  ecolumiere_adapt_check_sample(measure_avg, algo_sched_event->measure,
+                                (measure_avg == &natural_avg) ? &algo_adapt.natural_deviations
+                                                              : &algo_adapt.env_deviations);
+
+  bool window_done = algo_core_measure_push(measure_avg, algo_sched_event->measure);
+
+  if (algo_sched_event->source == LUX_SOURCE_ENVIRONMENT && window_done)
   {
     ecolumiere_algo_process();
   }
@@ -477,6 +728,7 @@ void ecolumiere_set_target(int32_t target)
   else if (target > 0)
   {
     algo_data.target_lux = target;
+    ecolumiere_adapt_kick("nuovo target");
   }
   else if (target < 0)
   {
@@ -544,11 +796,13 @@ static void initialize_algorithm_structures(void) {
     memset(&env_avg, 0, sizeof(measure_avg_t));
     memset(&algo_avg, 0, sizeof(algo_avg_t));
     memset(&algo_avg_live, 0, sizeof(algo_avg_t));
+    neighbor_table_init(&neighbor_table);
+    occupancy_init(&occupancy_sm, esp_timer_get_time() / 1000);
 
-    natural_avg.size = NATURAL_LUX_AVG_ORDER;
-    env_avg.size = ENV_LUX_AVG_ORDER;
-    algo_avg.size = ALGO_AVG;
-    algo_avg_live.size = ALGO_AVG_LIVE;
+    // ✅ AL BOOT SI PARTE IN FAST PER CONVERGERE RAPIDAMENTE
+    memset(&algo_adapt, 0, sizeof(algo_adapt_t));
+    algo_adapt.mode = ALGO_AVG_MODE_STABLE;
+    ecolumiere_adapt_kick("boot");
 }
 
 /**
@@ -733,6 +987,9 @@ void ecolumiere_init(void)
     // ✅ 4. INIZIALIZZA COMPONENTI SISTEMA
     initialize_system_components();
 
+    // ✅ 5. RIPARTENZA A CALDO DA STATO SALVATO
+    ecolumiere_warm_restore();
+
     ESP_LOGI("ECOLUMIERE", "✅ Ecolumiere System Initialized Successfully");
     slave_node_log_identity();
 }
@@ -800,8 +1057,10 @@ static float calculate_initial_pwm(void) {
  * @brief Gestisce comandi diretti dal Gateway via BLE Mesh
  * @param level: Livello PWM da impostare (0-32)
  * @param is_override: true = comando diretto, false = suggerimento algoritmo
+ * @param transition_ms: Durata del fade del comando diretto
+ * @param delay_ms: Ritardo prima del fade del comando diretto
  */
-void ecolumiere_handle_mesh_command(uint8_t level, bool is_override) {
+void ecolumiere_handle_mesh_command(uint8_t level, bool is_override, uint32_t transition_ms, uint32_t delay_ms) {
     ESP_LOGI(TAG, "📡 Ricevuto comando Mesh - Level: %d, Override: %s",
              level, is_override ? "SI" : "NO");
 
@@ -825,7 +1084,7 @@ void ecolumiere_handle_mesh_command(uint8_t level, bool is_override) {
             // ✅ SALVA TUTTI I DATI
             slave_node_update_lampada_data(&lampada_aggiornata);
 
-            pwmcontroller_set_level(level);
+            pwmcontroller_set_level_fade(level, transition_ms, delay_ms);
             ESP_LOGI(TAG, "🎛️ Override Mesh ATTIVO - Level: %d/32, Timeout: %d secondi",
                      level, MESH_OVERRIDE_DURATION_MS / 1000);
         } else {
@@ -844,6 +1103,8 @@ void ecolumiere_handle_mesh_command(uint8_t level, bool is_override) {
             ESP_LOGI(TAG, "💡 Suggerimento Mesh - Nuovo target: %lu lux (da PWM: %d)",
                      new_target_lux, level);
 
+            ecolumiere_adapt_kick("nuovo target mesh");
+
             // ✅ Ricalcola solo se non in override mesh
             if (!mesh_override_active) {
                 ESP_LOGI(TAG, "🔍 Trigger algoritmo con nuovo target...");
@@ -927,6 +1188,52 @@ void ecolumiere_show_algorithm_status(void) {
     ESP_LOGI(TAG, "Lux Totale: %.1f", algo_avg.enatural + algo_avg.eenv);
     ESP_LOGI(TAG, "PWM Attuale: %.1f/32", algo_data.pnew);
     ESP_LOGI(TAG, "Campioni: %d/%d", algo_avg.count, algo_avg.size);
+
+    const algo_avg_profile_t *profile = &algo_avg_profiles[algo_adapt.mode];
+    pwm_slot_rate_t slot_rate;
+    pwm_get_slot_rate(&slot_rate);
+    uint32_t now = esp_timer_get_time() / 1000;
+
+    ESP_LOGI(TAG, "Modalità Medie: %s (da %lu s, cambi: %lu)",
+             algo_avg_mode_names[algo_adapt.mode],
+             (now - algo_adapt.mode_since_ms) / 1000, algo_adapt.switch_count);
+    ESP_LOGI(TAG, "Ordini Medie - Nat: %u, Env: %u, Algo: %u/%u, Live: %u",
+             natural_avg.size, env_avg.size, algo_avg.size,
+             profile->algo_avg_last, algo_avg_live.size);
+    ESP_LOGI(TAG, "Cadenza Slot - tick/%u, ID/%u, NAT/%u, ENV/%u",
+             slot_rate.tick_divider, slot_rate.device_id_divider,
+             slot_rate.natural_divider, slot_rate.env_divider);
+    ESP_LOGI(TAG, "Fase Regolazione - %u/%u", pwm_get_control_phase(), PWM_CONTROL_PHASES);
+    if (algo_adapt.mode == ALGO_AVG_MODE_FAST) {
+        uint32_t quiet = now - algo_adapt.last_disturbance_ms;
+        ESP_LOGI(TAG, "Ritorno a STABLE tra: %lu s",
+                 (quiet < ADAPT_FAST_HOLD_MS) ? (ADAPT_FAST_HOLD_MS - quiet) / 1000 : 0);
+    }
+
+    static const char *fusion_names[] = { "OFF", "MEDIA", "MEDIANA" };
+    ESP_LOGI(TAG, "Fusione Vicini: %s - Vicini attivi: %u, Nat: %lu, Env: %lu",
+             fusion_names[neighbor_fusion_mode], fused_neighbors, fused_natural, fused_env);
+    ESP_LOGI(TAG, "Warm Start: %s%s", warm_started ? "SI" : "NO",
+             warm_pending_sources ? " (da confermare)" : "");
+    if (occupancy_sm.armed) {
+        ESP_LOGI(TAG, "Presenza: %s (da %lu s, ultimo movimento %lu s fa)",
+                 occupancy_state_name(occupancy_sm.state),
+                 (now - occupancy_sm.since_ms) / 1000,
+                 (now - occupancy_sm.last_motion_ms) / 1000);
+    } else {
+        ESP_LOGI(TAG, "Presenza: sensore non rilevato");
+    }
+    pwm_natural_est_stats_t natural_est;
+    pwm_get_natural_estimation_stats(&natural_est);
+    if (natural_est.enabled) {
+        ESP_LOGI(TAG, "Stima Naturale: %.2f lux/livello, errore %.1f (medio %.1f) lux",
+                 natural_est.gain, natural_est.last_error, natural_est.mean_error);
+        ESP_LOGI(TAG, "Stima Naturale: %lu stime, %lu calibrazioni, prossima ogni %lu s, buio %lu/%lu tick",
+                 natural_est.estimates, natural_est.calibrations, natural_est.interval_s,
+                 natural_est.blanked_ticks, natural_est.total_ticks);
+    } else {
+        ESP_LOGI(TAG, "Stima Naturale: DISATTIVA (misura a ogni slot)");
+    }
     ESP_LOGI(TAG, "Override Mesh: %s", mesh_override_active ? "ATTIVO" : "INATTIVO");
 
     if (mesh_override_active) {
@@ -937,4 +1244,122 @@ void ecolumiere_show_algorithm_status(void) {
 
     ESP_LOGI(TAG, "Config Valida: %s", ecolumiere_has_valid_config() ? "SI" : "NO");
     ESP_LOGI(TAG, "======================================");
-}
\ No newline at end of file
+}
+
+// ============================================================================
+// FUSIONE MISURE CON I VICINI DELLA STANZA
+// ============================================================================
+
+/**
+ * @brief Restituisce le misure filtrate locali da pubblicare ai vicini
+ */
+void ecolumiere_get_filtered_lux(uint32_t *natural, uint32_t *env)
+{
+  if (natural) *natural = (natural_avg.measure > 0) ? (uint32_t)natural_avg.measure : 0;
+  if (env) *env = (env_avg.measure > 0) ? (uint32_t)env_avg.measure : 0;
+}
+
+/**
+ * @brief Registra la lettura di un vicino della stessa stanza
+ */
+void ecolumiere_neighbor_update(uint16_t addr, uint32_t natural, uint32_t env, int8_t rssi)
+{
+  uint32_t now = (uint32_t)(esp_timer_get_time() / 1000);
+
+  portENTER_CRITICAL(&neighbor_lock);
+  neighbor_table_update(&neighbor_table, addr, natural, env, rssi, now);
+  portEXIT_CRITICAL(&neighbor_lock);
+
+  ECO_LOGD("Vicino 0x%04X - Nat: %lu, Env: %lu, RSSI: %d", addr, natural, env, rssi);
+}
+
+/**
+ * @brief Imposta il metodo di fusione con i vicini
+ */
+void ecolumiere_set_neighbor_fusion(uint8_t mode)
+{
+  if (mode > NEIGHBOR_FUSION_MEDIAN) return;
+
+  neighbor_fusion_mode = (neighbor_fusion_t)mode;
+  ESP_LOGI(TAG, "🏠 Fusione vicini: %u", mode);
+}
+
+/**
+ * @brief Elenca i nodi della stanza noti dalla condivisione lux
+ */
+uint8_t ecolumiere_get_room_members(uint16_t self, uint16_t *addrs, uint8_t max)
+{
+  if (max == 0) return 0;
+
+  uint32_t now = (uint32_t)(esp_timer_get_time() / 1000);
+
+  portENTER_CRITICAL(&neighbor_lock);
+  uint8_t count = neighbor_table_addresses(&neighbor_table, now, addrs, max - 1);
+  portEXIT_CRITICAL(&neighbor_lock);
+  addrs[count++] = self;
+  return count;
+}
+
+// ============================================================================
+// PRESENZA E STANDBY
+// ============================================================================
+
+/**
+ * @brief Aggiorna la macchina a stati di presenza
+ * @desc Le transizioni agiscono subito senza attendere il gateway: al rientro
+ *       si ripristina il livello precedente, in standby il livello scende al
+ *       minimo di standby; negli stati intermedi l'algoritmo converge in FAST
+ *       verso il target ridotto.
+ */
+void ecolumiere_occupancy_update(bool motion, bool edge)
+{
+  uint32_t now = esp_timer_get_time() / 1000;
+  occupancy_state_t previous = occupancy_sm.state;
+
+  if (edge) {
+    slave_node_set_sensore_movimento(motion);
+  }
+
+  if (!occupancy_step(&occupancy_sm, motion, now)) return;
+
+  ESP_LOGI(TAG, "🚶 Presenza: %s → %s", occupancy_state_name(previous),
+           occupancy_state_name(occupancy_sm.state));
+
+  if (previous == OCCUPANCY_OCCUPIED) {
+    occupancy_occupied_level = algo_data.pnew;
+  }
+
+  // Un comando diretto del gateway ha la precedenza fino alla scadenza
+  if (mesh_override_active) return;
+
+  if (occupancy_sm.state == OCCUPANCY_OCCUPIED) {
+    if (algo_data.pnew < occupancy_occupied_level) {
+      algo_data.pnew = occupancy_occupied_level;
+      pwm_set_duty_cycle((uint32_t)algo_data.pnew);
+    }
+  } else if (occupancy_sm.state == OCCUPANCY_STANDBY) {
+    float standby_level = occupancy_sm.config.standby_perc_min * LIGHT_MAX_LEVEL;
+    if (algo_data.pnew > standby_level) {
+      algo_data.pnew = standby_level;
+      pwm_set_duty_cycle((uint32_t)algo_data.pnew);
+    }
+  }
+
+  ecolumiere_adapt_kick("presenza");
+}
+
+/**
+ * @brief Imposta i tempi della macchina a stati di presenza
+ */
+bool ecolumiere_set_occupancy_times(uint32_t hold_s, uint32_t grace_s, uint32_t standby_s)
+{
+  if (!occupancy_set_times(&occupancy_sm, hold_s * 1000, grace_s * 1000, standby_s * 1000)) {
+    ESP_LOGW(TAG, "⚠️ Tempi presenza non validi: %lu/%lu/%lu s", hold_s, grace_s, standby_s);
+    return false;
+  }
+
+  ESP_LOGI(TAG, "🚶 Tempi presenza - Hold: %lu s, Grazia: %lu s, Standby: %lu s",
+           occupancy_sm.config.hold_ms / 1000, occupancy_sm.config.grace_ms / 1000,
+           occupancy_sm.config.standby_ms / 1000);
+  return true;
+}
@@ -10,6 +10,7 @@
 #define CODE_WINDOW_SIZE                (25)
 #define CODE_THRESHOLD_HIGH             (2)
 #define CODE_THRESHOLD_LOW              (1)
+#define CODE_MIN_CONFIDENCE             (10)    // Confidenza minima di una trama nella finestra codici
 
 
 /**
@@ -22,12 +23,24 @@ typedef enum lux_source_t
   LUX_SOURCE_DEVICE_ID
 } lux_source_t;
 
+/**
+* @brief evento verso l'algoritmo
+* @field measure: Misura in lux (LUX_SOURCE_NATURAL / LUX_SOURCE_ENVIRONMENT)
+* @field code: Codice a 7 bit (LUX_SOURCE_DEVICE_ID)
+* @field confidence: Confidenza della trama ottica, 0..100
+* @field device_id: Identificativo della trama ottica validata dal CRC (0 = nessuna)
+*/
 typedef struct algo_sched_event_t
 {
   union
   {
     uint32_t measure;
-    uint8_t code;
+    struct
+    {
+      uint8_t code;
+      uint8_t confidence;
+      uint16_t device_id;
+    };
   };
   uint8_t source;
 } algo_sched_event_t;
@@ -48,6 +61,34 @@ typedef struct __attribute__((packed))
   uint16_t crc;  // deve essere l'ultimo campo della struttura
 } algo_config_data_t;
 
+/**
+* @brief stato filtri e controllo salvato per la ripartenza a caldo
+* @field version: Versione del formato (scarta snapshot incompatibili)
+* @field mode: Modalità di media al momento del salvataggio
+* @field saved_at: Ora di sistema in secondi (0 = orologio non valido)
+* @field natural_measure/env_measure: Uscite dei filtri di misura
+* @field enatural/eenv: Medie algoritmo
+* @field live_enatural/live_eenv: Medie live
+* @field pnew/enew: Ultimo livello calcolato e relativi lux lampada
+* @field target_lux: Target attivo al momento del salvataggio
+*/
+typedef struct __attribute__((packed))
+{
+  uint8_t version;
+  uint8_t mode;
+  uint32_t saved_at;
+  int32_t natural_measure;
+  int32_t env_measure;
+  float enatural;
+  float eenv;
+  float live_enatural;
+  float live_eenv;
+  float pnew;
+  float enew;
+  uint32_t target_lux;
+  uint16_t crc;  // deve essere l'ultimo campo della struttura
+} ecl_warm_state_t;
+
 
 /**
 * @brief struttura di anagrafica completa
@@ -139,8 +180,10 @@ void ecolumiere_test_avg_status(void);
  * @brief Gestisce comandi diretti dal Gateway via BLE Mesh
  * @param level: Livello PWM da impostare (0-32)
  * @param is_override: true = comando diretto, false = suggerimento algoritmo
+ * @param transition_ms: Durata del fade del comando diretto
+ * @param delay_ms: Ritardo prima del fade del comando diretto
  */
-void ecolumiere_handle_mesh_command(uint8_t level, bool is_override);
+void ecolumiere_handle_mesh_command(uint8_t level, bool is_override, uint32_t transition_ms, uint32_t delay_ms);
 
 // Aggiungi questi prototipi alla fine di ecolumiere.h
 
@@ -171,4 +214,46 @@ void ecolumiere_test_algorithm(uint32_t natural_lux, uint32_t env_lux, uint32_t
  */
 void ecolumiere_show_algorithm_status(void);
 
+/**
+ * @brief Restituisce le misure filtrate locali (lux) da condividere con la stanza
+ */
+void ecolumiere_get_filtered_lux(uint32_t *natural, uint32_t *env);
+
+/**
+ * @brief Registra la lettura filtrata di un nodo della stessa stanza
+ * @param addr: Indirizzo unicast del vicino
+ * @param natural/env: Misure filtrate del vicino (lux)
+ * @param rssi: RSSI del messaggio ricevuto
+ */
+void ecolumiere_neighbor_update(uint16_t addr, uint32_t natural, uint32_t env, int8_t rssi);
+
+/**
+ * @brief Imposta il metodo di fusione con i vicini
+ * @param mode: 0 = disattiva (default), 1 = media pesata, 2 = mediana pesata
+ */
+void ecolumiere_set_neighbor_fusion(uint8_t mode);
+
+/**
+ * @brief Elenca i nodi della stanza: vicini non scaduti più il nodo stesso
+ * @param self: Indirizzo unicast del nodo (ultimo elemento)
+ * @param addrs: Buffer di destinazione
+ * @param max: Capacità del buffer
+ * @return Numero di indirizzi copiati
+ */
+uint8_t ecolumiere_get_room_members(uint16_t self, uint16_t *addrs, uint8_t max);
+
+/**
+ * @brief Aggiorna la presenza con il livello del sensore PIR
+ * @param motion: true se il sensore segnala movimento
+ * @param edge: true se il livello è appena cambiato
+ */
+void ecolumiere_occupancy_update(bool motion, bool edge);
+
+/**
+ * @brief Imposta i tempi di presenza, misurati dall'ultimo movimento
+ * @param hold_s/grace_s/standby_s: Fine presenza, fine grazia, standby (0 = invariato)
+ * @return false se i tempi non sono crescenti
+ */
+bool ecolumiere_set_occupancy_times(uint32_t hold_s, uint32_t grace_s, uint32_t standby_s);
+
 #endif //ECOLUMIERE_H
\ No newline at end of file
@@ -18,6 +18,8 @@
 #include "slave_role.h"
 #include "datarecorder.h"
 #include "zerocross.h"
+#include "pir.h"
+#include "offset_cal_task.h"
 
 static const char *TAG = "ECOLUMIERE_SYSTEM";
 
@@ -113,6 +115,11 @@ void ecolumiere_system_real_test(void) {
         ESP_LOGI(TAG, "   ❌ No valid code detected (normal in test)");
     }
 
+    light_frame_t frame;
+    if (light_code_get_frame(&frame)) {
+        ESP_LOGI(TAG, "   ✅ Optical ID: 0x%04X (confidence %u)", frame.payload, frame.confidence);
+    }
+
     // 4. TEST PWM CONTROLLER REALE
     ESP_LOGI(TAG, "4. 🎛️ Testing Real PWM Controller...");
 
@@ -213,6 +220,14 @@ esp_err_t ecolumiere_system_init(void) {
         zero_cross_disable();
     }
 
+    // 4.1 Sensore di presenza (inattivo finché non segnala il primo movimento)
+    ESP_LOGI(TAG, "4.1 Initializing PIR motion sensor...");
+    if (pir_init() == ESP_OK) {
+        pir_enable();
+    } else {
+        ESP_LOGW(TAG, "   PIR: DISABLED");
+    }
+
     // 5. PWM Controller
     ESP_LOGI(TAG, "5. Initializing PWM controller...");
     esp_err_t pwm_ret = pwmcontroller_init();
@@ -229,6 +244,13 @@ esp_err_t ecolumiere_system_init(void) {
     ESP_LOGI(TAG, "6. Initializing luxmeter...");
     luxmeter_init();
 
+    // Tabella di compensazione calibrata per il dispositivo, se salvata
+    if (offset_cal_load()) {
+        ESP_LOGI(TAG, "   Luxmeter offsets: DEVICE CALIBRATION");
+    } else {
+        ESP_LOGI(TAG, "   Luxmeter offsets: FACTORY TABLE");
+    }
+
     // 7. Ecolumiere Algorithm
     ESP_LOGI(TAG, "7. Initializing ecolumiere...");
     ecolumiere_init();
@@ -7,8 +7,11 @@
 
 #include "lightcode.h"
 #include "driver/gpio.h"
+#include "driver/rmt_tx.h"
 #include "esp_timer.h"
 #include "esp_log.h"
+#include "esp_cpu.h"
+#include "esp_rom_sys.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include <string.h>
@@ -21,143 +24,433 @@ static const char* TAG = "LIGHTCODE";
 #define SENSE_DIGITAL_IN_PIN            27      // GPIO sensore luce digitale
 #define DEBUG_PIN                       12      // GPIO debug (opzionale)
 
+// Trasmissione delle trame dal periferico RMT (LEDC aggiorna il duty solo a
+// fine periodo PWM, 1 ms: troppo lento per mezzi bit da 100 µs)
+#define LIGHT_CODE_TX_RESOLUTION_HZ     1000000 // Tick RMT da 1 µs
+#define LIGHT_CODE_TX_IDLE_UNITS        4       // Riposo alto fra le trame (T), entro i 10T della finestra
+#define LIGHT_CODE_TX_MEM_SYMBOLS       64      // Un blocco RMT: la ripetizione richiede la trama intera
+#define LIGHT_CODE_TX_MAX_LEVELS        (LIGHT_FRAME_MAX_RUNS + 2)
+
 /************************************************
  * PRIVATE GLOBAL VARIABLES                    *
  ************************************************/
 
-static uint8_t sense_queue_0[SENSE_QUEUE_SIZE]; // Buffer campioni primario
-static uint8_t *queue_ptr = NULL;               // Puntatore buffer attivo
+#if !LIGHT_CODE_EDGE_CAPTURE
+static uint32_t sense_queue_0[LIGHT_CODE_QUEUE_WORDS]; // Buffer campioni, 32 per parola
+static uint32_t *queue_ptr = NULL;              // Puntatore buffer attivo
 static uint32_t queue_index = 0;                // Indice scrittura corrente
 
-static uint8_t mean_buffer[MEAN_SIZE];          // Buffer filtro media mobile
+static uint32_t mean_history = 0;               // Ultimi 3 campioni per il filtro
 static bool mean_buffer_initialized = false;    // Flag inizializzazione filtro
 
-static esp_timer_handle_t light_code_timer = NULL;  // Timer campionamento
+static esp_timer_handle_t light_code_timer = NULL;  // Timer campionamento, armato per acquisizione
+#endif
+
+static light_code_stats_t stats;
+static portMUX_TYPE capture_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static uint64_t init_time_us = 0;
+
+static rmt_channel_handle_t tx_channel = NULL;  // Trasmettitore attivo (NULL = ricezione)
+static rmt_encoder_handle_t tx_encoder = NULL;
+static rmt_symbol_word_t tx_symbols[LIGHT_CODE_TX_MAX_LEVELS / 2];  // Letti dal driver a ogni ripetizione
 
 /************************************************
  * PRIVATE FUNCTIONS IMPLEMENTATION           *
  ************************************************/
 
+#if LIGHT_CODE_EDGE_CAPTURE
+
+/**
+ * @brief Sorgente GPIO + timer di sistema per lightcode_capture
+ * @desc Le sezioni critiche _SAFE valgono sia in ISR sia nei task.
+ */
+static uint8_t light_code_io_read_level(void) {
+    return (uint8_t)gpio_get_level(SENSE_DIGITAL_IN_PIN);
+}
+
+static uint32_t light_code_io_now_us(void) {
+    return (uint32_t)esp_timer_get_time();
+}
+
+static void light_code_io_edge_irq(bool enable) {
+    if (enable) {
+        gpio_intr_enable(SENSE_DIGITAL_IN_PIN);
+    } else {
+        gpio_intr_disable(SENSE_DIGITAL_IN_PIN);
+    }
+}
+
+static void light_code_io_lock(void) {
+    portENTER_CRITICAL_SAFE(&capture_lock);
+}
+
+static void light_code_io_unlock(void) {
+    portEXIT_CRITICAL_SAFE(&capture_lock);
+}
+
+static const light_code_io_if_t gpio_source = {
+    .name = "gpio",
+    .read_level = light_code_io_read_level,
+    .now_us = light_code_io_now_us,
+    .edge_irq = light_code_io_edge_irq,
+    .lock = light_code_io_lock,
+    .unlock = light_code_io_unlock,
+};
+
+/**
+ * @brief ISR sui fronti del sensore digitale
+ * @desc Il fronte va a light_code_on_edge; qui solo chiamate e cicli CPU.
+ *       Il servizio ISR è installato senza ESP_INTR_FLAG_IRAM: il gestore
+ *       non gira a cache disabilitata e può restare in flash.
+ */
+static void light_code_edge_isr(void *arg) {
+    uint32_t cycles = esp_cpu_get_cycle_count();
+
+    light_code_on_edge();
+
+    portENTER_CRITICAL_ISR(&capture_lock);
+    stats.isr_calls++;
+    stats.isr_cycles += esp_cpu_get_cycle_count() - cycles;
+    portEXIT_CRITICAL_ISR(&capture_lock);
+}
+
+#else
+
 /**
  * @brief Callback timer campionamento ad alta frequenza
- * @desc Eseguito ogni 15μs per acquisire stato sensore luce.
- *       Identico al comportamento Nordic originale.
+ * @desc Eseguito ogni 15μs per acquisire stato sensore luce, come il Nordic
+ *       originale, ma solo dall'armamento: al campione SENSE_QUEUE_SIZE il
+ *       timer si ferma fino all'acquisizione successiva.
  */
 static void light_code_timer_callback(void *arg) {
+    uint32_t cycles = esp_cpu_get_cycle_count();
+
+    portENTER_CRITICAL(&capture_lock);
     if (queue_index < SENSE_QUEUE_SIZE) {
         // Lettura stato pin sensore digitale (come Nordic)
         int pin_state = gpio_get_level(SENSE_DIGITAL_IN_PIN);
-        queue_ptr[queue_index++] = (uint8_t)pin_state;
+        light_code_pack_sample(queue_ptr, queue_index++, (uint8_t)pin_state);
+    }
+    bool full = queue_index >= SENSE_QUEUE_SIZE;
+    stats.isr_calls++;
+    stats.isr_cycles += esp_cpu_get_cycle_count() - cycles;
+    portEXIT_CRITICAL(&capture_lock);
+
+    if (full) {
+        esp_timer_stop(light_code_timer);
     }
 }
 
 /**
  * @brief Reset sistema acquisizione per nuovo frame
- * @desc Identico al comportamento Nordic originale
+ * @desc Azzera la coda e arma il timer: il primo campione cade
+ *       LIGHT_CODE_SAMPLE_US dopo la chiamata, l'ultimo dopo LIGHT_CODE_CAPTURE_US.
  */
 void light_code_reset_queue(void) {
+    if (light_code_timer == NULL) {
+        return;
+    }
+    esp_timer_stop(light_code_timer);   // ESP_ERR_INVALID_STATE se già fermo
+
+    portENTER_CRITICAL(&capture_lock);
     queue_index = 0;
+    memset(sense_queue_0, 0, sizeof(sense_queue_0));
 
     // Inizializzazione buffer filtro al primo reset (come Nordic)
     if (!mean_buffer_initialized) {
-        memset(mean_buffer, 0, sizeof(mean_buffer));
+        mean_history = 0;
         mean_buffer_initialized = true;
     }
+    stats.captures++;
+    portEXIT_CRITICAL(&capture_lock);
+
+    esp_err_t ret = esp_timer_start_periodic(light_code_timer, LIGHT_CODE_SAMPLE_US);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "⚠️ Sampling timer not armed: %s", esp_err_to_name(ret));
+    }
 }
 
 /**
  * @brief Applica filtro media mobile ai campioni acquisiti
- * @desc Implementa ESATTAMENTE lo stesso algoritmo del Nordic originale
+ * @desc Stessi risultati del Nordic originale, a parole di 32 campioni.
+ *       Disarma il timer se la coda non è ancora piena.
  */
 void light_code_pickup(void) {
+    if (light_code_timer) {
+        esp_timer_stop(light_code_timer);
+    }
+
     if (queue_ptr == NULL || queue_index == 0) {
         return;
     }
 
-    uint8_t temp_buffer[SENSE_QUEUE_SIZE];
+    light_code_filter_packed(queue_ptr, &mean_history);
+}
 
-    // Applicazione filtro media mobile - ALGORITMO IDENTICO A NORDIC
-    for (uint8_t i = 0; i < SENSE_QUEUE_SIZE; i++) {
-        uint8_t mean = 0;
+/**
+ * @brief Decodifica segnale ottico in codice dati
+ * @return Codice decodificato (0 in caso di errore)
+ * @desc Stessi risultati del Nordic originale, un livello per iterazione
+ */
+uint8_t light_code_check(void) {
+    return light_code_decode_packed(queue_ptr);
+}
 
-        // Shift buffer media e accumulo valori - IDENTICO A NORDIC
-        for (uint8_t j = 1; j < MEAN_SIZE; j++) {
-            mean_buffer[j - 1] = mean_buffer[j];
-            mean += mean_buffer[j];
-        }
+/**
+ * @brief Trame non disponibili: la coda copre 1.8 ms, meno di una trama
+ */
+bool light_code_get_frame(light_frame_t *frame) {
+    return false;
+}
+
+#endif // LIGHT_CODE_EDGE_CAPTURE
+
+void light_code_get_stats(light_code_stats_t *out) {
+#if LIGHT_CODE_EDGE_CAPTURE
+    light_code_capture_stats_t edge;
+    light_code_capture_get_stats(&edge);
+#endif
+
+    portENTER_CRITICAL(&capture_lock);
+    *out = stats;
+    portEXIT_CRITICAL(&capture_lock);
+#if LIGHT_CODE_EDGE_CAPTURE
+    out->captures = edge.captures;
+    out->edges = edge.edges;
+    out->overflows = edge.overflows;
+    out->frames = edge.frames;
+    out->frame_errors = edge.frame_errors;
+#endif
+    out->uptime_us = (uint64_t)esp_timer_get_time() - init_time_us;
+}
+
+/**
+ * @brief Trama come simboli RMT, seguita dal riposo alto
+ * @return Numero di simboli (due livelli ciascuno)
+ */
+static uint16_t light_code_tx_symbols(uint16_t payload, rmt_symbol_word_t *symbols) {
+    uint16_t run_us[LIGHT_CODE_TX_MAX_LEVELS];
+    uint8_t level[LIGHT_CODE_TX_MAX_LEVELS];
+    uint16_t runs = light_frame_encode(payload, run_us);
+    uint16_t idle_us = LIGHT_CODE_TX_IDLE_UNITS * LIGHT_FRAME_HALF_US;
+
+    for (uint16_t r = 0; r < runs; r++) {
+        level[r] = !(r & 1);
+    }
 
-        // Inserimento nuovo campione e calcolo media - IDENTICO A NORDIC
-        mean_buffer[MEAN_SIZE - 1] = queue_ptr[i];
-        mean += mean_buffer[0];
+    // Riposo alto: prolunga l'ultimo livello se alto, altrimenti lo segue
+    if (level[runs - 1]) {
+        run_us[runs - 1] += idle_us;
+    } else {
+        run_us[runs] = idle_us;
+        level[runs++] = 1;
+    }
 
-        // Sostituzione campione con valore filtrato - IDENTICO A NORDIC
-        temp_buffer[i] = (uint8_t)(((float)mean / (float)MEAN_SIZE) + 0.5);
+    // Numero di livelli dispari: l'ultimo (alto) si divide in due mezzi simboli
+    if (runs & 1) {
+        uint16_t last = run_us[runs - 1];
+        run_us[runs - 1] = last / 2;
+        run_us[runs] = last - last / 2;
+        level[runs++] = 1;
     }
 
-    // Copia buffer filtrato nel buffer principale
-    memcpy(queue_ptr, temp_buffer, SENSE_QUEUE_SIZE);
+    for (uint16_t s = 0; s < runs / 2; s++) {
+        symbols[s].duration0 = run_us[2 * s];
+        symbols[s].level0 = level[2 * s];
+        symbols[s].duration1 = run_us[2 * s + 1];
+        symbols[s].level1 = level[2 * s + 1];
+    }
+
+    return runs / 2;
 }
 
-/**
- * @brief Decodifica segnale ottico in codice dati
- * @return Codice decodificato (0 in caso di errore)
- * @desc Implementa ESATTAMENTE lo stesso algoritmo del Nordic originale
- */
-uint8_t light_code_check(void) {
+esp_err_t light_code_transmit_start(int gpio_num, uint16_t payload) {
+    if (tx_channel != NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
 
-    static uint32_t count;
-    static uint32_t bits;
-    static uint8_t code;
-    uint8_t bit_value = 0;
+    uint16_t count = light_code_tx_symbols(payload, tx_symbols);
 
-    // Inizializzazione come in Nordic originale
-    code = 0;
-    count = 0;
-    bits = 0;
+    rmt_tx_channel_config_t tx_config = {
+        .gpio_num = gpio_num,
+        .clk_src = RMT_CLK_SRC_DEFAULT,
+        .resolution_hz = LIGHT_CODE_TX_RESOLUTION_HZ,
+        .mem_block_symbols = LIGHT_CODE_TX_MEM_SYMBOLS,
+        .trans_queue_depth = 1,
+    };
+    rmt_copy_encoder_config_t encoder_config = { 0 };
+    rmt_transmit_config_t transmit_config = { .loop_count = -1 };  // Ripetizione continua
 
-    // Scansione range ESATTAMENTE come Nordic: 20-80
-    for (uint32_t i = 20; i < 80; i++) {
-        if (i >= SENSE_QUEUE_SIZE) {
-            break;  // Safety check
-        }
+    esp_err_t ret = rmt_new_tx_channel(&tx_config, &tx_channel);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create RMT TX channel: %s", esp_err_to_name(ret));
+        tx_channel = NULL;
+        return ret;
+    }
 
-        if (queue_ptr[i] == bit_value) {
-            count++;
-        } else {
-            count = 0;
-            bit_value = queue_ptr[i];  // Aggiorna bit_value quando cambia
-        }
+    ret = rmt_new_copy_encoder(&encoder_config, &tx_encoder);
+    if (ret == ESP_OK) ret = rmt_enable(tx_channel);
+    if (ret == ESP_OK) ret = rmt_transmit(tx_channel, tx_encoder, tx_symbols,
+                                          count * sizeof(rmt_symbol_word_t), &transmit_config);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start optical ID transmission: %s", esp_err_to_name(ret));
+        light_code_transmit_stop();
+        return ret;
+    }
 
-        // Logica ESATTAMENTE come Nordic originale
-        if (count >= 5) {
-            if (bits < 8) {
-                code |= (bit_value << (7 - bits));  // MSB first - IDENTICO A NORDIC
-            }
+    ESP_LOGI(TAG, "💡 Trasmissione ID 0x%04X su GPIO %d: %u simboli, %d us per trama",
+             payload, gpio_num, count, LIGHT_FRAME_US + LIGHT_CODE_TX_IDLE_UNITS * LIGHT_FRAME_HALF_US);
+    return ESP_OK;
+}
 
-            bits++;
-            bit_value = (bit_value) ? 0 : 1;  // Alterna bit - IDENTICO A NORDIC
-            count = 0;
+void light_code_transmit_stop(void) {
+    if (tx_channel == NULL) {
+        return;
+    }
+
+    // Disabilitare il canale interrompe la ripetizione; il pin torna libero
+    rmt_disable(tx_channel);
+    rmt_del_channel(tx_channel);
+    if (tx_encoder != NULL) {
+        rmt_del_encoder(tx_encoder);
+    }
+    tx_channel = NULL;
+    tx_encoder = NULL;
+}
+
+bool light_code_is_transmitting(void) {
+    return tx_channel != NULL;
+}
+
+void light_code_log_stats(void) {
+    light_code_stats_t s;
+    light_code_get_stats(&s);
+
+    double seconds = s.uptime_us / 1e6;
+    if (seconds <= 0.0) {
+        return;
+    }
+
+    double cpu_us = (double)s.isr_cycles / esp_rom_get_cpu_ticks_per_us();
+#if LIGHT_CODE_EDGE_CAPTURE
+    ESP_LOGI(TAG, "📊 Acquisizione a fronti: %lu acquisizioni, %lu fronti, %lu ISR (%.1f/s), %lu overflow",
+             s.captures, s.edges, s.isr_calls, s.isr_calls / seconds, s.overflows);
+    ESP_LOGI(TAG, "📊 Trame: %lu valide, %lu scartate (CRC o codifica)", s.frames, s.frame_errors);
+    ESP_LOGI(TAG, "📊 CPU nella ISR: %.0f us totali, %.1f cicli/ISR, carico %.5f%%",
+             cpu_us, s.isr_calls ? (double)s.isr_cycles / s.isr_calls : 0.0, 100.0 * cpu_us / s.uptime_us);
+    ESP_LOGI(TAG, "📊 Polling equivalente: %d callback/s in contesto task",
+             1000000 / LIGHT_CODE_SAMPLE_US);
+#else
+    // Confronto col timer sempre attivo del Nordic originale, a parità di costo per callback
+    double per_call_us = s.isr_calls ? cpu_us / s.isr_calls : 0.0;
+    double continuous = 100.0 * per_call_us * (1000000 / LIGHT_CODE_SAMPLE_US) / 1e6;
+    double armed = 100.0 * cpu_us / s.uptime_us;
+    ESP_LOGI(TAG, "📊 Polling armato: %lu acquisizioni, %lu callback (%.1f/s), %.1f cicli/callback",
+             s.captures, s.isr_calls, s.isr_calls / seconds,
+             s.isr_calls ? (double)s.isr_cycles / s.isr_calls : 0.0);
+    ESP_LOGI(TAG, "📊 CPU nelle callback: carico %.5f%%, sempre attivo %.3f%% (%d callback/s), riduzione %.0fx",
+             armed, continuous, 1000000 / LIGHT_CODE_SAMPLE_US, armed > 0.0 ? continuous / armed : 0.0);
+#endif
+}
+
+void light_code_bench(uint32_t frames) {
+    uint8_t queue[SENSE_QUEUE_SIZE];
+    uint32_t packed[LIGHT_CODE_QUEUE_WORDS];
+    uint8_t history[MEAN_SIZE] = { 0 };
+    uint32_t packed_history = 0;
+    uint32_t seed = 0x2545F491u;
+    uint64_t bytes_cycles = 0, packed_cycles = 0;
+    uint32_t mismatches = 0, valid = 0;
+
+    for (uint32_t f = 0; f < frames; f++) {
+        // Forma d'onda NRZ con periodo di bit fra 5 e 10 campioni
+        seed = seed * 1664525u + 1013904223u;
+        uint32_t period = 5 + (seed >> 28) % 6;
+        uint8_t level = 0;
+        for (uint32_t i = 0; i < SENSE_QUEUE_SIZE; i++) {
+            if (i % period == 0) {
+                seed = seed * 1664525u + 1013904223u;
+                level = (uint8_t)(seed >> 31);
+            }
+            queue[i] = level;
         }
+        light_code_pack(queue, packed);
+
+        uint32_t start = esp_cpu_get_cycle_count();
+        light_code_filter(queue, history);
+        uint8_t code_bytes = light_code_decode_samples(queue);
+        uint32_t mid = esp_cpu_get_cycle_count();
+        light_code_filter_packed(packed, &packed_history);
+        uint8_t code_packed = light_code_decode_packed(packed);
+        uint32_t end = esp_cpu_get_cycle_count();
+
+        bytes_cycles += mid - start;
+        packed_cycles += end - mid;
+        mismatches += (code_bytes != code_packed);
+        valid += (code_bytes != 0);
     }
 
-    // Verifica ESATTAMENTE come Nordic originale
-    if (bits < 6 || bits > 7) {
-        return 0;
+    if (frames == 0) {
+        return;
     }
 
-    return code & LIGHT_CODE_MASK;
+    ESP_LOGI(TAG, "📊 Bench %lu frame (%lu codici validi): byte %llu cicli/frame, compatta %llu cicli/frame, %lu differenze",
+             frames, valid, bytes_cycles / frames, packed_cycles / frames, mismatches);
 }
 
 /**
  * @brief Inizializzazione sistema comunicazione ottica
- * @desc Configura hardware sensore e timer campionamento.
+ * @desc Configura hardware sensore e acquisizione (fronti o timer).
  *       Basato su architettura Nordic con adattamento ESP32.
  */
 void light_code_init(void) {
     esp_err_t ret;
 
     ESP_LOGI(TAG, "Initializing Lightcode communication system");
+    init_time_us = (uint64_t)esp_timer_get_time();
+
+#if LIGHT_CODE_EDGE_CAPTURE
+    // Configurazione GPIO sensore input, interruzione su entrambi i fronti
+    gpio_config_t io_conf = {
+        .pin_bit_mask = (1ULL << SENSE_DIGITAL_IN_PIN),
+        .mode = GPIO_MODE_INPUT,
+        .pull_up_en = GPIO_PULLUP_DISABLE,
+        .pull_down_en = GPIO_PULLDOWN_DISABLE,
+        .intr_type = GPIO_INTR_ANYEDGE,
+    };
+    ret = gpio_config(&io_conf);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to configure sensor GPIO: %s", esp_err_to_name(ret));
+        return;
+    }
+
+    memset(&stats, 0, sizeof(stats));
+    light_code_capture_init(&gpio_source);
 
+    // Servizio ISR condiviso con zero-cross e PIR: già installato è accettato
+    gpio_intr_disable(SENSE_DIGITAL_IN_PIN);
+    ret = gpio_install_isr_service(0);
+    if (ret != ESP_OK && ret != ESP_ERR_INVALID_STATE) {
+        ESP_LOGE(TAG, "Failed to install GPIO ISR service: %s", esp_err_to_name(ret));
+        return;
+    }
+
+    ret = gpio_isr_handler_add(SENSE_DIGITAL_IN_PIN, light_code_edge_isr, NULL);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to add edge ISR: %s", esp_err_to_name(ret));
+        return;
+    }
+
+    // Reset iniziale sistema (arma la prima acquisizione)
+    light_code_reset_queue();
+
+    ESP_LOGI(TAG, "Lightcode system initialized successfully");
+    ESP_LOGI(TAG, "Edge capture: %d us window, %d edges max, sample grid %d us",
+             LIGHT_CODE_CAPTURE_US, LIGHT_CODE_MAX_RUNS, LIGHT_CODE_SAMPLE_US);
+    ESP_LOGI(TAG, "Frames: %d us window, T = %d us, %d-bit ID + CRC-8",
+             LIGHT_CODE_FRAME_WINDOW_US, LIGHT_FRAME_HALF_US, LIGHT_FRAME_PAYLOAD_BITS);
+#else
     // Inizializzazione strutture dati
     queue_ptr = sense_queue_0;
     queue_index = 0;
@@ -191,18 +484,13 @@ void light_code_init(void) {
         return;
     }
 
-    // Timer periodico a 15μs (stesso periodo Nordic)
-    ret = esp_timer_start_periodic(light_code_timer, 15);
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to start sampling timer: %s", esp_err_to_name(ret));
-        esp_timer_delete(light_code_timer);
-        light_code_timer = NULL;
-        return;
-    }
+    memset(&stats, 0, sizeof(stats));
 
-    // Reset iniziale sistema
+    // Reset iniziale sistema: arma il timer a 15μs (stesso periodo Nordic) per
+    // una sola acquisizione; le successive le arma lo scheduler degli slot
     light_code_reset_queue();
 
     ESP_LOGI(TAG, "Lightcode system initialized successfully");
-    ESP_LOGI(TAG, "Sampling rate: 15μs, Buffer size: %d samples", SENSE_QUEUE_SIZE);
-}
\ No newline at end of file
+    ESP_LOGI(TAG, "Sampling rate: 15μs, Buffer size: %d samples, armed per capture", SENSE_QUEUE_SIZE);
+#endif
+}
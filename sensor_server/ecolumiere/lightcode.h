@@ -9,17 +9,42 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include "esp_err.h"
+#include "lightcode_capture.h"
 
 /************************************************
  * PUBLIC DEFINES AND MACRO                     *
  ************************************************/
 
 #define LIGHT_CODE_ONE                   0x55    // Codice identificativo dispositivo master
-#define LIGHT_CODE_MASK                  0x7E    // Maschera 7-bit per codifica dati
 #define LIGHT_CODE_ZERO                  0x00    // Codice zero (nessuna comunicazione)
 
-#define SENSE_QUEUE_SIZE                 120     // Dimensione buffer campioni
-#define MEAN_SIZE                        4       // Dimensione filtro media mobile
+/************************************************
+ * PUBLIC TYPES                                 *
+ ************************************************/
+
+/**
+ * @brief Statistiche dell'acquisizione
+ * @field captures: Acquisizioni armate
+ * @field edges: Fronti registrati
+ * @field isr_calls: Chiamate della ISR (anche fronti ignorati) o callback del timer di polling
+ * @field isr_cycles: Cicli CPU spesi nella ISR o nelle callback
+ * @field overflows: Acquisizioni con più di LIGHT_CODE_MAX_RUNS fronti
+ * @field frames: Trame valide (lightframe) ricevute
+ * @field frame_errors: Trame scartate per CRC o violazioni di codifica
+ * @field uptime_us: Tempo dall'inizializzazione
+ */
+typedef struct light_code_stats_t
+{
+    uint32_t captures;
+    uint32_t edges;
+    uint32_t isr_calls;
+    uint64_t isr_cycles;
+    uint32_t overflows;
+    uint32_t frames;
+    uint32_t frame_errors;
+    uint64_t uptime_us;
+} light_code_stats_t;
 
 /************************************************
  * PUBLIC PROTOTYPES                           *
@@ -27,23 +52,46 @@
 
 /**
  * @brief Inizializza il sistema di comunicazione ottica
+ * @desc Acquisizione (light_code_reset_queue, light_code_pickup,
+ *       light_code_check, light_code_get_frame) in lightcode_capture.h.
  */
 void light_code_init(void);
 
 /**
- * @brief Reset coda campioni per nuova acquisizione
+ * @brief Avvia la trasmissione ottica di un identificativo
+ * @desc Trame lightframe ripetute senza sosta dal periferico RMT sul pin
+ *       dell'uscita della lampada, con un riposo alto fra le trame. La luce
+ *       media della lampada resta intorno al 50% per tutta la trasmissione.
+ *       Il pin appartiene all'RMT fino a light_code_transmit_stop(), poi va
+ *       restituito al driver della lampada.
+ * @return ESP_ERR_INVALID_STATE se già in trasmissione, errori del driver RMT
+ */
+esp_err_t light_code_transmit_start(int gpio_num, uint16_t payload);
+
+/**
+ * @brief Interrompe la trasmissione e libera il pin
+ */
+void light_code_transmit_stop(void);
+
+/**
+ * @brief Trasmissione in corso
+ */
+bool light_code_is_transmitting(void);
+
+/**
+ * @brief Copia le statistiche dell'acquisizione a fronti
  */
-void light_code_reset_queue(void);
+void light_code_get_stats(light_code_stats_t *stats);
 
 /**
- * @brief Acquisisce campioni e applica filtraggio
+ * @brief Stampa nel log statistiche e carico CPU dell'acquisizione
  */
-void light_code_pickup(void);
+void light_code_log_stats(void);
 
 /**
- * @brief Decodifica codice ricevuto da segnale ottico
- * @return Codice decodificato (0 in caso di errore)
+ * @brief Confronta su forme d'onda sintetiche la coda a byte e la coda compatta
+ * @desc Cicli CPU per frame di filtro + decodifica e differenze di codice, nel log.
  */
-uint8_t light_code_check(void);
+void light_code_bench(uint32_t frames);
 
 #endif // LIGHTCODE_H
\ No newline at end of file
@@ -0,0 +1,171 @@
+/**
+ * Autore: DJITSOP FUOGOUK LOIC STEVE
+ * Firmware: ECOLUMIERE BLE MESH ESP32
+ * Implementazione: Lightcode Capture - Acquisizione a fronti del sensore digitale
+ */
+
+#include "lightcode_capture.h"
+#include <string.h>
+
+#if LIGHT_CODE_EDGE_CAPTURE
+
+/************************************************
+ * PRIVATE GLOBAL VARIABLES                    *
+ ************************************************/
+
+static const light_code_io_if_t *io = NULL;     // Sorgente del sensore digitale
+static light_code_runs_t capture;               // Fronti dell'acquisizione corrente
+static volatile bool capture_armed = false;     // ISR attiva sui fronti
+static uint32_t capture_start_us = 0;           // Armamento
+static uint32_t capture_last_us = 0;            // Ultimo fronte registrato
+static uint8_t capture_level = 0;               // Livello dopo l'ultimo fronte
+static light_frame_decoder_t frame_decoder;     // Trame in streaming dalla ISR
+static light_frame_t frame_last;                // Ultima trama valida della finestra
+static bool frame_valid = false;
+static light_code_capture_stats_t stats;
+
+/************************************************
+ * PRIVATE FUNCTIONS IMPLEMENTATION           *
+ ************************************************/
+
+/**
+ * @brief Passa un livello concluso al decodificatore delle trame
+ * @desc Chiamata con la sezione critica acquisita.
+ */
+static void light_code_feed_frame(uint8_t level, uint32_t run_us) {
+    light_frame_t frame;
+
+    if (light_frame_feed(&frame_decoder, level, run_us, &frame)) {
+        frame_last = frame;
+        frame_valid = true;
+    }
+}
+
+/************************************************
+ * PUBLIC FUNCTIONS IMPLEMENTATION             *
+ ************************************************/
+
+void light_code_capture_init(const light_code_io_if_t *source) {
+    io = source;
+    capture_armed = false;
+    frame_valid = false;
+    memset(&capture, 0, sizeof(capture));
+    memset(&frame_decoder, 0, sizeof(frame_decoder));
+    memset(&stats, 0, sizeof(stats));
+}
+
+void light_code_on_edge(void) {
+    uint32_t now = io->now_us();
+    uint8_t level = io->read_level();
+
+    io->lock();
+    if (capture_armed) {
+        uint32_t elapsed = now - capture_start_us;
+
+        if (level != capture_level) {
+            uint32_t run = now - capture_last_us;
+            if (elapsed < LIGHT_CODE_CAPTURE_US && !capture.overflow) {
+                if (capture.count < LIGHT_CODE_MAX_RUNS) {
+                    capture.run_us[capture.count++] = (run > UINT16_MAX) ? UINT16_MAX : (uint16_t)run;
+                } else {
+                    capture.overflow = true;
+                    stats.overflows++;
+                }
+            }
+            light_code_feed_frame(capture_level, run);
+            capture_last_us = now;
+            capture_level = level;
+            stats.edges++;
+        }
+
+        if (elapsed >= LIGHT_CODE_FRAME_WINDOW_US) {
+            capture_armed = false;
+            io->edge_irq(false);
+        }
+    }
+    io->unlock();
+}
+
+/**
+ * @brief Reset sistema acquisizione per nuovo frame
+ * @desc Arma la ISR: il livello attuale apre la lista dei fronti.
+ */
+void light_code_reset_queue(void) {
+    if (io == NULL) {
+        return;
+    }
+    io->edge_irq(false);
+
+    io->lock();
+    memset(&capture, 0, sizeof(capture));
+    capture_level = io->read_level();
+    capture.first_level = capture_level;
+    capture_start_us = io->now_us();
+    capture_last_us = capture_start_us;
+    capture_armed = true;
+    light_frame_decoder_reset(&frame_decoder);
+    frame_valid = false;
+    stats.captures++;
+    io->unlock();
+
+    io->edge_irq(true);
+}
+
+/**
+ * @brief Chiude l'acquisizione
+ * @desc La lista dei fronti non richiede filtraggio: il filtro è applicato
+ *       dal decodificatore. Se la finestra non è ancora trascorsa i fronti
+ *       raccolti finora vengono decodificati così come sono. Il livello in
+ *       corso va al decodificatore delle trame: può chiudere l'ultimo mezzo bit.
+ */
+void light_code_pickup(void) {
+    if (io == NULL) {
+        return;
+    }
+    io->edge_irq(false);
+
+    io->lock();
+    if (capture_armed) {
+        light_code_feed_frame(capture_level, io->now_us() - capture_last_us);
+        capture_armed = false;
+    }
+    io->unlock();
+}
+
+/**
+ * @brief Decodifica i fronti acquisiti in codice dati
+ * @return Codice decodificato (0 in caso di errore)
+ */
+uint8_t light_code_check(void) {
+    return light_code_decode_runs(&capture);
+}
+
+bool light_code_get_frame(light_frame_t *frame) {
+    if (io == NULL) {
+        return false;
+    }
+
+    io->lock();
+    bool valid = frame_valid;
+    if (valid && frame) {
+        *frame = frame_last;
+    }
+    io->unlock();
+
+    return valid;
+}
+
+void light_code_capture_get_stats(light_code_capture_stats_t *out) {
+    if (io == NULL) {
+        memset(out, 0, sizeof(*out));
+        return;
+    }
+
+    io->lock();
+    *out = stats;
+    out->frames = frame_decoder.stats.frames;
+    out->frame_errors = frame_decoder.stats.crc_errors + frame_decoder.stats.violations;
+    io->unlock();
+}
+
+#endif // LIGHT_CODE_EDGE_CAPTURE
@@ -0,0 +1,131 @@
+/**
+ * Autore: DJITSOP FUOGOUK LOIC STEVE
+ * Firmware: ECOLUMIERE BLE MESH ESP32
+ * Modulo: Lightcode Capture - Acquisizione a fronti del sensore digitale
+ * Descrizione: Armamento, fronti, chiusura e decodifica dell'acquisizione
+ *              ottica separati dall'hardware. Lettura del pin, timestamp,
+ *              interruzione sui fronti e sezione critica arrivano da una
+ *              sorgente light_code_io_if_t: lightcode.c la implementa con
+ *              GPIO ed esp_timer, i tool host con forme d'onda sintetiche.
+ *              Nessuna dipendenza ESP-IDF.
+ */
+
+#ifndef LIGHTCODE_CAPTURE_H
+#define LIGHTCODE_CAPTURE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "lightcode_decode.h"
+#include "lightframe.h"
+
+/************************************************
+ * PUBLIC DEFINES AND MACRO                     *
+ ************************************************/
+
+// 1 = fronti a interruzione con timestamp del timer di sistema (questo modulo),
+// 0 = polling del pin ogni LIGHT_CODE_SAMPLE_US (originale Nordic, lightcode.c)
+#define LIGHT_CODE_EDGE_CAPTURE          1
+
+// Finestra delle trame: una trama intera qualunque sia la fase dell'armamento,
+// con trasmettitore in ripetizione continua e riposo fino a 10T fra le trame
+#define LIGHT_CODE_FRAME_WINDOW_US       (2 * LIGHT_FRAME_US + 10 * LIGHT_FRAME_HALF_US)
+
+/************************************************
+ * PUBLIC TYPES                                 *
+ ************************************************/
+
+/**
+ * @brief Accesso al sensore digitale
+ * @desc Le funzioni sono chiamate anche dalla ISR dei fronti: non devono
+ *       bloccare. lock/unlock proteggono lo stato dell'acquisizione fra ISR
+ *       e task e devono funzionare in entrambi i contesti.
+ * @field name: Nome per i log
+ * @field read_level: Livello attuale del pin (0/1)
+ * @field now_us: Timestamp in µs (a 32 bit, con ritorno a zero)
+ * @field edge_irq: Abilita o disabilita l'interruzione sui fronti
+ * @field lock/unlock: Sezione critica
+ */
+typedef struct light_code_io_if_t
+{
+    const char *name;
+    uint8_t (*read_level)(void);
+    uint32_t (*now_us)(void);
+    void (*edge_irq)(bool enable);
+    void (*lock)(void);
+    void (*unlock)(void);
+} light_code_io_if_t;
+
+/**
+ * @brief Contatori dell'acquisizione a fronti
+ * @field captures: Acquisizioni armate
+ * @field edges: Fronti registrati
+ * @field overflows: Acquisizioni con più di LIGHT_CODE_MAX_RUNS fronti
+ * @field frames: Trame valide (lightframe) ricevute
+ * @field frame_errors: Trame scartate per CRC o violazioni di codifica
+ */
+typedef struct light_code_capture_stats_t
+{
+    uint32_t captures;
+    uint32_t edges;
+    uint32_t overflows;
+    uint32_t frames;
+    uint32_t frame_errors;
+} light_code_capture_stats_t;
+
+/************************************************
+ * PUBLIC PROTOTYPES                           *
+ ************************************************/
+
+/**
+ * @brief Collega la sorgente e azzera acquisizione e contatori
+ * @desc Non arma l'acquisizione: la prima la arma light_code_reset_queue().
+ */
+void light_code_capture_init(const light_code_io_if_t *io);
+
+/**
+ * @brief Fronte del sensore digitale (corpo della ISR)
+ * @desc Registra la durata del livello appena concluso. Un fronte che non
+ *       cambia il livello letto (impulso più corto della latenza della ISR)
+ *       viene ignorato: il filtro del decodificatore lo scarterebbe comunque.
+ *       La lista dei fronti si ferma a LIGHT_CODE_CAPTURE_US o a buffer
+ *       pieno; il decodificatore delle trame riceve ogni livello fino a
+ *       LIGHT_CODE_FRAME_WINDOW_US, poi l'interruzione si disattiva da sola.
+ */
+void light_code_on_edge(void);
+
+/**
+ * @brief Copia i contatori dell'acquisizione a fronti
+ */
+void light_code_capture_get_stats(light_code_capture_stats_t *stats);
+
+/**
+ * @brief Reset coda campioni e armamento di una nuova acquisizione
+ * @desc Chiamata dallo scheduler degli slot subito prima dello slot device ID.
+ *       Con l'acquisizione a fronti arma la ISR: la lista dei fronti copre
+ *       LIGHT_CODE_CAPTURE_US, le trame LIGHT_CODE_FRAME_WINDOW_US. Con il
+ *       polling avvia il timer, che si ferma da solo dopo SENSE_QUEUE_SIZE campioni.
+ */
+void light_code_reset_queue(void);
+
+/**
+ * @brief Acquisisce campioni e applica filtraggio
+ */
+void light_code_pickup(void);
+
+/**
+ * @brief Decodifica codice ricevuto da segnale ottico
+ * @return Codice decodificato (0 in caso di errore)
+ */
+uint8_t light_code_check(void);
+
+/**
+ * @brief Ultima trama valida dell'acquisizione corrente
+ * @desc Le trame (preambolo, identificativo a 16 bit, CRC-8) sono decodificate
+ *       in streaming dalla ISR per LIGHT_CODE_FRAME_WINDOW_US dall'armamento.
+ *       Con il polling non sono disponibili.
+ * @param frame: Trama con confidenza e ripetizioni (può essere NULL)
+ * @return true se nella finestra è arrivata almeno una trama valida
+ */
+bool light_code_get_frame(light_frame_t *frame);
+
+#endif // LIGHTCODE_CAPTURE_H
@@ -0,0 +1,283 @@
+/**
+ * Autore: DJITSOP FUOGOUK LOIC STEVE
+ * Firmware: ECOLUMIERE BLE MESH ESP32
+ * Implementazione: Lightcode Decode - Decodifica del codice ottico
+ * Basato su: Implementazione Nordic originale
+ */
+
+#include "lightcode_decode.h"
+#include <string.h>
+
+/************************************************
+ * PRIVATE TYPES                               *
+ ************************************************/
+
+/**
+ * @brief Stato della scansione dei bit (variabili di light_code_check Nordic)
+ */
+typedef struct {
+    uint8_t bit_value;
+    uint32_t count;
+    uint32_t bits;
+    uint8_t code;
+} light_code_scan_t;
+
+/************************************************
+ * PRIVATE FUNCTIONS IMPLEMENTATION           *
+ ************************************************/
+
+/**
+ * @brief Registra un bit riconosciuto (MSB first, come Nordic)
+ */
+static void light_code_emit(light_code_scan_t *scan) {
+    if (scan->bits < 8) {
+        scan->code |= (scan->bit_value << (7 - scan->bits));
+    }
+
+    scan->bits++;
+    scan->bit_value = (scan->bit_value) ? 0 : 1;
+    scan->count = 0;
+}
+
+/**
+ * @brief Avanza la scansione di un livello costante lungo length campioni
+ * @desc Stesso risultato di length passi campione per campione: il primo
+ *       campione diverso da bit_value azzera il conteggio, poi un bit ogni
+ *       LIGHT_CODE_RUN_SAMPLES campioni più uno di riallineamento.
+ */
+static void light_code_scan_run(light_code_scan_t *scan, uint8_t level, uint32_t length) {
+    while (length > 0) {
+        if (level != scan->bit_value) {
+            scan->count = 0;
+            scan->bit_value = level;
+            length--;
+            continue;
+        }
+
+        uint32_t need = LIGHT_CODE_RUN_SAMPLES - scan->count;
+        if (length < need) {
+            scan->count += length;
+            return;
+        }
+
+        length -= need;
+        light_code_emit(scan);
+    }
+}
+
+/**
+ * @brief Verifica finale (ESATTAMENTE come Nordic originale)
+ */
+static uint8_t light_code_result(const light_code_scan_t *scan) {
+    if (scan->bits < LIGHT_CODE_MIN_BITS || scan->bits > LIGHT_CODE_MAX_BITS) {
+        return 0;
+    }
+
+    return scan->code & LIGHT_CODE_MASK;
+}
+
+/**
+ * @brief Indice del primo campione preso a partire da t_us dall'armamento
+ */
+static uint32_t light_code_sample_at(uint32_t t_us) {
+    return (t_us + LIGHT_CODE_SAMPLE_US - 1) / LIGHT_CODE_SAMPLE_US;
+}
+
+/**
+ * @brief Intervalli alti del segnale filtrato, uniti se si sovrappongono
+ * @field open: Un intervallo in attesa di essere scansionato
+ * @field start, end: Intervallo in attesa [start, end)
+ * @field pos: Primo campione non ancora scansionato (finestra)
+ */
+typedef struct {
+    bool open;
+    int32_t start;
+    int32_t end;
+    uint32_t pos;
+} light_code_high_t;
+
+/**
+ * @brief Scansiona l'intervallo alto in attesa e lo zero che lo precede
+ */
+static void light_code_flush_high(light_code_scan_t *scan, light_code_high_t *high) {
+    if (!high->open) return;
+    high->open = false;
+
+    uint32_t start = (high->start < (int32_t)high->pos) ? high->pos : (uint32_t)high->start;
+    uint32_t end = (high->end > LIGHT_CODE_WINDOW_END) ? LIGHT_CODE_WINDOW_END : (uint32_t)high->end;
+    if (start >= end) return;
+
+    light_code_scan_run(scan, 0, start - high->pos);
+    light_code_scan_run(scan, 1, end - start);
+    high->pos = end;
+}
+
+/**
+ * @brief Aggiunge un livello alto grezzo [begin, end) (campioni)
+ * @desc Il filtro lo porta a [begin + 2, end + 3), un campione isolato a
+ *       [begin + 3, begin + 4).
+ */
+static void light_code_add_high(light_code_scan_t *scan, light_code_high_t *high, int32_t begin, int32_t end) {
+    int32_t start = (end - begin == 1) ? begin + 3 : begin + 2;
+
+    if (high->open && start <= high->end) {
+        high->end = end + 3;
+        return;
+    }
+
+    light_code_flush_high(scan, high);
+    high->open = true;
+    high->start = start;
+    high->end = end + 3;
+}
+
+/************************************************
+ * PUBLIC FUNCTIONS IMPLEMENTATION             *
+ ************************************************/
+
+void light_code_filter(uint8_t *queue, uint8_t *history) {
+    uint8_t temp_buffer[SENSE_QUEUE_SIZE];
+
+    // Applicazione filtro media mobile - ALGORITMO IDENTICO A NORDIC
+    for (uint8_t i = 0; i < SENSE_QUEUE_SIZE; i++) {
+        uint8_t mean = 0;
+
+        // Shift buffer media e accumulo valori - IDENTICO A NORDIC
+        for (uint8_t j = 1; j < MEAN_SIZE; j++) {
+            history[j - 1] = history[j];
+            mean += history[j];
+        }
+
+        // Inserimento nuovo campione e calcolo media - IDENTICO A NORDIC
+        history[MEAN_SIZE - 1] = queue[i];
+        mean += history[0];
+
+        // Sostituzione campione con valore filtrato - IDENTICO A NORDIC
+        temp_buffer[i] = (uint8_t)(((float)mean / (float)MEAN_SIZE) + 0.5);
+    }
+
+    memcpy(queue, temp_buffer, SENSE_QUEUE_SIZE);
+}
+
+uint8_t light_code_decode_samples(const uint8_t *queue) {
+    light_code_scan_t scan = { 0 };
+
+    // Scansione range ESATTAMENTE come Nordic: 20-80
+    for (uint32_t i = LIGHT_CODE_WINDOW_FIRST; i < LIGHT_CODE_WINDOW_END && i < SENSE_QUEUE_SIZE; i++) {
+        if (queue[i] == scan.bit_value) {
+            scan.count++;
+        } else {
+            scan.count = 0;
+            scan.bit_value = queue[i];
+        }
+
+        if (scan.count >= LIGHT_CODE_RUN_SAMPLES) {
+            light_code_emit(&scan);
+        }
+    }
+
+    return light_code_result(&scan);
+}
+
+void light_code_pack(const uint8_t *queue, uint32_t *bits) {
+    memset(bits, 0, LIGHT_CODE_QUEUE_WORDS * sizeof(uint32_t));
+
+    for (uint32_t i = 0; i < SENSE_QUEUE_SIZE; i++) {
+        light_code_pack_sample(bits, i, queue[i]);
+    }
+}
+
+void light_code_filter_packed(uint32_t *bits, uint32_t *history) {
+    uint32_t prev = *history;
+
+    for (uint32_t w = 0; w < LIGHT_CODE_QUEUE_WORDS; w++) {
+        uint32_t cur = bits[w];
+
+        // Campioni i-3, i-2, i-1 allineati al campione i (riporto dalla parola precedente)
+        uint32_t d3 = (cur >> 3) | (prev << 29);
+        uint32_t d2 = (cur >> 2) | (prev << 30);
+        uint32_t d1 = (cur >> 1) | (prev << 31);
+
+        bits[w] = d3 | (d2 & d1);
+        prev = cur;
+    }
+
+    // Ultimi tre campioni della coda (non filtrati) per la prossima chiamata;
+    // oltre la fine della coda l'ultima parola resta a zero
+    uint32_t tail = SENSE_QUEUE_SIZE & 31;
+    if (tail != 0) {
+        prev >>= 32 - tail;
+        bits[LIGHT_CODE_QUEUE_WORDS - 1] &= ~0u << (32 - tail);
+    }
+    *history = prev & 0x7;
+}
+
+uint8_t light_code_decode_packed(const uint32_t *bits) {
+    light_code_scan_t scan = { 0 };
+    uint32_t pos = LIGHT_CODE_WINDOW_FIRST;
+
+    while (pos < LIGHT_CODE_WINDOW_END) {
+        uint32_t shift = pos & 31;
+        uint32_t word = bits[pos >> 5] << shift;
+        uint8_t level = (uint8_t)(word >> 31);
+
+        // Primo campione diverso: zeri iniziali della parola (negata se alta)
+        uint32_t diff = level ? ~word : word;
+        uint32_t run = diff ? (uint32_t)__builtin_clz(diff) : 32;
+        if (run > 32 - shift) run = 32 - shift;
+        if (run > LIGHT_CODE_WINDOW_END - pos) run = LIGHT_CODE_WINDOW_END - pos;
+
+        light_code_scan_run(&scan, level, run);
+        pos += run;
+    }
+
+    return light_code_result(&scan);
+}
+
+uint8_t light_code_decode_runs(const light_code_runs_t *runs) {
+    light_code_scan_t scan = { 0 };
+    light_code_high_t high = { .pos = LIGHT_CODE_WINDOW_FIRST };
+    uint32_t t_us = 0;
+    uint8_t level = runs->first_level ? 1 : 0;
+
+    // Livello alto grezzo in corso; la storia del filtro vale first_level
+    bool raw_open = level;
+    int32_t raw_begin = -MEAN_SIZE;
+    int32_t raw_end = 0;
+
+    for (uint16_t i = 0; i <= runs->count; i++) {
+        // Un livello sulla griglia dei campioni: [begin, end), l'ultimo fino a fine finestra
+        int32_t begin = (int32_t)light_code_sample_at(t_us);
+        int32_t end = LIGHT_CODE_WINDOW_END;
+        if (i < runs->count) {
+            t_us += runs->run_us[i];
+            end = (int32_t)light_code_sample_at(t_us);
+        }
+        if (end > LIGHT_CODE_WINDOW_END) end = LIGHT_CODE_WINDOW_END;
+
+        // Un livello senza campioni non interrompe i vicini
+        if (end > begin) {
+            if (level) {
+                if (!raw_open) {
+                    raw_open = true;
+                    raw_begin = begin;
+                }
+                raw_end = end;
+            } else if (raw_open) {
+                light_code_add_high(&scan, &high, raw_begin, raw_end);
+                raw_open = false;
+            }
+        }
+
+        if (end >= LIGHT_CODE_WINDOW_END) break;
+        level ^= 1;
+    }
+
+    if (raw_open) {
+        light_code_add_high(&scan, &high, raw_begin, raw_end);
+    }
+    light_code_flush_high(&scan, &high);
+    light_code_scan_run(&scan, 0, LIGHT_CODE_WINDOW_END - high.pos);
+
+    return light_code_result(&scan);
+}
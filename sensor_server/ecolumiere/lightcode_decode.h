@@ -0,0 +1,129 @@
+/**
+ * Autore: DJITSOP FUOGOUK LOIC STEVE
+ * Firmware: ECOLUMIERE BLE MESH ESP32
+ * Modulo: Lightcode Decode - Decodifica del codice ottico
+ * Descrizione: Decodificatore del codice ottico separato dall'acquisizione.
+ *              Due ingressi equivalenti: la coda di campioni del polling
+ *              (un campione ogni LIGHT_CODE_SAMPLE_US, filtro a media mobile
+ *              e scansione come l'originale Nordic) e la lista di durate fra
+ *              i fronti dell'acquisizione a interruzioni. La lista viene
+ *              decodificata direttamente, run per run: i fronti sono
+ *              riportati sulla griglia di campionamento, il filtro diventa
+ *              un allungamento degli intervalli alti e il conteggio dei bit
+ *              avanza di un bit per iterazione invece che di un campione.
+ *              La coda del polling esiste anche compatta, 32 campioni per
+ *              parola (primo campione nel bit più alto): il filtro diventa
+ *              tre shift e due operazioni logiche per parola e le lunghezze
+ *              dei livelli si contano con count-leading-zeros (NSAU su Xtensa).
+ *              Nessuna dipendenza ESP-IDF.
+ */
+
+#ifndef LIGHTCODE_DECODE_H
+#define LIGHTCODE_DECODE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/************************************************
+ * PUBLIC DEFINES AND MACRO                     *
+ ************************************************/
+
+#define LIGHT_CODE_MASK                  0x7E    // Maschera 7-bit per codifica dati
+
+#define SENSE_QUEUE_SIZE                 120     // Dimensione buffer campioni
+#define MEAN_SIZE                        4       // Dimensione filtro media mobile
+
+#define LIGHT_CODE_SAMPLE_US             15      // Periodo di campionamento (come Nordic)
+#define LIGHT_CODE_WINDOW_FIRST          20      // Primo campione decodificato
+#define LIGHT_CODE_WINDOW_END            80      // Fine della scansione (esclusa)
+#define LIGHT_CODE_RUN_SAMPLES           5       // Campioni uguali per un bit
+#define LIGHT_CODE_MIN_BITS              6
+#define LIGHT_CODE_MAX_BITS              7
+#define LIGHT_CODE_CAPTURE_US            (SENSE_QUEUE_SIZE * LIGHT_CODE_SAMPLE_US)
+#define LIGHT_CODE_MAX_RUNS              64      // Fronti registrati per acquisizione
+#define LIGHT_CODE_QUEUE_WORDS           ((SENSE_QUEUE_SIZE + 31) / 32)  // Coda compatta
+
+/************************************************
+ * PUBLIC TYPES                                 *
+ ************************************************/
+
+/**
+ * @brief Acquisizione a fronti: durate dei livelli dall'armamento
+ * @field first_level: Livello del pin all'armamento
+ * @field count: Fronti registrati
+ * @field run_us: Durata di ogni livello fino al fronte successivo (µs);
+ *        i livelli alternano a partire da first_level e l'ultimo livello
+ *        prosegue oltre la fine dell'acquisizione
+ * @field overflow: Più di LIGHT_CODE_MAX_RUNS fronti nella finestra
+ */
+typedef struct light_code_runs_t
+{
+    uint8_t first_level;
+    uint16_t count;
+    uint16_t run_us[LIGHT_CODE_MAX_RUNS];
+    bool overflow;
+} light_code_runs_t;
+
+/************************************************
+ * PUBLIC PROTOTYPES                           *
+ ************************************************/
+
+/**
+ * @brief Filtro a media mobile della coda di campioni
+ * @desc Stesso algoritmo (e stessi risultati) dell'originale Nordic: il
+ *       campione filtrato è alto se lo è il campione di tre posizioni prima
+ *       o se lo sono entrambi i due precedenti.
+ * @param queue: SENSE_QUEUE_SIZE campioni 0/1, filtrati sul posto
+ * @param history: MEAN_SIZE campioni di storia, aggiornati
+ */
+void light_code_filter(uint8_t *queue, uint8_t *history);
+
+/**
+ * @brief Decodifica la coda filtrata
+ * @return Codice decodificato (0 in caso di errore)
+ */
+uint8_t light_code_decode_samples(const uint8_t *queue);
+
+/**
+ * @brief Scrive un campione alto nella coda compatta (azzerata all'armamento)
+ * @desc Il campione index occupa il bit 31 - (index % 32) della parola index / 32.
+ */
+static inline void light_code_pack_sample(uint32_t *bits, uint32_t index, uint8_t level) {
+    if (level) {
+        bits[index >> 5] |= 0x80000000u >> (index & 31);
+    }
+}
+
+/**
+ * @brief Compatta SENSE_QUEUE_SIZE campioni 0/1 in LIGHT_CODE_QUEUE_WORDS parole
+ */
+void light_code_pack(const uint8_t *queue, uint32_t *bits);
+
+/**
+ * @brief Filtro della coda compatta, parola per parola
+ * @desc Stessi risultati di light_code_filter: alto = x[i-3] | (x[i-2] & x[i-1]),
+ *       una maggioranza pesata (il campione più vecchio conta doppio).
+ * @param bits: LIGHT_CODE_QUEUE_WORDS parole, filtrate sul posto
+ * @param history: Ultimi tre campioni della coda precedente nei bit 2..0
+ *        (il più recente nel bit 0), aggiornati
+ */
+void light_code_filter_packed(uint32_t *bits, uint32_t *history);
+
+/**
+ * @brief Decodifica la coda compatta filtrata
+ * @desc Stesso risultato di light_code_decode_samples; ogni livello costante
+ *       della finestra è misurato con un count-leading-zeros.
+ * @return Codice decodificato (0 in caso di errore)
+ */
+uint8_t light_code_decode_packed(const uint32_t *bits);
+
+/**
+ * @brief Decodifica la lista di fronti
+ * @desc Equivalente a campionare lo stesso segnale ogni LIGHT_CODE_SAMPLE_US
+ *       dall'armamento, filtrare e decodificare la coda, con la storia del
+ *       filtro uguale al livello all'armamento.
+ * @return Codice decodificato (0 in caso di errore)
+ */
+uint8_t light_code_decode_runs(const light_code_runs_t *runs);
+
+#endif // LIGHTCODE_DECODE_H
@@ -0,0 +1,213 @@
+/**
+ * Autore: DJITSOP FUOGOUK LOIC STEVE
+ * Firmware: ECOLUMIERE BLE MESH ESP32
+ * Implementazione: Lightframe - Trama ottica con identificativo e CRC
+ */
+
+#include "lightframe.h"
+#include <string.h>
+
+/************************************************
+ * PRIVATE DEFINES AND TYPES                   *
+ ************************************************/
+
+typedef enum {
+    LIGHT_FRAME_HUNT,       ///< Ricerca dell'alto del preambolo
+    LIGHT_FRAME_SYNC_LOW,   ///< Alto del preambolo visto, atteso il basso
+    LIGHT_FRAME_DATA        ///< Bit della trama
+} light_frame_state_t;
+
+/************************************************
+ * PRIVATE FUNCTIONS IMPLEMENTATION           *
+ ************************************************/
+
+/**
+ * @brief Inizio di una nuova trama dopo il preambolo
+ */
+static void light_frame_start(light_frame_decoder_t *dec, uint16_t sync_err_us) {
+    dec->state = LIGHT_FRAME_DATA;
+    dec->half_pending = false;
+    dec->bits = 0;
+    dec->data = 0;
+    dec->worst_err_us = sync_err_us;
+    dec->stats.syncs++;
+}
+
+/**
+ * @brief Verifica CRC e conclude la trama
+ * @return true se la trama è valida
+ */
+static bool light_frame_complete(light_frame_decoder_t *dec, light_frame_t *out) {
+    uint16_t payload = (uint16_t)(dec->data >> LIGHT_FRAME_CRC_BITS);
+    uint8_t bytes[2] = { (uint8_t)(payload >> 8), (uint8_t)payload };
+
+    dec->state = LIGHT_FRAME_HUNT;
+
+    if (light_frame_crc8(bytes, sizeof(bytes)) != (uint8_t)dec->data || payload == LIGHT_FRAME_ID_NONE) {
+        dec->stats.crc_errors++;
+        return false;
+    }
+
+    // Confidenza: margine del livello peggiore rispetto alla tolleranza
+    uint32_t margin = (dec->worst_err_us >= LIGHT_FRAME_TOLERANCE_US) ? 0 :
+                      LIGHT_FRAME_TOLERANCE_US - dec->worst_err_us;
+
+    if (dec->last.repeats && dec->last.payload == payload) {
+        if (dec->last.repeats < LIGHT_FRAME_MAX_REPEATS) dec->last.repeats++;
+    } else {
+        dec->last.repeats = 1;
+    }
+    dec->last.payload = payload;
+    dec->last.confidence = (uint8_t)(100 * margin / LIGHT_FRAME_TOLERANCE_US);
+    dec->stats.frames++;
+
+    if (out) *out = dec->last;
+    return true;
+}
+
+/**
+ * @brief Interrompe la trama in corso
+ */
+static void light_frame_violation(light_frame_decoder_t *dec) {
+    dec->state = LIGHT_FRAME_HUNT;
+    dec->stats.violations++;
+}
+
+/**
+ * @brief Livello in ricerca: un alto di almeno 3T (meno la tolleranza) è un preambolo
+ * @desc Il riposo alto prima della trama si unisce al preambolo: nessun limite superiore.
+ */
+static void light_frame_hunt(light_frame_decoder_t *dec, uint8_t level, uint32_t duration_us) {
+    if (level && duration_us + LIGHT_FRAME_TOLERANCE_US >= LIGHT_FRAME_SYNC_UNITS * LIGHT_FRAME_HALF_US) {
+        dec->state = LIGHT_FRAME_SYNC_LOW;
+    }
+}
+
+/************************************************
+ * PUBLIC FUNCTIONS IMPLEMENTATION             *
+ ************************************************/
+
+uint8_t light_frame_crc8(const uint8_t *data, uint32_t len) {
+    uint8_t crc = LIGHT_FRAME_CRC_INIT;
+
+    for (uint32_t i = 0; i < len; i++) {
+        crc ^= data[i];
+        for (int b = 0; b < 8; b++) {
+            crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ LIGHT_FRAME_CRC_POLY) : (uint8_t)(crc << 1);
+        }
+    }
+
+    return crc ^ LIGHT_FRAME_CRC_XOROUT;
+}
+
+uint16_t light_frame_encode(uint16_t payload, uint16_t *run_us) {
+    uint8_t bytes[2] = { (uint8_t)(payload >> 8), (uint8_t)payload };
+    uint32_t frame = ((uint32_t)payload << LIGHT_FRAME_CRC_BITS) | light_frame_crc8(bytes, sizeof(bytes));
+    uint16_t count = 0;
+    uint8_t level = 1;
+    uint16_t units = LIGHT_FRAME_SYNC_UNITS;
+
+    // Mezzi bit dopo il preambolo: 1 = alto, basso; 0 = basso, alto
+    uint8_t halves[2 * LIGHT_FRAME_BITS + 1];
+    halves[0] = 0;  // Basso del preambolo, unito al primo mezzo bit se basso
+    for (int b = 0; b < LIGHT_FRAME_BITS; b++) {
+        uint8_t bit = (frame >> (LIGHT_FRAME_BITS - 1 - b)) & 1;
+        halves[1 + 2 * b] = bit;
+        halves[2 + 2 * b] = !bit;
+    }
+
+    for (uint32_t h = 0; h < sizeof(halves); h++) {
+        uint16_t add = (h == 0) ? LIGHT_FRAME_SYNC_UNITS : 1;
+        if (halves[h] == level) {
+            units += add;
+            continue;
+        }
+        run_us[count++] = units * LIGHT_FRAME_HALF_US;
+        level = halves[h];
+        units = add;
+    }
+    run_us[count++] = units * LIGHT_FRAME_HALF_US;
+
+    return count;
+}
+
+void light_frame_decoder_reset(light_frame_decoder_t *dec) {
+    dec->state = LIGHT_FRAME_HUNT;
+    dec->half_pending = false;
+    dec->bits = 0;
+    dec->data = 0;
+    dec->worst_err_us = 0;
+}
+
+bool light_frame_feed(light_frame_decoder_t *dec, uint8_t level, uint32_t duration_us, light_frame_t *out) {
+    level = level ? 1 : 0;
+
+    // Livello in mezzi bit e scarto dal multiplo più vicino
+    uint32_t units = (duration_us + LIGHT_FRAME_HALF_US / 2) / LIGHT_FRAME_HALF_US;
+    uint32_t nominal = units * LIGHT_FRAME_HALF_US;
+    uint16_t err_us = (uint16_t)((duration_us > nominal) ? duration_us - nominal : nominal - duration_us);
+    bool exact = units > 0 && err_us <= LIGHT_FRAME_TOLERANCE_US;
+
+    switch (dec->state) {
+        case LIGHT_FRAME_SYNC_LOW:
+            // Basso del preambolo, eventualmente unito al primo mezzo bit (0)
+            if (level == 0 && exact && units >= LIGHT_FRAME_SYNC_UNITS && units <= LIGHT_FRAME_SYNC_UNITS + 1) {
+                light_frame_start(dec, err_us);
+                if (units > LIGHT_FRAME_SYNC_UNITS) {
+                    dec->half_pending = true;
+                    dec->first_half = 0;
+                }
+            } else {
+                dec->state = LIGHT_FRAME_HUNT;
+                light_frame_hunt(dec, level, duration_us);
+            }
+            return false;
+
+        case LIGHT_FRAME_DATA:
+            break;
+
+        default:
+            light_frame_hunt(dec, level, duration_us);
+            return false;
+    }
+
+    // Ultimo mezzo bit unito al riposo o al preambolo successivo: basta il primo T
+    bool last_half = dec->bits == LIGHT_FRAME_BITS - 1 && dec->half_pending && level != dec->first_half;
+    if (!exact && !(last_half && duration_us + LIGHT_FRAME_TOLERANCE_US >= LIGHT_FRAME_HALF_US)) {
+        light_frame_violation(dec);
+        light_frame_hunt(dec, level, duration_us);
+        return false;
+    }
+    if (exact && err_us > dec->worst_err_us) {
+        dec->worst_err_us = err_us;
+    }
+
+    for (uint32_t u = 0; u < units; u++) {
+        if (!dec->half_pending) {
+            dec->half_pending = true;
+            dec->first_half = level;
+            continue;
+        }
+
+        // Due mezzi bit uguali: violazione della codifica
+        if (dec->first_half == level) {
+            light_frame_violation(dec);
+            light_frame_hunt(dec, level, duration_us);
+            return false;
+        }
+
+        dec->half_pending = false;
+        dec->data = (dec->data << 1) | dec->first_half;
+        if (++dec->bits < LIGHT_FRAME_BITS) {
+            continue;
+        }
+
+        // Trama completa; il resto del livello può essere il preambolo successivo
+        bool valid = light_frame_complete(dec, out);
+        uint32_t rest = (duration_us > (u + 1) * LIGHT_FRAME_HALF_US) ? duration_us - (u + 1) * LIGHT_FRAME_HALF_US : 0;
+        light_frame_hunt(dec, level, rest);
+        return valid;
+    }
+
+    return false;
+}
@@ -0,0 +1,134 @@
+/**
+ * Autore: DJITSOP FUOGOUK LOIC STEVE
+ * Firmware: ECOLUMIERE BLE MESH ESP32
+ * Modulo: Lightframe - Trama ottica con identificativo e CRC
+ * Descrizione: Formato di trama per l'identificativo ottico dei dispositivi:
+ *              preambolo di sincronismo (3T alto + 3T basso, una violazione
+ *              della codifica Manchester che nessun dato può imitare),
+ *              identificativo a 16 bit e CRC-8, tutti in Manchester con
+ *              mezzo bit T = LIGHT_FRAME_HALF_US (alto→basso = 1). La luce
+ *              media non cambia durante la trama. Il decodificatore lavora in
+ *              streaming sulle durate dei livelli (una chiamata per fronte,
+ *              anche dalla ISR): riconosce il preambolo, accumula i bit,
+ *              scarta le trame con violazioni o CRC errato e riporta le
+ *              trame valide con una confidenza dal margine di temporizzazione
+ *              e dal numero di ripetizioni consecutive.
+ *              Nessuna dipendenza ESP-IDF.
+ */
+
+#ifndef LIGHTFRAME_H
+#define LIGHTFRAME_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/************************************************
+ * PUBLIC DEFINES AND MACRO                     *
+ ************************************************/
+
+#define LIGHT_FRAME_HALF_US              100     // Mezzo bit Manchester (T)
+#define LIGHT_FRAME_TOLERANCE_US         40      // Scarto massimo di un livello da un multiplo di T
+#define LIGHT_FRAME_SYNC_UNITS           3       // Preambolo: 3T alto + 3T basso
+#define LIGHT_FRAME_PAYLOAD_BITS         16
+#define LIGHT_FRAME_CRC_BITS             8
+#define LIGHT_FRAME_BITS                 (LIGHT_FRAME_PAYLOAD_BITS + LIGHT_FRAME_CRC_BITS)
+#define LIGHT_FRAME_UNITS                (2 * LIGHT_FRAME_SYNC_UNITS + 2 * LIGHT_FRAME_BITS)
+#define LIGHT_FRAME_US                   (LIGHT_FRAME_UNITS * LIGHT_FRAME_HALF_US)   // 5.4 ms
+#define LIGHT_FRAME_MAX_RUNS             (2 + 2 * LIGHT_FRAME_BITS)                  // Livelli di una trama
+
+#define LIGHT_FRAME_CRC_POLY             0x2F    // CRC-8/AUTOSAR: distanza di Hamming 4 su 24 bit
+#define LIGHT_FRAME_CRC_INIT             0xFF
+#define LIGHT_FRAME_CRC_XOROUT           0xFF
+
+#define LIGHT_FRAME_ID_NONE              0x0000  // Identificativo riservato: nessuna trama
+#define LIGHT_FRAME_MAX_REPEATS          255
+
+/************************************************
+ * PUBLIC TYPES                                 *
+ ************************************************/
+
+/**
+ * @brief Trama valida
+ * @field payload: Identificativo a 16 bit
+ * @field confidence: 0..100, margine di temporizzazione del livello peggiore
+ *        (100 = tutti i livelli su multipli esatti di T, 0 = al limite)
+ * @field repeats: Trame consecutive con lo stesso identificativo (1 = prima)
+ */
+typedef struct light_frame_t
+{
+    uint16_t payload;
+    uint8_t confidence;
+    uint8_t repeats;
+} light_frame_t;
+
+/**
+ * @brief Contatori del decodificatore
+ * @field frames: Trame valide
+ * @field crc_errors: Trame complete scartate dal CRC
+ * @field violations: Trame interrotte da un livello fuori codifica
+ * @field syncs: Preamboli riconosciuti
+ */
+typedef struct light_frame_stats_t
+{
+    uint32_t frames;
+    uint32_t crc_errors;
+    uint32_t violations;
+    uint32_t syncs;
+} light_frame_stats_t;
+
+/**
+ * @brief Stato del decodificatore in streaming
+ * @field state: Ricerca, basso del preambolo o dati
+ * @field half_pending: Primo mezzo bit ricevuto, in attesa del secondo
+ * @field first_half: Livello del primo mezzo bit
+ * @field bits: Bit ricevuti della trama
+ * @field data: Bit ricevuti, il più recente nel bit 0
+ * @field worst_err_us: Scarto peggiore dei livelli della trama
+ * @field last: Ultima trama valida
+ * @field stats: Contatori
+ */
+typedef struct light_frame_decoder_t
+{
+    uint8_t state;
+    bool half_pending;
+    uint8_t first_half;
+    uint8_t bits;
+    uint32_t data;
+    uint16_t worst_err_us;
+    light_frame_t last;
+    light_frame_stats_t stats;
+} light_frame_decoder_t;
+
+/************************************************
+ * PUBLIC PROTOTYPES                           *
+ ************************************************/
+
+/**
+ * @brief CRC-8 della trama (poly 0x2F, init 0xFF, xorout 0xFF)
+ */
+uint8_t light_frame_crc8(const uint8_t *data, uint32_t len);
+
+/**
+ * @brief Codifica una trama come durate dei livelli
+ * @desc Il primo livello è alto (preambolo); i livelli alternano. Le durate
+ *       non includono il riposo dopo la trama.
+ * @param run_us: Almeno LIGHT_FRAME_MAX_RUNS durate
+ * @return Numero di livelli
+ */
+uint16_t light_frame_encode(uint16_t payload, uint16_t *run_us);
+
+/**
+ * @brief Azzera lo stato (non i contatori né l'ultima trama)
+ */
+void light_frame_decoder_reset(light_frame_decoder_t *dec);
+
+/**
+ * @brief Riceve un livello concluso
+ * @param level: Livello (0/1) appena terminato da un fronte
+ * @param duration_us: Durata del livello
+ * @param out: Trama completata da questo livello, se valida
+ * @return true se una trama valida è stata completata
+ */
+bool light_frame_feed(light_frame_decoder_t *dec, uint8_t level, uint32_t duration_us, light_frame_t *out);
+
+#endif // LIGHTFRAME_H
@@ -0,0 +1,53 @@
+/**
+ * Autore: DJITSOP FUOGOUK LOIC STEVE
+ * Firmware: ECOLUMIERE BLE MESH ESP32
+ * Implementazione: Lux LUT - Conversione codice ADC → lux a tabella
+ */
+
+#include "lux_lut.h"
+#include <math.h>
+
+#define LUX_LUT_MAX_CODE                4095
+#define LUX_LUT_MAX_FINE                (LUX_LUT_MAX_CODE << LUX_LUT_FRAC_BITS)
+#define LUX_LUT_FINE_SHIFT              (LUX_LUT_SHIFT + LUX_LUT_FRAC_BITS)
+#define LUX_LUT_FINE_STEP               (1 << LUX_LUT_FINE_SHIFT)     // Codici fini fra due nodi
+
+/************************************************
+ * PUBLIC FUNCTIONS IMPLEMENTATION             *
+ ************************************************/
+
+void lux_lut_build(lux_lut_t *lut, double lsb_v, double resistance_ohm)
+{
+    for (int i = 0; i < LUX_LUT_KNOTS; i++) {
+        double measure = ((double)(LUX_LUT_MAX_CODE - i * LUX_LUT_STEP) * lsb_v) / resistance_ohm;
+        lut->knots[i] = (float)pow(10.0, measure / 10e-6);
+    }
+
+    lut->ready = true;
+}
+
+uint32_t lux_lut_lookup(const lux_lut_t *lut, uint16_t fine)
+{
+    if (fine > LUX_LUT_MAX_FINE) {
+        fine = LUX_LUT_MAX_FINE;
+    }
+
+    uint32_t i = fine >> LUX_LUT_FINE_SHIFT;
+    uint32_t frac = fine & (LUX_LUT_FINE_STEP - 1);
+    float lo = lut->knots[i];
+    float lux = lo + (lut->knots[i + 1] - lo) * (float)frac * (1.0f / LUX_LUT_FINE_STEP);
+
+    // Ai codici bassi la formula esce dal campo di uint32_t: saturazione
+    return (lux >= (float)UINT32_MAX) ? UINT32_MAX : (uint32_t)lux;
+}
+
+uint32_t lux_lut_compensated(const lux_lut_t *lut, uint16_t fine, int32_t offset)
+{
+    uint32_t lux = lux_lut_lookup(lut, fine);
+
+    if (offset < 0) {
+        uint32_t add = (uint32_t)(-offset);
+        return (lux > UINT32_MAX - add) ? UINT32_MAX : lux + add;
+    }
+    return ((uint32_t)offset > lux) ? 0 : lux - (uint32_t)offset;
+}
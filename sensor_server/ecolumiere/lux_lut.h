@@ -0,0 +1,57 @@
+/**
+ * Autore: DJITSOP FUOGOUK LOIC STEVE
+ * Firmware: ECOLUMIERE BLE MESH ESP32
+ * Modulo: Lux LUT - Conversione codice ADC → lux a tabella
+ * Descrizione: Tabella di LUX_LUT_KNOTS nodi sulla media ADC a 12 bit, un nodo
+ *              ogni LUX_LUT_STEP codici, calcolata una volta con la formula
+ *              del luxmeter (pow in doppia precisione) e letta con
+ *              interpolazione lineare in float (FPU hardware dell'ESP32).
+ *              Sostituisce pow() in doppia precisione emulata a ogni misura.
+ *              L'ingresso è il codice fine della finestra del luxmeter
+ *              (LUX_LUT_FRAC_BITS bit frazionari), interpolato anche fra due
+ *              codici interi.
+ *              Nessuna dipendenza ESP-IDF.
+ */
+
+#ifndef LUX_LUT_H
+#define LUX_LUT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define LUX_LUT_SHIFT                   3
+#define LUX_LUT_STEP                    (1 << LUX_LUT_SHIFT)            // Codici ADC fra due nodi
+#define LUX_LUT_KNOTS                   ((4096 >> LUX_LUT_SHIFT) + 1)   // 513 nodi, 0..4096
+#define LUX_LUT_FRAC_BITS               2                               // Bit frazionari del codice (LUXMETER_CODE_FRAC_BITS)
+
+/**
+ * @brief Tabella di conversione
+ * @field knots: Lux ai codici i * LUX_LUT_STEP
+ * @field ready: Tabella calcolata
+ */
+typedef struct lux_lut_t
+{
+  float knots[LUX_LUT_KNOTS];
+  bool ready;
+} lux_lut_t;
+
+/**
+ * @brief Calcola i nodi con la formula del luxmeter
+ * @desc lux = 10^(((4095 - code) * lsb_v / resistance_ohm) / 10e-6),
+ *       la stessa di luxmeter_pickup. Da chiamare una volta (inizializzazione).
+ */
+void lux_lut_build(lux_lut_t *lut, double lsb_v, double resistance_ohm);
+
+/**
+ * @brief Lux al codice fine (0..4095 << LUX_LUT_FRAC_BITS), senza compensazione di offset
+ * @desc Troncato come la conversione originale, saturato a UINT32_MAX.
+ */
+uint32_t lux_lut_lookup(const lux_lut_t *lut, uint16_t fine);
+
+/**
+ * @brief Lux compensati: lookup meno offset, limitato a zero
+ * @desc Un offset negativo (tabella calibrata) viene sommato, saturando.
+ */
+uint32_t lux_lut_compensated(const lux_lut_t *lut, uint16_t fine, int32_t offset);
+
+#endif //LUX_LUT_H
@@ -5,16 +5,22 @@
  */
 
 #include "luxmeter.h"
+#include "lux_lut.h"
+#include "analog_scan.h"
 #include "pwmcontroller.h"
+#include "scheduler.h"
 #include "ecolumiere.h"
 #include "esp_log.h"
 #include "esp_timer.h"
 #include "driver/gpio.h"
 #include "esp_adc/adc_oneshot.h"
+#include "esp_adc/adc_continuous.h"
+#include "esp_attr.h"
+#include "soc/soc_caps.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/timers.h"
-#include <math.h>
+#include <string.h>
 
 /************************************************
  * PRIVATE DEFINES AND CONSTANTS               *
@@ -25,96 +31,225 @@ static const char* TAG = "LUXMETER";
 // Configurazione hardware (simile a Nordic)
 #define SENSOR_CONVERSION_RESISTANCE            22000.0
 #define LUX_SENSOR_ADC_CHANNEL                  ADC_CHANNEL_4
+#define NTC_ADC_CHANNEL                         ADC_CHANNEL_5   // GPIO33
+#define VSUPPLY_ADC_CHANNEL                     ADC_CHANNEL_6   // GPIO34
+#define ILED_ADC_CHANNEL                        ADC_CHANNEL_7   // GPIO35
+#define ADC_UNIT_CHANNELS                       8               // Ingressi di ADC1 (ESP32)
 #define ADC_UNIT                                ADC_UNIT_1
 
-// Configurazione acquisizione (stessi parametri Nordic)
-#define SAMPLES_PER_CHANNEL                     45
-#define TIMER_INTERVAL_US                       1000
-#define SAMPLE_BUFFER_FIRST_VALUE_INDEX         20
-#define SAMPLE_BUFFER_LAST_VALUE_INDEX          42
+// Sorgente dei campioni: 1 = driver continuo DMA, 0 = oneshot da timer software
+#define LUX_ADC_CONTINUOUS                      1
+
+// Stimatore della finestra: Hampel scarta picchi e rimbalzi di PWM senza
+// spostare la media sui campioni puliti
+#define LUX_WINDOW_FILTER                       LUXMETER_FILTER_HAMPEL
+
+// Acquisizione oneshot: un campione ogni 10 ms dal timer daemon
+#define SAMPLE_PERIOD_MS                        (1000 / LUXMETER_SAMPLE_HZ)
+
+// Acquisizione continua: una scansione di LUX_ADC_PATTERN_LEN conversioni
+// serve tutti i canali, 5 al sensore luce e una a ciascun canale
+// ausiliario. 30.9 kHz e non 32: la corrente dei LED è a impulsi PWM da
+// 1 kHz e un canale a 3862.5 Hz ne percorre 309 fasi invece di 4 fisse.
+// Luce a ~19.3 kHz: 193 conversioni mediate per campione = 10 periodi PWM.
+// Frame da ~50 ms (193 scansioni complete), due frame nel pool DMA: il driver
+// vuole frame multipli di SOC_ADC_DIGI_DATA_BYTES_PER_CONV byte.
+#define LUX_ADC_SAMPLE_FREQ_HZ                  30900
+#define LUX_ADC_PATTERN_LEN                     8
+#define LUX_ADC_PATTERN_LUX                     5
+#define LUX_ADC_LUX_RATE_HZ                     (LUX_ADC_SAMPLE_FREQ_HZ / LUX_ADC_PATTERN_LEN * LUX_ADC_PATTERN_LUX)
+#define LUX_ADC_FRAME_CONV                      1544
+#define LUX_ADC_RESULT_BYTES                    sizeof(adc_digi_output_data_t)
+#define LUX_ADC_FRAME_BYTES                     (LUX_ADC_FRAME_CONV * LUX_ADC_RESULT_BYTES)
+#define LUX_ADC_POOL_FRAMES                     2
+#define LUX_ADC_FRAME_MS                        ((LUX_ADC_FRAME_CONV * 1000 + LUX_ADC_SAMPLE_FREQ_HZ / 2) / LUX_ADC_SAMPLE_FREQ_HZ)
+
+_Static_assert(LUX_ADC_FRAME_BYTES % SOC_ADC_DIGI_DATA_BYTES_PER_CONV == 0,
+               "conv_frame_size deve essere multiplo di SOC_ADC_DIGI_DATA_BYTES_PER_CONV");
+_Static_assert(LUX_ADC_FRAME_CONV % LUX_ADC_PATTERN_LEN == 0,
+               "il frame deve contenere scansioni complete del pattern");
 
 // Fattore di conversione (come Nordic)
 static const double saadc_lsb = 3.3 / 4096.0; // 3.3V reference / 12-bit
 
+#if LUX_LUT_FRAC_BITS != LUXMETER_CODE_FRAC_BITS
+#error "lux_lut e la finestra del luxmeter devono usare gli stessi codici fini"
+#endif
+
 /************************************************
  * PRIVATE GLOBAL VARIABLES                    *
  ************************************************/
 
-static int samples_buffer[SAMPLES_PER_CHANNEL];
-static float measure_mean = 0.0;
+static uint16_t measure_code = LUXMETER_FINE_MAX_CODE;  // Codice fine, nessuna luce: 1 lux
+static lux_lut_t lux_lut;
 static uint32_t measure_index = 0;
+static luxmeter_window_t window;
+static uint32_t processed_windows = 0;
+static bool conversion_active = false;
+static portMUX_TYPE window_lock = portMUX_INITIALIZER_UNLOCKED;  // Finestra condivisa con la ISR ADC
+static analog_scan_t scan;                                          // Canali ausiliari, stesso lock
+
+/**
+ * @brief Canale ausiliario di ogni ingresso ADC1 (ANALOG_CH_LUX = luce)
+ */
+static const analog_channel_t adc_channel_map[ADC_UNIT_CHANNELS] = {
+    [LUX_SENSOR_ADC_CHANNEL] = ANALOG_CH_LUX,
+    [NTC_ADC_CHANNEL]        = ANALOG_CH_NTC,
+    [VSUPPLY_ADC_CHANNEL]    = ANALOG_CH_VSUPPLY,
+    [ILED_ADC_CHANNEL]       = ANALOG_CH_ILED,
+};
+
+#if LUX_ADC_CONTINUOUS
+static adc_continuous_handle_t adc_cont_handle = NULL;
+static luxmeter_adc_cb_t continuous_cb = NULL;
+static uint16_t frame_codes[LUX_ADC_FRAME_CONV];
+/**
+ * @brief Sequenza della scansione: canali ausiliari fra le conversioni luce
+ */
+static const adc_channel_t scan_pattern[LUX_ADC_PATTERN_LEN] = {
+    LUX_SENSOR_ADC_CHANNEL, NTC_ADC_CHANNEL, LUX_SENSOR_ADC_CHANNEL, LUX_SENSOR_ADC_CHANNEL,
+    VSUPPLY_ADC_CHANNEL, LUX_SENSOR_ADC_CHANNEL, LUX_SENSOR_ADC_CHANNEL, ILED_ADC_CHANNEL
+};
+#else
+static const adc_channel_t aux_channels[ANALOG_CH_COUNT - 1] = {
+    NTC_ADC_CHANNEL, VSUPPLY_ADC_CHANNEL, ILED_ADC_CHANNEL
+};
 static adc_oneshot_unit_handle_t adc_handle = NULL;
 static TimerHandle_t sampling_timer = NULL;
-static int sample_count = 0;
-static bool conversion_active = false;
+static luxmeter_adc_cb_t oneshot_cb = NULL;
+#endif
 
 /**
- * @brief Mappa compensazione offset (stessa di Nordic)
+ * @brief Mappa compensazione offset di fabbrica (stessa di Nordic)
  */
-static const uint8_t offset_map[] = {
+static const uint8_t offset_map[LUXMETER_OFFSET_LEVELS] = {
     0, 8, 10, 12, 11, 14, 17, 11, 14, 15, 18, 19, 21, 22, 22, 22,
     22, 22, 22, 21, 21, 22, 23, 24, 25, 26, 27, 28, 30, 31, 33, 34, 38
 };
 
+// Tabella in uso: offset_map o la calibrazione del dispositivo
+static int16_t offset_table[LUXMETER_OFFSET_LEVELS];
+static bool offset_calibrated = false;
+
 /************************************************
  * PRIVATE FUNCTIONS IMPLEMENTATION           *
  ************************************************/
 
 /**
- * @brief Elabora buffer ADC e calcola valore lux (stesso algoritmo Nordic)
+ * @brief Registra la media di una finestra ADC (stesso algoritmo Nordic)
+ * @desc La conversione ADC → Volt → Resistenza → Lux della formula Nordic è
+ *       precalcolata in lux_lut: qui resta solo il codice medio.
+ * @param samples_mean: Media dei campioni FIRST..LAST della finestra (codice fine)
+ * @param windows: Finestre completate dall'ultima elaborazione
  */
-static void luxmeter_process_adc_buffer(void) {
-    uint32_t samples_mean = 0;
-    uint16_t valid_samples_count = 0;
+static void luxmeter_process_adc_buffer(uint16_t samples_mean, uint32_t windows) {
+    measure_code = samples_mean;
 
-    // Calcola media sui campioni validi (stesso range Nordic)
-    for (uint16_t i = SAMPLE_BUFFER_FIRST_VALUE_INDEX; i <= SAMPLE_BUFFER_LAST_VALUE_INDEX; i++) {
-        samples_mean += (uint32_t)samples_buffer[i];
-        valid_samples_count++;
-    }
+    // Aggiorna indice debug, una volta per finestra (stesso comportamento Nordic)
+    measure_index = (measure_index + windows) % 8; // SLOT_COUNT/2 dal codice Nordic
 
-    if (valid_samples_count > 0) {
-        samples_mean /= valid_samples_count;
-    }
+    ESP_LOGD(TAG, "ADC processing - Mean: %u", samples_mean);
+}
 
-    // Conversione ADC → Volt → Resistenza → Lux (stessa formula Nordic)
-    measure_mean = ((double)(4095 - samples_mean) * saadc_lsb) / SENSOR_CONVERSION_RESISTANCE;
+/**
+ * @brief Offset di compensazione per livello PWM (stessa mappa Nordic)
+ */
+static int32_t luxmeter_offset(uint16_t pwm_level) {
+    return (pwm_level < LUXMETER_OFFSET_LEVELS) ? offset_table[pwm_level] : 0;
+}
 
-    // Aggiorna indice debug (stesso comportamento Nordic)
-    if (++measure_index == 8) { // SLOT_COUNT/2 dal codice Nordic
-        measure_index = 0;
+/**
+ * @brief Riceve i codici dalla sorgente ADC
+ * @desc Solo accumulo intero nella finestra: con il driver continuo gira in
+ *       ISR. La conversione in lux avviene in luxmeter_pickup.
+ */
+static void luxmeter_on_codes(const uint16_t *codes, uint32_t count) {
+    if (conversion_active) {
+        portENTER_CRITICAL_SAFE(&window_lock);
+        luxmeter_window_feed(&window, codes, count);
+        portEXIT_CRITICAL_SAFE(&window_lock);
     }
+}
 
-    ESP_LOGD(TAG, "ADC processing - Mean: %lu, Value: %.6f", samples_mean, measure_mean);
+/**
+ * @brief Pubblica la fotografia dei sensori (task scheduler)
+ * @desc Il canale luce usa la stima dell'ultima finestra, compensata al
+ *       livello PWM corrente; gli altri canali la media del periodo.
+ */
+static void luxmeter_scan_publish(void *p_event_data, uint16_t event_size) {
+    analog_acc_t acc[ANALOG_CH_COUNT];
+
+    portENTER_CRITICAL(&window_lock);
+    analog_scan_latch(&scan, acc);
+    uint16_t code = window.mean;
+    portEXIT_CRITICAL(&window_lock);
+
+    uint32_t lux = lux_lut_compensated(&lux_lut, code, luxmeter_offset(pwmcontroller_get_current_level()));
+    analog_scan_publish(&scan, acc, lux, (uint16_t)(code >> LUXMETER_CODE_FRAC_BITS));
+
+    ESP_LOGD(TAG, "Scan - NTC %u, VSUPPLY %u, ILED %u (%lu/%lu/%lu conv)",
+             acc[ANALOG_CH_NTC].count ? (unsigned)(acc[ANALOG_CH_NTC].sum / acc[ANALOG_CH_NTC].count) : 0,
+             acc[ANALOG_CH_VSUPPLY].count ? (unsigned)(acc[ANALOG_CH_VSUPPLY].sum / acc[ANALOG_CH_VSUPPLY].count) : 0,
+             acc[ANALOG_CH_ILED].count ? (unsigned)(acc[ANALOG_CH_ILED].sum / acc[ANALOG_CH_ILED].count) : 0,
+             acc[ANALOG_CH_NTC].count, acc[ANALOG_CH_VSUPPLY].count, acc[ANALOG_CH_ILED].count);
 }
 
 /**
- * @brief Callback timer campionamento periodico
+ * @brief Chiude un passaggio di scansione dei canali ausiliari
+ * @desc Ogni ANALOG_SCAN_PUBLISH_MS chiede al task scheduler una nuova
+ *       fotografia: conversione e floating point restano fuori dalla ISR.
  */
-static void luxmeter_timer_callback(TimerHandle_t xTimer) {
-    if (!conversion_active || sample_count >= SAMPLES_PER_CHANNEL) {
+static void luxmeter_on_scan(const analog_acc_t *frame, bool from_isr) {
+    if (!conversion_active) {
         return;
     }
 
+    portENTER_CRITICAL_SAFE(&window_lock);
+    bool publish = analog_scan_merge(&scan, frame);
+    portEXIT_CRITICAL_SAFE(&window_lock);
+
+    if (publish) {
+        if (from_isr) {
+            scheduler_put_event_isr(NULL, 0, SCH_EVT_ANALOG_SCAN, luxmeter_scan_publish);
+        } else {
+            scheduler_put_event(NULL, 0, SCH_EVT_ANALOG_SCAN, luxmeter_scan_publish);
+        }
+    }
+}
+
+#if !LUX_ADC_CONTINUOUS
+
+/************************************************
+ * SORGENTE ONESHOT (TIMER SOFTWARE)           *
+ ************************************************/
+
+/**
+ * @brief Callback timer campionamento periodico
+ * @desc Un passaggio legge il sensore luce e poi i canali ausiliari.
+ */
+static void luxmeter_timer_callback(TimerHandle_t xTimer) {
     // Lettura valore ADC
     int adc_value;
     esp_err_t ret = adc_oneshot_read(adc_handle, LUX_SENSOR_ADC_CHANNEL, &adc_value);
 
-    if (ret == ESP_OK) {
-        samples_buffer[sample_count++] = adc_value;
+    if (ret == ESP_OK && oneshot_cb) {
+        uint16_t code = (uint16_t)adc_value;
+        oneshot_cb(&code, 1);
+    }
 
-        // Elabora quando buffer è completo
-        if (sample_count >= SAMPLES_PER_CHANNEL) {
-            luxmeter_process_adc_buffer();
-            sample_count = 0;
+    analog_acc_t frame[ANALOG_CH_COUNT] = { 0 };
+    for (int i = 0; i < ANALOG_CH_COUNT - 1; i++) {
+        if (adc_oneshot_read(adc_handle, aux_channels[i], &adc_value) == ESP_OK) {
+            analog_scan_add(frame, adc_channel_map[aux_channels[i]], (uint16_t)adc_value);
         }
     }
+    luxmeter_on_scan(frame, false);
 }
 
 /**
  * @brief Inizializzazione sistema ADC (equivalente a SAADC Nordic)
  */
-static void luxmeter_adc_init(void) {
+static bool luxmeter_oneshot_init(luxmeter_adc_cb_t cb) {
     ESP_LOGI(TAG, "Initializing ADC for light sensor");
 
     // Configurazione unità ADC
@@ -125,7 +260,7 @@ static void luxmeter_adc_init(void) {
     esp_err_t ret = adc_oneshot_new_unit(&init_config, &adc_handle);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "ADC unit initialization failed: %s", esp_err_to_name(ret));
-        return;
+        return false;
     }
 
     // Configurazione canale ADC (come Nordic)
@@ -135,27 +270,20 @@ static void luxmeter_adc_init(void) {
     };
 
     ret = adc_oneshot_config_channel(adc_handle, LUX_SENSOR_ADC_CHANNEL, &config);
+    for (int i = 0; ret == ESP_OK && i < ANALOG_CH_COUNT - 1; i++) {
+        ret = adc_oneshot_config_channel(adc_handle, aux_channels[i], &config);
+    }
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "ADC channel configuration failed: %s", esp_err_to_name(ret));
-        return;
+        return false;
     }
 
-    // Inizializzazione variabili
-    sample_count = 0;
-    measure_mean = 0.0;
-    measure_index = 0;
-
-    ESP_LOGI(TAG, "ADC initialized - Channel: %d", LUX_SENSOR_ADC_CHANNEL);
-}
+    ESP_LOGI(TAG, "ADC initialized - Channel: %d + %d auxiliary", LUX_SENSOR_ADC_CHANNEL, ANALOG_CH_COUNT - 1);
 
-/**
- * @brief Inizializzazione timer campionamento (equivalente a PPI Nordic)
- */
-static void luxmeter_sampling_timer_init(void) {
-    // Timer per campionamento periodico
+    // Timer per campionamento periodico (equivalente a PPI Nordic)
     sampling_timer = xTimerCreate(
         "LuxmeterSamplingTimer",
-        pdMS_TO_TICKS(TIMER_INTERVAL_US / 100),
+        pdMS_TO_TICKS(SAMPLE_PERIOD_MS),
         pdTRUE,
         NULL,
         luxmeter_timer_callback
@@ -163,12 +291,154 @@ static void luxmeter_sampling_timer_init(void) {
 
     if (sampling_timer == NULL) {
         ESP_LOGE(TAG, "Failed to create sampling timer");
-        return;
+        return false;
+    }
+
+    oneshot_cb = cb;
+    ESP_LOGD(TAG, "Sampling timer initialized - Interval: %d ms", SAMPLE_PERIOD_MS);
+    return true;
+}
+
+static bool luxmeter_oneshot_start(void) {
+    return sampling_timer && (xTimerIsTimerActive(sampling_timer) || xTimerStart(sampling_timer, 0) == pdPASS);
+}
+
+static void luxmeter_oneshot_stop(void) {
+    if (sampling_timer && xTimerIsTimerActive(sampling_timer)) {
+        xTimerStop(sampling_timer, 0);
+    }
+}
+
+static const luxmeter_adc_if_t adc_oneshot_source = {
+    .name = "oneshot",
+    .rate_hz = LUXMETER_SAMPLE_HZ,
+    .latency_ms = 0,
+    .init = luxmeter_oneshot_init,
+    .start = luxmeter_oneshot_start,
+    .stop = luxmeter_oneshot_stop,
+};
+
+static const luxmeter_adc_if_t *adc_source = &adc_oneshot_source;
+
+#else
+
+/************************************************
+ * SORGENTE CONTINUA (DMA)                     *
+ ************************************************/
+
+/**
+ * @brief Frame DMA completo (ISR)
+ * @desc Il driver alterna i due frame del pool: questo viene letto mentre il
+ *       DMA riempie l'altro. Separa per canale i codici a 12 bit: la luce va
+ *       alla finestra, gli altri canali all'accumulo della scansione.
+ */
+static bool IRAM_ATTR luxmeter_conv_done_cb(adc_continuous_handle_t handle,
+                                            const adc_continuous_evt_data_t *edata, void *user_data) {
+    const adc_digi_output_data_t *results = (const adc_digi_output_data_t *)edata->conv_frame_buffer;
+    uint32_t count = edata->size / LUX_ADC_RESULT_BYTES;
+    uint32_t lux_count = 0;
+    analog_acc_t frame[ANALOG_CH_COUNT] = { 0 };
+
+    if (count > LUX_ADC_FRAME_CONV) {
+        count = LUX_ADC_FRAME_CONV;
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t channel = results[i].type1.channel;
+        uint16_t code = (uint16_t)results[i].type1.data;
+
+        if (channel == LUX_SENSOR_ADC_CHANNEL) {
+            frame_codes[lux_count++] = code;
+        } else if (channel < ADC_UNIT_CHANNELS && adc_channel_map[channel] != ANALOG_CH_LUX) {
+            analog_scan_add(frame, adc_channel_map[channel], code);
+        }
+    }
+
+    if (continuous_cb) {
+        continuous_cb(frame_codes, lux_count);
+    }
+    luxmeter_on_scan(frame, true);
+
+    return false; // Nessun task da risvegliare
+}
+
+static bool luxmeter_continuous_init(luxmeter_adc_cb_t cb) {
+    ESP_LOGI(TAG, "Initializing continuous ADC for light sensor");
+
+    adc_continuous_handle_cfg_t handle_config = {
+        .max_store_buf_size = LUX_ADC_POOL_FRAMES * LUX_ADC_FRAME_BYTES,
+        .conv_frame_size = LUX_ADC_FRAME_BYTES,
+    };
+
+    esp_err_t ret = adc_continuous_new_handle(&handle_config, &adc_cont_handle);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Continuous ADC handle failed: %s", esp_err_to_name(ret));
+        return false;
+    }
+
+    adc_digi_pattern_config_t pattern[LUX_ADC_PATTERN_LEN];
+    for (int i = 0; i < LUX_ADC_PATTERN_LEN; i++) {
+        pattern[i] = (adc_digi_pattern_config_t) {
+            .atten = ADC_ATTEN_DB_12,
+            .channel = scan_pattern[i],
+            .unit = ADC_UNIT,
+            .bit_width = ADC_BITWIDTH_12,
+        };
+    }
+
+    adc_continuous_config_t dig_config = {
+        .pattern_num = LUX_ADC_PATTERN_LEN,
+        .adc_pattern = pattern,
+        .sample_freq_hz = LUX_ADC_SAMPLE_FREQ_HZ,
+        .conv_mode = ADC_CONV_SINGLE_UNIT_1,
+        .format = ADC_DIGI_OUTPUT_FORMAT_TYPE1,
+    };
+
+    ret = adc_continuous_config(adc_cont_handle, &dig_config);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Continuous ADC configuration failed: %s", esp_err_to_name(ret));
+        return false;
+    }
+
+    adc_continuous_evt_cbs_t cbs = {
+        .on_conv_done = luxmeter_conv_done_cb,
+    };
+
+    ret = adc_continuous_register_event_callbacks(adc_cont_handle, &cbs, NULL);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Continuous ADC callback registration failed: %s", esp_err_to_name(ret));
+        return false;
     }
 
-    ESP_LOGD(TAG, "Sampling timer initialized - Interval: %d μs", TIMER_INTERVAL_US);
+    continuous_cb = cb;
+    ESP_LOGI(TAG, "Continuous ADC initialized - Channel: %d + %d auxiliary, %d Hz, frame %d conversions",
+             LUX_SENSOR_ADC_CHANNEL, ANALOG_CH_COUNT - 1, LUX_ADC_SAMPLE_FREQ_HZ, LUX_ADC_FRAME_CONV);
+    return true;
+}
+
+static bool luxmeter_continuous_start(void) {
+    return adc_cont_handle && adc_continuous_start(adc_cont_handle) == ESP_OK;
 }
 
+static void luxmeter_continuous_stop(void) {
+    if (adc_cont_handle) {
+        adc_continuous_stop(adc_cont_handle);
+    }
+}
+
+static const luxmeter_adc_if_t adc_continuous_source = {
+    .name = "continuous",
+    .rate_hz = LUX_ADC_LUX_RATE_HZ,     // Conversioni del solo sensore luce
+    .latency_ms = LUX_ADC_FRAME_MS,     // Il frame consegnato può iniziare prima dell'armamento
+    .init = luxmeter_continuous_init,
+    .start = luxmeter_continuous_start,
+    .stop = luxmeter_continuous_stop,
+};
+
+static const luxmeter_adc_if_t *adc_source = &adc_continuous_source;
+
+#endif // LUX_ADC_CONTINUOUS
+
 /************************************************
  * PUBLIC FUNCTIONS IMPLEMENTATION             *
  ************************************************/
@@ -179,10 +449,28 @@ static void luxmeter_sampling_timer_init(void) {
 void luxmeter_init(void) {
     ESP_LOGI(TAG, "🚀 Initializing Luxmeter system (Real mode only)");
 
-    luxmeter_adc_init();
-    luxmeter_sampling_timer_init();
-
     conversion_active = false;
+    measure_code = LUXMETER_FINE_MAX_CODE;
+    measure_index = 0;
+    processed_windows = 0;
+
+    // Formula Nordic precalcolata una volta: nessun pow() a ogni misura
+    lux_lut_build(&lux_lut, saadc_lsb, SENSOR_CONVERSION_RESISTANCE);
+    if (!offset_calibrated) {
+        luxmeter_set_offsets(NULL);
+    }
+    luxmeter_window_init(&window, adc_source->rate_hz);
+    luxmeter_window_set_filter(&window, LUX_WINDOW_FILTER);
+#if LUX_ADC_CONTINUOUS
+    analog_scan_init(&scan, ANALOG_SCAN_PUBLISH_MS / LUX_ADC_FRAME_MS);
+#else
+    analog_scan_init(&scan, ANALOG_SCAN_PUBLISH_MS / SAMPLE_PERIOD_MS);
+#endif
+
+    if (!adc_source->init(luxmeter_on_codes)) {
+        ESP_LOGE(TAG, "❌ ADC source %s not available", adc_source->name);
+        return;
+    }
 
     ESP_LOGI(TAG, "✅ Luxmeter system initialized - Ready for real measurements");
 }
@@ -191,50 +479,136 @@ void luxmeter_init(void) {
  * @brief Acquisizione misurazione luminosa (stesso comportamento Nordic)
  */
 void luxmeter_pickup(luxmeter_measure_t measure, uint16_t pwm_level, uint32_t *lux, uint32_t *index) {
-    uint32_t lux_value;
-    uint32_t offset = 0;
+    int32_t offset = luxmeter_offset(pwm_level);
 
-    // Conversione valore elaborato in lux (stessa formula Nordic)
-    lux_value = (uint32_t)pow(10.0, measure_mean / 10e-6);
-
-    // Applicazione compensazione offset (stessa mappa Nordic)
-    if (pwm_level < sizeof(offset_map)) {
-        offset = (offset_map[pwm_level] > lux_value) ? lux_value : offset_map[pwm_level];
+    // Elabora l'ultima finestra completata dalla sorgente ADC
+    uint32_t windows = window.windows;
+    if (windows != processed_windows) {
+        luxmeter_process_adc_buffer(window.mean, windows - processed_windows);
+        processed_windows = windows;
     }
 
-    lux_value -= offset;
-
-    // Restituzione risultati
+    // Conversione in lux a tabella con interpolazione (stessa formula Nordic)
     *index = measure_index;
-    *lux = lux_value;
+    *lux = lux_lut_compensated(&lux_lut, measure_code, offset);
 
-    ESP_LOGD(TAG, "Lux measurement - Type: %d, PWM: %d, Value: %lu, Offset: %lu",
+    ESP_LOGD(TAG, "Lux measurement - Type: %d, PWM: %d, Value: %lu, Offset: %ld",
              measure, pwm_level, *lux, offset);
 }
 
+/**
+ * @brief Arma una raffica di campioni per uno slot
+ * @desc Chiamata dal controllore PWM subito dopo aver applicato la sequenza
+ *       dello slot. Il ritardo di assestamento copre anche la latenza della
+ *       sorgente: con il DMA un frame consegnato dopo l'armamento contiene
+ *       conversioni precedenti.
+ */
+void luxmeter_burst_arm(luxmeter_measure_t measure, uint16_t settle_ms, uint16_t samples) {
+    uint16_t skip = (uint16_t)((settle_ms + adc_source->latency_ms + SAMPLE_PERIOD_MS - 1) / SAMPLE_PERIOD_MS);
+
+    portENTER_CRITICAL(&window_lock);
+    luxmeter_window_arm_burst(&window, (uint8_t)measure, skip, samples);
+    portEXIT_CRITICAL(&window_lock);
+
+    ESP_LOGD(TAG, "Burst armed - Type: %d, skip %u, samples %u", measure, skip, samples);
+}
+
+/**
+ * @brief Misura della raffica etichettata con il tipo richiesto
+ */
+bool luxmeter_burst_pickup(luxmeter_measure_t measure, uint16_t pwm_level, uint32_t *lux) {
+    uint16_t code;
+
+    portENTER_CRITICAL(&window_lock);
+    bool ready = luxmeter_window_burst_result(&window, (uint8_t)measure, &code);
+    portEXIT_CRITICAL(&window_lock);
+
+    if (!ready) {
+        return false;
+    }
+
+    // Le misure di calibrazione restano grezze: servono a ricavare la tabella
+    int32_t offset = (measure == LUX_MEASURE_CALIBRATION) ? 0 : luxmeter_offset(pwm_level);
+    *lux = lux_lut_compensated(&lux_lut, code, offset);
+
+    ESP_LOGD(TAG, "Burst measurement - Type: %d, PWM: %d, Code: %u, Value: %lu",
+             measure, pwm_level, code, *lux);
+    return true;
+}
+
 /**
  * @brief Avvia acquisizione continua
  */
 void luxmeter_start_acquisition(void) {
+    if (conversion_active) {
+        return;
+    }
+
+    portENTER_CRITICAL(&window_lock);
+    luxmeter_window_reset(&window);
+    analog_acc_t discard[ANALOG_CH_COUNT];
+    analog_scan_latch(&scan, discard);
+    portEXIT_CRITICAL(&window_lock);
     conversion_active = true;
-    sample_count = 0;
 
-    if (sampling_timer && !xTimerIsTimerActive(sampling_timer)) {
-        xTimerStart(sampling_timer, 0);
+    if (!adc_source->start()) {
+        conversion_active = false;
+        ESP_LOGE(TAG, "❌ Failed to start %s acquisition", adc_source->name);
+        return;
     }
 
-    ESP_LOGI(TAG, "🎯 Continuous acquisition started");
+    ESP_LOGI(TAG, "🎯 Continuous acquisition started (%s)", adc_source->name);
 }
 
 /**
  * @brief Arresta acquisizione continua
  */
 void luxmeter_stop_acquisition(void) {
+    if (conversion_active) {
+        adc_source->stop();
+    }
     conversion_active = false;
 
-    if (sampling_timer && xTimerIsTimerActive(sampling_timer)) {
-        xTimerStop(sampling_timer, 0);
+    ESP_LOGI(TAG, "⏹️ Continuous acquisition stopped");
+}
+
+/**
+ * @brief Seleziona lo stimatore della finestra ADC
+ */
+bool luxmeter_set_filter(luxmeter_filter_t filter) {
+    if (filter >= LUXMETER_FILTER_COUNT) {
+        return false;
     }
 
-    ESP_LOGI(TAG, "⏹️ Continuous acquisition stopped");
+    // Scrittura di un byte: sicura anche con la ISR del driver continuo
+    luxmeter_window_set_filter(&window, filter);
+    ESP_LOGI(TAG, "🧮 Window filter: %s", luxmeter_filter_name(filter));
+    return true;
+}
+
+/**
+ * @brief Installa la tabella di compensazione per livello PWM
+ */
+void luxmeter_set_offsets(const int16_t *offsets) {
+    for (int level = 0; level < LUXMETER_OFFSET_LEVELS; level++) {
+        offset_table[level] = offsets ? offsets[level] : (int16_t)offset_map[level];
+    }
+    offset_calibrated = (offsets != NULL);
+
+    ESP_LOGI(TAG, "📏 Offset table: %s", offset_calibrated ? "device calibration" : "factory (Nordic)");
+}
+
+/**
+ * @brief Copia la tabella di compensazione in uso
+ */
+bool luxmeter_get_offsets(int16_t *offsets) {
+    memcpy(offsets, offset_table, sizeof(offset_table));
+    return offset_calibrated;
+}
+
+/**
+ * @brief Copia l'ultima fotografia dei sensori analogici
+ */
+uint32_t luxmeter_get_snapshot(analog_snapshot_t *snapshot) {
+    return analog_scan_read(&scan, snapshot);
 }
\ No newline at end of file
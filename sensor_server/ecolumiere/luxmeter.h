@@ -9,6 +9,10 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include "luxmeter_adc.h"
+#include "analog_scan.h"
+
+#define LUXMETER_OFFSET_LEVELS   33      ///< Voci della tabella di compensazione (livelli PWM 0..32)
 
 /**
  * @brief Tipi di misurazione luminosa supportati
@@ -16,7 +20,8 @@
 typedef enum {
  LUX_MEASURE_NATURAL,     ///< Luce naturale (senza contributo lampada)
  LUX_MEASURE_ENVIRONMENT, ///< Luce ambiente (con contributo lampada)
- LUX_MEASURE_NODE_ID      ///< Identificazione nodo
+ LUX_MEASURE_NODE_ID,     ///< Identificazione nodo
+ LUX_MEASURE_CALIBRATION  ///< Calibrazione degli offset (raffica non compensata)
 } luxmeter_measure_t;
 
 /**
@@ -33,6 +38,26 @@ void luxmeter_init(void);
  */
 void luxmeter_pickup(luxmeter_measure_t measure, uint16_t pwm_level, uint32_t *lux, uint32_t *index);
 
+/**
+ * @brief Arma una raffica ADC etichettata con il tipo di misura
+ * @desc Scarta i campioni dei primi settle_ms (più la latenza della sorgente)
+ *       e stima i successivi samples campioni da 10 ms. La stima resta
+ *       disponibile per luxmeter_burst_pickup con la stessa etichetta.
+ * @param measure Tipo di misura (etichetta della raffica)
+ * @param settle_ms Ritardo di assestamento dopo il cambio di sequenza PWM
+ * @param samples Campioni della raffica (1..LUXMETER_BURST_MAX)
+ */
+void luxmeter_burst_arm(luxmeter_measure_t measure, uint16_t settle_ms, uint16_t samples);
+
+/**
+ * @brief Legge la raffica completa del tipo richiesto
+ * @param measure Tipo di misura (etichetta della raffica)
+ * @param pwm_level Livello PWM corrente per compensazione
+ * @param lux Puntatore per valore lux misurato
+ * @return false se nessuna raffica di quel tipo si è completata dall'ultima lettura
+ */
+bool luxmeter_burst_pickup(luxmeter_measure_t measure, uint16_t pwm_level, uint32_t *lux);
+
 /**
  * @brief Avvia l'acquisizione continua
  */
@@ -43,4 +68,33 @@ void luxmeter_start_acquisition(void);
  */
 void luxmeter_stop_acquisition(void);
 
+/**
+ * @brief Seleziona lo stimatore della finestra ADC (media, mediana, troncata, Hampel)
+ * @return false se il filtro non esiste
+ */
+bool luxmeter_set_filter(luxmeter_filter_t filter);
+
+/**
+ * @brief Installa la tabella di compensazione per livello PWM
+ * @desc Sostituisce offset_map di fabbrica in luxmeter_pickup e nelle
+ *       raffiche. Offset negativi vengono sommati alla lettura.
+ * @param offsets LUXMETER_OFFSET_LEVELS voci in lux, NULL per la tabella di fabbrica
+ */
+void luxmeter_set_offsets(const int16_t *offsets);
+
+/**
+ * @brief Copia la tabella di compensazione in uso
+ * @param offsets Buffer di LUXMETER_OFFSET_LEVELS voci
+ * @return true se la tabella è la calibrazione del dispositivo
+ */
+bool luxmeter_get_offsets(int16_t *offsets);
+
+/**
+ * @brief Copia l'ultima fotografia dei sensori analogici
+ * @desc Luce, temperatura, tensione, corrente e potenza pubblicate dalla
+ *       scansione ADC ogni ANALOG_SCAN_PUBLISH_MS durante l'acquisizione.
+ * @return Numero di sequenza della fotografia (0 = nessuna pubblicazione)
+ */
+uint32_t luxmeter_get_snapshot(analog_snapshot_t *snapshot);
+
 #endif // LUXMETER_H
\ No newline at end of file
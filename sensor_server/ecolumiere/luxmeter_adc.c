@@ -0,0 +1,273 @@
+/**
+ * Autore: DJITSOP FUOGOUK LOIC STEVE
+ * Firmware: ECOLUMIERE BLE MESH ESP32
+ * Implementazione: Luxmeter ADC - Finestra di campioni con decimazione
+ */
+
+#include "luxmeter_adc.h"
+#include <string.h>
+
+/************************************************
+ * PRIVATE FUNCTIONS IMPLEMENTATION           *
+ ************************************************/
+
+/**
+ * @brief Ordinamento per inserzione (23 campioni quasi ordinati: poche mosse)
+ */
+static void luxmeter_sort(uint16_t *v, uint16_t n)
+{
+    for (uint16_t i = 1; i < n; i++) {
+        uint16_t x = v[i];
+        uint16_t j = i;
+        while (j > 0 && v[j - 1] > x) {
+            v[j] = v[j - 1];
+            j--;
+        }
+        v[j] = x;
+    }
+}
+
+/**
+ * @brief Campioni in mezzi codici fini meno la componente alternata, mediana e MAD
+ * @param alt: Doppia ampiezza della componente alternata (0 = nessuna)
+ * @param v: Campioni corretti, con offset 2 * LUXMETER_HAMPEL_BIAS
+ * @param median: Mediana di v
+ * @return MAD di v, almeno 1 LSB intero (finestra costante)
+ */
+static uint32_t luxmeter_hampel_scale(const uint16_t *samples, uint16_t n, int32_t alt, uint16_t *v, uint16_t *median)
+{
+    uint16_t sorted[LUXMETER_WINDOW_USED];
+
+    // 2x - alt sui campioni pari, 2x + alt sui dispari (limitato a uint16_t:
+    // solo un'alternanza vicina al fondo scala esce dal campo)
+    for (uint16_t i = 0; i < n; i++) {
+        int32_t x2 = 2 * (int32_t)samples[i] + ((i & 1) ? alt : -alt) + 2 * LUXMETER_HAMPEL_BIAS;
+        v[i] = (uint16_t)((x2 < 0) ? 0 : (x2 > UINT16_MAX) ? UINT16_MAX : x2);
+    }
+
+    memcpy(sorted, v, n * sizeof(uint16_t));
+    luxmeter_sort(sorted, n);
+    *median = sorted[n / 2];
+
+    for (uint16_t i = 0; i < n; i++) {
+        sorted[i] = (v[i] > *median) ? v[i] - *median : *median - v[i];
+    }
+    luxmeter_sort(sorted, n);
+
+    return (sorted[n / 2] > 2 * LUXMETER_CODE_ONE) ? sorted[n / 2] : 2 * LUXMETER_CODE_ONE;
+}
+
+/**
+ * @brief Hampel con rimozione della componente alternata
+ * @desc L'ondulazione di rete a 50 Hz campionata a 100 Hz alterna il segno a
+ *       ogni campione e divide la finestra in due gruppi che la MAD
+ *       scambierebbe per picchi. La componente alternata è la mediana delle
+ *       semidifferenze fra campioni pari e dispari; viene sottratta solo se
+ *       riduce la MAD (con molti picchi la mediana delle differenze è
+ *       inaffidabile). Poi scarta i campioni oltre 4.5 MAD (3 sigma) dalla
+ *       mediana e media i restanti. Calcoli in mezzi codici fini con offset
+ *       LUXMETER_HAMPEL_BIAS per restare in uint16_t.
+ * @param samples: Campioni in ordine di acquisizione (4..LUXMETER_WINDOW_USED)
+ */
+static uint16_t luxmeter_hampel(const uint16_t *samples, uint16_t n)
+{
+    uint16_t v[LUXMETER_WINDOW_USED];
+    uint16_t v_alt[LUXMETER_WINDOW_USED];
+    uint16_t diff[LUXMETER_WINDOW_USED / 2];
+    uint16_t median, median_alt;
+
+    // Doppia ampiezza della componente alternata
+    for (uint16_t i = 0; i < n / 2; i++) {
+        diff[i] = (uint16_t)(samples[2 * i] + LUXMETER_HAMPEL_BIAS - samples[2 * i + 1]);
+    }
+    luxmeter_sort(diff, n / 2);
+    int32_t alt = (int32_t)diff[n / 4] - LUXMETER_HAMPEL_BIAS;
+
+    uint32_t mad = luxmeter_hampel_scale(samples, n, 0, v, &median);
+    if (alt != 0) {
+        uint32_t mad_alt = luxmeter_hampel_scale(samples, n, alt, v_alt, &median_alt);
+        if (mad_alt < mad) {
+            memcpy(v, v_alt, n * sizeof(uint16_t));
+            median = median_alt;
+            mad = mad_alt;
+        }
+    }
+
+    uint32_t sum = 0;
+    uint16_t count = 0;
+    for (uint16_t i = 0; i < n; i++) {
+        uint32_t dev = (v[i] > median) ? v[i] - median : median - v[i];
+        if (2u * dev <= LUXMETER_HAMPEL_K_X2 * mad) {
+            sum += v[i];
+            count++;
+        }
+    }
+
+    // La mediana è sempre entro la soglia: count >= 1
+    return (uint16_t)((sum / count - 2 * LUXMETER_HAMPEL_BIAS) / 2);
+}
+
+/************************************************
+ * PUBLIC FUNCTIONS IMPLEMENTATION             *
+ ************************************************/
+
+void luxmeter_window_init(luxmeter_window_t *w, uint32_t rate_hz)
+{
+    memset(w, 0, sizeof(*w));
+
+    // Conversioni per campione da 10 ms (almeno una)
+    uint32_t decimation = rate_hz / LUXMETER_SAMPLE_HZ;
+    w->decimation = (uint16_t)(decimation ? decimation : 1);
+    w->burst.tag = LUXMETER_BURST_IDLE;
+}
+
+void luxmeter_window_set_filter(luxmeter_window_t *w, luxmeter_filter_t filter)
+{
+    if (filter < LUXMETER_FILTER_COUNT) {
+        w->filter = (uint8_t)filter;
+    }
+}
+
+void luxmeter_window_reset(luxmeter_window_t *w)
+{
+    w->count = 0;
+    w->acc = 0;
+    w->acc_count = 0;
+    w->burst.tag = LUXMETER_BURST_IDLE;
+}
+
+void luxmeter_window_arm_burst(luxmeter_window_t *w, uint8_t tag, uint16_t skip, uint16_t length)
+{
+    luxmeter_burst_t *b = &w->burst;
+
+    if (tag >= LUXMETER_BURST_TAGS || length == 0) {
+        return;
+    }
+
+    b->tag = LUXMETER_BURST_IDLE;
+    b->ready &= (uint8_t)~(1u << tag);
+    b->skip = skip;
+    b->length = (length > LUXMETER_BURST_MAX) ? LUXMETER_BURST_MAX : length;
+    b->count = 0;
+
+    // Primo campione allineato all'armamento
+    w->acc = 0;
+    w->acc_count = 0;
+    b->tag = tag;
+}
+
+bool luxmeter_window_burst_result(luxmeter_window_t *w, uint8_t tag, uint16_t *code)
+{
+    luxmeter_burst_t *b = &w->burst;
+
+    if (tag >= LUXMETER_BURST_TAGS || !(b->ready & (1u << tag))) {
+        return false;
+    }
+
+    *code = b->result[tag];
+    b->ready &= (uint8_t)~(1u << tag);
+    return true;
+}
+
+uint32_t luxmeter_window_feed(luxmeter_window_t *w, const uint16_t *codes, uint32_t count)
+{
+    uint32_t completed = 0;
+
+    for (uint32_t i = 0; i < count; i++) {
+        w->acc += codes[i];
+        if (++w->acc_count < w->decimation) continue;
+
+        // Campione da 10 ms: media arrotondata delle conversioni del gruppo,
+        // in codici fini (il rumore fa da dither fra codici adiacenti)
+        w->samples[w->count++] = (uint16_t)(((w->acc << LUXMETER_CODE_FRAC_BITS) + w->acc_count / 2) / w->acc_count);
+        w->acc = 0;
+        w->acc_count = 0;
+
+        luxmeter_burst_t *b = &w->burst;
+        if (b->tag != LUXMETER_BURST_IDLE) {
+            if (b->skip > 0) {
+                b->skip--;
+            } else {
+                b->samples[b->count++] = w->samples[w->count - 1];
+                if (b->count >= b->length) {
+                    b->result[b->tag] = luxmeter_estimate(b->samples, b->count, (luxmeter_filter_t)w->filter);
+                    b->ready |= (uint8_t)(1u << b->tag);
+                    b->tag = LUXMETER_BURST_IDLE;
+                }
+            }
+        }
+
+        if (w->count >= LUXMETER_WINDOW_SAMPLES) {
+            w->mean = luxmeter_window_estimate(w->samples, (luxmeter_filter_t)w->filter);
+            w->windows++;
+            w->count = 0;
+            completed++;
+        }
+    }
+
+    return completed;
+}
+
+uint16_t luxmeter_window_mean(const uint16_t *samples)
+{
+    uint32_t sum = 0;
+
+    for (uint16_t i = LUXMETER_WINDOW_FIRST; i <= LUXMETER_WINDOW_LAST; i++) {
+        sum += samples[i];
+    }
+
+    return (uint16_t)(sum / LUXMETER_WINDOW_USED);
+}
+
+uint16_t luxmeter_window_estimate(const uint16_t *samples, luxmeter_filter_t filter)
+{
+    if (filter == LUXMETER_FILTER_MEAN || filter >= LUXMETER_FILTER_COUNT) {
+        return luxmeter_window_mean(samples);
+    }
+
+    return luxmeter_estimate(&samples[LUXMETER_WINDOW_FIRST], LUXMETER_WINDOW_USED, filter);
+}
+
+uint16_t luxmeter_estimate(const uint16_t *samples, uint16_t n, luxmeter_filter_t filter)
+{
+    if (n > LUXMETER_WINDOW_USED) {
+        n = LUXMETER_WINDOW_USED;
+    }
+
+    if (filter == LUXMETER_FILTER_HAMPEL && n >= 4) {
+        return luxmeter_hampel(samples, n);
+    }
+
+    if (filter == LUXMETER_FILTER_MEAN || filter == LUXMETER_FILTER_HAMPEL || filter >= LUXMETER_FILTER_COUNT) {
+        uint32_t sum = 0;
+        for (uint16_t i = 0; i < n; i++) {
+            sum += samples[i];
+        }
+        return (uint16_t)(sum / n);
+    }
+
+    uint16_t v[LUXMETER_WINDOW_USED];
+    memcpy(v, samples, n * sizeof(uint16_t));
+    luxmeter_sort(v, n);
+
+    switch (filter) {
+        case LUXMETER_FILTER_TRIMMED: {
+            // Stessa frazione scartata della finestra: 4 su 23 per lato
+            uint16_t trim = (uint16_t)((uint32_t)n * LUXMETER_TRIM / LUXMETER_WINDOW_USED);
+            uint32_t sum = 0;
+            for (uint16_t i = trim; i < n - trim; i++) {
+                sum += v[i];
+            }
+            return (uint16_t)(sum / (n - 2 * trim));
+        }
+
+        default:
+            return v[n / 2];
+    }
+}
+
+const char *luxmeter_filter_name(luxmeter_filter_t filter)
+{
+    static const char *names[LUXMETER_FILTER_COUNT] = { "MEDIA", "MEDIANA", "TRONCATA", "HAMPEL" };
+    return (filter < LUXMETER_FILTER_COUNT) ? names[filter] : "?";
+}
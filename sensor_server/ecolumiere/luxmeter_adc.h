@@ -0,0 +1,203 @@
+/**
+ * Autore: DJITSOP FUOGOUK LOIC STEVE
+ * Firmware: ECOLUMIERE BLE MESH ESP32
+ * Modulo: Luxmeter ADC - Interfaccia di acquisizione e finestra di campioni
+ * Descrizione: Sorgente dei campioni del sensore luce dietro una piccola
+ *              interfaccia (oneshot a timer, continuo DMA, mock su PC) e
+ *              finestra di LUXMETER_WINDOW_SAMPLES campioni da 10 ms su cui il
+ *              luxmeter calcola la media o uno stimatore robusto (mediana,
+ *              media troncata, Hampel) in aritmetica intera senza allocazioni.
+ *              Le conversioni più veloci di 10 ms vengono mediate a gruppi
+ *              (decimazione). Accanto alla finestra continua, una raffica
+ *              (burst) armata dal controllore PWM raccoglie pochi campioni
+ *              dopo un ritardo di assestamento e ne salva la stima con
+ *              l'etichetta dello slot che l'ha richiesta. Campioni, stime e
+ *              raffiche sono codici fini (1/LUXMETER_CODE_ONE di LSB): la
+ *              decimazione conserva la frazione che il rumore del sensore
+ *              rende misurabile, invece di arrotondare al codice intero.
+ *              Nessuna dipendenza ESP-IDF.
+ */
+
+#ifndef LUXMETER_ADC_H
+#define LUXMETER_ADC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/************************************************
+ * PUBLIC DEFINES AND MACRO                     *
+ ************************************************/
+
+#define LUXMETER_WINDOW_SAMPLES         45      // Campioni per finestra (SAMPLES_PER_CHANNEL)
+#define LUXMETER_WINDOW_FIRST           20      // Primo campione mediato
+#define LUXMETER_WINDOW_LAST            42      // Ultimo campione mediato
+#define LUXMETER_WINDOW_USED            (LUXMETER_WINDOW_LAST - LUXMETER_WINDOW_FIRST + 1)
+#define LUXMETER_SAMPLE_HZ              100     // Un campione ogni 10 ms
+#define LUXMETER_ADC_MAX_CODE           4095    // ADC a 12 bit
+#define LUXMETER_CODE_FRAC_BITS         2       // Bit frazionari dei codici fini
+#define LUXMETER_CODE_ONE               (1 << LUXMETER_CODE_FRAC_BITS)
+#define LUXMETER_FINE_MAX_CODE          (LUXMETER_ADC_MAX_CODE << LUXMETER_CODE_FRAC_BITS)
+
+#define LUXMETER_TRIM                   4       // Campioni scartati per lato (media troncata)
+#define LUXMETER_HAMPEL_K_X2            9       // Soglia Hampel 4.5 MAD (3 sigma), raddoppiata
+#define LUXMETER_HAMPEL_BIAS            (4096 << LUXMETER_CODE_FRAC_BITS)   // Offset dei calcoli Hampel (valori senza segno)
+
+#define LUXMETER_BURST_MAX              LUXMETER_WINDOW_USED    // Campioni massimi per raffica
+#define LUXMETER_BURST_TAGS             4       // Etichette di raffica (tipi di misura)
+#define LUXMETER_BURST_IDLE             0xFF    // Nessuna raffica armata
+
+/************************************************
+ * PUBLIC TYPES                                 *
+ ************************************************/
+
+/**
+ * @brief Stimatore applicato ai campioni FIRST..LAST della finestra
+ */
+typedef enum {
+  LUXMETER_FILTER_MEAN,       ///< Media aritmetica (algoritmo Nordic)
+  LUXMETER_FILTER_MEDIAN,     ///< Mediana
+  LUXMETER_FILTER_TRIMMED,    ///< Media senza i LUXMETER_TRIM estremi per lato
+  LUXMETER_FILTER_HAMPEL,     ///< Media dei campioni entro 4.5 MAD dalla mediana, senza ondulazione di rete
+  LUXMETER_FILTER_COUNT
+} luxmeter_filter_t;
+
+/**
+ * @brief Raffica di campioni sincronizzata con uno slot
+ * @field tag: Etichetta della raffica armata, LUXMETER_BURST_IDLE se nessuna
+ * @field skip: Campioni ancora da scartare (assestamento)
+ * @field length/count: Campioni richiesti e raccolti
+ * @field samples: Campioni della raffica in corso
+ * @field result: Ultima stima completa per etichetta (codice fine)
+ * @field ready: Bit per etichetta: stima completa non ancora letta
+ */
+typedef struct luxmeter_burst_t
+{
+  uint8_t tag;
+  uint16_t skip;
+  uint16_t length;
+  uint16_t count;
+  uint16_t samples[LUXMETER_BURST_MAX];
+  volatile uint16_t result[LUXMETER_BURST_TAGS];
+  volatile uint8_t ready;
+} luxmeter_burst_t;
+
+/**
+ * @brief Callback dei codici ADC convertiti
+ * @desc Chiamata dalla sorgente con blocchi di codici a 12 bit alla sua
+ *       frequenza di conversione. Con il driver continuo gira in ISR: non
+ *       deve bloccare né usare il floating point.
+ */
+typedef void (*luxmeter_adc_cb_t)(const uint16_t *codes, uint32_t count);
+
+/**
+ * @brief Sorgente di campioni del sensore luce
+ * @field name: Nome per i log
+ * @field rate_hz: Conversioni al secondo consegnate alla callback
+ * @field latency_ms: Ritardo massimo fra conversione e consegna (frame DMA)
+ * @field init: Configura l'hardware e registra la callback
+ * @field start/stop: Avvia e arresta le conversioni
+ */
+typedef struct luxmeter_adc_if_t
+{
+  const char *name;
+  uint32_t rate_hz;
+  uint16_t latency_ms;
+  bool (*init)(luxmeter_adc_cb_t cb);
+  bool (*start)(void);
+  void (*stop)(void);
+} luxmeter_adc_if_t;
+
+/**
+ * @brief Finestra di campioni con decimazione
+ * @field samples: Campioni da 10 ms della finestra corrente (codici fini)
+ * @field count: Campioni raccolti nella finestra corrente
+ * @field decimation: Conversioni mediate per ogni campione
+ * @field filter: Stimatore della finestra (luxmeter_filter_t)
+ * @field acc/acc_count: Somma delle conversioni del campione in corso
+ * @field mean: Stima dell'ultima finestra completa (codice fine)
+ * @field windows: Finestre complete dall'inizializzazione
+ * @field burst: Raffica sincronizzata con gli slot
+ */
+typedef struct luxmeter_window_t
+{
+  uint16_t samples[LUXMETER_WINDOW_SAMPLES];
+  uint16_t count;
+  uint16_t decimation;
+  uint8_t filter;
+  uint32_t acc;
+  uint16_t acc_count;
+  volatile uint16_t mean;
+  volatile uint32_t windows;
+  luxmeter_burst_t burst;
+} luxmeter_window_t;
+
+/************************************************
+ * PUBLIC PROTOTYPES                           *
+ ************************************************/
+
+/**
+ * @brief Inizializza la finestra per una sorgente a rate_hz conversioni al secondo
+ * @desc Stimatore iniziale: media (LUXMETER_FILTER_MEAN).
+ */
+void luxmeter_window_init(luxmeter_window_t *w, uint32_t rate_hz);
+
+/**
+ * @brief Scarta la finestra e il campione in corso (nuova acquisizione)
+ */
+void luxmeter_window_reset(luxmeter_window_t *w);
+
+/**
+ * @brief Aggiunge un blocco di conversioni
+ * @return Numero di finestre completate dal blocco
+ */
+uint32_t luxmeter_window_feed(luxmeter_window_t *w, const uint16_t *codes, uint32_t count);
+
+/**
+ * @brief Arma una raffica etichettata
+ * @desc Scarta il campione in corso, così il primo campione parte adesso;
+ *       la finestra continua prosegue. Sostituisce una raffica ancora in
+ *       corso e invalida la stima precedente della stessa etichetta.
+ * @param tag: Etichetta (< LUXMETER_BURST_TAGS)
+ * @param skip: Campioni da scartare prima della raffica (assestamento)
+ * @param length: Campioni della raffica (1..LUXMETER_BURST_MAX)
+ */
+void luxmeter_window_arm_burst(luxmeter_window_t *w, uint8_t tag, uint16_t skip, uint16_t length);
+
+/**
+ * @brief Legge e consuma la stima di una raffica completa
+ * @return false se la raffica dell'etichetta non è ancora completa
+ */
+bool luxmeter_window_burst_result(luxmeter_window_t *w, uint8_t tag, uint16_t *code);
+
+/**
+ * @brief Seleziona lo stimatore delle prossime finestre e raffiche
+ */
+void luxmeter_window_set_filter(luxmeter_window_t *w, luxmeter_filter_t filter);
+
+/**
+ * @brief Media intera dei campioni FIRST..LAST (stesso calcolo Nordic)
+ * @desc Con campioni a codice intero (decimazione 1) il codice intero
+ *       della media coincide con quello Nordic.
+ */
+uint16_t luxmeter_window_mean(const uint16_t *samples);
+
+/**
+ * @brief Stima dei campioni FIRST..LAST con lo stimatore scelto
+ * @desc Solo interi e memoria sullo stack (due copie da 23 campioni):
+ *       utilizzabile in ISR.
+ */
+uint16_t luxmeter_window_estimate(const uint16_t *samples, luxmeter_filter_t filter);
+
+/**
+ * @brief Stima di n campioni consecutivi (1..LUXMETER_WINDOW_USED)
+ * @desc La media troncata scarta la stessa frazione della finestra; Hampel
+ *       richiede almeno 4 campioni, altrimenti media.
+ */
+uint16_t luxmeter_estimate(const uint16_t *v, uint16_t n, luxmeter_filter_t filter);
+
+/**
+ * @brief Nome dello stimatore per i log
+ */
+const char *luxmeter_filter_name(luxmeter_filter_t filter);
+
+#endif // LUXMETER_ADC_H
@@ -0,0 +1,134 @@
+/**
+ * Autore: DJITSOP FUOGOUK LOIC STEVE
+ * Firmware: ECOLUMIERE BLE MESH ESP32
+ * Implementazione: Natural Estimator - Stima della luce naturale senza spegnere la lampada
+ */
+
+#include "natural_est.h"
+
+#include <string.h>
+#include <math.h>
+
+/************************************************
+ * PRIVATE FUNCTIONS IMPLEMENTATION            *
+ ************************************************/
+
+/**
+ * @brief Numero di livelli accesi (> 0) già calibrati
+ */
+static int natural_est_points(const natural_est_t *est)
+{
+  return __builtin_popcountll(est->valid_mask & ~1ULL);
+}
+
+/**
+ * @brief Ricalcola il guadagno lux/livello (minimi quadrati per l'origine)
+ */
+static void natural_est_refit(natural_est_t *est)
+{
+  float sum_lc = 0.0f;
+  float sum_ll = 0.0f;
+
+  for (int level = 1; level < NATURAL_EST_LEVELS; level++) {
+    if (est->valid_mask & (1ULL << level)) {
+      sum_lc += (float)level * est->contrib[level];
+      sum_ll += (float)(level * level);
+    }
+  }
+
+  est->gain = (sum_ll > 0.0f) ? sum_lc / sum_ll : 0.0f;
+}
+
+/************************************************
+ * PUBLIC FUNCTIONS IMPLEMENTATION              *
+ ************************************************/
+
+void natural_est_init(natural_est_t *est, uint32_t now_ms)
+{
+  memset(est, 0, sizeof(natural_est_t));
+
+  est->last_cal_ms = now_ms;
+  est->interval_ms = NATURAL_EST_RECAL_MIN_MS;
+}
+
+float natural_est_contribution(const natural_est_t *est, uint16_t level)
+{
+  if (level == 0) return 0.0f;
+  if (level >= NATURAL_EST_LEVELS) level = NATURAL_EST_LEVELS - 1;
+
+  if (est->valid_mask & (1ULL << level)) {
+    return est->contrib[level];
+  }
+
+  // Livello mai calibrato: retta sui livelli noti se ce ne sono abbastanza
+  if (natural_est_points(est) >= NATURAL_EST_MIN_POINTS) {
+    return est->gain * (float)level;
+  }
+
+  return -1.0f;
+}
+
+bool natural_est_need_blank(const natural_est_t *est, uint16_t level, uint32_t now_ms)
+{
+  if (level == 0) return false;
+  if (est->force) return true;
+  if (natural_est_contribution(est, level) < 0.0f) return true;
+
+  return (now_ms - est->last_cal_ms) >= est->interval_ms;
+}
+
+void natural_est_calibrate(natural_est_t *est, uint16_t level, uint32_t env_lux,
+                           uint32_t natural_lux, uint32_t now_ms)
+{
+  if (level == 0) return;
+  if (level >= NATURAL_EST_LEVELS) level = NATURAL_EST_LEVELS - 1;
+
+  float measured = (env_lux > natural_lux) ? (float)(env_lux - natural_lux) : 0.0f;
+  float predicted = natural_est_contribution(est, level);
+
+  // L'errore di previsione è l'errore che avrebbe avuto la stima
+  if (predicted >= 0.0f) {
+    est->last_error = fabsf(predicted - measured);
+    est->err_sum += est->last_error;
+    est->err_count++;
+
+    if (est->last_error > NATURAL_EST_ERR_LUX) {
+      est->interval_ms = NATURAL_EST_RECAL_MIN_MS;
+    } else if (est->interval_ms < NATURAL_EST_RECAL_MAX_MS / 2) {
+      est->interval_ms *= 2;
+    } else {
+      est->interval_ms = NATURAL_EST_RECAL_MAX_MS;
+    }
+  }
+
+  if (est->valid_mask & (1ULL << level)) {
+    est->contrib[level] += NATURAL_EST_ALPHA * (measured - est->contrib[level]);
+  } else {
+    est->contrib[level] = measured;
+    est->valid_mask |= (1ULL << level);
+  }
+
+  natural_est_refit(est);
+
+  est->last_cal_ms = now_ms;
+  est->force = false;
+  est->calibrations++;
+}
+
+bool natural_est_estimate(natural_est_t *est, uint16_t level, uint32_t env_lux,
+                          uint32_t *natural_lux)
+{
+  float contrib = natural_est_contribution(est, level);
+  if (contrib < 0.0f) return false;
+
+  float natural = (float)env_lux - contrib;
+
+  // Ambiente molto sotto il contributo previsto: il modello non è più valido
+  if (natural < -NATURAL_EST_NEG_LUX) {
+    est->force = true;
+  }
+
+  *natural_lux = (natural > 0.0f) ? (uint32_t)(natural + 0.5f) : 0;
+  est->estimates++;
+  return true;
+}
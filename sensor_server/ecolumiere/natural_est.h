@@ -0,0 +1,86 @@
+/**
+ * Autore: DJITSOP FUOGOUK LOIC STEVE
+ * Firmware: ECOLUMIERE BLE MESH ESP32
+ * Modulo: Natural Estimator - Stima della luce naturale senza spegnere la lampada
+ * Descrizione: Apprende il contributo della lampada per ogni livello dalle coppie
+ *              (misura ambiente, misura al buio) e stima la luce naturale come
+ *              ambiente meno contributo. Decide quando serve una nuova misura al
+ *              buio. Nessuna dipendenza ESP-IDF: il tempo viene passato dal chiamante.
+ */
+
+#ifndef NATURAL_EST_H
+#define NATURAL_EST_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define NATURAL_EST_LEVELS              33      // Livelli 0..LIGHT_MAX_LEVEL
+#define NATURAL_EST_ALPHA               0.3f    // Peso della nuova calibrazione (EWMA)
+#define NATURAL_EST_MIN_POINTS          2       // Livelli calibrati per la stima per interpolazione
+#define NATURAL_EST_RECAL_MIN_MS        (60 * 1000)        // Intervallo dopo una calibrazione scadente
+#define NATURAL_EST_RECAL_MAX_MS        (15 * 60 * 1000)   // Intervallo massimo a modello stabile
+#define NATURAL_EST_ERR_LUX             15.0f   // Errore di previsione oltre il quale il modello è scadente
+#define NATURAL_EST_NEG_LUX             20.0f   // Stima negativa oltre la quale si forza la calibrazione
+
+/**
+ * @brief Modello del contributo lampada
+ * @field contrib: Lux aggiunti dalla lampada al sensore per livello (EWMA)
+ * @field valid_mask: Bit i = livello i calibrato almeno una volta
+ * @field gain: Lux per livello, retta per l'origine sui livelli calibrati
+ * @field last_cal_ms: Istante dell'ultima calibrazione al buio
+ * @field interval_ms: Intervallo corrente tra due calibrazioni
+ * @field force: Calibrazione richiesta dalla stima (valore incoerente)
+ * @field last_error: Errore di previsione dell'ultima calibrazione (lux)
+ * @field err_sum/err_count: Errore assoluto cumulato sulle calibrazioni
+ * @field calibrations/estimates: Contatori per la diagnostica
+ */
+typedef struct natural_est_t
+{
+  float contrib[NATURAL_EST_LEVELS];
+  uint64_t valid_mask;
+  float gain;
+  uint32_t last_cal_ms;
+  uint32_t interval_ms;
+  bool force;
+  float last_error;
+  float err_sum;
+  uint32_t err_count;
+  uint32_t calibrations;
+  uint32_t estimates;
+} natural_est_t;
+
+/**
+ * @brief Inizializza un modello vuoto (prima stima solo dopo una calibrazione)
+ */
+void natural_est_init(natural_est_t *est, uint32_t now_ms);
+
+/**
+ * @brief Indica se la prossima misura naturale deve essere presa al buio
+ * @desc Vero se il livello non è coperto dal modello, se è scaduto l'intervallo
+ *       di ricalibrazione o se una stima precedente è risultata incoerente.
+ *       A livello 0 la lampada è già spenta: la misura ambiente è già naturale.
+ */
+bool natural_est_need_blank(const natural_est_t *est, uint16_t level, uint32_t now_ms);
+
+/**
+ * @brief Aggiorna il modello con una coppia di misure allo stesso livello
+ * @param env_lux: Misura ambiente con lampada accesa a level
+ * @param natural_lux: Misura con lampada spenta
+ */
+void natural_est_calibrate(natural_est_t *est, uint16_t level, uint32_t env_lux,
+                           uint32_t natural_lux, uint32_t now_ms);
+
+/**
+ * @brief Contributo previsto della lampada a level (lux), negativo se ignoto
+ */
+float natural_est_contribution(const natural_est_t *est, uint16_t level);
+
+/**
+ * @brief Stima la luce naturale dalla misura ambiente
+ * @param natural_lux: Stima (ambiente meno contributo, limitata a zero)
+ * @return false se il modello non copre ancora il livello
+ */
+bool natural_est_estimate(natural_est_t *est, uint16_t level, uint32_t env_lux,
+                          uint32_t *natural_lux);
+
+#endif //NATURAL_EST_H
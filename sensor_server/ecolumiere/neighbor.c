@@ -0,0 +1,210 @@
+/**
+ * Autore: DJITSOP FUOGOUK LOIC STEVE
+ * Firmware: ECOLUMIERE BLE MESH ESP32
+ * Implementazione: Neighbor - Fusione delle misure lux dei nodi della stessa stanza
+ */
+
+#include "neighbor.h"
+
+#include <string.h>
+#include <math.h>
+
+/************************************************
+ * PRIVATE TYPES AND STRUCTURES                *
+ ************************************************/
+
+typedef struct fuse_sample_t
+{
+  uint32_t value;
+  float weight;
+} fuse_sample_t;
+
+/************************************************
+ * PRIVATE FUNCTIONS IMPLEMENTATION            *
+ ************************************************/
+
+/**
+ * @brief Peso di una lettura in funzione dell'età
+ */
+static float neighbor_weight(const neighbor_entry_t *entry, uint32_t now_ms)
+{
+  uint32_t age = now_ms - entry->rx_ms;
+
+  if (age <= NEIGHBOR_FRESH_MS) return NEIGHBOR_WEIGHT;
+  if (age >= NEIGHBOR_STALE_MS) return 0.0f;
+
+  return NEIGHBOR_WEIGHT * (float)(NEIGHBOR_STALE_MS - age) /
+         (float)(NEIGHBOR_STALE_MS - NEIGHBOR_FRESH_MS);
+}
+
+/**
+ * @brief Combina i campioni con media o mediana pesata
+ */
+static uint32_t fuse_samples(fuse_sample_t *samples, uint8_t count, neighbor_fusion_t mode)
+{
+  float total = 0.0f;
+
+  if (mode == NEIGHBOR_FUSION_MEAN) {
+    float sum = 0.0f;
+    for (uint8_t i = 0; i < count; i++) {
+      sum += (float)samples[i].value * samples[i].weight;
+      total += samples[i].weight;
+    }
+    return (uint32_t)(sum / total + 0.5f);
+  }
+
+  // Ordinamento per inserzione: al massimo NEIGHBOR_TABLE_SIZE + 1 campioni
+  for (uint8_t i = 1; i < count; i++) {
+    fuse_sample_t key = samples[i];
+    int8_t j = i - 1;
+    while (j >= 0 && samples[j].value > key.value) {
+      samples[j + 1] = samples[j];
+      j--;
+    }
+    samples[j + 1] = key;
+  }
+
+  for (uint8_t i = 0; i < count; i++) {
+    total += samples[i].weight;
+  }
+
+  float half = total / 2.0f;
+  float cumulative = 0.0f;
+  for (uint8_t i = 0; i < count; i++) {
+    cumulative += samples[i].weight;
+    if (cumulative >= half) {
+      return samples[i].value;
+    }
+  }
+
+  return samples[count - 1].value;
+}
+
+/**
+ * @brief Avvicina la misura locale al valore di stanza
+ * @desc Entro NEIGHBOR_TRUST_BAND la misura locale pesa per lo più (mantiene i
+ *       gradienti reali, es. lato finestra); oltre 2 x NEIGHBOR_TRUST_BAND è
+ *       considerata anomala (ombra locale, sensore coperto) e si usa la stanza.
+ */
+static uint32_t fuse_blend(uint32_t own, uint32_t center)
+{
+  float reference = (center > 0) ? (float)center : 1.0f;
+  float deviation = fabsf((float)own - (float)center) / reference;
+  float alpha;
+
+  if (deviation <= NEIGHBOR_TRUST_BAND) {
+    alpha = NEIGHBOR_BLEND_MIN;
+  } else if (deviation >= 2.0f * NEIGHBOR_TRUST_BAND) {
+    alpha = 1.0f;
+  } else {
+    alpha = NEIGHBOR_BLEND_MIN + (1.0f - NEIGHBOR_BLEND_MIN) *
+            (deviation - NEIGHBOR_TRUST_BAND) / NEIGHBOR_TRUST_BAND;
+  }
+
+  return (uint32_t)((float)own + alpha * ((float)center - (float)own) + 0.5f);
+}
+
+/************************************************
+ * PUBLIC FUNCTIONS IMPLEMENTATION              *
+ ************************************************/
+
+void neighbor_table_init(neighbor_table_t *table)
+{
+  memset(table, 0, sizeof(neighbor_table_t));
+}
+
+void neighbor_table_update(neighbor_table_t *table, uint16_t addr, uint32_t natural,
+                           uint32_t env, int8_t rssi, uint32_t now_ms)
+{
+  neighbor_entry_t *slot = NULL;
+  neighbor_entry_t *oldest = &table->entries[0];
+
+  for (uint8_t i = 0; i < NEIGHBOR_TABLE_SIZE; i++) {
+    neighbor_entry_t *entry = &table->entries[i];
+
+    if (entry->used && entry->addr == addr) {
+      slot = entry;
+      break;
+    }
+    if (slot == NULL && !entry->used) {
+      slot = entry;
+    }
+    if (entry->used && oldest->used &&
+        (now_ms - entry->rx_ms) > (now_ms - oldest->rx_ms)) {
+      oldest = entry;
+    }
+  }
+
+  if (slot == NULL) {
+    slot = oldest;
+  }
+
+  slot->addr = addr;
+  slot->natural = natural;
+  slot->env = env;
+  slot->rssi = rssi;
+  slot->rx_ms = now_ms;
+  slot->used = true;
+}
+
+uint8_t neighbor_table_count(const neighbor_table_t *table, uint32_t now_ms)
+{
+  uint8_t count = 0;
+
+  for (uint8_t i = 0; i < NEIGHBOR_TABLE_SIZE; i++) {
+    if (table->entries[i].used && neighbor_weight(&table->entries[i], now_ms) > 0.0f) {
+      count++;
+    }
+  }
+
+  return count;
+}
+
+uint8_t neighbor_table_addresses(const neighbor_table_t *table, uint32_t now_ms,
+                                 uint16_t *addrs, uint8_t max)
+{
+  uint8_t count = 0;
+
+  for (uint8_t i = 0; i < NEIGHBOR_TABLE_SIZE && count < max; i++) {
+    if (table->entries[i].used && neighbor_weight(&table->entries[i], now_ms) > 0.0f) {
+      addrs[count++] = table->entries[i].addr;
+    }
+  }
+
+  return count;
+}
+
+uint8_t neighbor_fuse(const neighbor_table_t *table, neighbor_fusion_t mode,
+                      uint32_t own_natural, uint32_t now_ms, uint32_t *fused_natural)
+{
+  fuse_sample_t natural[NEIGHBOR_TABLE_SIZE + 1];
+  uint8_t count = 0;
+
+  *fused_natural = own_natural;
+
+  if (mode == NEIGHBOR_FUSION_OFF) return 0;
+
+  natural[0].value = own_natural;
+  natural[0].weight = NEIGHBOR_OWN_WEIGHT;
+  count = 1;
+
+  for (uint8_t i = 0; i < NEIGHBOR_TABLE_SIZE; i++) {
+    const neighbor_entry_t *entry = &table->entries[i];
+    if (!entry->used) continue;
+
+    float weight = neighbor_weight(entry, now_ms);
+    if (weight <= 0.0f) continue;
+
+    natural[count].value = entry->natural;
+    natural[count].weight = weight;
+    count++;
+  }
+
+  if (count == 1) return 0;
+
+  uint32_t center_natural = fuse_samples(natural, count, mode);
+
+  *fused_natural = fuse_blend(own_natural, center_natural);
+
+  return count - 1;
+}
@@ -0,0 +1,103 @@
+/**
+ * Autore: DJITSOP FUOGOUK LOIC STEVE
+ * Firmware: ECOLUMIERE BLE MESH ESP32
+ * Modulo: Neighbor - Fusione delle misure lux dei nodi della stessa stanza
+ * Descrizione: Tabella delle letture ricevute dai vicini via mesh e fusione
+ *              pesata della luce naturale con la misura locale. Nessuna
+ *              dipendenza ESP-IDF né lock: il tempo viene passato dal
+ *              chiamante, che serializza gli accessi alla tabella.
+ */
+
+#ifndef NEIGHBOR_H
+#define NEIGHBOR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define NEIGHBOR_TABLE_SIZE         8
+#define NEIGHBOR_FRESH_MS           (60 * 1000)     // Peso pieno fino a 1 minuto
+#define NEIGHBOR_STALE_MS           (3 * 60 * 1000) // Ignorato oltre 3 minuti
+#define NEIGHBOR_OWN_WEIGHT         2.0f            // Peso della misura locale
+#define NEIGHBOR_WEIGHT             1.0f            // Peso di un vicino fresco
+#define NEIGHBOR_TRUST_BAND         0.25f           // Scostamento dalla stanza ritenuto normale
+#define NEIGHBOR_BLEND_MIN          0.25f           // Peso minimo del valore di stanza
+
+/**
+ * @brief Metodo di fusione delle misure
+ */
+typedef enum neighbor_fusion_t
+{
+  NEIGHBOR_FUSION_OFF = 0,
+  NEIGHBOR_FUSION_MEAN,
+  NEIGHBOR_FUSION_MEDIAN
+} neighbor_fusion_t;
+
+/**
+ * @brief Lettura ricevuta da un vicino
+ * @field addr: Indirizzo unicast mesh del vicino
+ * @field natural: Misura filtrata di luce naturale (lux)
+ * @field env: Misura filtrata di luce ambiente (lux)
+ * @field rx_ms: Istante di ricezione (ms)
+ * @field rssi: RSSI dell'ultimo messaggio
+ * @field used: Slot occupato
+ */
+typedef struct neighbor_entry_t
+{
+  uint16_t addr;
+  uint32_t natural;
+  uint32_t env;
+  uint32_t rx_ms;
+  int8_t rssi;
+  bool used;
+} neighbor_entry_t;
+
+typedef struct neighbor_table_t
+{
+  neighbor_entry_t entries[NEIGHBOR_TABLE_SIZE];
+} neighbor_table_t;
+
+/**
+ * @brief Svuota la tabella vicini
+ */
+void neighbor_table_init(neighbor_table_t *table);
+
+/**
+ * @brief Inserisce o aggiorna la lettura di un vicino
+ * @desc Se la tabella è piena viene sostituita la lettura più vecchia.
+ */
+void neighbor_table_update(neighbor_table_t *table, uint16_t addr, uint32_t natural,
+                           uint32_t env, int8_t rssi, uint32_t now_ms);
+
+/**
+ * @brief Numero di vicini non scaduti
+ */
+uint8_t neighbor_table_count(const neighbor_table_t *table, uint32_t now_ms);
+
+/**
+ * @brief Copia gli indirizzi dei vicini non scaduti
+ * @param addrs: Buffer di destinazione
+ * @param max: Capacità del buffer
+ * @return Numero di indirizzi copiati
+ */
+uint8_t neighbor_table_addresses(const neighbor_table_t *table, uint32_t now_ms,
+                                 uint16_t *addrs, uint8_t max);
+
+/**
+ * @brief Fonde la misura naturale locale con quelle dei vicini
+ * @desc Solo la luce naturale è confrontabile fra nodi: la misura ambiente
+ *       di ogni vicino contiene soprattutto la sua lampada e resta locale.
+ *       Il peso dei vicini decresce linearmente da NEIGHBOR_FRESH_MS a
+ *       NEIGHBOR_STALE_MS. Il valore di riferimento è la media o la mediana
+ *       pesata (che scarta le ombre locali di un singolo sensore); la misura
+ *       locale viene poi avvicinata al riferimento in proporzione allo
+ *       scostamento. host/room_sim: uniformità, comfort ed energia invariati,
+ *       qualche inversione del livello in meno con la mediana; per questo il
+ *       firmware parte con NEIGHBOR_FUSION_OFF.
+ * @param own_natural: Misura naturale filtrata locale
+ * @param fused_natural: Risultato della fusione
+ * @return Numero di vicini che hanno contribuito
+ */
+uint8_t neighbor_fuse(const neighbor_table_t *table, neighbor_fusion_t mode,
+                      uint32_t own_natural, uint32_t now_ms, uint32_t *fused_natural);
+
+#endif //NEIGHBOR_H
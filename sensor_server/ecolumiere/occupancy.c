@@ -0,0 +1,124 @@
+/**
+ * Autore: DJITSOP FUOGOUK LOIC STEVE
+ * Firmware: ECOLUMIERE BLE MESH ESP32
+ * Implementazione: Occupancy - Macchina a stati di presenza nella stanza
+ */
+
+#include "occupancy.h"
+
+#include <string.h>
+
+/************************************************
+ * PRIVATE VARIABLES                           *
+ ************************************************/
+
+static const char *occupancy_state_names[OCCUPANCY_STATE_COUNT] = {
+  "OCCUPIED", "GRACE", "VACANT", "STANDBY"
+};
+
+/************************************************
+ * PRIVATE FUNCTIONS IMPLEMENTATION            *
+ ************************************************/
+
+/**
+ * @brief Stato atteso dopo idle_ms senza movimento
+ */
+static occupancy_state_t occupancy_state_for_idle(const occupancy_config_t *config, uint32_t idle_ms)
+{
+  if (idle_ms < config->hold_ms) return OCCUPANCY_OCCUPIED;
+  if (idle_ms < config->grace_ms) return OCCUPANCY_GRACE;
+  if (idle_ms < config->standby_ms) return OCCUPANCY_VACANT;
+  return OCCUPANCY_STANDBY;
+}
+
+/************************************************
+ * PUBLIC FUNCTIONS IMPLEMENTATION              *
+ ************************************************/
+
+void occupancy_init(occupancy_sm_t *sm, uint32_t now_ms)
+{
+  memset(sm, 0, sizeof(occupancy_sm_t));
+
+  sm->config.hold_ms = OCCUPANCY_HOLD_MS;
+  sm->config.grace_ms = OCCUPANCY_GRACE_MS;
+  sm->config.standby_ms = OCCUPANCY_STANDBY_MS;
+  sm->config.grace_perc = OCCUPANCY_GRACE_TARGET_PERC;
+  sm->config.vacant_perc = OCCUPANCY_VACANT_TARGET_PERC;
+  sm->config.standby_perc = OCCUPANCY_STANDBY_TARGET_PERC;
+  sm->config.standby_perc_min = OCCUPANCY_STANDBY_PERC_MIN;
+
+  sm->state = OCCUPANCY_OCCUPIED;
+  sm->last_motion_ms = now_ms;
+  sm->since_ms = now_ms;
+}
+
+bool occupancy_set_times(occupancy_sm_t *sm, uint32_t hold_ms, uint32_t grace_ms, uint32_t standby_ms)
+{
+  uint32_t hold = hold_ms ? hold_ms : sm->config.hold_ms;
+  uint32_t grace = grace_ms ? grace_ms : sm->config.grace_ms;
+  uint32_t standby = standby_ms ? standby_ms : sm->config.standby_ms;
+
+  if (hold > grace || grace > standby) return false;
+
+  sm->config.hold_ms = hold;
+  sm->config.grace_ms = grace;
+  sm->config.standby_ms = standby;
+  return true;
+}
+
+bool occupancy_step(occupancy_sm_t *sm, bool motion, uint32_t now_ms)
+{
+  occupancy_state_t next;
+
+  sm->motion = motion;
+
+  if (motion) {
+    sm->armed = true;
+    sm->last_motion_ms = now_ms;
+  }
+
+  // Senza sensore (nessun movimento mai visto) la stanza resta occupata
+  if (!sm->armed) return false;
+
+  next = motion ? OCCUPANCY_OCCUPIED
+                : occupancy_state_for_idle(&sm->config, now_ms - sm->last_motion_ms);
+
+  if (next == sm->state) return false;
+
+  sm->state = next;
+  sm->since_ms = now_ms;
+  return true;
+}
+
+void occupancy_modulate(const occupancy_sm_t *sm, uint32_t *target_lux, float *perc_min)
+{
+  uint8_t perc = 100;
+
+  switch (sm->state)
+  {
+  case OCCUPANCY_GRACE:
+    perc = sm->config.grace_perc;
+    break;
+  case OCCUPANCY_VACANT:
+    perc = sm->config.vacant_perc;
+    break;
+  case OCCUPANCY_STANDBY:
+    perc = sm->config.standby_perc;
+    *perc_min = sm->config.standby_perc_min;
+    break;
+  default:
+    break;
+  }
+
+  if (perc < 100 && *target_lux > 0) {
+    uint32_t reduced = (*target_lux * perc) / 100;
+    // Il passo di controllo divide per target_lux: mai zero se configurato
+    *target_lux = reduced ? reduced : 1;
+  }
+}
+
+const char *occupancy_state_name(occupancy_state_t state)
+{
+  if (state >= OCCUPANCY_STATE_COUNT) return "UNKNOWN";
+  return occupancy_state_names[state];
+}
@@ -0,0 +1,107 @@
+/**
+ * Autore: DJITSOP FUOGOUK LOIC STEVE
+ * Firmware: ECOLUMIERE BLE MESH ESP32
+ * Modulo: Occupancy - Macchina a stati di presenza nella stanza
+ * Descrizione: Da presenza rilevata a standby passando per grazia e stanza
+ *              vuota, con modulazione di target_lux e perc_min. Nessuna
+ *              dipendenza ESP-IDF: il tempo viene passato dal chiamante.
+ */
+
+#ifndef OCCUPANCY_H
+#define OCCUPANCY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Tempi misurati dall'ultimo movimento rilevato
+#define OCCUPANCY_HOLD_MS               (2 * 60 * 1000)  // Presenza confermata
+#define OCCUPANCY_GRACE_MS              (5 * 60 * 1000)  // Fine periodo di grazia
+#define OCCUPANCY_STANDBY_MS            (15 * 60 * 1000) // Ingresso in standby
+
+// Modulazione del target (percentuale del target configurato)
+#define OCCUPANCY_GRACE_TARGET_PERC     70
+#define OCCUPANCY_VACANT_TARGET_PERC    40
+#define OCCUPANCY_STANDBY_TARGET_PERC   10
+#define OCCUPANCY_STANDBY_PERC_MIN      0.05f   // Minimo garantito in standby
+
+/**
+ * @brief Stati di presenza
+ */
+typedef enum occupancy_state_t
+{
+  OCCUPANCY_OCCUPIED = 0,
+  OCCUPANCY_GRACE,
+  OCCUPANCY_VACANT,
+  OCCUPANCY_STANDBY,
+  OCCUPANCY_STATE_COUNT
+} occupancy_state_t;
+
+/**
+ * @brief Parametri configurabili della macchina a stati
+ * @field hold_ms: Permanenza in OCCUPIED dopo l'ultimo movimento
+ * @field grace_ms: Fine del periodo di grazia (dall'ultimo movimento)
+ * @field standby_ms: Passaggio in standby (dall'ultimo movimento)
+ * @field grace_perc/vacant_perc/standby_perc: Target in % per stato
+ * @field standby_perc_min: perc_min applicato in standby
+ */
+typedef struct occupancy_config_t
+{
+  uint32_t hold_ms;
+  uint32_t grace_ms;
+  uint32_t standby_ms;
+  uint8_t grace_perc;
+  uint8_t vacant_perc;
+  uint8_t standby_perc;
+  float standby_perc_min;
+} occupancy_config_t;
+
+/**
+ * @brief Stato della macchina
+ * @field armed: Sensore presente (almeno un movimento visto dall'avvio)
+ * @field motion: Ultimo livello del sensore
+ * @field last_motion_ms: Istante dell'ultimo movimento
+ * @field since_ms: Istante di ingresso nello stato corrente
+ */
+typedef struct occupancy_sm_t
+{
+  occupancy_config_t config;
+  occupancy_state_t state;
+  bool armed;
+  bool motion;
+  uint32_t last_motion_ms;
+  uint32_t since_ms;
+} occupancy_sm_t;
+
+/**
+ * @brief Inizializza la macchina con la configurazione di default
+ * @desc Finché il sensore non segnala il primo movimento la macchina resta
+ *       in OCCUPIED: una lampada senza PIR non viene mai spenta.
+ */
+void occupancy_init(occupancy_sm_t *sm, uint32_t now_ms);
+
+/**
+ * @brief Imposta i tempi di transizione (0 = lascia invariato)
+ * @return false se i tempi non sono crescenti
+ */
+bool occupancy_set_times(occupancy_sm_t *sm, uint32_t hold_ms, uint32_t grace_ms, uint32_t standby_ms);
+
+/**
+ * @brief Aggiorna la macchina con il livello del sensore
+ * @param motion: true se il sensore segnala movimento
+ * @return true se lo stato è cambiato
+ */
+bool occupancy_step(occupancy_sm_t *sm, bool motion, uint32_t now_ms);
+
+/**
+ * @brief Applica la modulazione dello stato corrente
+ * @param target_lux: Target configurato, ridotto secondo lo stato
+ * @param perc_min: Minimo configurato, sostituito in standby
+ */
+void occupancy_modulate(const occupancy_sm_t *sm, uint32_t *target_lux, float *perc_min);
+
+/**
+ * @brief Nome leggibile dello stato
+ */
+const char *occupancy_state_name(occupancy_state_t state);
+
+#endif //OCCUPANCY_H
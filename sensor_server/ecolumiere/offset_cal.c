@@ -0,0 +1,131 @@
+/**
+ * Autore: DJITSOP FUOGOUK LOIC STEVE
+ * Firmware: ECOLUMIERE BLE MESH ESP32
+ * Implementazione: Offset Cal - Tabella di compensazione del luxmeter per dispositivo
+ */
+
+#include "offset_cal.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+/************************************************
+ * PRIVATE VARIABLES                           *
+ ************************************************/
+
+static const char *offset_cal_status_names[OFFSET_CAL_STATUS_COUNT] = {
+  "OK", "NESSUNA LETTURA", "STANZA NON BUIA", "DERIVA DEL BUIO",
+  "NESSUNA RISPOSTA", "OFFSET FUORI LIMITI", "OCCUPATO"
+};
+
+/************************************************
+ * PRIVATE FUNCTIONS IMPLEMENTATION           *
+ ************************************************/
+
+/**
+ * @brief Pendenza ai minimi quadrati della retta per il buio
+ * @param offset: Offset sottratti alle letture (NULL = nessuno)
+ */
+static float offset_cal_slope(const float *lux, const int16_t *offset, float dark)
+{
+  double sum_ly = 0.0, sum_ll = 0.0;
+
+  for (int level = 1; level < OFFSET_CAL_LEVELS; level++) {
+    double y = lux[level] - (offset ? offset[level] : 0) - dark;
+    sum_ly += level * y;
+    sum_ll += (double)level * level;
+  }
+
+  return (float)(sum_ly / sum_ll);
+}
+
+/**
+ * @brief Scarto quadratico medio delle letture compensate dalla loro retta
+ */
+static float offset_cal_rms(const float *lux, const int16_t *offset, float dark)
+{
+  float gain = offset_cal_slope(lux, offset, dark);
+  double sum = 0.0;
+
+  for (int level = 1; level < OFFSET_CAL_LEVELS; level++) {
+    double r = lux[level] - offset[level] - dark - gain * level;
+    sum += r * r;
+  }
+
+  return (float)sqrt(sum / (OFFSET_CAL_LEVELS - 1));
+}
+
+/************************************************
+ * PUBLIC FUNCTIONS IMPLEMENTATION              *
+ ************************************************/
+
+uint8_t offset_cal_level_at(uint8_t step)
+{
+  return (step < OFFSET_CAL_LEVELS) ? step : 0;
+}
+
+bool offset_cal_fit(const float *lux, const int16_t *prior, offset_cal_table_t *table,
+                    offset_cal_result_t *result)
+{
+  memset(result, 0, sizeof(offset_cal_result_t));
+  memset(table, 0, sizeof(offset_cal_table_t));
+
+  for (int i = 0; i < OFFSET_CAL_POINTS; i++) {
+    if (lux[i] < 0.0f) {
+      result->status = OFFSET_CAL_ERR_NO_SAMPLES;
+      return false;
+    }
+  }
+
+  result->dark = lux[0];
+  result->drift = lux[OFFSET_CAL_POINTS - 1] - lux[0];
+
+  if (result->dark > OFFSET_CAL_MAX_DARK_LUX) {
+    result->status = OFFSET_CAL_ERR_NOT_DARK;
+    return false;
+  }
+  if (fabsf(result->drift) > OFFSET_CAL_MAX_DRIFT_LUX) {
+    result->status = OFFSET_CAL_ERR_DRIFT;
+    return false;
+  }
+
+  // Buio medio fra inizio e fine: la deriva residua si divide fra i livelli
+  float dark = 0.5f * (lux[0] + lux[OFFSET_CAL_POINTS - 1]);
+  result->gain = offset_cal_slope(lux, NULL, dark);
+
+  if (result->gain < OFFSET_CAL_MIN_GAIN) {
+    result->status = OFFSET_CAL_ERR_NO_RESPONSE;
+    return false;
+  }
+
+  int16_t offset[OFFSET_CAL_LEVELS] = { 0 };
+
+  for (int level = 1; level < OFFSET_CAL_LEVELS; level++) {
+    offset[level] = (int16_t)lroundf(lux[level] - dark - result->gain * level);
+
+    int16_t magnitude = (int16_t)abs(offset[level]);
+    if (magnitude > result->max_offset) result->max_offset = magnitude;
+  }
+
+  result->rms_prior = offset_cal_rms(lux, prior, dark);
+  result->rms = offset_cal_rms(lux, offset, dark);
+
+  table->version = OFFSET_CAL_VERSION;
+  table->levels = OFFSET_CAL_LEVELS;
+  table->gain_x100 = (uint16_t)(result->gain * 100.0f + 0.5f);
+  memcpy(table->offset, offset, sizeof(offset));
+
+  if (result->max_offset > OFFSET_CAL_MAX_OFFSET) {
+    result->status = OFFSET_CAL_ERR_OUT_OF_RANGE;
+    return false;
+  }
+
+  result->status = OFFSET_CAL_OK;
+  return true;
+}
+
+const char *offset_cal_status_name(offset_cal_status_t status)
+{
+  return (status < OFFSET_CAL_STATUS_COUNT) ? offset_cal_status_names[status] : "?";
+}
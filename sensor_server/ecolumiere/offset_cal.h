@@ -0,0 +1,119 @@
+/**
+ * Autore: DJITSOP FUOGOUK LOIC STEVE
+ * Firmware: ECOLUMIERE BLE MESH ESP32
+ * Modulo: Offset Cal - Tabella di compensazione del luxmeter per dispositivo
+ * Descrizione: Dalla scansione al buio di tutti i livelli PWM ricava la
+ *              tabella che sostituisce offset_map di fabbrica. La luce media
+ *              della lampada è lineare nel duty: lo scarto delle letture dalla
+ *              retta che parte dal buio è errore di misura (ottica, sensore
+ *              logaritmico sotto PWM) e diventa l'offset del livello. Nessuna
+ *              dipendenza ESP-IDF.
+ */
+
+#ifndef OFFSET_CAL_H
+#define OFFSET_CAL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/************************************************
+ * PUBLIC DEFINES AND MACRO                     *
+ ************************************************/
+
+#define OFFSET_CAL_LEVELS               33      // Livelli PWM 0..32 (voci di offset_map)
+#define OFFSET_CAL_POINTS               (OFFSET_CAL_LEVELS + 1)  // Tutti i livelli, poi di nuovo il buio
+#define OFFSET_CAL_SETTLE_MS            300     // Lampada a regime dopo il cambio di livello
+#define OFFSET_CAL_BURSTS               3       // Raffiche mediate per livello
+#define OFFSET_CAL_BURST_MS             300     // Latenza ADC + raffica da 23 campioni
+#define OFFSET_CAL_VERSION              1
+
+// Limiti di accettazione
+#define OFFSET_CAL_MAX_DARK_LUX         20.0f   // Luce a lampada spenta oltre cui la stanza non è buia
+#define OFFSET_CAL_MAX_DRIFT_LUX        3.0f    // Variazione del buio tra inizio e fine scansione
+#define OFFSET_CAL_MIN_GAIN             0.5f    // Lux per livello minimi (sensore che vede la lampada)
+#define OFFSET_CAL_MAX_OFFSET           200     // Offset massimo in valore assoluto (lux)
+
+/************************************************
+ * PUBLIC TYPES                                 *
+ ************************************************/
+
+/**
+ * @brief Esito della calibrazione
+ */
+typedef enum offset_cal_status_t
+{
+  OFFSET_CAL_OK = 0,
+  OFFSET_CAL_ERR_NO_SAMPLES,
+  OFFSET_CAL_ERR_NOT_DARK,
+  OFFSET_CAL_ERR_DRIFT,
+  OFFSET_CAL_ERR_NO_RESPONSE,
+  OFFSET_CAL_ERR_OUT_OF_RANGE,
+  OFFSET_CAL_ERR_BUSY,
+  OFFSET_CAL_STATUS_COUNT
+} offset_cal_status_t;
+
+/**
+ * @brief Tabella salvata in NVS
+ * @field version: OFFSET_CAL_VERSION
+ * @field levels: Voci della tabella (OFFSET_CAL_LEVELS)
+ * @field gain_x100: Pendenza della retta di riferimento (lux per livello x 100)
+ * @field offset: Lux da sottrarre alla lettura per livello (negativi: da sommare)
+ */
+typedef struct __attribute__((packed)) offset_cal_table_t
+{
+  uint8_t version;
+  uint8_t levels;
+  uint16_t gain_x100;
+  int16_t offset[OFFSET_CAL_LEVELS];
+  uint16_t crc;  // deve essere l'ultimo campo della struttura
+} offset_cal_table_t;
+
+/**
+ * @brief Risultato della stima
+ * @field dark/drift: Buio a inizio scansione e sua variazione a fine scansione
+ * @field gain: Lux per livello della retta dal buio
+ * @field rms_prior: Scarto dalla retta con la tabella in uso prima della scansione
+ * @field rms: Scarto dalla retta con la nuova tabella (solo arrotondamento)
+ * @field max_offset: Offset più grande in valore assoluto
+ */
+typedef struct offset_cal_result_t
+{
+  offset_cal_status_t status;
+  float dark;
+  float drift;
+  float gain;
+  float rms_prior;
+  float rms;
+  int16_t max_offset;
+} offset_cal_result_t;
+
+/************************************************
+ * PUBLIC PROTOTYPES                           *
+ ************************************************/
+
+/**
+ * @brief Livello della lampada al passo step della scansione
+ * @desc 0, 1, ..., 32 e infine di nuovo 0 per la deriva.
+ */
+uint8_t offset_cal_level_at(uint8_t step);
+
+/**
+ * @brief Ricava la tabella dalla scansione
+ * @desc Retta lux = buio + gain * livello ai minimi quadrati con il buio
+ *       fisso, offset = lettura - retta arrotondato; offset[0] = 0, così la
+ *       luce naturale non viene mai sottratta.
+ * @param lux: OFFSET_CAL_POINTS letture non compensate nell'ordine di
+ *             offset_cal_level_at (negative = nessuna lettura)
+ * @param prior: Tabella in uso, per il confronto (OFFSET_CAL_LEVELS voci)
+ * @param table: Tabella calcolata (CRC non calcolato)
+ * @return true se status == OFFSET_CAL_OK
+ */
+bool offset_cal_fit(const float *lux, const int16_t *prior, offset_cal_table_t *table,
+                    offset_cal_result_t *result);
+
+/**
+ * @brief Nome leggibile dell'esito
+ */
+const char *offset_cal_status_name(offset_cal_status_t status);
+
+#endif //OFFSET_CAL_H
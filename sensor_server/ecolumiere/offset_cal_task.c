@@ -0,0 +1,182 @@
+/**
+ * Autore: DJITSOP FUOGOUK LOIC STEVE
+ * Firmware: ECOLUMIERE BLE MESH ESP32
+ * Implementazione: Offset Cal Task - Esecuzione della calibrazione degli offset sul dispositivo
+ */
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+
+#include "offset_cal_task.h"
+#include "commissioning.h"
+#include "pwmcontroller.h"
+#include "luxmeter.h"
+#include "storage.h"
+#include "esp_rom_crc.h"
+
+#include <string.h>
+
+/************************************************
+ * PRIVATE DEFINES AND MACRO                   *
+ ************************************************/
+static const char *TAG = "OFFSET_CAL";
+
+#define OFFSET_CAL_TASK_STACK           4096
+#define OFFSET_CAL_TASK_PRIORITY        3
+
+/************************************************
+ * PRIVATE GLOBAL VARIABLES                    *
+ ************************************************/
+static bool offset_has_result = false;
+static offset_cal_run_t offset_last_result;
+static offset_cal_done_cb_t offset_done_callback = NULL;
+
+/************************************************
+ * PRIVATE FUNCTIONS IMPLEMENTATION           *
+ ************************************************/
+
+/**
+ * @brief Lettura non compensata del livello: media di più raffiche
+ * @return Lux medi, negativo se nessuna raffica si è completata
+ */
+static float offset_cal_measure_raw(uint8_t level) {
+    uint32_t lux;
+    float sum = 0.0f;
+    int count = 0;
+
+    pwm_hold_level(level);
+    vTaskDelay(pdMS_TO_TICKS(OFFSET_CAL_SETTLE_MS));
+
+    for (int i = 0; i < OFFSET_CAL_BURSTS; i++) {
+        luxmeter_burst_arm(LUX_MEASURE_CALIBRATION, 0, LUXMETER_BURST_MAX);
+        vTaskDelay(pdMS_TO_TICKS(OFFSET_CAL_BURST_MS));
+
+        if (luxmeter_burst_pickup(LUX_MEASURE_CALIBRATION, level, &lux)) {
+            sum += (float)lux;
+            count++;
+        }
+    }
+
+    return count ? sum / count : -1.0f;
+}
+
+/**
+ * @brief CRC della tabella, escluso il campo crc finale
+ */
+static uint16_t offset_cal_crc(const offset_cal_table_t *table) {
+    return esp_rom_crc16_le(0xFFFF, (const uint8_t *)table, sizeof(offset_cal_table_t) - sizeof(uint16_t));
+}
+
+/**
+ * @brief Installa nel luxmeter gli offset della tabella (struttura packed)
+ */
+static void offset_cal_apply(const offset_cal_table_t *table) {
+    int16_t offsets[LUXMETER_OFFSET_LEVELS];
+
+    memcpy(offsets, table->offset, sizeof(offsets));
+    luxmeter_set_offsets(offsets);
+}
+
+/**
+ * @brief Task di calibrazione degli offset: misura, stima, installa e salva
+ */
+static void offset_cal_task(void *pvParameters) {
+    offset_cal_run_t result;
+    float lux[OFFSET_CAL_POINTS];
+    int16_t prior[LUXMETER_OFFSET_LEVELS];
+    int64_t start = esp_timer_get_time();
+
+    memset(&result, 0, sizeof(result));
+    luxmeter_get_offsets(prior);
+
+    for (uint8_t step = 0; step < OFFSET_CAL_POINTS; step++) {
+        uint8_t level = offset_cal_level_at(step);
+        lux[step] = offset_cal_measure_raw(level);
+
+        ESP_LOGD(TAG, "📏 Livello %2u/32: %.1f lux (grezzi)", level, lux[step]);
+    }
+
+    pwm_hold_level(-1);
+
+    offset_cal_fit(lux, prior, &result.table, &result.cal);
+    result.duration_ms = (uint32_t)((esp_timer_get_time() - start) / 1000);
+
+    if (result.cal.status == OFFSET_CAL_OK) {
+        result.table.crc = offset_cal_crc(&result.table);
+        offset_cal_apply(&result.table);
+        if (!storage_save_offset_table(&result.table)) {
+            ESP_LOGW(TAG, "⚠️ Tabella offset non salvata: in uso fino al riavvio");
+        }
+
+        ESP_LOGI(TAG, "✅ Offset calibrati in %lu ms - %.2f lux/livello, offset massimo %d lux",
+                 result.duration_ms, result.cal.gain, result.cal.max_offset);
+        ESP_LOGI(TAG, "📊 Scarto dalla retta %.2f lux (tabella precedente %.2f lux)",
+                 result.cal.rms, result.cal.rms_prior);
+    } else {
+        ESP_LOGW(TAG, "❌ Calibrazione offset fallita: %s - tabella invariata",
+                 offset_cal_status_name(result.cal.status));
+    }
+
+    offset_last_result = result;
+    offset_has_result = true;
+
+    if (offset_done_callback) {
+        offset_done_callback(&result);
+    }
+
+    commissioning_release();
+    vTaskDelete(NULL);
+}
+
+/************************************************
+ * PUBLIC FUNCTIONS IMPLEMENTATION             *
+ ************************************************/
+
+esp_err_t offset_cal_start(offset_cal_done_cb_t done) {
+    if (!is_pwm_initialized()) {
+        ESP_LOGE(TAG, "PWM not initialized");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (!commissioning_claim()) {
+        ESP_LOGW(TAG, "Commissioning already running");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    offset_done_callback = done;
+
+    if (xTaskCreate(offset_cal_task, "offset_cal", OFFSET_CAL_TASK_STACK,
+                    NULL, OFFSET_CAL_TASK_PRIORITY, NULL) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create offset calibration task");
+        commissioning_release();
+        return ESP_ERR_NO_MEM;
+    }
+
+    ESP_LOGI(TAG, "🚀 Offset calibration started - %d levels, about %d s",
+             OFFSET_CAL_LEVELS,
+             OFFSET_CAL_POINTS * (OFFSET_CAL_SETTLE_MS + OFFSET_CAL_BURSTS * OFFSET_CAL_BURST_MS) / 1000);
+    return ESP_OK;
+}
+
+bool offset_cal_get_last_result(offset_cal_run_t *result) {
+    if (!offset_has_result || result == NULL) return false;
+    *result = offset_last_result;
+    return true;
+}
+
+bool offset_cal_load(void) {
+    offset_cal_table_t table;
+
+    if (storage_load_offset_table(&table) &&
+        table.version == OFFSET_CAL_VERSION &&
+        table.levels == LUXMETER_OFFSET_LEVELS &&
+        table.crc == offset_cal_crc(&table)) {
+        offset_cal_apply(&table);
+        return true;
+    }
+
+    luxmeter_set_offsets(NULL);
+    return false;
+}
@@ -0,0 +1,60 @@
+/**
+ * Autore: DJITSOP FUOGOUK LOIC STEVE
+ * Firmware: ECOLUMIERE BLE MESH ESP32
+ * Modulo: Offset Cal Task - Esecuzione della calibrazione degli offset sul dispositivo
+ * Descrizione: Task che percorre al buio tutti i 33 livelli con raffiche non
+ *              compensate, ricava la tabella con offset_cal_fit, la installa
+ *              nel luxmeter e la salva in NVS con CRC. Esclusivo con la
+ *              scansione di commissioning (commissioning_claim).
+ */
+
+#ifndef OFFSET_CAL_TASK_H
+#define OFFSET_CAL_TASK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "offset_cal.h"
+
+/**
+ * @brief Esito di una calibrazione degli offset
+ * @field cal: Stima e verifica della tabella
+ * @field table: Tabella calcolata (valida solo con cal.status OK)
+ * @field duration_ms: Durata della scansione
+ */
+typedef struct {
+    offset_cal_result_t cal;
+    offset_cal_table_t table;
+    uint32_t duration_ms;
+} offset_cal_run_t;
+
+/**
+ * @brief Notifica di fine calibrazione degli offset
+ */
+typedef void (*offset_cal_done_cb_t)(const offset_cal_run_t *result);
+
+/**
+ * @brief Avvia la calibrazione degli offset del luxmeter in un task dedicato
+ * @desc Stanza buia: misura ogni livello PWM con raffiche non compensate,
+ *       ricava la tabella con offset_cal_fit e, se valida, la installa nel
+ *       luxmeter e la salva in NVS con CRC.
+ * @param done: Notifica di fine calibrazione (può essere NULL)
+ * @return ESP_ERR_INVALID_STATE se una scansione è già in corso
+ */
+esp_err_t offset_cal_start(offset_cal_done_cb_t done);
+
+/**
+ * @brief Restituisce l'esito dell'ultima calibrazione degli offset
+ * @return false se nessuna calibrazione è stata completata dall'avvio
+ */
+bool offset_cal_get_last_result(offset_cal_run_t *result);
+
+/**
+ * @brief Installa nel luxmeter la tabella salvata in NVS
+ * @desc Tabella assente, di versione diversa o con CRC errato: resta
+ *       offset_map di fabbrica. Da chiamare dopo storage e luxmeter.
+ * @return true se è in uso la calibrazione del dispositivo
+ */
+bool offset_cal_load(void);
+
+#endif // OFFSET_CAL_TASK_H
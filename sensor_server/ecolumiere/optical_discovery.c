@@ -0,0 +1,199 @@
+/**
+ * Autore: DJITSOP FUOGOUK LOIC STEVE
+ * Firmware: ECOLUMIERE BLE MESH ESP32
+ * Implementazione: Optical Discovery - Vicini ottici delle lampade della stanza
+ */
+
+#include "optical_discovery.h"
+
+#include <string.h>
+
+/************************************************
+ * PRIVATE FUNCTIONS IMPLEMENTATION            *
+ ************************************************/
+
+/**
+ * @brief Entra nel passo index: trasmette solo la lampada di turno
+ */
+static void optical_discovery_enter(optical_discovery_t *od, uint8_t index, uint32_t now_ms)
+{
+  od->index = index;
+  od->step_ms = now_ms;
+  od->transmit = (index == (uint8_t)od->self_index);
+  od->repeated = false;
+}
+
+/**
+ * @brief Chiude la scoperta: nessuna lampada trasmette
+ */
+static uint8_t optical_discovery_finish(optical_discovery_t *od)
+{
+  od->index = od->count;
+  od->transmit = false;
+  od->state = OPTICAL_DISCOVERY_DONE;
+  return OPTICAL_DISCOVERY_ACT_ROLE | OPTICAL_DISCOVERY_ACT_DONE;
+}
+
+/**
+ * @brief Conclude il proprio turno e passa il gettone (l'ultimo chiude la sessione)
+ */
+static uint8_t optical_discovery_pass(optical_discovery_t *od, uint32_t now_ms)
+{
+  uint8_t next = (uint8_t)(od->index + 1);
+
+  if (next >= od->count) {
+    return optical_discovery_finish(od) | OPTICAL_DISCOVERY_ACT_SEND;
+  }
+
+  optical_discovery_enter(od, next, now_ms);
+  return OPTICAL_DISCOVERY_ACT_ROLE | OPTICAL_DISCOVERY_ACT_SEND;
+}
+
+/**
+ * @brief Registra un'acquisizione durante il turno della lampada index
+ */
+static void optical_discovery_record(optical_discovery_t *od, uint16_t payload, uint8_t confidence)
+{
+  uint8_t k = od->index;
+
+  if (od->captures[k] == UINT8_MAX) return;
+  od->captures[k]++;
+
+  if (payload == od->members[k]) {
+    od->hits[k]++;
+    od->confidence_sum[k] += confidence;
+  }
+}
+
+/************************************************
+ * PUBLIC FUNCTIONS IMPLEMENTATION              *
+ ************************************************/
+
+void optical_discovery_init(optical_discovery_t *od, uint16_t self)
+{
+  memset(od, 0, sizeof(optical_discovery_t));
+  od->self = self;
+  od->self_index = -1;
+  od->state = OPTICAL_DISCOVERY_IDLE;
+}
+
+bool optical_discovery_start(optical_discovery_t *od, const uint16_t *members, uint8_t count,
+                             uint8_t session, uint32_t now_ms)
+{
+  if (count == 0 || count > OPTICAL_DISCOVERY_MAX_MEMBERS) return false;
+
+  // Ordinamento per indirizzo: tutti i nodi ottengono la stessa sequenza
+  uint16_t sorted[OPTICAL_DISCOVERY_MAX_MEMBERS];
+  memcpy(sorted, members, count * sizeof(uint16_t));
+  for (uint8_t i = 1; i < count; i++) {
+    uint16_t addr = sorted[i];
+    int j = i - 1;
+    while (j >= 0 && sorted[j] > addr) {
+      sorted[j + 1] = sorted[j];
+      j--;
+    }
+    sorted[j + 1] = addr;
+  }
+
+  int8_t self_index = -1;
+  for (uint8_t i = 0; i < count; i++) {
+    if (sorted[i] == od->self) self_index = (int8_t)i;
+  }
+  if (self_index < 0) return false;
+
+  uint16_t self = od->self;
+  memset(od, 0, sizeof(optical_discovery_t));
+  od->self = self;
+  od->self_index = self_index;
+  memcpy(od->members, sorted, count * sizeof(uint16_t));
+  od->count = count;
+  od->session = session;
+  od->state = OPTICAL_DISCOVERY_RUNNING;
+
+  optical_discovery_enter(od, 0, now_ms);
+  return true;
+}
+
+uint8_t optical_discovery_on_token(optical_discovery_t *od, uint8_t session, const uint16_t *members,
+                                   uint8_t count, uint8_t index, uint32_t now_ms)
+{
+  uint8_t actions = 0;
+
+  // Sessione nuova (una sessione conclusa con lo stesso numero è un'eco)
+  if (od->state == OPTICAL_DISCOVERY_IDLE || session != od->session) {
+    if (!optical_discovery_start(od, members, count, session, now_ms)) return 0;
+    actions |= OPTICAL_DISCOVERY_ACT_ROLE;
+  }
+
+  if (od->state != OPTICAL_DISCOVERY_RUNNING || index > od->count) return actions;
+
+  if (index == od->count) {
+    return actions | optical_discovery_finish(od);
+  }
+
+  if (index > od->index) {
+    optical_discovery_enter(od, index, now_ms);
+    actions |= OPTICAL_DISCOVERY_ACT_ROLE;
+  }
+
+  return actions;
+}
+
+uint8_t optical_discovery_tick(optical_discovery_t *od, uint32_t now_ms, bool captured,
+                               uint16_t payload, uint8_t confidence)
+{
+  if (od->state != OPTICAL_DISCOVERY_RUNNING) return 0;
+
+  uint32_t elapsed = now_ms - od->step_ms;
+
+  if (elapsed < OPTICAL_DISCOVERY_STEP_MS) {
+    if (elapsed < OPTICAL_DISCOVERY_GUARD_MS) return 0;
+
+    if (od->transmit) {
+      // Ripetizione del gettone per i nodi che non si sono ancora uniti
+      if (od->repeated) return 0;
+      od->repeated = true;
+      return OPTICAL_DISCOVERY_ACT_SEND;
+    }
+
+    if (captured) optical_discovery_record(od, payload, confidence);
+    return 0;
+  }
+
+  // Fine del proprio turno: spegne il trasmettitore e passa il gettone
+  if (od->transmit) {
+    return optical_discovery_pass(od, now_ms);
+  }
+
+  // Gettone perso: si prosegue da soli, la lampada di turno riallinea gli altri
+  if (elapsed < OPTICAL_DISCOVERY_STEP_MS + OPTICAL_DISCOVERY_TOKEN_TIMEOUT_MS) return 0;
+
+  uint8_t next = (uint8_t)(od->index + 1);
+  if (next >= od->count) {
+    return optical_discovery_finish(od);
+  }
+
+  optical_discovery_enter(od, next, now_ms);
+  return od->transmit ? (OPTICAL_DISCOVERY_ACT_ROLE | OPTICAL_DISCOVERY_ACT_SEND) : 0;
+}
+
+void optical_discovery_get_table(const optical_discovery_t *od, optical_discovery_table_t *table)
+{
+  memset(table, 0, sizeof(optical_discovery_table_t));
+
+  table->version = OPTICAL_DISCOVERY_VERSION;
+  table->session = od->session;
+  table->count = od->count;
+
+  for (uint8_t k = 0; k < od->count; k++) {
+    table->addr[k] = od->members[k];
+    table->captures[k] = od->captures[k];
+    if (od->hits[k] == 0) continue;
+
+    table->strength[k] = (uint8_t)(100U * od->hits[k] / od->captures[k]);
+    table->confidence[k] = (uint8_t)(od->confidence_sum[k] / od->hits[k]);
+    if (od->hits[k] >= OPTICAL_DISCOVERY_MIN_HITS && table->strength[k] >= OPTICAL_DISCOVERY_MIN_STRENGTH) {
+      table->neighbor_mask |= (1U << k);
+    }
+  }
+}
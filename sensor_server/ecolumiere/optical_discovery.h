@@ -0,0 +1,143 @@
+/**
+ * Autore: DJITSOP FUOGOUK LOIC STEVE
+ * Firmware: ECOLUMIERE BLE MESH ESP32
+ * Modulo: Optical Discovery - Vicini ottici delle lampade della stanza
+ * Descrizione: Protocollo a gettone sul gruppo stanza, come la matrice di
+ *              stanza: a turno una lampada trasmette in luce il proprio
+ *              identificativo (trame lightframe con l'indirizzo unicast)
+ *              mentre le altre acquisiscono e decodificano. Ogni nodo ricava
+ *              la tabella dei membri che il proprio sensore vede, con la
+ *              frazione di acquisizioni decodificate e la confidenza media
+ *              delle trame come intensità del segnale. Le tabelle di tutti i
+ *              nodi formano il grafo di adiacenza fisica della stanza.
+ *              Nessuna dipendenza ESP-IDF: tempo, trame e messaggi passano
+ *              dal chiamante.
+ */
+
+#ifndef OPTICAL_DISCOVERY_H
+#define OPTICAL_DISCOVERY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "neighbor.h"
+
+#define OPTICAL_DISCOVERY_MAX_MEMBERS       (NEIGHBOR_TABLE_SIZE + 1)  // Vicini più il nodo stesso
+#define OPTICAL_DISCOVERY_GUARD_MS          1000    // Inizio turno ignorato: gettone in ritardo sugli altri nodi
+#define OPTICAL_DISCOVERY_LISTEN_MS         5000    // Acquisizioni per turno
+#define OPTICAL_DISCOVERY_STEP_MS           (OPTICAL_DISCOVERY_GUARD_MS + OPTICAL_DISCOVERY_LISTEN_MS)
+#define OPTICAL_DISCOVERY_TOKEN_TIMEOUT_MS  2000    // Attesa del gettone prima di proseguire da soli
+#define OPTICAL_DISCOVERY_MIN_HITS          2       // Trame per riconoscere un vicino
+#define OPTICAL_DISCOVERY_MIN_STRENGTH      50      // Acquisizioni con trama (%) per riconoscere un vicino
+#define OPTICAL_DISCOVERY_VERSION           1
+
+// Azioni richieste al chiamante (maschera di bit)
+#define OPTICAL_DISCOVERY_ACT_ROLE          0x01    // Trasmettere (transmit) o tornare ricevitore
+#define OPTICAL_DISCOVERY_ACT_SEND          0x02    // Inviare il gettone con optical_discovery_t.index
+#define OPTICAL_DISCOVERY_ACT_DONE          0x04    // Scoperta conclusa: rilasciare l'uscita
+
+/**
+ * @brief Stato della scoperta
+ */
+typedef enum optical_discovery_state_t
+{
+  OPTICAL_DISCOVERY_IDLE = 0,
+  OPTICAL_DISCOVERY_RUNNING,
+  OPTICAL_DISCOVERY_DONE
+} optical_discovery_state_t;
+
+/**
+ * @brief Stato di un nodo nel protocollo
+ * @desc I passi sono 0..count-1 (trasmette la lampada members[i]); il
+ *       gettone del passo count chiude la scoperta. Il gettone del passo i+1
+ *       è inviato da chi ha trasmesso nel passo i, dopo aver spento il
+ *       trasmettitore; la lampada di turno lo ripete a fine guardia perché i
+ *       nodi che hanno perso l'avvio della sessione si uniscano in tempo per
+ *       il proprio turno. Le acquisizioni contano dopo OPTICAL_DISCOVERY_GUARD_MS
+ *       dall'inizio del passo e solo le trame con l'indirizzo della lampada di
+ *       turno: un passo iniziato per timeout resta quindi attendibile.
+ * @field members: Indirizzi unicast in ordine crescente
+ * @field self_index: Posizione del nodo in members
+ * @field index/step_ms: Passo corrente e istante di inizio
+ * @field transmit: Il nodo deve trasmettere il proprio identificativo
+ * @field repeated: Gettone del passo già ripetuto (lampada di turno)
+ * @field captures: Acquisizioni eseguite durante il turno di ciascun membro
+ * @field hits: Acquisizioni con una trama valida del membro
+ * @field confidence_sum: Somma delle confidenze delle trame del membro
+ */
+typedef struct optical_discovery_t
+{
+  uint16_t self;
+  optical_discovery_state_t state;
+  uint8_t session;
+  uint8_t count;
+  int8_t self_index;
+  uint16_t members[OPTICAL_DISCOVERY_MAX_MEMBERS];
+  uint8_t index;
+  uint32_t step_ms;
+  bool transmit;
+  bool repeated;
+  uint8_t captures[OPTICAL_DISCOVERY_MAX_MEMBERS];
+  uint8_t hits[OPTICAL_DISCOVERY_MAX_MEMBERS];
+  uint16_t confidence_sum[OPTICAL_DISCOVERY_MAX_MEMBERS];
+} optical_discovery_t;
+
+/**
+ * @brief Tabella dei vicini esposta al gateway
+ * @field neighbor_mask: Bit i = membro addr[i] visto in almeno
+ *        OPTICAL_DISCOVERY_MIN_HITS acquisizioni e OPTICAL_DISCOVERY_MIN_STRENGTH
+ * @field strength: Acquisizioni con trama valida sul totale del turno (%)
+ * @field confidence: Confidenza media delle trame ricevute (0..100)
+ */
+typedef struct __attribute__((packed)) optical_discovery_table_t
+{
+  uint8_t version;
+  uint8_t session;
+  uint8_t count;
+  uint16_t neighbor_mask;
+  uint16_t addr[OPTICAL_DISCOVERY_MAX_MEMBERS];
+  uint8_t captures[OPTICAL_DISCOVERY_MAX_MEMBERS];
+  uint8_t strength[OPTICAL_DISCOVERY_MAX_MEMBERS];
+  uint8_t confidence[OPTICAL_DISCOVERY_MAX_MEMBERS];
+} optical_discovery_table_t;
+
+/**
+ * @brief Inizializza il nodo (nessuna scoperta in corso)
+ */
+void optical_discovery_init(optical_discovery_t *od, uint16_t self);
+
+/**
+ * @brief Avvia una sessione con i membri indicati (nodo promotore)
+ * @desc I membri vengono ordinati; il chiamante invia poi il gettone del
+ *       passo 0 e applica il ruolo (trasmette il primo membro).
+ * @return false se il nodo non è fra i membri o i membri sono troppi
+ */
+bool optical_discovery_start(optical_discovery_t *od, const uint16_t *members, uint8_t count,
+                             uint8_t session, uint32_t now_ms);
+
+/**
+ * @brief Gestisce un gettone ricevuto dal gruppo stanza
+ * @desc Una sessione nuova viene adottata; un gettone di un passo successivo
+ *       fa avanzare il nodo, uno del passo corrente (ripetizione) è ignorato.
+ *       I gettoni del nodo stesso vanno scartati dal chiamante.
+ * @return Azioni richieste (OPTICAL_DISCOVERY_ACT_*)
+ */
+uint8_t optical_discovery_on_token(optical_discovery_t *od, uint8_t session, const uint16_t *members,
+                                   uint8_t count, uint8_t index, uint32_t now_ms);
+
+/**
+ * @brief Avanza la scoperta con l'esito dell'ultima acquisizione
+ * @desc Da chiamare periodicamente (ogni 500 ms) durante la sessione.
+ * @param captured: Acquisizione eseguita (false mentre il nodo trasmette)
+ * @param payload: Identificativo della trama ricevuta (LIGHT_FRAME_ID_NONE se nessuna)
+ * @param confidence: Confidenza della trama
+ * @return Azioni richieste (OPTICAL_DISCOVERY_ACT_*)
+ */
+uint8_t optical_discovery_tick(optical_discovery_t *od, uint32_t now_ms, bool captured,
+                               uint16_t payload, uint8_t confidence);
+
+/**
+ * @brief Copia la tabella dei vicini
+ */
+void optical_discovery_get_table(const optical_discovery_t *od, optical_discovery_table_t *table);
+
+#endif //OPTICAL_DISCOVERY_H
@@ -0,0 +1,120 @@
+/**
+ * Autore: DJITSOP FUOGOUK LOIC STEVE
+ * Firmware: ECOLUMIERE BLE MESH ESP32
+ * Implementazione: PIR - Sensore di presenza con debounce e notifica allo scheduler
+ */
+
+#include "pir.h"
+#include "driver/gpio.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include "esp_attr.h"
+#include "freertos/FreeRTOS.h"
+#include "scheduler.h"
+
+static const char *TAG = "PIR";
+
+static esp_timer_handle_t pir_timer = NULL;
+static volatile bool stable_motion = false;
+static volatile uint32_t last_edge_us = 0;      // Ultimo fronte (timer di sistema)
+static volatile bool edge_pending = false;      // Fronte in attesa del debounce
+static uint16_t tick_polls = 0;
+static portMUX_TYPE pir_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/**
+ * @brief Timer callback - debounce e avanzamento della macchina a stati
+ * @desc Ogni PIR_POLL_MS: un fronte vecchio di almeno PIR_DEBOUNCE_MS senza
+ *       fronti successivi dà il livello stabile. Ogni PIR_TICK_MS notifica
+ *       il livello corrente per l'avanzamento della macchina a stati.
+ */
+static void pir_timer_callback(void* arg) {
+    uint32_t now = (uint32_t)esp_timer_get_time();
+    bool settled = false;
+
+    portENTER_CRITICAL(&pir_lock);
+    if (edge_pending && now - last_edge_us >= PIR_DEBOUNCE_MS * 1000) {
+        edge_pending = false;
+        settled = true;
+    }
+    portEXIT_CRITICAL(&pir_lock);
+
+    if (settled) {
+        bool motion = gpio_get_level(PIR_GPIO) != 0;
+
+        if (motion != stable_motion) {
+            stable_motion = motion;
+            if (scheduler_put_occupancy_event(motion, true) != ESP_OK) {
+                ESP_LOGW(TAG, "Occupancy event dropped");
+            }
+        }
+    }
+
+    if (++tick_polls >= PIR_TICK_MS / PIR_POLL_MS) {
+        tick_polls = 0;
+        scheduler_put_occupancy_event(stable_motion, false);
+    }
+}
+
+/**
+ * @brief ISR - registra solo l'istante del fronte
+ * @desc Un rimbalzo sposta in avanti last_edge_us: il debounce riparte.
+ */
+static void IRAM_ATTR pir_isr(void* arg) {
+    portENTER_CRITICAL_ISR(&pir_lock);
+    last_edge_us = (uint32_t)esp_timer_get_time();
+    edge_pending = true;
+    portEXIT_CRITICAL_ISR(&pir_lock);
+}
+
+/**
+ * @brief Inizializzazione sensore PIR
+ */
+esp_err_t pir_init(void) {
+    ESP_LOGI(TAG, "Initializing PIR motion sensor");
+
+    // 1. Configura GPIO: uscita attiva alta, a riposo tenuta bassa
+    gpio_config_t io_conf = {
+        .pin_bit_mask = (1ULL << PIR_GPIO),
+        .mode = GPIO_MODE_INPUT,
+        .pull_down_en = GPIO_PULLDOWN_ENABLE,
+        .intr_type = GPIO_INTR_ANYEDGE
+    };
+    gpio_config(&io_conf);
+
+    // 2. Timer periodico di debounce e di avanzamento
+    esp_timer_create_args_t timer_args = {
+        .callback = pir_timer_callback,
+        .name = "pir_poll"
+    };
+    esp_err_t ret = esp_timer_create(&timer_args, &pir_timer);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create PIR timer: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    // 3. Installa ISR (servizio già installato da zero-cross, errore ignorato)
+    gpio_install_isr_service(0);
+    gpio_isr_handler_add(PIR_GPIO, pir_isr, NULL);
+
+    stable_motion = gpio_get_level(PIR_GPIO) != 0;
+
+    ESP_LOGI(TAG, "PIR ready - GPIO %d, debounce %d ms", PIR_GPIO, PIR_DEBOUNCE_MS);
+    return ESP_OK;
+}
+
+void pir_enable(void) {
+    gpio_intr_enable(PIR_GPIO);
+    esp_timer_start_periodic(pir_timer, PIR_POLL_MS * 1000);
+    ESP_LOGI(TAG, "PIR enabled");
+}
+
+void pir_disable(void) {
+    gpio_intr_disable(PIR_GPIO);
+    esp_timer_stop(pir_timer);
+    edge_pending = false;
+    ESP_LOGI(TAG, "PIR disabled");
+}
+
+bool pir_get_motion(void) {
+    return stable_motion;
+}
@@ -0,0 +1,32 @@
+/**
+ * Autore: DJITSOP FUOGOUK LOIC STEVE
+ * Firmware: ECOLUMIERE BLE MESH ESP32
+ * Sensore di presenza PIR con debounce e notifica allo scheduler
+ */
+#pragma once
+#include "esp_err.h"
+#include <stdbool.h>
+
+
+#ifndef PIR_H
+#define PIR_H
+
+// Configurazione sensore di presenza
+#define PIR_GPIO                        18
+#define PIR_DEBOUNCE_MS                 50      // Livello stabile richiesto
+#define PIR_POLL_MS                     25      // Verifica del debounce (timer periodico)
+#define PIR_TICK_MS                     1000    // Cadenza aggiornamento macchina a stati
+
+
+esp_err_t pir_init(void);
+
+void pir_enable(void);
+
+void pir_disable(void);
+
+/**
+ * @brief Ultimo livello stabile del sensore (true = movimento)
+ */
+bool pir_get_motion(void);
+
+#endif // PIR_H
@@ -8,6 +8,7 @@
 #include "driver/gpio.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/timers.h"
+#include "freertos/semphr.h"
 #include "esp_timer.h"
 #include "esp_log.h"
 
@@ -17,6 +18,8 @@
 #include "lightcode.h"
 #include "slave_role.h"
 #include "datarecorder.h"
+#include "natural_est.h"
+#include "scheduler.h"
 #include "config.h"
 
 /************************************************
@@ -27,6 +30,11 @@ static const char *TAG = "PWMCONTROLLER";
 #define PWM_OUT_PIN             5      // GPIO per uscita PWM principale
 #define DIM_CTRL_PIN            21      // GPIO per controllo dimming (opzionale)
 #define SLOT_TIME_MS            500     // Durata di ogni slot temporale in ms
+#define FADE_SEGMENT_DIM        32      // Livelli logici per segmento lineare del fade hardware
+#define NATURAL_BLANK_TICKS     1       // Durata buio per calibrazione (contiene la raffica naturale)
+#define MEASURE_SETTLE_MS       30      // Assestamento di default dopo il cambio di duty
+#define MEASURE_SETTLE_MAX_MS   250     // Assestamento + latenza ADC + raffica entro un tick
+#define MEASURE_BURST_SAMPLES   16      // Campioni da 10 ms per raffica (160 ms)
 
 
 /************************************************
@@ -42,25 +50,71 @@ static struct {
     uint8_t current_slot;
     uint16_t light_level;
     uint16_t target_duty;
-    uint16_t sequence_0[PWM_SEQUENCE_LEN];
-    uint16_t sequence_1[PWM_SEQUENCE_LEN];
-    uint8_t active_sequence;
-    uint16_t *current_sequence;
     uint16_t current_pwm_hw;
 
-    // 🔥 NUOVI CONTATORI PER RIDURRE FREQUENZA OPERAZIONI
-    uint8_t fade_counter;
-    uint8_t env_measure_counter;
-    uint8_t sequence_update_counter;
+    // Uscita sulla scala percettiva e forzatura al buio per le misure
+    uint16_t dim_level;
+    uint16_t target_dim;
+    bool blanked;
+
+    // Fade hardware LEDC: segmento in corso e durata residua del fade
+    bool fading;
+    uint16_t segment_dim;
+    uint32_t segment_ms;
+    uint32_t fade_left_ms;
+    uint32_t delayed_fade_ms;
+
     uint32_t log_counter;
+
+    // Cadenza slot impostata a runtime dall'algoritmo e contatori dei cicli
+    slot_plan_t slot_plan;
+
+    // Uscita bloccata a livello fisso (commissioning)
+    bool hold;
+
+    // Fase di regolazione nella stanza e slot corrispondente
+    uint8_t control_phase;
+    uint8_t control_slot;
+
+    // Stima luce naturale: buio solo per le ricalibrazioni
+    bool natural_estimation;
+    uint8_t blank_ticks;
+    uint16_t blank_level;
+    uint32_t blank_natural;
+    uint32_t last_env_lux;
+    uint16_t last_env_level;
+    uint32_t blanked_ticks;
+    uint32_t total_ticks;
+    natural_est_t natural_est;
+
+    // Raffiche ADC sincronizzate con gli slot di misura
+    uint16_t measure_settle_ms;
+    uint16_t env_burst_level;
+    uint32_t burst_misses;
 } pwm_state;
 
+/**
+ * @brief Cadenza slot di default (valori storici a regime)
+ */
+static const pwm_slot_rate_t default_slot_rate = {
+    .tick_divider = 2,
+    .device_id_divider = 4,
+    .natural_divider = 2,
+    .env_divider = 1
+};
+
 /************************************************
  * PRIVATE GLOBAL VARIABLES                    *
  ************************************************/
 static bool pwm_initialized = false;
 
 static TimerHandle_t slot_timer;
+static TimerHandle_t fade_delay_timer;
+
+// Stato PWM modificato da timer daemon, scheduler, task di commissioning e
+// callback BLE Mesh: ricorsivo perché lo slot ambiente richiama l'algoritmo,
+// che a sua volta imposta il duty
+static SemaphoreHandle_t pwm_lock;
 
 /************************************************
  * PRIVATE HARDWARE CONFIGURATION              *
@@ -90,92 +144,423 @@ static const ledc_channel_config_t ledc_channel = {
     .hpoint = 0
 };
 
+/************************************************
+ * PRIVATE DIMMING TABLES                      *
+ ************************************************/
+
+/**
+ * @brief Duty LEDC per livello logico 0..PWM_DIM_LEVELS
+ * @desc Curva CIE 1931: L* = 100 * dim / PWM_DIM_LEVELS, duty = Y(L*) *
+ *       PWM_MAX_VALUE. Gradini di L* sotto 0.5 anche nella parte bassa, dove
+ *       la scala lineare a 33 livelli salta da spento al 3% di luce (L* 20).
+ *       Generata da host/pwm_curve_gen.c.
+ */
+static const uint16_t pwm_dim_duty[PWM_DIM_LEVELS + 1] = {
+        0,     4,     7,    11,    14,    18,    21,    25,    28,    32,
+       35,    39,    43,    46,    50,    53,    57,    60,    64,    67,
+       71,    74,    78,    82,    86,    90,    94,    98,   103,   107,
+      112,   117,   121,   127,   132,   137,   143,   148,   154,   160,
+      166,   172,   179,   185,   192,   199,   206,   213,   220,   228,
+      235,   243,   251,   259,   268,   276,   285,   294,   303,   312,
+      322,   332,   341,   351,   362,   372,   383,   394,   405,   416,
+      427,   439,   451,   463,   475,   488,   500,   513,   527,   540,
+      554,   567,   581,   596,   610,   625,   640,   655,   671,   687,
+      703,   719,   735,   752,   769,   786,   804,   821,   839,   858,
+      876,   895,   914,   933,   953,   973,   993,  1013,  1034,  1055,
+     1076,  1098,  1119,  1141,  1164,  1187,  1210,  1233,  1256,  1280,
+     1304,  1329,  1354,  1379,  1404,  1430,  1456,  1482,  1509,  1536,
+     1563,  1590,  1618,  1647,  1675,  1704,  1733,  1763,  1793,  1823,
+     1853,  1884,  1916,  1947,  1979,  2011,  2044,  2077,  2110,  2144,
+     2178,  2212,  2247,  2282,  2318,  2354,  2390,  2426,  2463,  2501,
+     2538,  2577,  2615,  2654,  2693,  2733,  2773,  2813,  2854,  2895,
+     2937,  2979,  3021,  3064,  3107,  3150,  3194,  3239,  3284,  3329,
+     3374,  3420,  3467,  3514,  3561,  3609,  3657,  3705,  3754,  3804,
+     3853,  3904,  3954,  4006,  4057,  4109,  4162,  4215,  4268,  4322,
+     4376,  4431,  4486,  4541,  4598,  4654,  4711,  4769,  4826,  4885,
+     4944,  5003,  5063,  5123,  5184,  5245,  5307,  5369,  5432,  5495,
+     5559,  5623,  5687,  5753,  5818,  5884,  5951,  6018,  6086,  6154,
+     6222,  6292,  6361,  6431,  6502,  6573,  6645,  6717,  6790,  6863,
+     6937,  7011,  7086,  7162,  7238,  7314,  7391,  7469,  7547,  7625,
+     7704,  7784,  7864,  7945,  8027,  8109,  8191
+};
+
+/**
+ * @brief Livello logico per livello di regolazione 0..LIGHT_MAX_LEVEL
+ * @desc Duty più vicino a level * PWM_MAX_VALUE / LIGHT_MAX_LEVEL (scarto
+ *       massimo 1.6%): algoritmo, commissioning, matrice di stanza e stima
+ *       naturale restano lineari in luce. Generata da host/pwm_curve_gen.c.
+ */
+static const uint16_t pwm_level_dim[LIGHT_MAX_LEVEL + 1] = {
+        0,    52,    77,    94,   107,   119,   129,   138,   146,   154,
+      161,   167,   173,   179,   184,   190,   195,   200,   204,   209,
+      213,   217,   221,   225,   229,   233,   236,   240,   243,   246,
+      250,   253,   256
+};
+
 /************************************************
  * PRIVATE FUNCTIONS IMPLEMENTATION           *
  ************************************************/
 
 /**
- * @brief Aggiorna sequenza PWM in base all'evento corrente
+ * @brief Acquisisce il lock dello stato PWM (nessun effetto prima dell'init)
  */
-static void pwm_sequence_update(uint8_t event) {
-    uint16_t *sequence = pwm_state.current_sequence;
+static void pwm_lock_take(void) {
+    if (pwm_lock) xSemaphoreTakeRecursive(pwm_lock, portMAX_DELAY);
+}
 
-    for (uint16_t i = 0; i < PWM_SEQUENCE_LEN; i++) {
-        if (event == NATURAL_MEASURE_EVENT || event == ENV_MEASURE_EVENT) {
-            sequence[i] = 0x1FFF;  // PWM OFF per misurazioni
-        }
-        else if (event == DEFAULT_EVENT) {
-            if (i < pwm_state.light_level) {
-                sequence[i] = 0x0000;  // ON per primi light_level campioni
-            } else {
-                sequence[i] = 0x1FFF;  // OFF per campioni rimanenti
-            }
-        }
-        else {
-            sequence[i] = 0x1FFF;  // PWM OFF
-        }
-    }
+/**
+ * @brief Rilascia il lock dello stato PWM
+ */
+static void pwm_lock_give(void) {
+    if (pwm_lock) xSemaphoreGiveRecursive(pwm_lock);
 }
 
 /**
- * @brief Applica sequenza corrente all'hardware PWM
+ * @brief Porta l'uscita a un livello di regolazione senza fade
  */
-static void pwm_apply_current_sequence(void) {
-    if (!pwm_initialized) return;
+static void pwm_set_level_now(uint16_t level) {
+    pwm_state.light_level = level;
+    pwm_state.dim_level = pwm_level_dim[level];
+}
 
-    uint32_t sum_on = 0;
-    for (int i = 0; i < PWM_SEQUENCE_LEN; i++) {
-        if (pwm_state.current_sequence[i] == 0x0000) {
-            sum_on++;
-        }
+/**
+ * @brief Livello di regolazione con il duty più vicino a un livello logico
+ */
+static uint16_t pwm_dim_to_level(uint16_t dim) {
+    return (pwm_dim_duty[dim] * LIGHT_MAX_LEVEL + PWM_MAX_VALUE / 2) / PWM_MAX_VALUE;
+}
+
+/**
+ * @brief Livello logico con il duty più vicino a un duty letto dall'hardware
+ * @desc Ricerca binaria sulla tabella crescente pwm_dim_duty.
+ */
+static uint16_t pwm_duty_to_dim(uint32_t duty) {
+    uint16_t lo = 0, hi = PWM_DIM_LEVELS;
+
+    if (duty >= pwm_dim_duty[PWM_DIM_LEVELS]) return PWM_DIM_LEVELS;
+
+    // Invariante: pwm_dim_duty[lo] <= duty < pwm_dim_duty[hi]
+    while (hi - lo > 1) {
+        uint16_t mid = (lo + hi) / 2;
+        if (pwm_dim_duty[mid] <= duty) lo = mid;
+        else hi = mid;
     }
 
-    uint32_t duty = (sum_on * PWM_MAX_VALUE) / PWM_SEQUENCE_LEN;
+    return (duty - pwm_dim_duty[lo] <= pwm_dim_duty[hi] - duty) ? lo : hi;
+}
+
+/**
+ * @brief Applica il livello logico corrente all'hardware PWM
+ * @desc Durante il buio di misura l'uscita è spenta qualunque sia il livello.
+ *       Con un fade in corso il duty appartiene al motore di fade.
+ */
+static void pwm_apply_output(void) {
+    if (!pwm_initialized || pwm_state.fading) return;
+
+    uint32_t duty = pwm_state.blanked ? 0 : pwm_dim_duty[pwm_state.dim_level];
 
     if (duty != pwm_state.current_pwm_hw) {
         ledc_set_duty(ledc_channel.speed_mode, ledc_channel.channel, duty);
         ledc_update_duty(ledc_channel.speed_mode, ledc_channel.channel);
         pwm_state.current_pwm_hw = duty;
 
-        ESP_LOGD(TAG, "Sequence applied: %lu/%lu ON samples, duty=%lu",
-                 sum_on, PWM_SEQUENCE_LEN, duty);
+        ESP_LOGD(TAG, "Output applied: dim %u/%u%s, duty=%lu",
+                 pwm_state.dim_level, PWM_DIM_LEVELS, pwm_state.blanked ? " (blanked)" : "", duty);
     }
 }
 
+/**
+ * @brief Il fade può pilotare l'uscita (non al buio, in trasmissione o bloccata)
+ */
+static bool pwm_fade_ready(void) {
+    return pwm_initialized && !pwm_state.blanked && !pwm_state.broadcast && !pwm_state.hold;
+}
+
+/**
+ * @brief Avvia il prossimo segmento del fade verso target_dim
+ * @desc Il fade hardware è lineare nel duty: segmenti di FADE_SEGMENT_DIM
+ *       livelli logici, con durata proporzionale, seguono la curva percettiva.
+ *       Un fade senza durata o rifiutato dal driver porta subito al target.
+ *       Senza uscita disponibile il fade resta sospeso fino a
+ *       pwm_fade_segment() successiva.
+ */
+static void pwm_fade_segment(void) {
+    uint16_t dim = pwm_state.dim_level;
+    uint16_t target = pwm_state.target_dim;
+
+    if (!pwm_fade_ready() || pwm_state.fading) return;
+
+    // Nessun passo residuo: l'uscita torna al duty esatto del livello
+    if (dim == target) {
+        pwm_apply_output();
+        return;
+    }
+
+    uint16_t span = (dim < target) ? target - dim : dim - target;
+    uint16_t step = (span > FADE_SEGMENT_DIM) ? FADE_SEGMENT_DIM : span;
+    uint32_t segment_ms = pwm_state.fade_left_ms * step / span;
+
+    if (segment_ms > 0) {
+        uint16_t segment_dim = (dim < target) ? dim + step : dim - step;
+
+        esp_err_t ret = ledc_set_fade_with_time(ledc_channel.speed_mode, ledc_channel.channel,
+                                                pwm_dim_duty[segment_dim], (int)segment_ms);
+        if (ret == ESP_OK) {
+            ret = ledc_fade_start(ledc_channel.speed_mode, ledc_channel.channel, LEDC_FADE_NO_WAIT);
+        }
+        if (ret == ESP_OK) {
+            pwm_state.fading = true;
+            pwm_state.segment_dim = segment_dim;
+            pwm_state.segment_ms = segment_ms;
+            pwm_state.current_pwm_hw = pwm_dim_duty[segment_dim];
+            return;
+        }
+        ESP_LOGW(TAG, "⚠️ Hardware fade failed: %s - level applied directly", esp_err_to_name(ret));
+    }
+
+    pwm_state.dim_level = target;
+    pwm_state.light_level = pwm_dim_to_level(target);
+    pwm_state.fade_left_ms = 0;
+    pwm_apply_output();
+}
+
+/**
+ * @brief Chiude il segmento in corso: livello logico alla fine del segmento
+ */
+static void pwm_fade_segment_done(void) {
+    pwm_state.fading = false;
+    pwm_state.dim_level = pwm_state.segment_dim;
+    pwm_state.light_level = pwm_dim_to_level(pwm_state.segment_dim);
+    pwm_state.fade_left_ms -= (pwm_state.segment_ms < pwm_state.fade_left_ms) ?
+                              pwm_state.segment_ms : pwm_state.fade_left_ms;
+}
+
+/**
+ * @brief Interrompe il segmento in corso
+ * @desc Il livello logico diventa quello più vicino al duty raggiunto dal
+ *       fade: la successiva applicazione dell'uscita corregge al più mezzo
+ *       gradino invece di saltare alla fine del segmento. Il tempo residuo
+ *       del fade scala con la parte di segmento percorsa.
+ */
+static void pwm_fade_stop(void) {
+    if (!pwm_state.fading) return;
+
+    ledc_fade_stop(ledc_channel.speed_mode, ledc_channel.channel);
+
+    uint32_t duty = ledc_get_duty(ledc_channel.speed_mode, ledc_channel.channel);
+    uint16_t start = pwm_state.dim_level;
+    uint16_t end = pwm_state.segment_dim;
+    uint16_t dim = pwm_duty_to_dim(duty);
+
+    // Il duty appartiene al segmento: fuori dagli estremi solo per arrotondamento
+    if (dim < ((start < end) ? start : end)) dim = (start < end) ? start : end;
+    if (dim > ((start < end) ? end : start)) dim = (start < end) ? end : start;
+
+    uint16_t step = (start < end) ? end - start : start - end;
+    uint16_t done = (start < dim) ? dim - start : start - dim;
+    uint32_t elapsed_ms = step ? pwm_state.segment_ms * done / step : pwm_state.segment_ms;
+
+    pwm_state.fading = false;
+    pwm_state.dim_level = dim;
+    pwm_state.light_level = pwm_dim_to_level(dim);
+    pwm_state.fade_left_ms -= (elapsed_ms < pwm_state.fade_left_ms) ? elapsed_ms : pwm_state.fade_left_ms;
+    pwm_state.current_pwm_hw = duty;
+}
+
+/**
+ * @brief Avvia un fade verso un livello logico (sostituisce quello in corso)
+ */
+static void pwm_fade_to(uint16_t target_dim, uint32_t fade_ms) {
+    pwm_fade_stop();
+
+    pwm_state.target_dim = target_dim;
+    pwm_state.fade_left_ms = fade_ms;
+    pwm_fade_segment();
+}
+
+/**
+ * @brief Fine di un segmento del fade
+ * @desc Un evento rimasto in coda da un segmento interrotto trova un duty
+ *       diverso dalla fine del segmento corrente e viene ignorato.
+ */
+static void pwm_fade_end(void) {
+    if (!pwm_state.fading) return;
+    if (ledc_get_duty(ledc_channel.speed_mode, ledc_channel.channel) != pwm_dim_duty[pwm_state.segment_dim]) {
+        return;
+    }
+
+    pwm_fade_segment_done();
+
+    if (pwm_state.dim_level != pwm_state.target_dim) {
+        pwm_fade_segment();
+        return;
+    }
+
+    ESP_LOGD(TAG, "Fade complete - level %u/%d, dim %u/%u",
+             pwm_state.light_level, LIGHT_MAX_LEVEL, pwm_state.dim_level, PWM_DIM_LEVELS);
+}
+
+/**
+ * @brief Fine di un segmento del fade (task scheduler)
+ */
+static void pwm_fade_end_handler(void *p_event_data, uint16_t event_size) {
+    pwm_lock_take();
+    pwm_fade_end();
+    pwm_lock_give();
+}
+
+/**
+ * @brief ISR di fine fade del driver LEDC: completamento allo scheduler
+ */
+static bool IRAM_ATTR pwm_fade_end_isr(const ledc_cb_param_t *param, void *user_arg) {
+    if (param->event == LEDC_FADE_END_EVT) {
+        scheduler_put_event_isr(NULL, 0, SCH_EVT_PWM_FADE, pwm_fade_end_handler);
+    }
+    return false;
+}
+
+/**
+ * @brief Scadenza del ritardo di un comando con transizione (task timer)
+ */
+static void fade_delay_callback(TimerHandle_t timer) {
+    pwm_lock_take();
+    pwm_fade_to(pwm_level_dim[pwm_state.target_duty], pwm_state.delayed_fade_ms);
+    pwm_lock_give();
+}
+
 /**
  * @brief Gestisce slot comunicazione device ID
  */
 static void handle_device_id_slot(void) {
     light_code_pickup();
     uint8_t received_code = light_code_check();
+    light_frame_t frame;
+    bool framed = light_code_get_frame(&frame);
 
     algo_sched_event_t event = {
         .source = LUX_SOURCE_DEVICE_ID,
-        .code = received_code
+        .code = received_code,
+        .confidence = framed ? frame.confidence : 0,
+        .device_id = framed ? frame.payload : LIGHT_FRAME_ID_NONE
     };
     ecolumiere_update_lux(&event, sizeof(event));
 
     if (received_code == LIGHT_CODE_ONE) {
         ESP_LOGD(TAG, "Master signal detected - Code: 0x%02X", received_code);
     }
+    if (framed) {
+        ESP_LOGD(TAG, "Optical ID 0x%04X - confidence %u, repeats %u",
+                 frame.payload, frame.confidence, frame.repeats);
+    }
 }
 
 /**
- * @brief Gestisce slot misurazione luce naturale
+ * @brief Arma l'acquisizione ottica se il prossimo tick elabora lo slot device ID
+ * @desc Chiamata dopo l'avanzamento dello slot, con gli stessi contatori che
+ *       il tick successivo userà per decidere: campioni e fronti coprono
+ *       l'inizio dello slot device ID e restano pronti per
+ *       handle_device_id_slot. Negli altri slot il sensore non viene letto.
  */
-static void handle_natural_light_slot(void) {
-    uint32_t natural_lux, index;
+static void arm_device_id_capture(void) {
+    if (!slot_plan_device_id_due(&pwm_state.slot_plan, pwm_state.current_slot)) {
+        return;
+    }
+
+    light_code_reset_queue();
+}
+
+/**
+ * @brief Invia al modulo algoritmo una misura di luce naturale
+ */
+static void post_natural_measure(uint32_t natural_lux) {
+    algo_sched_event_t event = {
+        .source = LUX_SOURCE_NATURAL,
+        .measure = natural_lux
+    };
+    ecolumiere_update_lux(&event, sizeof(event));
+}
 
-    luxmeter_pickup(LUX_MEASURE_NATURAL, pwm_state.light_level, &natural_lux, &index);
+/**
+ * @brief Spegne la lampada per una misura naturale di calibrazione
+ */
+static void natural_blank_start(void) {
+    pwm_fade_stop();
+    pwm_state.blanked = true;
+    pwm_apply_output();
+
+    // Raffica dentro il buio, dopo lo spegnimento del driver LED
+    luxmeter_burst_arm(LUX_MEASURE_NATURAL, pwm_state.measure_settle_ms, MEASURE_BURST_SAMPLES);
+
+    pwm_state.blank_ticks = NATURAL_BLANK_TICKS;
+    pwm_state.blank_level = pwm_state.light_level;
+    pwm_state.blank_natural = MEASURE_INVALID;
+}
+
+/**
+ * @brief Fine del buio: misura naturale reale e ripristino dell'uscita
+ * @desc La coppia con la misura ambiente viene completata nel prossimo slot
+ *       ambiente, se il livello nel frattempo non è cambiato.
+ */
+static void natural_blank_end(void) {
+    uint32_t natural_lux = MEASURE_INVALID;
+
+    // Lampada spenta: nessuna compensazione dell'offset di livello. Senza
+    // raffica completa nessuna misura: la finestra continua include luce
+    // della lampada
+    if (!luxmeter_burst_pickup(LUX_MEASURE_NATURAL, 0, &natural_lux)) {
+        natural_lux = MEASURE_INVALID;
+        pwm_state.burst_misses++;
+        ESP_LOGW(TAG, "⚠️ Natural burst not completed in the blank window");
+    }
+
+    pwm_state.blanked = false;
+    pwm_apply_output();
+    pwm_fade_segment();
 
     if (natural_lux != MEASURE_INVALID) {
-        algo_sched_event_t event = {
-            .source = LUX_SOURCE_NATURAL,
-            .measure = natural_lux
-        };
-        ecolumiere_update_lux(&event, sizeof(event));
+        pwm_state.blank_natural = natural_lux;
+        post_natural_measure(natural_lux);
+        ESP_LOGD(TAG, "Natural light (blanked): %lu lux", natural_lux);
+    }
+}
 
-        ESP_LOGD(TAG, "Natural light: %lu lux", natural_lux);
+/**
+ * @brief Slot naturale in modalità stima
+ * @desc Buio solo quando il modello lo richiede, altrimenti la luce naturale
+ *       è l'ultima misura ambiente meno il contributo appreso della lampada.
+ */
+static void handle_natural_estimate_slot(void) {
+    uint32_t now_ms = (uint32_t)(esp_timer_get_time() / 1000);
+    uint32_t natural_lux;
+
+    if (pwm_state.blank_ticks == 0 &&
+        natural_est_need_blank(&pwm_state.natural_est, pwm_state.light_level, now_ms)) {
+        natural_blank_start();
+        return;
+    }
+
+    if (pwm_state.last_env_lux == MEASURE_INVALID) return;
+
+    if (natural_est_estimate(&pwm_state.natural_est, pwm_state.last_env_level,
+                             pwm_state.last_env_lux, &natural_lux)) {
+        post_natural_measure(natural_lux);
+        ESP_LOGD(TAG, "Natural light (estimated): %lu lux", natural_lux);
+    }
+}
+
+/**
+ * @brief Gestisce slot misurazione luce naturale
+ * @desc Senza stima ogni slot naturale spegne la lampada per un tick: la
+ *       misura arriva da natural_blank_end con la raffica etichettata.
+ */
+static void handle_natural_light_slot(void) {
+    if (pwm_state.natural_estimation) {
+        handle_natural_estimate_slot();
+        return;
+    }
+
+    if (pwm_state.blank_ticks == 0) {
+        natural_blank_start();
     }
 }
 
@@ -185,9 +570,25 @@ static void handle_natural_light_slot(void) {
 static void handle_env_light_slot(void) {
     uint32_t env_lux, index;
 
-    luxmeter_pickup(LUX_MEASURE_ENVIRONMENT, pwm_state.light_level, &env_lux, &index);
+    // Raffica armata nel tick precedente; in mancanza la finestra continua
+    if (!luxmeter_burst_pickup(LUX_MEASURE_ENVIRONMENT, pwm_state.env_burst_level, &env_lux)) {
+        luxmeter_pickup(LUX_MEASURE_ENVIRONMENT, pwm_state.light_level, &env_lux, &index);
+        pwm_state.burst_misses++;
+    }
 
     if (env_lux != MEASURE_INVALID) {
+        // Completa la coppia di calibrazione se il livello non è cambiato
+        if (pwm_state.blank_natural != MEASURE_INVALID) {
+            if (pwm_state.blank_level == pwm_state.light_level) {
+                natural_est_calibrate(&pwm_state.natural_est, pwm_state.light_level,
+                                      env_lux, pwm_state.blank_natural,
+                                      (uint32_t)(esp_timer_get_time() / 1000));
+            }
+            pwm_state.blank_natural = MEASURE_INVALID;
+        }
+        pwm_state.last_env_lux = env_lux;
+        pwm_state.last_env_level = pwm_state.light_level;
+
         algo_sched_event_t event = {
             .source = LUX_SOURCE_ENVIRONMENT,
             .measure = env_lux
@@ -201,86 +602,54 @@ static void handle_env_light_slot(void) {
 }
 
 /**
- * @brief Applica transizione graduale verso livello target
+ * @brief Elabora un tick degli slot (lock dello stato PWM acquisito)
  */
-static void apply_fade(void) {
-    if (pwm_state.light_level < pwm_state.target_duty) {
-        pwm_state.light_level++;
-    }
-
-    if (pwm_state.light_level > pwm_state.target_duty) {
-        pwm_state.light_level--;
+static void pwm_slot_tick(void) {
+    // 🔥 USCITA BLOCCATA (commissioning) - nessuno slot, nessun fade
+    if (pwm_state.hold) {
+        pwm_advance_slot();
+        return;
     }
-}
 
-/**
- * @brief Callback timer slot - VERSIONE OTTIMIZZATA
- */
-static void slot_timer_callback(TimerHandle_t timer) {
-    // 🔥 CONTROLLO SICUREZZA RINFORZATO
-    if (!pwm_initialized || !timer) {
-        return;
+    // 🔥 BUIO DI CALIBRAZIONE - l'uscita resta spenta fino alla misura
+    pwm_state.total_ticks++;
+    if (pwm_state.blank_ticks > 0) {
+        pwm_state.blanked_ticks++;
+        if (--pwm_state.blank_ticks == 0) {
+            natural_blank_end();
+        }
     }
 
-    // 🔥 OTTIMIZZAZIONE: Salta ogni secondo callback
-    static uint8_t skip_counter = 0;
-    if (++skip_counter < 2) {
-        pwm_advance_slot();
-        return;
+    // 🔥 RAFFICA AMBIENTE - armata nel tick che precede lo slot di regolazione
+    if (pwm_state.blank_ticks == 0 &&
+        (pwm_state.current_slot + 1) % SLOT_COUNT == pwm_state.control_slot) {
+        pwm_state.env_burst_level = pwm_state.light_level;
+        luxmeter_burst_arm(LUX_MEASURE_ENVIRONMENT, pwm_state.measure_settle_ms, MEASURE_BURST_SAMPLES);
     }
-    skip_counter = 0;
 
     uint8_t current_slot = pwm_get_current_slot();
 
-    // 🔥 FADE - SOLO OGNI 4 SLOT (2 secondi)
-    if (++pwm_state.fade_counter >= 4) {
-        apply_fade();
-        pwm_state.fade_counter = 0;
+    // 🔥 MISURA AMBIENTE E REGOLAZIONE - slot della fase del nodo, a ogni ciclo
+    // (fuori da tick_divider: gli slot di regolazione 5, 7 e 9 sono dispari)
+    if (slot_plan_control_tick(&pwm_state.slot_plan, current_slot, pwm_state.control_slot,
+                               pwm_state.blank_ticks == 0)) {
+        handle_env_light_slot();
     }
 
-    // 🔥 GESTIONE SLOT MOLTO RIDOTTA
-    switch (current_slot) {
-        case DEVICE_ID_SLOT:
-            // Device ID - solo ogni 4 cicli (8 secondi)
-            static uint8_t device_id_counter = 0;
-            if (++device_id_counter >= 4) {
-                handle_device_id_slot();
-                device_id_counter = 0;
-            }
-            break;
-
-        case NATURAL_MEASURE_SLOT:
-            // Misura naturale - solo ogni 2 cicli (4 secondi)
-            static uint8_t natural_measure_counter = 0;
-            if (++natural_measure_counter >= 2) {
-                handle_natural_light_slot();
-                natural_measure_counter = 0;
-            }
-            break;
-
-        case ENV_MEASURE_SLOT:
-            // Misura ambiente - solo ogni ciclo (2 secondi)
-            if (++pwm_state.env_measure_counter >= 1) {
-                handle_env_light_slot();
-                pwm_state.env_measure_counter = 0;
-            }
-            break;
-
-        default:
-            // Slot vuoti - nessuna operazione
-            break;
+    // 🔥 GESTIONE SLOT - divisori impostati dall'algoritmo, fase ancorata allo
+    // slot: un cambio di cadenza nella regolazione qui sopra non la sposta
+    uint8_t tasks = slot_plan_measure_tick(&pwm_state.slot_plan, current_slot);
+    if (tasks & SLOT_TASK_DEVICE_ID) {
+        handle_device_id_slot();
     }
-
-    // 🔥 SEQUENCE UPDATE - SOLO OGNI 2 CALLBACK (1 secondo)
-    if (++pwm_state.sequence_update_counter >= 2) {
-        pwm_sequence_update(DEFAULT_EVENT);
-        pwm_apply_current_sequence();
-        pwm_state.sequence_update_counter = 0;
+    if (tasks & SLOT_TASK_NATURAL) {
+        handle_natural_light_slot();
     }
 
     pwm_advance_slot();
+    arm_device_id_capture();
 
-    // 🔥 LOG MOLTO RIDOTTO - solo ogni 20 callback (10 secondi)
+    // 🔥 LOG MOLTO RIDOTTO - solo ogni 20 callback
     if (++pwm_state.log_counter >= 20) {
         ESP_LOGD(TAG, "Slot %d - PWM: %d/%d",
                  current_slot, pwm_state.light_level, pwm_state.target_duty);
@@ -288,6 +657,20 @@ static void slot_timer_callback(TimerHandle_t timer) {
     }
 }
 
+/**
+ * @brief Callback timer slot - VERSIONE OTTIMIZZATA
+ */
+static void slot_timer_callback(TimerHandle_t timer) {
+    // 🔥 CONTROLLO SICUREZZA RINFORZATO
+    if (!pwm_initialized || !timer) {
+        return;
+    }
+
+    pwm_lock_take();
+    pwm_slot_tick();
+    pwm_lock_give();
+}
+
 /************************************************
  * PUBLIC FUNCTIONS IMPLEMENTATION             *
  ************************************************/
@@ -318,6 +701,31 @@ esp_err_t pwmcontroller_init(void) {
         return ret;
     }
 
+    // 🔥 FADE HARDWARE - fine fade segnalata dall'ISR del driver
+    ret = ledc_fade_func_install(0);
+    if (ret != ESP_OK && ret != ESP_ERR_INVALID_STATE) {
+        ESP_LOGE(TAG, "LEDC fade install failed: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    ledc_cbs_t fade_cbs = {
+        .fade_cb = pwm_fade_end_isr
+    };
+    ret = ledc_cb_register(ledc_channel.speed_mode, ledc_channel.channel, &fade_cbs, NULL);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "LEDC fade callback failed: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    // Creato una sola volta: sopravvive a pwm_stop() e a una nuova init
+    if (pwm_lock == NULL) {
+        pwm_lock = xSemaphoreCreateRecursiveMutex();
+        if (pwm_lock == NULL) {
+            ESP_LOGE(TAG, "Failed to create PWM state lock");
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
     // 🔥 INIZIALIZZA STATO CON CONTATORI
     memset(&pwm_state, 0, sizeof(pwm_state)); // Reset completo
 
@@ -326,17 +734,19 @@ esp_err_t pwmcontroller_init(void) {
     pwm_state.light_level = 0;
     pwm_state.target_duty = 0;
     pwm_state.current_pwm_hw = 0xFFFF;
-    pwm_state.fade_counter = 0;
-    pwm_state.env_measure_counter = 0;
-    pwm_state.sequence_update_counter = 0;
+    pwm_state.dim_level = 0;
+    pwm_state.target_dim = 0;
+    pwm_state.blanked = false;
+    pwm_state.fading = false;
     pwm_state.log_counter = 0;
-
-    for (int i = 0; i < PWM_SEQUENCE_LEN; i++) {
-        pwm_state.sequence_0[i] = 0x1FFF;
-        pwm_state.sequence_1[i] = 0x1FFF;
-    }
-    pwm_state.current_sequence = pwm_state.sequence_0;
-    pwm_state.active_sequence = 0;
+    slot_plan_init(&pwm_state.slot_plan, &default_slot_rate);
+    pwm_state.natural_estimation = false;   // Opt-in (NATEST 1): errore ~2x la misura al buio
+    pwm_state.control_phase = 0;
+    pwm_state.control_slot = ENV_MEASURE_SLOT;
+    pwm_state.blank_natural = MEASURE_INVALID;
+    pwm_state.last_env_lux = MEASURE_INVALID;
+    pwm_state.measure_settle_ms = MEASURE_SETTLE_MS;
+    natural_est_init(&pwm_state.natural_est, (uint32_t)(esp_timer_get_time() / 1000));
 
     // 🔥 CREA TIMER CON STACK AUMENTATO
     slot_timer = xTimerCreate(
@@ -352,6 +762,13 @@ esp_err_t pwmcontroller_init(void) {
         return ESP_FAIL;
     }
 
+    // Ritardo dei comandi con transizione (one-shot, periodo impostato all'avvio)
+    fade_delay_timer = xTimerCreate("PWMFadeDelay", 1, pdFALSE, NULL, fade_delay_callback);
+    if (fade_delay_timer == NULL) {
+        ESP_LOGE(TAG, "Failed to create fade delay timer");
+        return ESP_FAIL;
+    }
+
     // 🔥 AVVIA TIMER CON DELAY PER STABILIZZAZIONE
     if (xTimerStart(slot_timer, pdMS_TO_TICKS(2000)) != pdPASS) { // Start dopo 2 secondi
         ESP_LOGE(TAG, "Failed to start slot timer");
@@ -373,6 +790,13 @@ esp_err_t pwmcontroller_init(void) {
  * @brief Imposta duty cycle target per dimming
  */
 void pwm_set_duty_cycle(uint32_t duty_cycle) {
+    pwm_set_duty_cycle_fade(duty_cycle, PWM_FADE_DEFAULT_MS, 0);
+}
+
+/**
+ * @brief Imposta duty cycle target con durata e ritardo della transizione
+ */
+void pwm_set_duty_cycle_fade(uint32_t duty_cycle, uint32_t fade_ms, uint32_t delay_ms) {
 
     if (!pwm_initialized) {
         ESP_LOGE(TAG, "PWM not initialized - call pwmcontroller_init() first");
@@ -383,29 +807,84 @@ void pwm_set_duty_cycle(uint32_t duty_cycle) {
         duty_cycle = LIGHT_MAX_LEVEL;
     }
 
+    pwm_lock_take();
     pwm_state.target_duty = duty_cycle;
+
+    // Un comando nuovo annulla quello ancora in ritardo
+    xTimerStop(fade_delay_timer, 0);
+    if (delay_ms > 0) {
+        TickType_t ticks = pdMS_TO_TICKS(delay_ms);
+        pwm_state.delayed_fade_ms = fade_ms;
+        xTimerChangePeriod(fade_delay_timer, ticks > 0 ? ticks : 1, 0);
+    } else {
+        pwm_fade_to(pwm_level_dim[duty_cycle], fade_ms);
+    }
+    pwm_lock_give();
+
     data_recorder_push_history_data((uint8_t)duty_cycle);
 
     const slave_identity_t *identity = slave_node_get_identity();
-    ESP_LOGI(TAG, "PWM target duty set - Device: %s, Duty Cycle: %lu/%d",
-             identity->device_name, duty_cycle, LIGHT_MAX_LEVEL);
+    ESP_LOGI(TAG, "PWM target duty set - Device: %s, Duty Cycle: %lu/%d, fade %lu ms (delay %lu ms)",
+             identity->device_name, duty_cycle, LIGHT_MAX_LEVEL, fade_ms, delay_ms);
 }
 
 /**
  * @brief Restituisce ruolo dispositivo
  */
 device_id_role_t pwm_get_id_role(void) {
-    return ROLE_ID_RECEIVER;
+    return pwm_state.broadcast ? ROLE_ID_BROADCASTER : ROLE_ID_RECEIVER;
+}
+
+/**
+ * @brief Cambia ruolo dispositivo (lock dello stato PWM acquisito)
+ * @desc Il trasmettitore cede il pin della lampada all'RMT; al ritorno in
+ *       ricezione il canale LEDC riprende il pin con il duty corrente.
+ */
+static void pwm_switch_id_role(bool broadcast) {
+    if (broadcast == pwm_state.broadcast) return;
+
+    if (broadcast) {
+        pwm_fade_stop();
+        if (light_code_transmit_start(PWM_OUT_PIN, pwm_state.device_code) != ESP_OK) {
+            ESP_LOGW(TAG, "Role change failed - staying RECEIVER");
+            pwm_apply_output();
+            pwm_fade_segment();
+            return;
+        }
+        pwm_state.broadcast = true;
+        ESP_LOGI(TAG, "Device role: BROADCASTER - ID 0x%04X", pwm_state.device_code);
+        return;
+    }
+
+    light_code_transmit_stop();
+    pwm_state.broadcast = false;
+
+    esp_err_t ret = ledc_channel_config(&ledc_channel);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "LEDC channel restore failed: %s", esp_err_to_name(ret));
+    }
+    pwm_state.current_pwm_hw = 0xFFFF;
+    pwm_apply_output();
+    pwm_fade_segment();
+    ESP_LOGI(TAG, "Device role: RECEIVER");
 }
 
 /**
  * @brief Imposta ruolo dispositivo
  */
 void pwm_set_id_role(device_id_role_t role) {
-    if (role != ROLE_ID_RECEIVER) {
-        ESP_LOGW(TAG, "Role change ignored - SLAVE mode only supported");
-    }
-    ESP_LOGI(TAG, "Device role: SLAVE (fixed)");
+    if (!pwm_initialized) return;
+
+    pwm_lock_take();
+    pwm_switch_id_role(role == ROLE_ID_BROADCASTER);
+    pwm_lock_give();
+}
+
+/**
+ * @brief Imposta l'identificativo trasmesso nel ruolo BROADCASTER
+ */
+void pwm_set_device_code(uint16_t code) {
+    pwm_state.device_code = code;
 }
 
 /**
@@ -424,7 +903,14 @@ void pwm_stop(void) {
             xTimerDelete(slot_timer, portMAX_DELAY);
             slot_timer = NULL;
         }
+        if (fade_delay_timer) {
+            xTimerDelete(fade_delay_timer, portMAX_DELAY);
+            fade_delay_timer = NULL;
+        }
+        pwm_lock_take();
+        pwm_fade_stop();
         pwm_initialized = false;
+        pwm_lock_give();
         ESP_LOGI(TAG, "PWM system stopped safely");
     }
 }
@@ -442,7 +928,9 @@ uint16_t pwmcontroller_get_current_level(void) {
 void pwm_apply_phase_controlled_duty(void) {
     if (!pwm_initialized) return;
 
-    pwm_apply_current_sequence();
+    pwm_lock_take();
+    pwm_apply_output();
+    pwm_lock_give();
     ESP_LOGD(TAG, "Zero-cross: Applied phase-controlled duty");
 }
 
@@ -469,10 +957,17 @@ static void save_pwm_level_to_config(uint8_t level) {
  * @brief Imposta livello PWM per compatibilità BLE Mesh
  */
 void pwmcontroller_set_level(uint8_t level) {
+    pwmcontroller_set_level_fade(level, PWM_FADE_DEFAULT_MS, 0);
+}
+
+/**
+ * @brief Imposta livello PWM con la transizione del comando BLE Mesh
+ */
+void pwmcontroller_set_level_fade(uint8_t level, uint32_t fade_ms, uint32_t delay_ms) {
     ESP_LOGI("PWM", "🎛️ pwmcontroller_set_level CALLED with: %d", level);
     ESP_LOGI("PWM", "📍 Called from: %p", __builtin_return_address(0));
 
-    pwm_set_duty_cycle(level);
+    pwm_set_duty_cycle_fade(level, fade_ms, delay_ms);
 
     save_pwm_level_to_config(level);
 
@@ -505,10 +1000,12 @@ void pwm_set_output_level(uint8_t level) {
 }
 
 /**
- * @brief Applica fade graduale (wrapper pubblico)
+ * @brief Riprende il fade sospeso verso il target (wrapper pubblico)
  */
 void pwm_fade(void) {
-    apply_fade();
+    pwm_lock_take();
+    pwm_fade_segment();
+    pwm_lock_give();
 }
 
 /**
@@ -518,6 +1015,137 @@ bool is_pwm_initialized(void) {
     return pwm_initialized;
 }
 
+/**
+ * @brief Imposta la cadenza di elaborazione degli slot
+ */
+void pwm_set_slot_rate(const pwm_slot_rate_t *rate) {
+    if (rate == NULL) return;
+
+    // Contatori conservati: un cambio a metà ciclo non rinvia gli slot di misura
+    pwm_lock_take();
+    pwm_slot_rate_t new_rate = slot_plan_set_rate(&pwm_state.slot_plan, rate);
+    pwm_lock_give();
+
+    ESP_LOGI(TAG, "Slot rate - tick/%u, ID/%u, NAT/%u, ENV/%u",
+             new_rate.tick_divider, new_rate.device_id_divider,
+             new_rate.natural_divider, new_rate.env_divider);
+}
+
+/**
+ * @brief Restituisce la cadenza di elaborazione degli slot corrente
+ */
+void pwm_get_slot_rate(pwm_slot_rate_t *rate) {
+    if (rate == NULL) return;
+    pwm_lock_take();
+    *rate = pwm_state.slot_plan.rate;
+    pwm_lock_give();
+}
+
+/**
+ * @brief Blocca l'uscita a un livello fisso o rilascia il blocco (lock acquisito)
+ */
+static void pwm_apply_hold(int16_t level) {
+    if (level < 0) {
+        pwm_state.hold = false;
+        pwm_fade_to(pwm_level_dim[pwm_state.target_duty], PWM_FADE_DEFAULT_MS);
+        ESP_LOGI(TAG, "Output hold released - fading to %d/%d",
+                 pwm_state.target_duty, LIGHT_MAX_LEVEL);
+        return;
+    }
+
+    if (level > LIGHT_MAX_LEVEL) level = LIGHT_MAX_LEVEL;
+
+    // Un buio di calibrazione o un fade in corso vengono abbandonati
+    pwm_fade_stop();
+    pwm_state.hold = true;
+    pwm_state.blank_ticks = 0;
+    pwm_state.blank_natural = MEASURE_INVALID;
+    pwm_state.blanked = false;
+
+    pwm_set_level_now((uint16_t)level);
+    pwm_apply_output();
+}
+
+/**
+ * @brief Blocca l'uscita a un livello fisso o rilascia il blocco
+ */
+void pwm_hold_level(int16_t level) {
+    if (!pwm_initialized) return;
+
+    pwm_lock_take();
+    pwm_apply_hold(level);
+    pwm_lock_give();
+}
+
+/**
+ * @brief Imposta la fase di regolazione del nodo
+ */
+void pwm_set_control_phase(uint8_t phase) {
+    phase %= PWM_CONTROL_PHASES;
+
+    pwm_lock_take();
+    pwm_state.control_phase = phase;
+    pwm_state.control_slot = slot_plan_control_slot(phase);
+    pwm_lock_give();
+
+    ESP_LOGI(TAG, "Control phase %u/%u - environment slot %u",
+             phase, PWM_CONTROL_PHASES, pwm_state.control_slot);
+}
+
+/**
+ * @brief Restituisce la fase di regolazione corrente
+ */
+uint8_t pwm_get_control_phase(void) {
+    return pwm_state.control_phase;
+}
+
+/**
+ * @brief Abilita o disabilita la stima della luce naturale
+ */
+void pwm_set_natural_estimation(bool enable) {
+    pwm_lock_take();
+    pwm_state.natural_estimation = enable;
+    pwm_state.blank_natural = MEASURE_INVALID;
+    pwm_lock_give();
+
+    ESP_LOGI(TAG, "Natural light: %s", enable ? "ESTIMATED (blank on recalibration)"
+                                              : "MEASURED (every natural slot)");
+}
+
+/**
+ * @brief Imposta il ritardo di assestamento delle raffiche di misura
+ */
+void pwm_set_measure_settle(uint16_t settle_ms) {
+    if (settle_ms > MEASURE_SETTLE_MAX_MS) settle_ms = MEASURE_SETTLE_MAX_MS;
+
+    pwm_lock_take();
+    pwm_state.measure_settle_ms = settle_ms;
+    pwm_lock_give();
+    ESP_LOGI(TAG, "Measure burst: settle %u ms, %u samples", settle_ms, MEASURE_BURST_SAMPLES);
+}
+
+/**
+ * @brief Restituisce diagnostica della stima della luce naturale
+ */
+void pwm_get_natural_estimation_stats(pwm_natural_est_stats_t *stats) {
+    if (stats == NULL) return;
+
+    const natural_est_t *est = &pwm_state.natural_est;
+
+    pwm_lock_take();
+    stats->enabled = pwm_state.natural_estimation;
+    stats->calibrations = est->calibrations;
+    stats->estimates = est->estimates;
+    stats->gain = est->gain;
+    stats->last_error = est->last_error;
+    stats->mean_error = est->err_count ? est->err_sum / est->err_count : 0.0f;
+    stats->interval_s = est->interval_ms / 1000;
+    stats->blanked_ticks = pwm_state.blanked_ticks;
+    stats->total_ticks = pwm_state.total_ticks;
+    stats->burst_misses = pwm_state.burst_misses;
+    pwm_lock_give();
+}
+
 /**
  * @brief Converte intensità luminosa (0-100) in PWM (0-32)
  */
@@ -12,26 +12,19 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include "esp_err.h"
+#include "slot_plan.h"
 
 /************************************************
  * PUBLIC DEFINES AND MACRO                     *
  ************************************************/
 
 #define LIGHT_MAX_LEVEL                 32      // Livello massimo dimming (0-32)
-#define SLOT_COUNT                      10      // Numero slot per ciclo completo
-#define PWM_SEQUENCE_LEN                32      // Lunghezza sequenza PWM (campionamenti)
 #define PWM_MAX_VALUE                   8191    // Valore massimo PWM 13-bit (0-8191)
 
-// Definizioni slot temporali per gestione eventi
-#define DEVICE_ID_SLOT                  0       // Slot comunicazione ID dispositivo
-#define NATURAL_MEASURE_SLOT            2       // Slot misurazione luce naturale
-#define ENV_MEASURE_SLOT                6       // Slot misurazione luce ambiente
+// Scala logica dell'uscita: L* (CIE 1931) proporzionale al livello, duty da tabella
+#define PWM_DIM_LEVELS                  256     // Livelli logici di dimming (0-256)
+#define PWM_FADE_DEFAULT_MS             1000    // Durata del fade senza tempo di transizione esplicito
 
-// Tipi di evento per gestione sequenze PWM
-#define DEFAULT_EVENT                   0x00    // Evento normale: regolazione luminosità
-#define NATURAL_MEASURE_EVENT           0x01    // Evento misurazione luce naturale
-#define ENV_MEASURE_EVENT               0x02    // Evento misurazione luce ambiente
-#define DEVICE_ID_EVENT                 0x04    // Evento comunicazione ID dispositivo
 #define MEASURE_INVALID                 0xFFFF
 
 /************************************************
@@ -52,21 +45,45 @@ typedef enum {
 
 /**
  * @brief Ruolo del dispositivo nella rete
- * @enum ROLE_ID_BROADCASTER: Dispositivo MASTER che trasmette codici
- * @enum ROLE_ID_RECEIVER: Dispositivo SLAVE che riceve codici
+ * @enum ROLE_ID_BROADCASTER: Dispositivo che trasmette in luce il proprio identificativo
+ * @enum ROLE_ID_RECEIVER: Dispositivo che riceve codici (ruolo normale)
  */
 typedef enum {
     ROLE_ID_BROADCASTER = 1,
     ROLE_ID_RECEIVER = 0
 } device_id_role_t;
 
+/**
+ * @brief Diagnostica della stima della luce naturale
+ * @field enabled: Modalità stima attiva
+ * @field calibrations: Misure al buio usate per calibrare il modello
+ * @field estimates: Misure naturali stimate senza buio
+ * @field gain: Contributo lampada appreso (lux per livello)
+ * @field last_error/mean_error: Errore di previsione alle calibrazioni (lux)
+ * @field interval_s: Intervallo corrente tra due ricalibrazioni
+ * @field blanked_ticks/total_ticks: Tick con lampada spenta su tick totali
+ * @field burst_misses: Raffiche di misura non completate in tempo
+ */
+typedef struct {
+    bool enabled;
+    uint32_t calibrations;
+    uint32_t estimates;
+    float gain;
+    float last_error;
+    float mean_error;
+    uint32_t interval_s;
+    uint32_t blanked_ticks;
+    uint32_t total_ticks;
+    uint32_t burst_misses;
+} pwm_natural_est_stats_t;
+
 /************************************************
  * PUBLIC PROTOTYPES                           *
  ************************************************/
 
 /**
  * @brief Inizializza il sistema PWM controller
- * @desc Configura hardware PWM, sistema a slot temporali, buffer sequenze
+ * @desc Configura hardware PWM, sistema a slot temporali
  *       e timer per gestione eventi periodici. Deve essere chiamato all'avvio.
  * @return ESP_OK se inizializzazione riuscita, codice errore altrimenti
  */
@@ -75,32 +92,57 @@ esp_err_t pwmcontroller_init(void);
 /**
  * @brief Imposta il duty cycle target per il dimming
  * @desc Definisce il livello luminoso target verso cui eseguire il fade graduale.
- *       Il valore viene salvato anche nel data recorder per tracciamento storico.
+ *       I livelli restano lineari in luce (duty ≈ livello * PWM_MAX_VALUE /
+ *       LIGHT_MAX_LEVEL); il fade attraversa la scala percettiva a
+ *       PWM_DIM_LEVELS livelli. Il valore viene salvato anche nel data
+ *       recorder per tracciamento storico. Durata PWM_FADE_DEFAULT_MS.
  * @param duty_cycle: Valore target tra 0 e LIGHT_MAX_LEVEL
  */
 void pwm_set_duty_cycle(uint32_t duty_cycle);
 
 /**
- * @brief Applica transizione graduale verso livello target
- * @desc Esegue fade smooth tra livello corrente e target, chiamato periodicamente
- *       dal sistema a slot per garantire transizioni fluide.
+ * @brief Imposta il duty cycle target con durata e ritardo della transizione
+ * @desc Il fade è eseguito dal motore di fade LEDC in segmenti lineari sulla
+ *       scala percettiva; la fine del fade arriva allo scheduler come evento
+ *       SCH_EVT_PWM_FADE. Il buio di misura, la trasmissione dell'ID e il
+ *       blocco dell'uscita sospendono il fade, che poi riprende con la durata
+ *       residua. Un comando nuovo sostituisce quello in corso o in ritardo.
+ * @param duty_cycle: Valore target tra 0 e LIGHT_MAX_LEVEL
+ * @param fade_ms: Durata della transizione (0 = immediata)
+ * @param delay_ms: Attesa prima dell'inizio della transizione
+ */
+void pwm_set_duty_cycle_fade(uint32_t duty_cycle, uint32_t fade_ms, uint32_t delay_ms);
+
+/**
+ * @brief Riprende il fade verso il livello target
+ * @desc Avvia il segmento successivo se il fade era sospeso e l'uscita è
+ *       disponibile; altrimenti nessun effetto.
  */
 void pwm_fade(void);
 
 /**
  * @brief Restituisce il ruolo corrente del dispositivo
- * @desc Indica se il dispositivo opera come MASTER o SLAVE nella comunicazione.
- * @return Ruolo corrente del dispositivo (sempre SLAVE in questa implementazione)
+ * @desc Indica se il dispositivo sta trasmettendo il proprio identificativo.
+ * @return Ruolo corrente del dispositivo
  */
 device_id_role_t pwm_get_id_role(void);
 
 /**
  * @brief Imposta il ruolo del dispositivo
- * @desc Permette di configurare il ruolo (solo SLAVE supportato in questa versione).
- * @param role: Ruolo da impostare (ROLE_ID_RECEIVER per SLAVE)
+ * @desc ROLE_ID_BROADCASTER modula l'uscita della lampada con trame ottiche
+ *       ripetute dell'identificativo impostato con pwm_set_device_code()
+ *       (luce media intorno al 50%); ROLE_ID_RECEIVER restituisce l'uscita al
+ *       PWM. Da usare con l'uscita bloccata (pwm_hold_level): gli slot di
+ *       misura non sanno della trasmissione.
+ * @param role: Ruolo da impostare
  */
 void pwm_set_id_role(device_id_role_t role);
 
+/**
+ * @brief Imposta l'identificativo ottico trasmesso (16 bit, non nullo)
+ */
+void pwm_set_device_code(uint16_t code);
+
 /**
  * @brief Ferma il sistema PWM
  * @desc Disattiva timer slot e resetta stato interno. Utilizzato per shutdown.
@@ -136,6 +178,13 @@ uint32_t pwm_get_playback_task(void);
  */
 void pwmcontroller_set_level(uint8_t level);
 
+/**
+ * @brief Imposta livello PWM con la transizione di un comando BLE Mesh
+ * @desc Come pwmcontroller_set_level(), con durata e ritardo presi dal
+ *       messaggio (Transition Time e Delay).
+ */
+void pwmcontroller_set_level_fade(uint8_t level, uint32_t fade_ms, uint32_t delay_ms);
+
 /**
  * @brief Restituisce lo slot temporale corrente
  * @desc Fornisce l'indice dello slot attualmente in esecuzione.
@@ -159,6 +208,77 @@ void pwm_set_output_level(uint8_t level);
 
 bool is_pwm_initialized(void);
 
+/**
+ * @brief Imposta la cadenza di elaborazione degli slot
+ * @desc Sostituisce i contatori di salto fissi: permette all'algoritmo di
+ *       campionare più spesso durante i transitori e meno a regime.
+ *       I divisori a zero vengono portati a 1; tick_divider è limitato a 2
+ *       perché con SLOT_COUNT pari gli slot di misura restano raggiungibili.
+ *       Contatori e fase del salto dei tick restano invariati (slot_plan.h).
+ * @param rate: Nuova cadenza da applicare
+ */
+void pwm_set_slot_rate(const pwm_slot_rate_t *rate);
+
+/**
+ * @brief Restituisce la cadenza di elaborazione degli slot corrente
+ * @param rate: Puntatore dove copiare la cadenza corrente
+ */
+void pwm_get_slot_rate(pwm_slot_rate_t *rate);
+
+/**
+ * @brief Blocca l'uscita a un livello fisso
+ * @desc Usato dal commissioning: finché il blocco è attivo slot di misura,
+ *       fade e buio di calibrazione sono sospesi e il livello è applicato
+ *       subito. Un livello negativo rilascia il blocco e riprende il fade
+ *       verso il target.
+ * @param level: Livello 0..LIGHT_MAX_LEVEL, negativo per rilasciare
+ */
+void pwm_hold_level(int16_t level);
+
+/**
+ * @brief Abilita o disabilita la stima della luce naturale
+ * @desc Con la stima attiva lo slot naturale spegne la lampada solo per le
+ *       ricalibrazioni richieste dal modello; negli altri cicli la luce
+ *       naturale è l'ultima misura ambiente meno il contributo della lampada.
+ *       Disabilitata, ogni slot naturale spegne la lampada per la raffica.
+ *       Disabilitata di default: natural_est_sim mostra un errore sulla luce
+ *       naturale circa doppio rispetto alla misura al buio (medio 11.6 contro
+ *       5.1 lux, massimo 79), accettabile solo se lo sfarfallio conta di più.
+ * @param enable: true per la stima, false per la misura a ogni slot
+ */
+void pwm_set_natural_estimation(bool enable);
+
+/**
+ * @brief Imposta il ritardo di assestamento delle raffiche ADC
+ * @desc Le misure naturale e ambiente usano raffiche armate al cambio di
+ *       sequenza: i campioni dei primi settle_ms (driver LED, sensore)
+ *       vengono scartati. Limitato a 250 ms per restare nel tick.
+ * @param settle_ms: Ritardo in ms (default 30)
+ */
+void pwm_set_measure_settle(uint16_t settle_ms);
+
+/**
+ * @brief Restituisce la diagnostica della stima della luce naturale
+ * @param stats: Puntatore dove copiare i contatori
+ */
+void pwm_get_natural_estimation_stats(pwm_natural_est_stats_t *stats);
+
+/**
+ * @brief Imposta la fase di regolazione del nodo
+ * @desc La misura ambiente e il passo dell'algoritmo avvengono nello slot
+ *       della fase invece che in ENV_MEASURE_SLOT per tutti: le lampade di
+ *       una stanza reagiscono a turno allo stesso disturbo. La fase 0
+ *       corrisponde a ENV_MEASURE_SLOT. Lo slot è elaborato a ogni ciclo
+ *       indipendentemente da tick_divider.
+ * @param phase: Fase 0..PWM_CONTROL_PHASES-1 (ridotta modulo PWM_CONTROL_PHASES)
+ */
+void pwm_set_control_phase(uint8_t phase);
+
+/**
+ * @brief Restituisce la fase di regolazione corrente
+ */
+uint8_t pwm_get_control_phase(void);
+
 
 
 uint8_t convert_intensity_to_pwm(uint16_t intensity);
@@ -0,0 +1,276 @@
+/**
+ * Autore: DJITSOP FUOGOUK LOIC STEVE
+ * Firmware: ECOLUMIERE BLE MESH ESP32
+ * Implementazione: Room Matrix - Misura dei contributi incrociati fra le lampade della stanza
+ */
+
+#include "room_matrix.h"
+
+#include <string.h>
+
+/************************************************
+ * PRIVATE FUNCTIONS IMPLEMENTATION            *
+ ************************************************/
+
+/**
+ * @brief Ordine dei passi (il passo iniziale precede tutti gli altri)
+ */
+static int room_matrix_order(uint8_t index)
+{
+  return (index == ROOM_MATRIX_INDEX_BASELINE) ? -1 : (int)index;
+}
+
+static uint8_t room_matrix_next(uint8_t index)
+{
+  return (index == ROOM_MATRIX_INDEX_BASELINE) ? 0 : (uint8_t)(index + 1);
+}
+
+/**
+ * @brief Entra nel passo index: accesa solo la lampada di turno
+ */
+static void room_matrix_enter(room_matrix_t *rm, uint8_t index, uint32_t now_ms, bool timed_out)
+{
+  rm->index = index;
+  rm->step_ms = now_ms;
+  rm->measured = false;
+  rm->timed_out = timed_out;
+  rm->acc = 0.0f;
+  rm->samples = 0;
+  rm->level = (index == (uint8_t)rm->self_index) ? ROOM_MATRIX_HIGH_LEVEL : ROOM_MATRIX_BASE_LEVEL;
+
+  if (rm->level == ROOM_MATRIX_HIGH_LEVEL) rm->lit_ms = now_ms;
+}
+
+/**
+ * @brief Passa al passo successivo inviando il gettone
+ * @param known: La propria lampada era accesa nel passo concluso
+ */
+static uint8_t room_matrix_pass(room_matrix_t *rm, uint32_t now_ms, bool known)
+{
+  uint32_t lit = now_ms - rm->lit_ms;
+
+  rm->lit = (known && lit < ROOM_MATRIX_LIT_UNKNOWN) ? (uint16_t)lit : ROOM_MATRIX_LIT_UNKNOWN;
+  room_matrix_enter(rm, room_matrix_next(rm->index), now_ms, false);
+  return ROOM_MATRIX_ACT_LEVEL | ROOM_MATRIX_ACT_SEND;
+}
+
+/**
+ * @brief Conferma la colonna in attesa con la durata di accensione ricevuta
+ * @desc La finestra di misura deve iniziare dopo l'accensione più la
+ *       finestra ADC: una lampada di turno partita in ritardo la invalida.
+ */
+static void room_matrix_confirm(room_matrix_t *rm, uint8_t index, uint16_t lit, uint32_t now_ms)
+{
+  if (rm->pending < 0 || index != (uint8_t)(rm->pending + 1)) return;
+
+  if (lit != ROOM_MATRIX_LIT_UNKNOWN &&
+      (int32_t)(rm->window_ms - (now_ms - lit)) >= ROOM_MATRIX_ADC_WINDOW_MS) {
+    rm->high_mask |= (1U << rm->pending);
+  }
+  rm->pending = -1;
+}
+
+/**
+ * @brief Registra la media delle letture del passo corrente
+ */
+static void room_matrix_store(room_matrix_t *rm)
+{
+  if (rm->measured) return;
+  rm->measured = true;
+
+  if (rm->samples == 0) return;
+  float value = rm->acc / rm->samples;
+
+  if (rm->index == ROOM_MATRIX_INDEX_BASELINE) {
+    rm->base_start = value;
+    rm->base_mask |= 0x01;
+  } else if (rm->index == rm->count) {
+    rm->base_end = value;
+    rm->base_mask |= 0x02;
+  } else if (rm->index < rm->count && !rm->timed_out) {
+    rm->high[rm->index] = value;
+    rm->window_ms = rm->step_ms + ROOM_MATRIX_SETTLE_MS;
+
+    // La propria lampada è accesa dall'inizio del passo; le altre attendono conferma
+    if (rm->index == (uint8_t)rm->self_index) {
+      rm->high_mask |= (1U << rm->index);
+    } else {
+      rm->pending = (int8_t)rm->index;
+    }
+  }
+}
+
+/**
+ * @brief Calcola la riga: base interpolata fra inizio e fine per la deriva
+ */
+static void room_matrix_finalize(room_matrix_t *rm)
+{
+  rm->level = ROOM_MATRIX_BASE_LEVEL;
+
+  if (rm->base_mask == 0) {
+    rm->state = ROOM_MATRIX_FAILED;
+    return;
+  }
+
+  float start = (rm->base_mask & 0x01) ? rm->base_start : rm->base_end;
+  float end = (rm->base_mask & 0x02) ? rm->base_end : rm->base_start;
+
+  rm->coef_mask = 0;
+  for (uint8_t k = 0; k < rm->count; k++) {
+    if (!(rm->high_mask & (1U << k))) continue;
+
+    float base = start + (end - start) * (float)(k + 1) / (float)(rm->count + 1);
+    rm->coef[k] = (rm->high[k] - base) / (float)(ROOM_MATRIX_HIGH_LEVEL - ROOM_MATRIX_BASE_LEVEL);
+    rm->coef_mask |= (1U << k);
+  }
+
+  rm->state = ROOM_MATRIX_DONE;
+}
+
+/************************************************
+ * PUBLIC FUNCTIONS IMPLEMENTATION              *
+ ************************************************/
+
+void room_matrix_init(room_matrix_t *rm, uint16_t self)
+{
+  memset(rm, 0, sizeof(room_matrix_t));
+  rm->self = self;
+  rm->self_index = -1;
+  rm->state = ROOM_MATRIX_IDLE;
+}
+
+bool room_matrix_start(room_matrix_t *rm, const uint16_t *members, uint8_t count,
+                       uint8_t session, uint32_t now_ms)
+{
+  if (count == 0 || count > ROOM_MATRIX_MAX_MEMBERS) return false;
+
+  // Ordinamento per indirizzo: tutti i nodi ottengono la stessa sequenza
+  uint16_t sorted[ROOM_MATRIX_MAX_MEMBERS];
+  memcpy(sorted, members, count * sizeof(uint16_t));
+  for (uint8_t i = 1; i < count; i++) {
+    uint16_t addr = sorted[i];
+    int j = i - 1;
+    while (j >= 0 && sorted[j] > addr) {
+      sorted[j + 1] = sorted[j];
+      j--;
+    }
+    sorted[j + 1] = addr;
+  }
+
+  int8_t self_index = -1;
+  for (uint8_t i = 0; i < count; i++) {
+    if (sorted[i] == rm->self) self_index = (int8_t)i;
+  }
+  if (self_index < 0) return false;
+
+  uint16_t self = rm->self;
+  memset(rm, 0, sizeof(room_matrix_t));
+  rm->self = self;
+  rm->self_index = self_index;
+  memcpy(rm->members, sorted, count * sizeof(uint16_t));
+  rm->count = count;
+  rm->session = session;
+  rm->session_ms = now_ms;
+  rm->state = ROOM_MATRIX_RUNNING;
+  rm->pending = -1;
+  rm->lit = ROOM_MATRIX_LIT_UNKNOWN;
+
+  room_matrix_enter(rm, ROOM_MATRIX_INDEX_BASELINE, now_ms, false);
+  return true;
+}
+
+uint8_t room_matrix_on_token(room_matrix_t *rm, uint8_t session, const uint16_t *members,
+                             uint8_t count, uint8_t index, uint16_t lit, uint32_t now_ms)
+{
+  uint8_t actions = 0;
+
+  // Sessione nuova (una sessione conclusa con lo stesso numero è un'eco)
+  if (rm->state == ROOM_MATRIX_IDLE || session != rm->session) {
+    if (!room_matrix_start(rm, members, count, session, now_ms)) return 0;
+    actions |= ROOM_MATRIX_ACT_LEVEL;
+  }
+
+  if (rm->state != ROOM_MATRIX_RUNNING) return actions;
+  if (index != ROOM_MATRIX_INDEX_BASELINE && index > rm->count) return actions;
+
+  // Un secondo gettone dello stesso passo arriva solo dalla lampada di turno
+  // che riparte dopo un timeout: la sua accensione è appena avvenuta
+  bool advance = room_matrix_order(index) > room_matrix_order(rm->index);
+  bool realign = (index == rm->index);
+
+  if (advance || realign) {
+    // Le letture già raccolte del passo precedente restano valide
+    if (advance) {
+      room_matrix_store(rm);
+      room_matrix_confirm(rm, index, lit, now_ms);
+    }
+    room_matrix_enter(rm, index, now_ms, false);
+    actions |= ROOM_MATRIX_ACT_LEVEL;
+  }
+
+  return actions;
+}
+
+uint8_t room_matrix_tick(room_matrix_t *rm, uint32_t now_ms, float lux)
+{
+  if (rm->state != ROOM_MATRIX_RUNNING) return 0;
+
+  uint32_t elapsed = now_ms - rm->step_ms;
+
+  if (!rm->measured) {
+    if (elapsed < ROOM_MATRIX_STEP_MS) {
+      if (elapsed >= ROOM_MATRIX_SETTLE_MS) {
+        rm->acc += lux;
+        rm->samples++;
+      }
+      return 0;
+    }
+
+    room_matrix_store(rm);
+
+    if (rm->index == rm->count) {
+      room_matrix_finalize(rm);
+      return ROOM_MATRIX_ACT_LEVEL | ROOM_MATRIX_ACT_DONE;
+    }
+
+    // Chi ha concluso il passo passa il gettone (dopo il buio iniziale il primo membro)
+    uint8_t passer = (rm->index == ROOM_MATRIX_INDEX_BASELINE) ? 0 : rm->index;
+    if ((uint8_t)rm->self_index == passer) {
+      return room_matrix_pass(rm, now_ms, rm->index != ROOM_MATRIX_INDEX_BASELINE);
+    }
+    return 0;
+  }
+
+  // Gettone perso: si prosegue da soli, la lampada di turno riallinea gli altri
+  if (elapsed < ROOM_MATRIX_STEP_MS + ROOM_MATRIX_TOKEN_TIMEOUT_MS) return 0;
+
+  uint8_t next = room_matrix_next(rm->index);
+  if (next < rm->count && next == (uint8_t)rm->self_index) {
+    room_matrix_enter(rm, next, now_ms, false);
+    rm->lit = ROOM_MATRIX_LIT_UNKNOWN;
+    return ROOM_MATRIX_ACT_LEVEL | ROOM_MATRIX_ACT_SEND;
+  }
+
+  room_matrix_enter(rm, next, now_ms, true);
+  return ROOM_MATRIX_ACT_LEVEL;
+}
+
+void room_matrix_get_row(const room_matrix_t *rm, room_matrix_row_t *row)
+{
+  memset(row, 0, sizeof(room_matrix_row_t));
+
+  row->version = ROOM_MATRIX_VERSION;
+  row->session = rm->session;
+  row->count = rm->count;
+  row->valid_mask = rm->coef_mask;
+
+  for (uint8_t k = 0; k < rm->count; k++) {
+    row->addr[k] = rm->members[k];
+    if (!(rm->coef_mask & (1U << k))) continue;
+
+    float scaled = rm->coef[k] * 100.0f;
+    if (scaled > 32767.0f) scaled = 32767.0f;
+    if (scaled < -32768.0f) scaled = -32768.0f;
+    row->coef_x100[k] = (int16_t)(scaled + (scaled >= 0.0f ? 0.5f : -0.5f));
+  }
+}
@@ -0,0 +1,151 @@
+/**
+ * Autore: DJITSOP FUOGOUK LOIC STEVE
+ * Firmware: ECOLUMIERE BLE MESH ESP32
+ * Modulo: Room Matrix - Misura dei contributi incrociati fra le lampade della stanza
+ * Descrizione: Protocollo a gettone sul gruppo stanza: a turno una lampada si
+ *              accende mentre le altre restano al livello base e misurano. Ogni
+ *              nodo ricava la propria riga della matrice di interazione (lux al
+ *              proprio sensore per livello di ciascuna lampada). Nessuna
+ *              dipendenza ESP-IDF: tempo, misure e messaggi passano dal chiamante.
+ */
+
+#ifndef ROOM_MATRIX_H
+#define ROOM_MATRIX_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "neighbor.h"
+
+#define ROOM_MATRIX_MAX_MEMBERS         (NEIGHBOR_TABLE_SIZE + 1)  // Vicini più il nodo stesso
+#define ROOM_MATRIX_BASE_LEVEL          0
+#define ROOM_MATRIX_HIGH_LEVEL          24      // Sotto la compressione dei livelli alti
+#define ROOM_MATRIX_SETTLE_MS           1500    // Lampade a regime + finestra ADC
+#define ROOM_MATRIX_MEASURE_MS          1500    // Letture mediate per passo
+#define ROOM_MATRIX_STEP_MS             (ROOM_MATRIX_SETTLE_MS + ROOM_MATRIX_MEASURE_MS)
+#define ROOM_MATRIX_TOKEN_TIMEOUT_MS    2000    // Attesa del gettone prima di proseguire da soli
+#define ROOM_MATRIX_ADC_WINDOW_MS       450     // Finestra di media del luxmeter
+#define ROOM_MATRIX_INDEX_BASELINE      0xFF    // Passo iniziale: tutte le lampade al livello base
+#define ROOM_MATRIX_LIT_UNKNOWN         0xFFFF  // Durata di accensione non nota
+#define ROOM_MATRIX_VERSION             1
+
+// Azioni richieste al chiamante (maschera di bit)
+#define ROOM_MATRIX_ACT_LEVEL           0x01    // Applicare room_matrix_t.level all'uscita
+#define ROOM_MATRIX_ACT_SEND            0x02    // Inviare il gettone con room_matrix_t.index
+#define ROOM_MATRIX_ACT_DONE            0x04    // Misura conclusa: rilasciare l'uscita e salvare
+
+/**
+ * @brief Stato della misura
+ */
+typedef enum room_matrix_state_t
+{
+  ROOM_MATRIX_IDLE = 0,
+  ROOM_MATRIX_RUNNING,
+  ROOM_MATRIX_DONE,
+  ROOM_MATRIX_FAILED
+} room_matrix_state_t;
+
+/**
+ * @brief Stato di un nodo nel protocollo
+ * @desc I passi sono BASELINE (tutte spente), 0..count-1 (accesa la lampada
+ *       members[i]) e count (di nuovo tutte spente, per la deriva della luce
+ *       ambiente). Il gettone del passo i è inviato da chi ha concluso il passo
+ *       precedente, con la durata per cui la sua lampada è rimasta accesa: una
+ *       colonna vale solo se la finestra di misura cade dentro quell'intervallo.
+ *       Senza gettone entro il timeout ogni nodo prosegue da solo e la lampada
+ *       di turno ritrasmette il gettone per riallineare gli altri.
+ * @field members: Indirizzi unicast in ordine crescente
+ * @field self_index: Posizione del nodo in members
+ * @field index/step_ms: Passo corrente e istante di inizio
+ * @field timed_out: Passo iniziato per timeout (colonna non attendibile)
+ * @field lit_ms/lit: Accensione della propria lampada (inizio, poi durata da inviare)
+ * @field window_ms/pending: Inizio finestra e passo della colonna da confermare
+ * @field acc/samples: Accumulo delle letture del passo
+ * @field base_start/base_end/base_mask: Livello base a inizio e fine misura
+ * @field high/high_mask: Lettura con ciascuna lampada accesa
+ * @field level: Livello richiesto all'uscita
+ * @field coef/coef_mask: Riga risultante (lux per livello)
+ */
+typedef struct room_matrix_t
+{
+  uint16_t self;
+  room_matrix_state_t state;
+  uint8_t session;
+  uint8_t count;
+  int8_t self_index;
+  uint16_t members[ROOM_MATRIX_MAX_MEMBERS];
+  uint8_t index;
+  uint32_t step_ms;
+  uint32_t session_ms;
+  bool measured;
+  bool timed_out;
+  uint32_t lit_ms;
+  uint16_t lit;
+  uint32_t window_ms;
+  int8_t pending;
+  float acc;
+  uint16_t samples;
+  float base_start;
+  float base_end;
+  uint8_t base_mask;
+  float high[ROOM_MATRIX_MAX_MEMBERS];
+  uint16_t high_mask;
+  uint8_t level;
+  float coef[ROOM_MATRIX_MAX_MEMBERS];
+  uint16_t coef_mask;
+} room_matrix_t;
+
+/**
+ * @brief Riga salvata ed esposta al gateway
+ * @field coef_x100: Lux al sensore per livello della lampada addr[i], x 100
+ * @field valid_mask: Bit i = coefficiente i misurato
+ */
+typedef struct __attribute__((packed)) room_matrix_row_t
+{
+  uint8_t version;
+  uint8_t session;
+  uint8_t count;
+  uint16_t valid_mask;
+  uint16_t addr[ROOM_MATRIX_MAX_MEMBERS];
+  int16_t coef_x100[ROOM_MATRIX_MAX_MEMBERS];
+  uint16_t crc;  // deve essere l'ultimo campo della struttura
+} room_matrix_row_t;
+
+/**
+ * @brief Inizializza il nodo (nessuna misura in corso)
+ */
+void room_matrix_init(room_matrix_t *rm, uint16_t self);
+
+/**
+ * @brief Avvia una sessione con i membri indicati (nodo promotore)
+ * @desc I membri vengono ordinati; il chiamante invia poi il gettone del
+ *       passo iniziale (index = ROOM_MATRIX_INDEX_BASELINE).
+ * @return false se il nodo non è fra i membri o i membri sono troppi
+ */
+bool room_matrix_start(room_matrix_t *rm, const uint16_t *members, uint8_t count,
+                       uint8_t session, uint32_t now_ms);
+
+/**
+ * @brief Gestisce un gettone ricevuto dal gruppo stanza
+ * @param lit: Durata di accensione della lampada del passo precedente (ms)
+ * @desc Una sessione nuova viene adottata; un gettone di un passo successivo
+ *       fa avanzare il nodo, uno del passo corrente fa ripartire la misura.
+ *       I gettoni inviati dal nodo stesso vanno scartati dal chiamante.
+ * @return Azioni richieste (ROOM_MATRIX_ACT_*)
+ */
+uint8_t room_matrix_on_token(room_matrix_t *rm, uint8_t session, const uint16_t *members,
+                             uint8_t count, uint8_t index, uint16_t lit, uint32_t now_ms);
+
+/**
+ * @brief Avanza la misura con la lettura corrente del sensore
+ * @desc Da chiamare periodicamente (ogni 500 ms) durante la sessione.
+ * @return Azioni richieste (ROOM_MATRIX_ACT_*); il gettone da inviare porta
+ *         index e lit correnti
+ */
+uint8_t room_matrix_tick(room_matrix_t *rm, uint32_t now_ms, float lux);
+
+/**
+ * @brief Copia la riga misurata (crc escluso, a carico del chiamante)
+ */
+void room_matrix_get_row(const room_matrix_t *rm, room_matrix_row_t *row);
+
+#endif //ROOM_MATRIX_H
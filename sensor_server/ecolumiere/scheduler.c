@@ -36,10 +36,12 @@ void handle_ble_mesh_event(void *p_event_data, uint16_t event_size) {
     ESP_LOGI(TAG, "   Lightness: %u%%", event->brightness);
     ESP_LOGI(TAG, "   PWM Level: %u/32", event->pwm_level);
     ESP_LOGI(TAG, "   Hue: %u, Sat: %u", event->hue, event->saturation);
+    ESP_LOGI(TAG, "   Transition: %lu ms (delay %lu ms)", event->transition_ms, event->delay_ms);
     ESP_LOGI(TAG, "   Queue Delay: %.2f ms", delay_us / 1000.0);
 
     // ✅ 1. Gestisci comando PWM
-    ecolumiere_handle_mesh_command(event->pwm_level, event->is_override);
+    ecolumiere_handle_mesh_command(event->pwm_level, event->is_override,
+                                   event->transition_ms, event->delay_ms);
 
     // ✅ 2. Sincronizza stato lampada BLE Mesh
     sync_nodo_lampada_with_hsl(event->hue, event->saturation, event->brightness);
@@ -128,6 +130,27 @@ static void handle_light_code_event(void *p_event_data, uint16_t event_size) {
     // light_code_process(event->code);
 }
 
+// Handler Lux Vicino
+static void handle_neighbor_lux_event(void *p_event_data, uint16_t event_size) {
+    neighbor_lux_event_t *event = (neighbor_lux_event_t *)p_event_data;
+
+    ESP_LOGD(TAG, "🏠 Neighbor Lux: addr=0x%04X, natural=%lu, env=%lu, rssi=%d",
+             event->addr, event->natural_lux, event->env_lux, event->rssi);
+
+    ecolumiere_neighbor_update(event->addr, event->natural_lux, event->env_lux, event->rssi);
+}
+
+// Handler Presenza
+static void handle_occupancy_event(void *p_event_data, uint16_t event_size) {
+    occupancy_event_t *event = (occupancy_event_t *)p_event_data;
+
+    if (event->edge) {
+        ESP_LOGD(TAG, "🚶 Motion: %s", event->motion ? "DETECTED" : "CLEARED");
+    }
+
+    ecolumiere_occupancy_update(event->motion, event->edge);
+}
+
 // Handler Seriale
 static void handle_serial_event(void *p_event_data, uint16_t event_size) {
     serial_event_t *event = (serial_event_t *)p_event_data;
@@ -457,7 +480,8 @@ void scheduler_get_stats(uint32_t *processed, uint32_t *dropped, uint32_t *queue
 esp_err_t scheduler_put_ble_mesh_event(uint16_t lightness, bool is_override) {
     ble_mesh_event_t event = {
         .brightness = lightness,
-        .is_override = is_override
+        .is_override = is_override,
+        .transition_ms = PWM_FADE_DEFAULT_MS
     };
 
     return scheduler_put_event(&event, sizeof(event),
@@ -521,3 +545,25 @@ esp_err_t scheduler_put_serial_command(const char *cmd, const char *params) {
     return scheduler_put_event(&event, sizeof(event),
                               SCH_EVT_SERIAL_CMD, handle_serial_event);
 }
+
+esp_err_t scheduler_put_neighbor_lux_event(uint16_t addr, uint32_t natural_lux, uint32_t env_lux, int8_t rssi) {
+    neighbor_lux_event_t event = {
+        .addr = addr,
+        .natural_lux = natural_lux,
+        .env_lux = env_lux,
+        .rssi = rssi
+    };
+
+    return scheduler_put_event(&event, sizeof(event),
+                              SCH_EVT_NEIGHBOR_LUX, handle_neighbor_lux_event);
+}
+
+esp_err_t scheduler_put_occupancy_event(bool motion, bool edge) {
+    occupancy_event_t event = {
+        .motion = motion,
+        .edge = edge
+    };
+
+    return scheduler_put_event(&event, sizeof(event),
+                              SCH_EVT_OCCUPANCY, handle_occupancy_event);
+}
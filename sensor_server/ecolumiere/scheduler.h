@@ -33,6 +33,12 @@ typedef enum {
     SCH_EVT_SYSTEM_CMD,           // Comando di sistema
     SCH_EVT_LAMPADA_UPDATE,       // Aggiornamento stato lampada
     SCH_EVT_DATA_RECORDER,        // Log dati
+    SCH_EVT_NEIGHBOR_LUX,         // Misura lux ricevuta da un vicino
+    SCH_EVT_OCCUPANCY,            // Sensore di presenza
+    SCH_EVT_ROOM_MATRIX,          // Misura della matrice di stanza
+    SCH_EVT_OPTICAL_DISCOVERY,    // Scoperta dei vicini ottici
+    SCH_EVT_ANALOG_SCAN,          // Fotografia dei sensori analogici
+    SCH_EVT_PWM_FADE,             // Segmento del fade hardware concluso
     SCH_EVT_MAX
 } scheduler_event_type_t;
 
@@ -67,6 +73,8 @@ typedef struct {
         uint16_t hue;           // 0-360 (se serve)
         uint16_t saturation;    // 0-100 (se serve)
         bool is_override;       // true/false
+        uint32_t transition_ms; // durata del fade (Transition Time o PWM_FADE_DEFAULT_MS)
+        uint32_t delay_ms;      // attesa prima del fade (Delay)
         uint64_t timestamp;     // quando ricevuto
     } ble_mesh_event_t;
 
@@ -111,6 +119,20 @@ typedef struct {
     uint8_t window[10];
 } light_code_event_t;
 
+// Evento Lux Vicino
+typedef struct {
+    uint16_t addr;       // Indirizzo unicast del vicino
+    uint32_t natural_lux;
+    uint32_t env_lux;
+    int8_t rssi;
+} neighbor_lux_event_t;
+
+// Evento Presenza
+typedef struct {
+    bool motion;         // Livello stabile del PIR
+    bool edge;           // true = cambio livello, false = avanzamento periodico
+} occupancy_event_t;
+
 // Evento Seriale
 typedef struct {
     char command[32];
@@ -162,6 +184,8 @@ esp_err_t scheduler_put_lux_event(uint32_t natural_lux, uint32_t env_lux, uint8_
 esp_err_t scheduler_put_algo_event(uint8_t trigger);
 esp_err_t scheduler_put_storage_write(void *data, size_t size);
 esp_err_t scheduler_put_serial_command(const char *cmd, const char *params);
+esp_err_t scheduler_put_neighbor_lux_event(uint16_t addr, uint32_t natural_lux, uint32_t env_lux, int8_t rssi);
+esp_err_t scheduler_put_occupancy_event(bool motion, bool edge);
 
 void handle_ble_mesh_event(void *p_event_data, uint16_t event_size);
 
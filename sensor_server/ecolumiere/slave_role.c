@@ -456,3 +456,9 @@ void slave_node_set_lampada_intensita(uint16_t intensita) {
     storage_save_lampada_state(&slave_node.lampada);
     ESP_LOGI(TAG, "Intensità: %u lumen", intensita);
 }
+
+// Stato volatile: non salvato per non consumare la flash ad ogni movimento
+void slave_node_set_sensore_movimento(bool movimento) {
+    slave_node.lampada.sensore_movimento = movimento;
+    ESP_LOGD(TAG, "Sensore movimento: %s", movimento ? "ATTIVO" : "INATTIVO");
+}
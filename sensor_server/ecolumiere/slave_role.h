@@ -170,6 +170,8 @@ void slave_node_log_identity(void);
 
  void slave_node_set_lampada_intensita(uint16_t intensita);
 
+ void slave_node_set_sensore_movimento(bool movimento);
+
  void slave_node_load_saved_state(void);
 
 
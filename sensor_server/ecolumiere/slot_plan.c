@@ -0,0 +1,99 @@
+/**
+ * Autore: DJITSOP FUOGOUK LOIC STEVE
+ * Firmware: ECOLUMIERE BLE MESH ESP32
+ * Implementazione: Slot Plan - Pianificazione degli slot temporali del PWM controller
+ */
+
+#include "slot_plan.h"
+
+#include <string.h>
+
+// Con tick_divider 2 solo gli slot pari vengono elaborati
+_Static_assert(DEVICE_ID_SLOT % SLOT_TICK_DIVIDER_MAX == 0, "DEVICE_ID_SLOT deve essere pari");
+_Static_assert(NATURAL_MEASURE_SLOT % SLOT_TICK_DIVIDER_MAX == 0, "NATURAL_MEASURE_SLOT deve essere pari");
+_Static_assert(SLOT_COUNT % SLOT_TICK_DIVIDER_MAX == 0, "SLOT_COUNT deve essere pari");
+
+/************************************************
+ * PUBLIC FUNCTIONS IMPLEMENTATION              *
+ ************************************************/
+
+void slot_plan_init(slot_plan_t *plan, const pwm_slot_rate_t *rate)
+{
+  memset(plan, 0, sizeof(slot_plan_t));
+  slot_plan_set_rate(plan, rate);
+}
+
+pwm_slot_rate_t slot_plan_set_rate(slot_plan_t *plan, const pwm_slot_rate_t *rate)
+{
+  pwm_slot_rate_t new_rate = *rate;
+
+  if (new_rate.tick_divider == 0) new_rate.tick_divider = 1;
+  if (new_rate.tick_divider > SLOT_TICK_DIVIDER_MAX) new_rate.tick_divider = SLOT_TICK_DIVIDER_MAX;
+  if (new_rate.device_id_divider == 0) new_rate.device_id_divider = 1;
+  if (new_rate.natural_divider == 0) new_rate.natural_divider = 1;
+  if (new_rate.env_divider == 0) new_rate.env_divider = 1;
+
+  plan->rate = new_rate;
+  return new_rate;
+}
+
+uint8_t slot_plan_control_slot(uint8_t phase)
+{
+  phase %= PWM_CONTROL_PHASES;
+  return PWM_CONTROL_SLOT_FIRST +
+         (ENV_MEASURE_SLOT - PWM_CONTROL_SLOT_FIRST + phase) % PWM_CONTROL_PHASES;
+}
+
+bool slot_plan_slot_processed(const slot_plan_t *plan, uint8_t slot)
+{
+  return (slot % plan->rate.tick_divider) == 0;
+}
+
+uint8_t slot_plan_control_tick(slot_plan_t *plan, uint8_t slot, uint8_t control_slot,
+                               bool env_ready)
+{
+  if (slot != control_slot || !env_ready) {
+    return 0;
+  }
+
+  if (++plan->env_counter < plan->rate.env_divider) {
+    return 0;
+  }
+
+  plan->env_counter = 0;
+  return SLOT_TASK_ENV;
+}
+
+uint8_t slot_plan_measure_tick(slot_plan_t *plan, uint8_t slot)
+{
+  if (!slot_plan_slot_processed(plan, slot)) {
+    return 0;
+  }
+
+  switch (slot) {
+    case DEVICE_ID_SLOT:
+      if (++plan->device_id_counter >= plan->rate.device_id_divider) {
+        plan->device_id_counter = 0;
+        return SLOT_TASK_DEVICE_ID;
+      }
+      break;
+
+    case NATURAL_MEASURE_SLOT:
+      if (++plan->natural_counter >= plan->rate.natural_divider) {
+        plan->natural_counter = 0;
+        return SLOT_TASK_NATURAL;
+      }
+      break;
+
+    default:
+      break;
+  }
+
+  return 0;
+}
+
+bool slot_plan_device_id_due(const slot_plan_t *plan, uint8_t slot)
+{
+  return slot == DEVICE_ID_SLOT && slot_plan_slot_processed(plan, slot) &&
+         plan->device_id_counter + 1 >= plan->rate.device_id_divider;
+}
@@ -0,0 +1,109 @@
+/**
+ * Autore: DJITSOP FUOGOUK LOIC STEVE
+ * Firmware: ECOLUMIERE BLE MESH ESP32
+ * Modulo: Slot Plan - Pianificazione degli slot temporali del PWM controller
+ * Descrizione: Decide, tick per tick, quali slot (device ID, misura naturale,
+ *              misura ambiente e regolazione) vengono serviti con la cadenza
+ *              impostata dall'algoritmo. Nessuna dipendenza ESP-IDF: usato da
+ *              pwmcontroller.c e dal controllo host slot_plan_check.
+ */
+
+#ifndef SLOT_PLAN_H
+#define SLOT_PLAN_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define SLOT_COUNT                      10      // Numero slot per ciclo completo
+
+// Definizioni slot temporali per gestione eventi
+#define DEVICE_ID_SLOT                  0       // Slot comunicazione ID dispositivo
+#define NATURAL_MEASURE_SLOT            2       // Slot misurazione luce naturale
+#define ENV_MEASURE_SLOT                6       // Slot misurazione luce ambiente
+
+// Fasi di regolazione sfalsate fra le lampade della stessa stanza
+#define PWM_CONTROL_PHASES              6       // Slot di regolazione disponibili (4..9)
+#define PWM_CONTROL_SLOT_FIRST          4       // Primo slot dopo il buio della misura naturale
+
+#define SLOT_TICK_DIVIDER_MAX           2       // Divisore massimo dei tick elaborati
+
+// Attività da svolgere nel tick corrente (maschera di bit)
+#define SLOT_TASK_DEVICE_ID             0x01
+#define SLOT_TASK_NATURAL               0x02
+#define SLOT_TASK_ENV                   0x04
+
+/**
+ * @brief Cadenza di elaborazione degli slot temporali
+ * @field tick_divider: Slot elaborati solo se l'indice è multiplo di N (1 o 2)
+ * @field device_id_divider: Slot device ID elaborato ogni N cicli
+ * @field natural_divider: Slot misura naturale elaborato ogni N cicli
+ * @field env_divider: Slot misura ambiente elaborato ogni N cicli
+ */
+typedef struct {
+  uint8_t tick_divider;
+  uint8_t device_id_divider;
+  uint8_t natural_divider;
+  uint8_t env_divider;
+} pwm_slot_rate_t;
+
+/**
+ * @brief Stato della pianificazione
+ * @field rate: Cadenza corrente (divisori già normalizzati)
+ * @field device_id_counter/natural_counter/env_counter: Cicli dall'ultimo
+ *        servizio di ciascuno slot, conservati ai cambi di cadenza
+ */
+typedef struct {
+  pwm_slot_rate_t rate;
+  uint8_t device_id_counter;
+  uint8_t natural_counter;
+  uint8_t env_counter;
+} slot_plan_t;
+
+/**
+ * @brief Inizializza la pianificazione con contatori azzerati
+ */
+void slot_plan_init(slot_plan_t *plan, const pwm_slot_rate_t *rate);
+
+/**
+ * @brief Cambia la cadenza senza toccare contatori né fase
+ * @desc I divisori a zero vengono portati a 1, tick_divider è limitato a
+ *       SLOT_TICK_DIVIDER_MAX. La fase del salto dei tick è l'indice dello
+ *       slot, non un contatore di tick: un cambio di cadenza dentro lo slot
+ *       di regolazione non può escludere gli slot di misura.
+ * @return Cadenza effettivamente applicata
+ */
+pwm_slot_rate_t slot_plan_set_rate(slot_plan_t *plan, const pwm_slot_rate_t *rate);
+
+/**
+ * @brief Slot di regolazione corrispondente a una fase
+ */
+uint8_t slot_plan_control_slot(uint8_t phase);
+
+/**
+ * @brief Indica se il salto dei tick lascia elaborare lo slot
+ */
+bool slot_plan_slot_processed(const slot_plan_t *plan, uint8_t slot);
+
+/**
+ * @brief Attività dello slot di regolazione, fuori dal salto dei tick
+ * @param env_ready: false durante un buio di calibrazione (nessun conteggio)
+ * @return SLOT_TASK_ENV o 0, con il contatore ambiente aggiornato
+ */
+uint8_t slot_plan_control_tick(slot_plan_t *plan, uint8_t slot, uint8_t control_slot,
+                               bool env_ready);
+
+/**
+ * @brief Attività degli slot device ID e misura naturale
+ * @desc Da chiamare dopo slot_plan_control_tick, nello stesso tick: la cadenza
+ *       eventualmente cambiata dall'algoritmo vale già per questo slot.
+ * @return SLOT_TASK_DEVICE_ID, SLOT_TASK_NATURAL o 0, con i contatori aggiornati
+ */
+uint8_t slot_plan_measure_tick(slot_plan_t *plan, uint8_t slot);
+
+/**
+ * @brief Indica se il tick dello slot indicato servirà il device ID
+ * @desc Usata dopo l'avanzamento per armare in anticipo l'acquisizione ottica.
+ */
+bool slot_plan_device_id_due(const slot_plan_t *plan, uint8_t slot);
+
+#endif //SLOT_PLAN_H
@@ -14,6 +14,8 @@
 #include "config.h"
 #include "slave_role.h"
 #include "esp_rom_crc.h"
+#include "room_matrix.h"
+#include "offset_cal.h"
 
 /************************************************
  * DEFINES AND MACRO                            *
@@ -495,4 +497,155 @@ bool storage_lampada_state_exists(void) {
 
   return exists;
 
-}
\ No newline at end of file
+}
+
+
+/**
+ * @brief Salva lo stato per la ripartenza a caldo
+ */
+bool storage_save_warm_state(const ecl_warm_state_t *state) {
+  if (state == NULL || !storage_is_ready_for_write()) return false;
+
+  char key_name[16];   // "WS_" + 12 caratteri MAC + null
+  generate_device_key("WS", key_name, sizeof(key_name));
+
+  esp_err_t err_code = nvs_set_blob(nvs_handle_val, key_name, state, sizeof(ecl_warm_state_t));
+  if (err_code == ESP_OK) {
+    err_code = nvs_commit(nvs_handle_val);
+  }
+
+  if (err_code != ESP_OK) {
+    ESP_LOGE(TAG, "Warm state write failed - Key: %s, Error: %s", key_name, esp_err_to_name(err_code));
+    return false;
+  }
+
+  ESP_LOGD(TAG, "Warm state saved - Key: %s, Size: %d", key_name, sizeof(ecl_warm_state_t));
+  return true;
+}
+
+/**
+ * @brief Carica lo stato per la ripartenza a caldo
+ */
+bool storage_load_warm_state(ecl_warm_state_t *state) {
+  if (state == NULL || nvs_handle_val == 0) return false;
+
+  char key_name[16];
+  generate_device_key("WS", key_name, sizeof(key_name));
+
+  size_t required_size = sizeof(ecl_warm_state_t);
+  esp_err_t err_code = nvs_get_blob(nvs_handle_val, key_name, state, &required_size);
+
+  if (err_code == ESP_OK && required_size == sizeof(ecl_warm_state_t)) {
+    ESP_LOGI(TAG, "✅ Warm state caricato - Key: %s", key_name);
+    return true;
+  }
+
+  if (err_code == ESP_OK) {
+    ESP_LOGW(TAG, "🗑️ Warm state con dimensione errata (%d), eliminato", required_size);
+    nvs_erase_key(nvs_handle_val, key_name);
+    nvs_commit(nvs_handle_val);
+  }
+
+  memset(state, 0, sizeof(ecl_warm_state_t));
+  return false;
+}
+
+/**
+ * @brief Salva la riga della matrice di stanza
+ */
+bool storage_save_room_matrix(const void *row) {
+  if (row == NULL || !storage_is_ready_for_write()) return false;
+
+  char key_name[16];   // "RM_" + 12 caratteri MAC + null
+  generate_device_key("RM", key_name, sizeof(key_name));
+
+  esp_err_t err_code = nvs_set_blob(nvs_handle_val, key_name, row, sizeof(room_matrix_row_t));
+  if (err_code == ESP_OK) {
+    err_code = nvs_commit(nvs_handle_val);
+  }
+
+  if (err_code != ESP_OK) {
+    ESP_LOGE(TAG, "Room matrix write failed - Key: %s, Error: %s", key_name, esp_err_to_name(err_code));
+    return false;
+  }
+
+  ESP_LOGD(TAG, "Room matrix saved - Key: %s, Size: %d", key_name, sizeof(room_matrix_row_t));
+  return true;
+}
+
+/**
+ * @brief Carica la riga della matrice di stanza
+ */
+bool storage_load_room_matrix(void *row) {
+  if (row == NULL || nvs_handle_val == 0) return false;
+
+  char key_name[16];
+  generate_device_key("RM", key_name, sizeof(key_name));
+
+  size_t required_size = sizeof(room_matrix_row_t);
+  esp_err_t err_code = nvs_get_blob(nvs_handle_val, key_name, row, &required_size);
+
+  if (err_code == ESP_OK && required_size == sizeof(room_matrix_row_t)) {
+    ESP_LOGI(TAG, "✅ Matrice di stanza caricata - Key: %s", key_name);
+    return true;
+  }
+
+  if (err_code == ESP_OK) {
+    ESP_LOGW(TAG, "🗑️ Matrice di stanza con dimensione errata (%d), eliminata", required_size);
+    nvs_erase_key(nvs_handle_val, key_name);
+    nvs_commit(nvs_handle_val);
+  }
+
+  memset(row, 0, sizeof(room_matrix_row_t));
+  return false;
+}
+
+/**
+ * @brief Salva la tabella di compensazione del luxmeter
+ */
+bool storage_save_offset_table(const void *table) {
+  if (table == NULL || !storage_is_ready_for_write()) return false;
+
+  char key_name[16];   // "OC_" + 12 caratteri MAC + null
+  generate_device_key("OC", key_name, sizeof(key_name));
+
+  esp_err_t err_code = nvs_set_blob(nvs_handle_val, key_name, table, sizeof(offset_cal_table_t));
+  if (err_code == ESP_OK) {
+    err_code = nvs_commit(nvs_handle_val);
+  }
+
+  if (err_code != ESP_OK) {
+    ESP_LOGE(TAG, "Offset table write failed - Key: %s, Error: %s", key_name, esp_err_to_name(err_code));
+    return false;
+  }
+
+  ESP_LOGD(TAG, "Offset table saved - Key: %s, Size: %d", key_name, sizeof(offset_cal_table_t));
+  return true;
+}
+
+/**
+ * @brief Carica la tabella di compensazione del luxmeter
+ */
+bool storage_load_offset_table(void *table) {
+  if (table == NULL || nvs_handle_val == 0) return false;
+
+  char key_name[16];
+  generate_device_key("OC", key_name, sizeof(key_name));
+
+  size_t required_size = sizeof(offset_cal_table_t);
+  esp_err_t err_code = nvs_get_blob(nvs_handle_val, key_name, table, &required_size);
+
+  if (err_code == ESP_OK && required_size == sizeof(offset_cal_table_t)) {
+    ESP_LOGI(TAG, "✅ Tabella offset luxmeter caricata - Key: %s", key_name);
+    return true;
+  }
+
+  if (err_code == ESP_OK) {
+    ESP_LOGW(TAG, "🗑️ Tabella offset con dimensione errata (%d), eliminata", required_size);
+    nvs_erase_key(nvs_handle_val, key_name);
+    nvs_commit(nvs_handle_val);
+  }
+
+  memset(table, 0, sizeof(offset_cal_table_t));
+  return false;
+}
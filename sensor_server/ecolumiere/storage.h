@@ -11,6 +11,7 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include "slave_role.h"
+#include "ecolumiere.h"
 
 /**
  * @brief Inizializza il modulo di storage
@@ -81,4 +82,47 @@ bool storage_load_lampada_state(NodoLampada *lampada);
 
 bool storage_lampada_state_exists(void);
 
+/**
+ * @brief Salva lo stato per la ripartenza a caldo
+ * @desc Scrittura immediata su NVS; va chiamata a bassa frequenza
+ * @param state: Stato da salvare (CRC già calcolato)
+ * @return true: Stato salvato, false: Storage non pronto o errore NVS
+ */
+bool storage_save_warm_state(const ecl_warm_state_t *state);
+
+/**
+ * @brief Carica lo stato per la ripartenza a caldo
+ * @param state: Stato da riempire (azzerato se assente)
+ * @return true: Stato trovato con dimensione corretta, false: Stato assente
+ */
+bool storage_load_warm_state(ecl_warm_state_t *state);
+
+/**
+ * @brief Salva la riga della matrice di stanza
+ * @param row: Puntatore alla struttura room_matrix_row_t (CRC già calcolato)
+ * @return true: Riga salvata, false: Storage non pronto o errore NVS
+ */
+bool storage_save_room_matrix(const void *row);
+
+/**
+ * @brief Carica la riga della matrice di stanza
+ * @param row: Puntatore alla struttura room_matrix_row_t da riempire
+ * @return true: Riga trovata con dimensione corretta, false: Riga assente
+ */
+bool storage_load_room_matrix(void *row);
+
+/**
+ * @brief Salva la tabella di compensazione del luxmeter
+ * @param table: Puntatore alla struttura offset_cal_table_t (CRC già calcolato)
+ * @return true: Tabella salvata, false: Storage non pronto o errore NVS
+ */
+bool storage_save_offset_table(const void *table);
+
+/**
+ * @brief Carica la tabella di compensazione del luxmeter
+ * @param table: Puntatore alla struttura offset_cal_table_t da riempire
+ * @return true: Tabella trovata con dimensione corretta, false: Tabella assente
+ */
+bool storage_load_offset_table(void *table);
+
 #endif //STORAGE_H
\ No newline at end of file
@@ -0,0 +1,179 @@
+/**
+ * Firmware: ECOLUMIERE BLE MESH ESP32
+ * Tool host: Analog Scan Sim - Scansione multicanale e fotografia dei sensori
+ * Descrizione: Genera la sequenza di conversioni della scansione del
+ *              luxmeter (5 luce, NTC, tensione, corrente LED su 8 posizioni)
+ *              con la corrente dei LED a impulsi PWM da 1 kHz, la passa
+ *              all'accumulo e alla pubblicazione del firmware (analog_scan.c)
+ *              e confronta corrente e potenza della fotografia con i valori
+ *              medi veri a ogni livello PWM. Scansione a 32 kHz (canale a
+ *              4 kHz, agganciato in fase al PWM) contro 30.9 kHz (canale
+ *              a 3862.5 Hz, 309 fasi che scorrono).
+ *
+ * Compilazione (da sensor_server/host):
+ *   gcc -O2 -Wall -I../ecolumiere -o analog_scan_sim analog_scan_sim.c \
+ *       ../ecolumiere/analog_scan.c -lm
+ *
+ * Uso: ./analog_scan_sim [pubblicazioni_per_livello] [seed]
+ *
+ * Ipotesi: corrente di picco 1.2 A, fronti del driver da 10 us, alimentazione
+ * 24 V, temperatura 22 °C, rumore 2 LSB su tutti i canali, frame da 50 ms,
+ * una fotografia ogni 10 frame, fase iniziale del PWM casuale. Il clock del
+ * PWM e dell'ADC derivano dallo stesso quarzo: nessuna deriva fra i due.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "host_common.h"
+#include "analog_scan.h"
+
+/************************************************
+ * PARAMETRI DI SIMULAZIONE                    *
+ ************************************************/
+
+#define SIM_DEFAULT_PUBLISH     20
+#define SIM_PATTERN_LEN         8       // LUX_ADC_PATTERN_LEN
+#define SIM_FRAME_MS            50      // LUX_ADC_FRAME_MS
+#define SIM_PUBLISH_FRAMES      (ANALOG_SCAN_PUBLISH_MS / SIM_FRAME_MS)
+#define SIM_PWM_HZ              1000.0
+#define SIM_LEVELS              32
+#define SIM_PEAK_A              1.2
+#define SIM_EDGE_US             10.0
+#define SIM_SUPPLY_V            24.0
+#define SIM_TEMP_C              22.0
+#define SIM_NOISE_LSB           2.0
+
+static const double sim_rates[] = { 32000.0, 30900.0 };
+#define SIM_RATES               (sizeof(sim_rates) / sizeof(sim_rates[0]))
+
+// Posizioni nella scansione (scan_pattern di luxmeter.c)
+static const analog_channel_t sim_pattern[SIM_PATTERN_LEN] = {
+    ANALOG_CH_LUX, ANALOG_CH_NTC, ANALOG_CH_LUX, ANALOG_CH_LUX,
+    ANALOG_CH_VSUPPLY, ANALOG_CH_LUX, ANALOG_CH_LUX, ANALOG_CH_ILED
+};
+
+/************************************************
+ * SEGNALI                                     *
+ ************************************************/
+
+static double sim_code(host_rng_t *rng, double volts)
+{
+    double code = volts * ANALOG_SCAN_MAX_CODE / (ANALOG_SCAN_FULL_SCALE_MV / 1000.0) +
+                  SIM_NOISE_LSB * host_rng_gauss(rng);
+    if (code < 0.0) code = 0.0;
+    if (code > ANALOG_SCAN_MAX_CODE) code = ANALOG_SCAN_MAX_CODE;
+    return code + 0.5;
+}
+
+/**
+ * @brief Corrente istantanea dei LED con fronti lineari
+ */
+static double sim_current(double phase, int level)
+{
+    double period_us = 1e6 / SIM_PWM_HZ;
+    double t = phase * period_us, on = period_us * level / SIM_LEVELS;
+
+    if (level == 0) return 0.0;
+    if (t < SIM_EDGE_US) return SIM_PEAK_A * t / SIM_EDGE_US;
+    if (t < on) return SIM_PEAK_A;
+    if (t < on + SIM_EDGE_US) return SIM_PEAK_A * (1.0 - (t - on) / SIM_EDGE_US);
+    return 0.0;
+}
+
+static double sim_ntc_volts(double celsius)
+{
+    double r = ANALOG_NTC_R0_OHM * exp(ANALOG_NTC_BETA * (1.0 / (celsius + 273.15) - 1.0 / ANALOG_NTC_T0_K));
+    return (ANALOG_SCAN_FULL_SCALE_MV / 1000.0) * r / (r + ANALOG_NTC_SERIES_OHM);
+}
+
+/************************************************
+ * MAIN                                        *
+ ************************************************/
+
+int main(int argc, char **argv)
+{
+    int publish = (argc > 1) ? atoi(argv[1]) : SIM_DEFAULT_PUBLISH;
+    uint32_t seed = (argc > 2) ? (uint32_t)strtoul(argv[2], NULL, 0) : 1;
+    int worst = 0;
+
+    printf("%d fotografie per livello PWM, seed %u, picco %.1f A, alimentazione %.0f V, %.0f °C\n",
+           publish, seed, SIM_PEAK_A, SIM_SUPPLY_V, SIM_TEMP_C);
+    printf("Errore della corrente rispetto alla media vera (%% della corrente di picco)\n\n");
+    printf("%-10s  %-14s  %-22s  %-18s  %s\n", "scansione", "canale ILED",
+           "corrente medio / max", "potenza max (W)", "temperatura / tensione");
+
+    for (size_t r = 0; r < SIM_RATES; r++) {
+        host_rng_t rng;
+        host_rng_seed(&rng, seed);
+
+        double rate = sim_rates[r];
+        uint32_t frame_conv = (uint32_t)(rate * SIM_FRAME_MS / 1000.0);
+        double sum_err = 0.0, max_err = 0.0, max_power_err = 0.0;
+        int count = 0;
+        analog_snapshot_t snap = { 0 };
+
+        for (int level = 0; level <= SIM_LEVELS; level++) {
+            analog_scan_t scan;
+            analog_scan_init(&scan, SIM_PUBLISH_FRAMES);
+
+            double true_a = 0.0;
+            for (int k = 0; k < 10000; k++) true_a += sim_current(k / 10000.0, level);
+            true_a /= 10000.0;
+
+            double phase = host_rng_uniform(&rng);
+            uint32_t pos = (uint32_t)(host_rng_next(&rng) % SIM_PATTERN_LEN);
+
+            for (int p = 0; p < publish; p++) {
+                bool due = false;
+                while (!due) {
+                    analog_acc_t frame[ANALOG_CH_COUNT] = { 0 };
+
+                    for (uint32_t c = 0; c < frame_conv; c++) {
+                        analog_channel_t ch = sim_pattern[pos];
+                        pos = (pos + 1) % SIM_PATTERN_LEN;
+                        phase += SIM_PWM_HZ / rate;
+                        if (phase >= 1.0) phase -= 1.0;
+
+                        double volts = 0.0;
+                        switch (ch) {
+                            case ANALOG_CH_NTC:     volts = sim_ntc_volts(SIM_TEMP_C); break;
+                            case ANALOG_CH_VSUPPLY: volts = SIM_SUPPLY_V * 100.0 / ANALOG_VSUPPLY_DIVIDER_X100; break;
+                            case ANALOG_CH_ILED:    volts = sim_current(phase, level) * ANALOG_ILED_MV_PER_A / 1000.0; break;
+                            default:                continue;
+                        }
+                        analog_scan_add(frame, ch, (uint16_t)sim_code(&rng, volts));
+                    }
+                    due = analog_scan_merge(&scan, frame);
+                }
+
+                analog_acc_t acc[ANALOG_CH_COUNT];
+                analog_scan_latch(&scan, acc);
+                analog_scan_publish(&scan, acc, 0, 0);
+                analog_scan_read(&scan, &snap);
+
+                // Filtro assestato dopo le prime fotografie
+                if (p < 4) continue;
+                double err = fabs(snap.current_ca / 100.0 - true_a) / SIM_PEAK_A;
+                double power_err = fabs(snap.power_cw / 100.0 - true_a * SIM_SUPPLY_V);
+                sum_err += err;
+                count++;
+                if (err > max_err) max_err = err;
+                if (power_err > max_power_err) max_power_err = power_err;
+            }
+        }
+
+        printf("%5.0f Hz  %8.0f Hz     %6.2f%% / %6.2f%%       %6.2f             %.1f °C / %.2f V",
+               rate, rate / SIM_PATTERN_LEN, 100.0 * sum_err / count, 100.0 * max_err,
+               max_power_err, snap.temp_half_c / 2.0, snap.voltage_cv / 100.0);
+        if (snap.faults) printf("  (guasti 0x%02X)", snap.faults);
+        printf("\n");
+
+        if (r == SIM_RATES - 1 && (max_err > 0.01 || snap.faults)) worst = 1;
+    }
+
+    printf("\nConversioni per fotografia e canale ausiliario: %d frame x %u\n",
+           SIM_PUBLISH_FRAMES, (unsigned)(sim_rates[SIM_RATES - 1] * SIM_FRAME_MS / 1000.0 / SIM_PATTERN_LEN));
+    return worst;
+}
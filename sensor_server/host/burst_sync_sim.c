@@ -0,0 +1,234 @@
+/**
+ * Firmware: ECOLUMIERE BLE MESH ESP32
+ * Tool host: Burst Sync Sim - Raffiche ADC sincronizzate con il buio del PWM
+ * Descrizione: Simula il sensore a 20 kHz (frame DMA da 50 ms) davanti a una
+ *              lampada PWM a 1 kHz con driver e sensore del primo ordine, e
+ *              passa i codici alla finestra del firmware (luxmeter_adc.c).
+ *              Confronta le misure naturale e ambiente di tre schemi:
+ *              lettura della finestra continua a lampada accesa (misura
+ *              originale senza buio), buio di 2 tick con la finestra continua
+ *              e buio di 1 tick con raffiche etichettate (luxmeter_burst_arm,
+ *              ritardo di assestamento e latenza del frame).
+ *
+ * Compilazione (da sensor_server/host):
+ *   gcc -O2 -Wall -I../ecolumiere -o burst_sync_sim burst_sync_sim.c \
+ *       ../ecolumiere/luxmeter_adc.c -lm
+ *
+ * Uso: ./burst_sync_sim [cicli] [assestamento_ms] [seed]
+ *
+ * Ipotesi: tick da 500 ms, slot naturale 2, slot di regolazione 4 (il primo
+ * dopo il buio) e 6, luce naturale 150 lux che deriva del 20%, costante di
+ * tempo driver + sensore 5 ms, rumore 2 LSB, fase dei frame DMA casuale
+ * rispetto ai tick. Il riferimento è la luce vera all'istante della lettura.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "host_common.h"
+#include "luxmeter_adc.h"
+
+/************************************************
+ * PARAMETRI DI SIMULAZIONE                    *
+ ************************************************/
+
+#define SIM_RATE_HZ             20000   // LUX_ADC_SAMPLE_FREQ_HZ
+#define SIM_FRAME               1000    // LUX_ADC_FRAME_CONV
+#define SIM_FRAME_MS            (SIM_FRAME * 1000 / SIM_RATE_HZ)
+#define SIM_TICK_MS             500
+#define SIM_SLOT_COUNT          10
+#define SIM_NATURAL_SLOT        2
+#define SIM_PWM_HZ              1000.0
+#define SIM_LEVELS              32
+#define SIM_LAMP_FULL_LUX       600.0   // Contributo della lampada al livello 32
+#define SIM_NATURAL_LUX         150.0
+#define SIM_NATURAL_DRIFT       0.20
+#define SIM_TAU_MS              5.0     // Driver LED + sensore
+#define SIM_NOISE_LSB           2.0f
+#define SIM_BURST_SAMPLES       16      // MEASURE_BURST_SAMPLES
+#define SIM_SETTLE_MS           30      // MEASURE_SETTLE_MS
+#define SIM_DEFAULT_CYCLES      100
+
+typedef enum {
+    SIM_LAMP_ON,        // Misura naturale originale: nessun buio
+    SIM_BLANK_WINDOW,   // Buio di 2 tick, finestra continua
+    SIM_BLANK_BURST,    // Buio di 1 tick, raffiche etichettate
+    SIM_SCHEMES
+} sim_scheme_t;
+
+static const char *scheme_names[SIM_SCHEMES] = {
+    "finestra, lampada accesa", "buio 2 tick + finestra", "buio 1 tick + raffica"
+};
+
+/**
+ * @brief Errori relativi accumulati per una misura
+ */
+typedef struct {
+    double sum;
+    double max;
+    uint32_t count;
+    uint32_t missed;
+} sim_err_t;
+
+/************************************************
+ * SENSORE E LAMPADA                           *
+ ************************************************/
+
+static luxmeter_window_t window;
+static uint16_t frame[SIM_FRAME];
+static uint32_t frame_pos;
+
+static double sim_natural(uint64_t conv, uint64_t total)
+{
+    return SIM_NATURAL_LUX * (1.0 + SIM_NATURAL_DRIFT * sin(6.2831853 * (double)conv / total));
+}
+
+static void sim_err_add(sim_err_t *e, uint16_t code, double truth)
+{
+    double err = fabs(host_lux_from_code((double)code / LUXMETER_CODE_ONE) - truth) / truth;
+    e->sum += err;
+    if (err > e->max) e->max = err;
+    e->count++;
+}
+
+static uint16_t sim_skip(uint16_t settle_ms)
+{
+    return (uint16_t)((settle_ms + SIM_FRAME_MS + 9) / 10);  // Come luxmeter_burst_arm
+}
+
+/**
+ * @brief Esegue uno schema e accumula gli errori naturale e ambiente
+ */
+static void sim_run(sim_scheme_t scheme, int control_slot, int cycles, uint16_t settle_ms,
+                    uint32_t seed, sim_err_t *natural_err, sim_err_t *env_err)
+{
+    host_rng_t rng;
+    host_rng_seed(&rng, seed);
+
+    luxmeter_window_init(&window, SIM_RATE_HZ);
+    luxmeter_window_set_filter(&window, LUXMETER_FILTER_HAMPEL);
+    frame_pos = 0;
+
+    const uint64_t conv_per_ms = SIM_RATE_HZ / 1000;
+    const uint64_t total = (uint64_t)cycles * SIM_SLOT_COUNT * SIM_TICK_MS * conv_per_ms;
+    const uint64_t frame_phase = host_rng_next(&rng) % SIM_FRAME;
+    const uint32_t blank_len = (scheme == SIM_BLANK_WINDOW) ? 2 : 1;
+
+    int level = 8 + (int)(host_rng_next(&rng) % 20);
+    uint32_t blank_ticks = 0;
+    double light = SIM_NATURAL_LUX;
+    double pwm_phase = host_rng_uniform(&rng);
+
+    for (uint64_t c = 0; c < total; c++) {
+        // Inizio tick: eventi dello slot come slot_timer_callback
+        if (c % (SIM_TICK_MS * conv_per_ms) == 0) {
+            uint64_t tick = c / (SIM_TICK_MS * conv_per_ms);
+            int slot = (int)(tick % SIM_SLOT_COUNT);
+            double natural = sim_natural(c, total);
+            double env = natural + SIM_LAMP_FULL_LUX * level / SIM_LEVELS;
+            uint16_t code;
+
+            if (blank_ticks > 0 && --blank_ticks == 0 && scheme != SIM_LAMP_ON) {
+                if (scheme == SIM_BLANK_BURST) {
+                    if (luxmeter_window_burst_result(&window, 0, &code)) sim_err_add(natural_err, code, natural);
+                    else natural_err->missed++;
+                } else {
+                    sim_err_add(natural_err, window.mean, natural);
+                }
+            }
+
+            if (slot == control_slot && blank_ticks == 0 && tick >= SIM_SLOT_COUNT) {
+                if (scheme == SIM_BLANK_BURST && luxmeter_window_burst_result(&window, 1, &code)) {
+                    sim_err_add(env_err, code, env);
+                } else {
+                    if (scheme == SIM_BLANK_BURST) env_err->missed++;
+                    sim_err_add(env_err, window.mean, env);
+                }
+
+                // Nuovo livello dopo il passo dell'algoritmo (fade istantaneo)
+                level = 8 + (int)(host_rng_next(&rng) % 20);
+            }
+
+            if (scheme == SIM_BLANK_BURST && blank_ticks == 0 &&
+                (slot + 1) % SIM_SLOT_COUNT == control_slot) {
+                luxmeter_window_arm_burst(&window, 1, sim_skip(settle_ms), SIM_BURST_SAMPLES);
+            }
+
+            if (slot == SIM_NATURAL_SLOT) {
+                if (scheme == SIM_LAMP_ON) {
+                    if (tick >= SIM_SLOT_COUNT) sim_err_add(natural_err, window.mean, natural);
+                } else if (blank_ticks == 0) {
+                    blank_ticks = blank_len;
+                    if (scheme == SIM_BLANK_BURST) {
+                        luxmeter_window_arm_burst(&window, 0, sim_skip(settle_ms), SIM_BURST_SAMPLES);
+                    }
+                }
+            }
+        }
+
+        // Lampada PWM filtrata da driver e sensore
+        pwm_phase += SIM_PWM_HZ / SIM_RATE_HZ;
+        if (pwm_phase >= 1.0) pwm_phase -= 1.0;
+        bool on = blank_ticks == 0 && pwm_phase < (double)level / SIM_LEVELS;
+        double target = sim_natural(c, total) + (on ? SIM_LAMP_FULL_LUX : 0.0);
+        light += (target - light) * (1000.0 / SIM_RATE_HZ) / SIM_TAU_MS;
+
+        double code = host_code_from_lux(light) + SIM_NOISE_LSB * host_rng_gauss(&rng);
+        if (code < 0.0) code = 0.0;
+        if (code > HOST_ADC_MAX_CODE) code = HOST_ADC_MAX_CODE;
+        frame[frame_pos++] = (uint16_t)(code + 0.5);
+
+        // Frame consegnato alla ISR a fine riempimento, con fase casuale
+        if ((c + frame_phase) % SIM_FRAME == SIM_FRAME - 1) {
+            luxmeter_window_feed(&window, frame, frame_pos);
+            frame_pos = 0;
+        }
+    }
+}
+
+static void sim_print(const char *label, const sim_err_t *e)
+{
+    if (e->count == 0) {
+        printf("  %-8s      --\n", label);
+        return;
+    }
+    printf("  %-8s %6.2f%% / %6.2f%%", label, 100.0 * e->sum / e->count, 100.0 * e->max);
+    if (e->missed) printf("  (%u raffiche mancate)", e->missed);
+    printf("\n");
+}
+
+/************************************************
+ * MAIN                                        *
+ ************************************************/
+
+int main(int argc, char **argv)
+{
+    int cycles = (argc > 1) ? atoi(argv[1]) : SIM_DEFAULT_CYCLES;
+    uint16_t settle_ms = (argc > 2) ? (uint16_t)atoi(argv[2]) : SIM_SETTLE_MS;
+    uint32_t seed = (argc > 3) ? (uint32_t)strtoul(argv[3], NULL, 0) : 1;
+    int worst = 0;
+
+    printf("%d cicli da %d slot, assestamento %u ms + frame %d ms, raffica %d campioni, seed %u\n",
+           cycles, SIM_SLOT_COUNT, settle_ms, SIM_FRAME_MS, SIM_BURST_SAMPLES, seed);
+    printf("Errore relativo medio / massimo sui lux\n");
+
+    for (int control_slot = 4; control_slot <= 6; control_slot += 2) {
+        printf("\nSlot di regolazione %d\n", control_slot);
+        for (int s = 0; s < SIM_SCHEMES; s++) {
+            sim_err_t natural_err = { 0 }, env_err = { 0 };
+            sim_run((sim_scheme_t)s, control_slot, cycles, settle_ms, seed, &natural_err, &env_err);
+
+            printf(" %s (%u tick al buio per ciclo)\n", scheme_names[s],
+                   s == SIM_LAMP_ON ? 0 : (s == SIM_BLANK_WINDOW ? 2 : 1));
+            sim_print("naturale", &natural_err);
+            sim_print("ambiente", &env_err);
+
+            if (s == SIM_BLANK_BURST && (natural_err.missed || env_err.missed)) worst = 1;
+        }
+    }
+
+    printf("\nCampioni stimati per misura: finestra %d (di %d acquisiti), raffica %d\n",
+           LUXMETER_WINDOW_USED, LUXMETER_WINDOW_SAMPLES, SIM_BURST_SAMPLES);
+    return worst;
+}
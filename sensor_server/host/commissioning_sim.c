@@ -0,0 +1,179 @@
+/**
+ * Firmware: ECOLUMIERE BLE MESH ESP32
+ * Tool host: Commissioning Sim - Scansione automatica contro valori di fabbrica
+ * Descrizione: Genera un lotto di lampade con distanza dal piano, efficienza e
+ *              risposta del sensore diverse da quelle nominali, esegue su ognuna
+ *              la scansione di commissioning del firmware (stessi livelli,
+ *              tempi e stima di commissioning_fit.c) e confronta l'errore di
+ *              regolazione con i valori di fabbrica (18.75 / 1.0 m / 1.0) e con
+ *              quelli stimati. Verifica anche il rifiuto di stanze non buie e
+ *              di luce ambiente che cambia durante la scansione.
+ *
+ * Compilazione (da sensor_server/host):
+ *   gcc -O2 -Wall -I../ecolumiere -o commissioning_sim commissioning_sim.c \
+ *       ../ecolumiere/commissioning_fit.c -lm
+ *
+ * Uso: ./commissioning_sim [lampade] [seed]
+ *
+ * Ipotesi: il luxmeter restituisce la media della finestra ADC con rumore
+ * gaussiano (2 lux + 1%); la risposta reale è leggermente compressa ai livelli
+ * alti. L'errore di regolazione è lo scarto fra i lux prodotti e quelli
+ * richiesti quando il livello è calcolato come lux / guadagno del modello; la
+ * richiesta è la resa reale della lampada a metà scala, raggiungibile da tutte.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "host_common.h"
+#include "commissioning_fit.h"
+
+/************************************************
+ * PARAMETRI DI SIMULAZIONE                    *
+ ************************************************/
+
+#define SIM_DEFAULT_LAMPS       200
+#define SIM_NOMINAL_EFFICIENCY  18.75f
+#define SIM_NOMINAL_DISTANCE    1.0f
+#define SIM_DIST_MIN_M          0.8f
+#define SIM_DIST_MAX_M          2.5f
+#define SIM_EFF_SPREAD          0.15f   // Tolleranza di efficienza del lotto
+#define SIM_COMPRESSION         0.004f  // Compressione della risposta per livello
+#define SIM_DARK_MAX_LUX        8.0f
+#define SIM_NOISE_LUX           2.0f
+#define SIM_NOISE_REL           0.01f
+#define SIM_CONTROL_LEVEL       16.0f   // Richiesta del confronto: resa reale a metà scala
+
+/**
+ * @brief Lampada del lotto
+ */
+typedef struct {
+    float efficiency;
+    float distance;
+    float dark;
+    float drift;        // Variazione di luce ambiente durante la scansione
+} sim_lamp_t;
+
+static float sim_true_lux(const sim_lamp_t *lamp, float level)
+{
+    float gain = lamp->efficiency / (lamp->distance * lamp->distance);
+    return gain * level * (1.0f - SIM_COMPRESSION * level);
+}
+
+static float sim_read(host_rng_t *rng, float lux)
+{
+    lux += (SIM_NOISE_LUX + SIM_NOISE_REL * lux) * host_rng_gauss(rng);
+    return (lux > 0.0f) ? (float)(uint32_t)(lux + 0.5f) : 0.0f;
+}
+
+/**
+ * @brief Scansione come commissioning_task (medie di COMMISSIONING_SAMPLES letture)
+ */
+static void sim_sweep(host_rng_t *rng, const sim_lamp_t *lamp, commissioning_point_t *points)
+{
+    for (int step = 0; step < COMMISSIONING_POINTS; step++) {
+        uint8_t level = commissioning_level_at(step);
+        float ambient = lamp->dark + lamp->drift * step / (COMMISSIONING_POINTS - 1);
+        float sum = 0.0f;
+
+        for (int i = 0; i < COMMISSIONING_SAMPLES; i++) {
+            sum += sim_read(rng, ambient + sim_true_lux(lamp, level));
+        }
+        points[step].level = level;
+        points[step].lux = sum / COMMISSIONING_SAMPLES;
+    }
+}
+
+/**
+ * @brief Errore relativo di regolazione con il guadagno del modello
+ */
+static float sim_control_error(const sim_lamp_t *lamp, float model_gain)
+{
+    float request = sim_true_lux(lamp, SIM_CONTROL_LEVEL);
+    float level = request / model_gain;
+    if (level > 32.0f) level = 32.0f;
+    return fabsf(sim_true_lux(lamp, level) - request) / request;
+}
+
+int main(int argc, char **argv)
+{
+    int lamps = (argc > 1) ? atoi(argv[1]) : SIM_DEFAULT_LAMPS;
+    uint32_t seed = (argc > 2) ? (uint32_t)strtoul(argv[2], NULL, 0) : 1;
+    host_rng_t rng;
+    host_rng_seed(&rng, seed);
+
+    const float nominal_gain = SIM_NOMINAL_EFFICIENCY / (SIM_NOMINAL_DISTANCE * SIM_NOMINAL_DISTANCE);
+    int status_count[COMMISSIONING_STATUS_COUNT] = { 0 };
+    double err_default = 0.0, err_fit = 0.0, rms_fit = 0.0, rms_prior = 0.0;
+    double dist_err = 0.0;
+    float worst_default = 0.0f, worst_fit = 0.0f;
+    int fitted = 0, fit_better = 0;
+
+    for (int n = 0; n < lamps; n++) {
+        sim_lamp_t lamp = {
+            .efficiency = SIM_NOMINAL_EFFICIENCY * (1.0f + SIM_EFF_SPREAD * (2.0f * host_rng_uniform(&rng) - 1.0f)),
+            .distance = SIM_DIST_MIN_M + (SIM_DIST_MAX_M - SIM_DIST_MIN_M) * host_rng_uniform(&rng),
+            .dark = SIM_DARK_MAX_LUX * host_rng_uniform(&rng),
+            .drift = 0.0f
+        };
+
+        // Un lotto reale contiene qualche stanza non buia o con luce che cambia
+        if (n % 25 == 7) lamp.dark = 80.0f;
+        if (n % 25 == 13) lamp.drift = 25.0f;
+
+        commissioning_point_t points[COMMISSIONING_POINTS];
+        commissioning_fit_t fit;
+
+        sim_sweep(&rng, &lamp, points);
+        commissioning_fit(points, COMMISSIONING_POINTS, SIM_NOMINAL_EFFICIENCY, nominal_gain, &fit);
+        status_count[fit.status]++;
+
+        if (fit.status != COMMISSIONING_OK) continue;
+
+        // Guadagno che il firmware ricava dalla configurazione scritta
+        float model_gain = fit.efficiency * fit.transparency / (fit.distance * fit.distance);
+        float e_def = sim_control_error(&lamp, nominal_gain);
+        float e_fit = sim_control_error(&lamp, model_gain);
+
+        // Distanza efficace attesa: quella che riproduce il guadagno reale a efficienza nominale
+        float true_gain = lamp.efficiency / (lamp.distance * lamp.distance);
+        float expected_distance = sqrtf(SIM_NOMINAL_EFFICIENCY / true_gain);
+
+        err_default += e_def;
+        err_fit += e_fit;
+        rms_fit += fit.rms;
+        rms_prior += fit.rms_prior;
+        dist_err += fabsf(fit.distance - expected_distance) / expected_distance;
+        if (e_def > worst_default) worst_default = e_def;
+        if (e_fit > worst_fit) worst_fit = e_fit;
+        if (e_fit < e_def) fit_better++;
+        fitted++;
+    }
+
+    uint32_t duration_ms = COMMISSIONING_POINTS *
+                           (COMMISSIONING_SETTLE_MS + COMMISSIONING_SAMPLES * COMMISSIONING_SAMPLE_MS);
+
+    printf("Lotto di %d lampade, seed %u - scansione di %d livelli in %.1f s per lampada\n\n",
+           lamps, seed, COMMISSIONING_POINTS, duration_ms / 1000.0f);
+
+    for (int s = 0; s < COMMISSIONING_STATUS_COUNT; s++) {
+        if (status_count[s]) {
+            printf("  %-22s %4d\n", commissioning_status_name((commissioning_status_t)s), status_count[s]);
+        }
+    }
+
+    if (fitted == 0) return 1;
+
+    printf("\nErrore di regolazione a metà scala (lampade stimate):\n");
+    printf("  valori di fabbrica   medio %5.1f%%  peggiore %5.1f%%\n",
+           100.0 * err_default / fitted, 100.0f * worst_default);
+    printf("  commissioning        medio %5.1f%%  peggiore %5.1f%%\n",
+           100.0 * err_fit / fitted, 100.0f * worst_fit);
+    printf("  migliore su %d/%d lampade\n", fit_better, fitted);
+    printf("\nResiduo della scansione: %.1f lux (fabbrica %.1f lux)\n",
+           rms_fit / fitted, rms_prior / fitted);
+    printf("Errore medio sulla distanza efficace: %.1f%%\n", 100.0 * dist_err / fitted);
+
+    return 0;
+}
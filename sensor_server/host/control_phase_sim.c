@@ -0,0 +1,297 @@
+/**
+ * Firmware: ECOLUMIERE BLE MESH ESP32
+ * Tool host: Control Phase Sim - Regolazione sincrona contro fasi sfalsate
+ * Descrizione: Più lampade nella stessa stanza vedono lo stesso campo luminoso
+ *              (host_room). Ogni nodo replica la catena del firmware a livello
+ *              di tick da 500 ms: misura ambiente nel proprio slot di
+ *              regolazione, media a blocchi, passo algo_core_step e fade di un
+ *              livello ogni FADE_TICKS. Confronta tutti i nodi nello slot
+ *              ENV_MEASURE_SLOT (sincroni) con lo slot ricavato dalla fase del
+ *              nodo (pwm_set_control_phase) dopo un calo brusco di luce
+ *              naturale: sovraelongazione e tempo di assestamento.
+ *
+ * Compilazione (da sensor_server/host):
+ *   gcc -O2 -Wall -I../ecolumiere -o control_phase_sim control_phase_sim.c \
+ *       ../ecolumiere/algo_core.c -lm
+ *
+ * Uso: ./control_phase_sim [colonne righe] [sequenze_rumore]
+ *
+ * Ipotesi: profilo medie FAST (5/5, media algoritmo 2 con divisore 4,
+ * tutti gli slot elaborati), misura naturale nello slot 2 a lampade spente,
+ * rumore del sensore 2%. Il guadagno dimm_step viene variato perché al
+ * valore di fabbrica (0.1) il passo è già smorzato.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "host_common.h"
+#include "algo_core.h"
+#include "config.h"
+
+/************************************************
+ * PARAMETRI DI SIMULAZIONE                    *
+ ************************************************/
+
+#define SIM_TICK_MS             500
+#define SIM_SLOT_COUNT          10
+#define SIM_NATURAL_SLOT        2
+#define SIM_ENV_SLOT            6       // ENV_MEASURE_SLOT
+#define SIM_CONTROL_SLOT_FIRST  4       // PWM_CONTROL_SLOT_FIRST
+#define SIM_CONTROL_PHASES      6       // PWM_CONTROL_PHASES
+#define SIM_FADE_TICKS          8
+#define SIM_SPACING_M           1.5f
+
+#define SIM_NATURAL_ORDER       5       // Profilo FAST
+#define SIM_ENV_ORDER           5
+#define SIM_ALGO_AVG            2
+#define SIM_ALGO_AVG_LAST       4
+
+#define SIM_TARGET_LUX          500
+#define SIM_PERC_MIN            0.01f
+#define SIM_NOISE               0.02f
+#define SIM_WINDOW_BEFORE       1500.0f // Luce in finestra prima del disturbo
+#define SIM_WINDOW_AFTER        200.0f  // Nuvola improvvisa
+#define SIM_WARMUP_TICKS        (30 * 60 * 2)
+#define SIM_RUN_TICKS           (30 * 60 * 2)
+#define SIM_FINAL_TICKS         (5 * 60 * 2)   // Finestra del valore di regime
+#define SIM_BAND                0.05f   // Banda di assestamento
+#define SIM_RUNS                20      // Sequenze di rumore per configurazione
+
+/************************************************
+ * STRUTTURE                                   *
+ ************************************************/
+
+typedef struct {
+    measure_avg_t natural;
+    measure_avg_t env;
+    algo_avg_t algo_avg;
+    algo_data_t algo;
+    uint8_t control_slot;
+    uint8_t phase;
+    float level;
+    uint32_t target;
+} sim_node_t;
+
+typedef struct {
+    float overshoot;        // Media di stanza oltre il regime, in % del regime
+    float settling_s;       // Ultimo istante della media fuori banda dopo il disturbo
+    float final_error;      // |regime - target| della media, in %
+    float travel;           // Livelli percorsi per nodo
+} sim_result_t;
+
+/************************************************
+ * CATENA DEL FIRMWARE                         *
+ ************************************************/
+
+/**
+ * @brief Replica ecolumiere_algo_process (senza fusione né medie live)
+ */
+static void sim_algo_process(sim_node_t *node)
+{
+    if (!algo_core_avg_add(&node->algo_avg, (uint32_t)node->natural.measure, (uint32_t)node->env.measure)) {
+        return;
+    }
+
+    algo_core_avg_compute(&node->algo_avg, &node->algo, SIM_ALGO_AVG_LAST);
+    algo_core_avg_load(&node->algo, &node->algo_avg);
+    algo_core_step(&node->algo);
+
+    node->target = (uint32_t)node->algo.pnew;
+}
+
+/**
+ * @brief Slot di regolazione come pwm_set_control_phase
+ */
+static uint8_t sim_control_slot(uint8_t phase)
+{
+    return SIM_CONTROL_SLOT_FIRST +
+           (SIM_ENV_SLOT - SIM_CONTROL_SLOT_FIRST + phase) % SIM_CONTROL_PHASES;
+}
+
+/**
+ * @brief Ripartenza delle medie come ecolumiere_apply_avg_mode
+ * @desc Con le fasi il blocco ambiente parte già avanzato della quota di fase,
+ *       riempita con l'ultima misura: i blocchi dei nodi si chiudono a turno.
+ */
+static void sim_apply_avg_mode(sim_node_t *node, bool staggered)
+{
+    uint8_t skew = staggered ? (uint8_t)(node->phase * SIM_ENV_ORDER / SIM_CONTROL_PHASES) : 0;
+
+    node->natural.sum = 0;
+    node->natural.count = 0;
+    node->env.count = skew;
+    node->env.sum = (uint32_t)node->env.measure * skew;
+    node->algo_avg.count = 0;
+    node->algo_avg.natural_sum = 0;
+    node->algo_avg.env_sum = 0;
+}
+
+static void sim_node_init(sim_node_t *node, float dimm_step, uint8_t phase, uint8_t control_slot)
+{
+    memset(node, 0, sizeof(*node));
+    node->natural.size = SIM_NATURAL_ORDER;
+    node->env.size = SIM_ENV_ORDER;
+    node->algo_avg.size = SIM_ALGO_AVG;
+
+    node->algo.target_lux = SIM_TARGET_LUX;
+    node->algo.power_efficiency = HOST_LAMP_LUX_PER_LEVEL;
+    node->algo.distance = 1.0f;
+    node->algo.in_pl = 1;
+    node->algo.transparency = 1.0f;
+    node->algo.dimm_step = dimm_step;
+    node->algo.perc_min = SIM_PERC_MIN;
+    node->algo.emax = (float)LIGHT_MAX_LEVEL * HOST_LAMP_LUX_PER_LEVEL;
+    node->phase = phase;
+    node->control_slot = control_slot;
+}
+
+/************************************************
+ * SIMULAZIONE                                 *
+ ************************************************/
+
+static uint32_t sim_sensor(host_rng_t *rng, float lux)
+{
+    float value = lux * (1.0f + SIM_NOISE * host_rng_gauss(rng));
+    return (value > 0.0f) ? (uint32_t)value : 0;
+}
+
+static float sim_lux_at(const host_room_t *room, const sim_node_t *nodes, int i, float window_lux)
+{
+    float levels[HOST_ROOM_MAX_NODES];
+    for (int j = 0; j < room->count; j++) levels[j] = nodes[j].level;
+    return host_room_natural(room, i, window_lux) + host_room_lamp(room, i, levels);
+}
+
+/**
+ * @brief Esegue il disturbo con nodi sincroni o sfalsati
+ */
+static void sim_run(const host_room_t *room, bool staggered, float dimm_step,
+                    uint32_t seed, sim_result_t *res)
+{
+    static sim_node_t nodes[HOST_ROOM_MAX_NODES];
+    static float trace[HOST_ROOM_MAX_NODES][SIM_RUN_TICKS];
+    host_rng_t rng;
+
+    host_rng_seed(&rng, seed);
+    memset(res, 0, sizeof(*res));
+
+    for (int i = 0; i < room->count; i++) {
+        uint8_t phase = staggered ? (uint8_t)(i % SIM_CONTROL_PHASES) : 0;
+        sim_node_init(&nodes[i], dimm_step, phase, sim_control_slot(phase));
+    }
+
+    for (uint32_t tick = 0; tick < SIM_WARMUP_TICKS + SIM_RUN_TICKS; tick++) {
+        uint8_t slot = tick % SIM_SLOT_COUNT;
+        float window = (tick < SIM_WARMUP_TICKS) ? SIM_WINDOW_BEFORE : SIM_WINDOW_AFTER;
+
+        // Il disturbo è visto da tutti i nodi: ognuno passa in FAST nello stesso istante
+        if (tick == SIM_WARMUP_TICKS) {
+            for (int i = 0; i < room->count; i++) sim_apply_avg_mode(&nodes[i], staggered);
+        }
+
+        // Fade comune a tutti i nodi (timer slot di ciascuno, stessa cadenza)
+        if (tick % SIM_FADE_TICKS == 0) {
+            for (int i = 0; i < room->count; i++) {
+                sim_node_t *node = &nodes[i];
+                float before = node->level;
+                if (node->level < node->target) node->level += 1.0f;
+                else if (node->level > node->target) node->level -= 1.0f;
+                if (tick >= SIM_WARMUP_TICKS) res->travel += fabsf(node->level - before);
+            }
+        }
+
+        for (int i = 0; i < room->count; i++) {
+            sim_node_t *node = &nodes[i];
+
+            if (slot == SIM_NATURAL_SLOT) {
+                algo_core_measure_push(&node->natural, sim_sensor(&rng, host_room_natural(room, i, window)));
+            }
+            if (slot == node->control_slot) {
+                // handle_env_light_slot: chiamata a fine blocco e chiamata dello slot
+                if (algo_core_measure_push(&node->env, sim_sensor(&rng, sim_lux_at(room, nodes, i, window)))) {
+                    sim_algo_process(node);
+                }
+                sim_algo_process(node);
+            }
+        }
+
+        if (tick >= SIM_WARMUP_TICKS) {
+            for (int i = 0; i < room->count; i++) {
+                trace[i][tick - SIM_WARMUP_TICKS] = sim_lux_at(room, nodes, i, window);
+            }
+        }
+    }
+
+    // Media di stanza: la sovraelongazione comune è quella che si vede
+    static float mean[SIM_RUN_TICKS];
+    for (int t = 0; t < SIM_RUN_TICKS; t++) {
+        float sum = 0.0f;
+        for (int i = 0; i < room->count; i++) sum += trace[i][t];
+        mean[t] = sum / room->count;
+    }
+
+    double sum = 0.0;
+    for (int t = SIM_RUN_TICKS - SIM_FINAL_TICKS; t < SIM_RUN_TICKS; t++) sum += mean[t];
+    float final = (float)(sum / SIM_FINAL_TICKS);
+
+    // Dopo il calo la luce risale verso il regime: l'eccesso è la sovraelongazione
+    int last_out = -1;
+    for (int t = 0; t < SIM_RUN_TICKS; t++) {
+        float dev = (mean[t] - final) / final;
+        if (100.0f * dev > res->overshoot) res->overshoot = 100.0f * dev;
+        if (fabsf(dev) > SIM_BAND) last_out = t;
+    }
+
+    res->settling_s = (last_out + 1) * SIM_TICK_MS / 1000.0f;
+    res->final_error = 100.0f * fabsf(final - SIM_TARGET_LUX) / SIM_TARGET_LUX;
+    res->travel /= room->count;
+}
+
+static void sim_accumulate(sim_result_t *acc, const sim_result_t *res, int runs)
+{
+    acc->overshoot += res->overshoot / runs;
+    acc->settling_s += res->settling_s / runs;
+    acc->final_error += res->final_error / runs;
+    acc->travel += res->travel / runs;
+}
+
+int main(int argc, char **argv)
+{
+    int cols = (argc > 2) ? atoi(argv[1]) : 3;
+    int rows = (argc > 2) ? atoi(argv[2]) : 2;
+    int runs = (argc > 3) ? atoi(argv[3]) : SIM_RUNS;
+    static const float steps[] = { 0.1f, 0.3f, 1.0f, 2.0f, 3.0f };
+    host_room_t room;
+
+    if (cols * rows < 1 || cols * rows > HOST_ROOM_MAX_NODES) {
+        fprintf(stderr, "Massimo %d nodi\n", HOST_ROOM_MAX_NODES);
+        return 1;
+    }
+
+    host_room_grid(&room, cols, rows, SIM_SPACING_M);
+
+    printf("Stanza %dx%d (passo %.1f m), target %d lux, finestra %.0f -> %.0f lux, media su %d seed\n\n",
+           cols, rows, SIM_SPACING_M, SIM_TARGET_LUX, SIM_WINDOW_BEFORE, SIM_WINDOW_AFTER, runs);
+    printf("%-9s %-9s %14s %16s %12s %12s\n",
+           "dimm_step", "Fasi", "Sovraelong. %", "Assestamento s", "Errore %", "Livelli/nodo");
+
+    for (size_t s = 0; s < sizeof(steps) / sizeof(steps[0]); s++) {
+        sim_result_t sync = { 0 }, stag = { 0 }, res;
+
+        for (int r = 0; r < runs; r++) {
+            sim_run(&room, false, steps[s], (uint32_t)r + 1, &res);
+            sim_accumulate(&sync, &res, runs);
+            sim_run(&room, true, steps[s], (uint32_t)r + 1, &res);
+            sim_accumulate(&stag, &res, runs);
+        }
+
+        printf("%-9.1f %-9s %14.1f %16.1f %12.1f %12.1f\n", steps[s], "sincrone",
+               sync.overshoot, sync.settling_s, sync.final_error, sync.travel);
+        printf("%-9s %-9s %14.1f %16.1f %12.1f %12.1f\n", "", "sfalsate",
+               stag.overshoot, stag.settling_s, stag.final_error, stag.travel);
+    }
+
+    return 0;
+}
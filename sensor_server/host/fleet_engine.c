@@ -0,0 +1,563 @@
+/**
+ * Firmware: ECOLUMIERE BLE MESH ESP32
+ * Tool host: Fleet Engine - Algoritmo su scala edificio (fino a 30.000 nodi)
+ * Descrizione: Stato dell'algoritmo di ogni nodo in layout structure-of-arrays
+ *              (un vettore allineato per campo), kernel di campionamento e di
+ *              controllo scritti come loop senza salti auto-vettorizzabili,
+ *              nodi divisi a blocchi fra tutti i core. Ogni blocco percorre
+ *              l'intero periodo restando in cache. Confronta l'energia della
+ *              configurazione attuale di ogni lampada con una nuova
+ *              configurazione di default applicata a tutta la flotta e
+ *              verifica bit per bit, su un campione di nodi, che il kernel
+ *              coincida con la catena scalare del firmware (medie e passo
+ *              di algo_core.c).
+ *
+ * Compilazione (da sensor_server/host):
+ *   gcc -O3 -ffp-contract=off -fno-trapping-math -Wall -pthread -I../ecolumiere \
+ *       -o fleet_engine fleet_engine.c ../ecolumiere/algo_core.c -lm
+ *   (aggiungere -march=native per AVX2/AVX-512. -ffp-contract=off impedisce
+ *    le FMA che romperebbero l'identità bit per bit con algo_core_step;
+ *    -fno-trapping-math permette di eseguire la divisione del ramo
+ *    enatural != 0 su tutte le corsie, senza cambiare i risultati)
+ *
+ * Uso: ./fleet_engine [-n nodi] [-d giorni] [-j thread] [-s seed] [-v passo_campione]
+ *
+ * Ipotesi: un ciclo da 5 s per passo, naturale e ambiente campionati ad ogni
+ * ciclo, passo di controllo ogni FLEET_ALGO_AVG cicli con divisore
+ * 2 x FLEET_ALGO_AVG come nel firmware, fade di un livello per ciclo.
+ * Il meteo è comune all'edificio, la luce naturale di ogni nodo dipende
+ * dalla distanza dalla finestra.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "host_common.h"
+#include "algo_core.h"
+#include "config.h"
+
+/************************************************
+ * PARAMETRI                                   *
+ ************************************************/
+
+#define FLEET_CYCLE_S           5
+#define FLEET_CYCLES_PER_DAY    (24 * 3600 / FLEET_CYCLE_S)
+#define FLEET_ALGO_AVG          10      // Profilo STABLE
+#define FLEET_ALGO_DIVIDER      (2 * FLEET_ALGO_AVG)
+#define FLEET_BLOCK             1024    // Nodi per blocco (stato in cache L2)
+#define FLEET_ALIGN             64
+#define FLEET_MAX_THREADS       64
+
+// Nuova configurazione di default da valutare (DEFALUT_* del firmware)
+#define FLEET_NEW_TARGET_LUX    400
+#define FLEET_NEW_EFFICIENCY    18.75f
+#define FLEET_NEW_DISTANCE      2.5f
+#define FLEET_NEW_DIMM_STEP     0.1f
+#define FLEET_NEW_PERC_MIN      0.20f
+#define FLEET_NEW_TRANSPARENCY  1.0f
+
+/************************************************
+ * STATO IN LAYOUT SOA                         *
+ ************************************************/
+
+/**
+ * @brief Stato della flotta, un vettore per campo
+ * @desc I campi di configurazione replicano algo_data_t; window e lamp_gain
+ *       descrivono la stanza reale del nodo (luce naturale relativa e lux al
+ *       sensore per livello della propria lampada).
+ */
+typedef struct {
+    uint32_t count;
+    // Configurazione (algo_data_t)
+    float *target;          // (float)target_lux
+    float *perc_min;
+    float *distance;
+    float *power_efficiency;
+    float *transparency;
+    float *dimm_step;
+    float *emax;
+    // Stato del passo di controllo
+    float *pnew;
+    float *enew;
+    float *enatural;
+    float *eenv;
+    // Catena di misura e lampada
+    uint32_t *natural_sum;
+    uint32_t *env_sum;
+    float *level;           // Livello applicato (dopo il fade)
+    float *level_target;    // (uint32_t)pnew richiesto a pwm_set_duty_cycle
+    double *energy;         // Somma dei livelli applicati
+    uint32_t *trace;        // Impronta dei pnew calcolati (verifica)
+    // Stanza reale
+    float *window;
+    float *lamp_gain;
+} fleet_t;
+
+/**
+ * @brief Meteo comune: luce in finestra per ciclo
+ */
+typedef struct {
+    uint32_t cycles;
+    float *window_lux;
+} fleet_weather_t;
+
+typedef struct {
+    fleet_t *fleet;
+    const fleet_weather_t *weather;
+    uint32_t next_block;    // Indice condiviso, incremento atomico
+} fleet_work_t;
+
+static void *fleet_alloc(size_t count, size_t size)
+{
+    size_t bytes = (count * size + FLEET_ALIGN - 1) / FLEET_ALIGN * FLEET_ALIGN;
+    void *p = aligned_alloc(FLEET_ALIGN, bytes);
+    if (p) memset(p, 0, bytes);
+    return p;
+}
+
+static void fleet_create(fleet_t *f, uint32_t count)
+{
+    memset(f, 0, sizeof(*f));
+    f->count = count;
+    f->target = fleet_alloc(count, sizeof(float));
+    f->perc_min = fleet_alloc(count, sizeof(float));
+    f->distance = fleet_alloc(count, sizeof(float));
+    f->power_efficiency = fleet_alloc(count, sizeof(float));
+    f->transparency = fleet_alloc(count, sizeof(float));
+    f->dimm_step = fleet_alloc(count, sizeof(float));
+    f->emax = fleet_alloc(count, sizeof(float));
+    f->pnew = fleet_alloc(count, sizeof(float));
+    f->enew = fleet_alloc(count, sizeof(float));
+    f->enatural = fleet_alloc(count, sizeof(float));
+    f->eenv = fleet_alloc(count, sizeof(float));
+    f->natural_sum = fleet_alloc(count, sizeof(uint32_t));
+    f->env_sum = fleet_alloc(count, sizeof(uint32_t));
+    f->level = fleet_alloc(count, sizeof(float));
+    f->level_target = fleet_alloc(count, sizeof(float));
+    f->energy = fleet_alloc(count, sizeof(double));
+    f->trace = fleet_alloc(count, sizeof(uint32_t));
+    f->window = fleet_alloc(count, sizeof(float));
+    f->lamp_gain = fleet_alloc(count, sizeof(float));
+}
+
+static void fleet_destroy(fleet_t *f)
+{
+    void *fields[] = { f->target, f->perc_min, f->distance, f->power_efficiency,
+                       f->transparency, f->dimm_step, f->emax, f->pnew, f->enew,
+                       f->enatural, f->eenv, f->natural_sum, f->env_sum, f->level,
+                       f->level_target, f->energy, f->trace, f->window, f->lamp_gain };
+    for (size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); i++) {
+        free(fields[i]);
+    }
+}
+
+/**
+ * @brief Impronta di un valore float (confronto bit per bit)
+ */
+static inline uint32_t fleet_trace_mix(uint32_t trace, float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return ((trace << 5) | (trace >> 27)) ^ bits;
+}
+
+/************************************************
+ * KERNEL VETTORIZZABILI                       *
+ ************************************************/
+
+/**
+ * @brief Campionamento, fade e consumo per i nodi [begin, end)
+ * @param sky: Luce in finestra del ciclo (comune all'edificio)
+ */
+static void fleet_kernel_sample(fleet_t *restrict f, uint32_t begin, uint32_t end, float sky)
+{
+    float *restrict level = f->level;
+    const float *restrict level_target = f->level_target;
+    const float *restrict window = f->window;
+    const float *restrict lamp_gain = f->lamp_gain;
+    uint32_t *restrict natural_sum = f->natural_sum;
+    uint32_t *restrict env_sum = f->env_sum;
+    double *restrict energy = f->energy;
+
+    // I vettori SoA non si sovrappongono: nessun controllo di aliasing a runtime
+    #pragma GCC ivdep
+    for (uint32_t i = begin; i < end; i++) {
+        float natural = sky * window[i];
+        float env = natural + level[i] * lamp_gain[i];
+
+        // Misure sempre positive: la conversione int32 coincide con uint32
+        natural_sum[i] += (uint32_t)(int32_t)natural;
+        env_sum[i] += (uint32_t)(int32_t)env;
+
+        // Fade: un livello per ciclo verso il livello richiesto
+        float step = level_target[i] - level[i];
+        step = (step > 1.0f) ? 1.0f : step;
+        step = (step < -1.0f) ? -1.0f : step;
+        level[i] += step;
+
+        energy[i] += level[i];
+    }
+}
+
+/**
+ * @brief Medie e passo di controllo per i nodi [begin, end)
+ * @desc Stesse operazioni, nello stesso ordine, di algo_core_avg_compute
+ *       (in_pl = 1), algo_core_avg_load e algo_core_step, con i rami
+ *       trasformati in selezioni.
+ */
+static void fleet_kernel_control(fleet_t *restrict f, uint32_t begin, uint32_t end)
+{
+    const float *restrict target = f->target;
+    const float *restrict perc_min = f->perc_min;
+    const float *restrict distance = f->distance;
+    const float *restrict power_efficiency = f->power_efficiency;
+    const float *restrict transparency = f->transparency;
+    const float *restrict dimm_step = f->dimm_step;
+    const float *restrict emax = f->emax;
+    float *restrict pnew = f->pnew;
+    float *restrict enew = f->enew;
+    float *restrict enatural = f->enatural;
+    float *restrict eenv = f->eenv;
+    float *restrict level_target = f->level_target;
+    uint32_t *restrict natural_sum = f->natural_sum;
+    uint32_t *restrict env_sum = f->env_sum;
+
+    #pragma GCC ivdep
+    for (uint32_t i = begin; i < end; i++) {
+        float d2 = distance[i] * distance[i];
+
+        // Medie (divisore ALGO_AVG_LAST); quozienti < 2^31: conversione via int32
+        float nat = (float)(int32_t)(natural_sum[i] / FLEET_ALGO_DIVIDER) / transparency[i];
+        float env = (float)(int32_t)(env_sum[i] / FLEET_ALGO_DIVIDER) * (d2 / transparency[i]);
+        env = (env < nat) ? nat : env;
+        natural_sum[i] = 0;
+        env_sum[i] = 0;
+
+        // A-B. Limite minimo e lux attuali della lampada
+        float emin = perc_min[i] * emax[i];
+        float elamp = (pnew[i] * power_efficiency[i] * transparency[i]) / d2;
+
+        // C. Variazione (ramo enatural != 0 come selezione, divisione sempre eseguita)
+        float error = target[i] - (elamp + env);
+        float scaled = (nat / target[i]) * dimm_step[i];
+        float gain = (nat != 0.0f) ? scaled : dimm_step[i];
+        float variation = error * gain;
+
+        // D. Nuovi lux con limite minimo
+        float e = elamp + variation;
+        e = (e < emin) ? emin : e;
+
+        // E-F. Livello con limite massimo
+        float p = (e * distance[i] * distance[i]) / (power_efficiency[i] * transparency[i]);
+        p = (p > LIGHT_MAX_LEVEL) ? (float)LIGHT_MAX_LEVEL : p;
+
+        enatural[i] = nat;
+        eenv[i] = env;
+        enew[i] = e;
+        pnew[i] = p;
+        level_target[i] = (float)(int32_t)p;   // pwm_set_duty_cycle((uint32_t)pnew)
+    }
+}
+
+/**
+ * @brief Aggiorna l'impronta dei pnew (fuori dal kernel: non vettorizzata)
+ */
+static void fleet_trace_update(fleet_t *f, uint32_t begin, uint32_t end)
+{
+    for (uint32_t i = begin; i < end; i++) {
+        f->trace[i] = fleet_trace_mix(f->trace[i], f->pnew[i]);
+    }
+}
+
+/************************************************
+ * ESECUZIONE PARALLELA                        *
+ ************************************************/
+
+/**
+ * @brief Percorre tutto il periodo per un blocco di nodi
+ */
+static void fleet_run_block(fleet_t *f, const fleet_weather_t *w, uint32_t begin, uint32_t end,
+                            bool trace)
+{
+    for (uint32_t cycle = 0; cycle < w->cycles; cycle++) {
+        fleet_kernel_sample(f, begin, end, w->window_lux[cycle]);
+        if ((cycle + 1) % FLEET_ALGO_AVG == 0) {
+            fleet_kernel_control(f, begin, end);
+            if (trace) fleet_trace_update(f, begin, end);
+        }
+    }
+}
+
+static void *fleet_worker(void *arg)
+{
+    fleet_work_t *work = (fleet_work_t *)arg;
+    uint32_t blocks = (work->fleet->count + FLEET_BLOCK - 1) / FLEET_BLOCK;
+
+    for (;;) {
+        uint32_t block = __atomic_fetch_add(&work->next_block, 1, __ATOMIC_RELAXED);
+        if (block >= blocks) break;
+
+        uint32_t begin = block * FLEET_BLOCK;
+        uint32_t end = begin + FLEET_BLOCK;
+        if (end > work->fleet->count) end = work->fleet->count;
+        fleet_run_block(work->fleet, work->weather, begin, end, true);
+    }
+    return NULL;
+}
+
+static double fleet_run(fleet_t *f, const fleet_weather_t *w, int threads)
+{
+    pthread_t ids[FLEET_MAX_THREADS];
+    fleet_work_t work = { .fleet = f, .weather = w, .next_block = 0 };
+
+    double t0 = host_time_s();
+    for (int i = 0; i < threads; i++) {
+        pthread_create(&ids[i], NULL, fleet_worker, &work);
+    }
+    for (int i = 0; i < threads; i++) {
+        pthread_join(ids[i], NULL);
+    }
+    return host_time_s() - t0;
+}
+
+/************************************************
+ * RIFERIMENTO SCALARE                         *
+ ************************************************/
+
+/**
+ * @brief Riesegue un nodo con algo_data_t e algo_core_step del firmware
+ * @return true se pnew, enew, livelli, energia e impronta coincidono bit per bit
+ */
+static bool fleet_verify_node(const fleet_t *f, const fleet_t *init, uint32_t i,
+                              const fleet_weather_t *w)
+{
+    algo_data_t algo;
+    algo_avg_t avg;
+    uint32_t trace = 0;
+    float level = init->level[i], level_target = init->level_target[i];
+    double energy = 0.0;
+
+    memset(&algo, 0, sizeof(algo));
+    algo.target_lux = (uint32_t)init->target[i];
+    algo.perc_min = init->perc_min[i];
+    algo.distance = init->distance[i];
+    algo.in_pl = 1;
+    algo.power_efficiency = init->power_efficiency[i];
+    algo.transparency = init->transparency[i];
+    algo.dimm_step = init->dimm_step[i];
+    algo.emax = init->emax[i];
+    algo.pnew = init->pnew[i];
+    memset(&avg, 0, sizeof(avg));
+    avg.size = FLEET_ALGO_AVG;
+
+    for (uint32_t cycle = 0; cycle < w->cycles; cycle++) {
+        float natural = w->window_lux[cycle] * init->window[i];
+        float env = natural + level * init->lamp_gain[i];
+
+        bool ready = algo_core_avg_add(&avg, (uint32_t)natural, (uint32_t)env);
+
+        if (level < level_target) level = (level_target - level > 1.0f) ? level + 1.0f : level_target;
+        else if (level > level_target) level = (level - level_target > 1.0f) ? level - 1.0f : level_target;
+        energy += level;
+
+        if (!ready) continue;
+
+        // Passi 7-8 di ecolumiere_algo_process
+        algo_core_avg_compute(&avg, &algo, FLEET_ALGO_DIVIDER);
+        algo_core_avg_load(&algo, &avg);
+        algo_core_step(&algo);
+
+        level_target = (float)(uint32_t)algo.pnew;
+        trace = fleet_trace_mix(trace, algo.pnew);
+    }
+
+    return memcmp(&algo.pnew, &f->pnew[i], sizeof(float)) == 0 &&
+           memcmp(&algo.enew, &f->enew[i], sizeof(float)) == 0 &&
+           memcmp(&level, &f->level[i], sizeof(float)) == 0 &&
+           memcmp(&energy, &f->energy[i], sizeof(double)) == 0 &&
+           trace == f->trace[i];
+}
+
+/************************************************
+ * SCENARIO                                    *
+ ************************************************/
+
+static void fleet_weather(fleet_weather_t *w, uint32_t days, uint32_t seed)
+{
+    host_rng_t rng;
+    float cloud = 1.0f;
+
+    host_rng_seed(&rng, seed);
+    w->cycles = days * FLEET_CYCLES_PER_DAY;
+    w->window_lux = (float *)malloc(w->cycles * sizeof(float));
+
+    for (uint32_t day = 0; day < days; day++) {
+        float day_peak = 600.0f + 900.0f * host_rng_uniform(&rng);
+        for (uint32_t c = 0; c < FLEET_CYCLES_PER_DAY; c++) {
+            float t_h = (float)(c * FLEET_CYCLE_S) / 3600.0f;
+            float x = (t_h - 6.0f) / 13.0f;
+            float sun = (x > 0.0f && x < 1.0f) ? sinf(3.14159265f * x) : 0.0f;
+
+            cloud += 0.01f * host_rng_gauss(&rng);
+            if (cloud < 0.2f) cloud = 0.2f;
+            if (cloud > 1.0f) cloud = 1.0f;
+            w->window_lux[day * FLEET_CYCLES_PER_DAY + c] = day_peak * sun * cloud;
+        }
+    }
+}
+
+/**
+ * @brief Popola la flotta: stanze e configurazioni attuali variano per nodo
+ * @param uniform: true applica la nuova configurazione di default a tutti
+ */
+static void fleet_populate(fleet_t *f, uint32_t seed, bool uniform)
+{
+    host_rng_t rng;
+    host_rng_seed(&rng, seed);
+
+    for (uint32_t i = 0; i < f->count; i++) {
+        // Stanza reale: sempre estratta, così le due flotte hanno le stesse stanze
+        f->window[i] = 0.05f + 0.6f * host_rng_uniform(&rng);
+        f->lamp_gain[i] = HOST_LAMP_LUX_PER_LEVEL * (0.7f + 0.6f * host_rng_uniform(&rng));
+
+        float target = (float)(300 + 50 * (host_rng_next(&rng) % 5));
+        float distance = 1.0f + 2.0f * host_rng_uniform(&rng);
+        float dimm_step = 0.05f + 0.25f * host_rng_uniform(&rng);
+        float perc_min = 0.01f + 0.2f * host_rng_uniform(&rng);
+        float transparency = 0.8f + 0.2f * host_rng_uniform(&rng);
+        float efficiency = 18.75f;
+
+        if (uniform) {
+            target = FLEET_NEW_TARGET_LUX;
+            distance = FLEET_NEW_DISTANCE;
+            dimm_step = FLEET_NEW_DIMM_STEP;
+            perc_min = FLEET_NEW_PERC_MIN;
+            transparency = FLEET_NEW_TRANSPARENCY;
+            efficiency = FLEET_NEW_EFFICIENCY;
+        }
+
+        f->target[i] = target;
+        f->distance[i] = distance;
+        f->dimm_step[i] = dimm_step;
+        f->perc_min[i] = perc_min;
+        f->transparency[i] = transparency;
+        f->power_efficiency[i] = efficiency;
+        // Come ecolumiere_update_algo_data
+        f->emax[i] = ((float)(LIGHT_MAX_LEVEL) * efficiency * transparency) / (distance * distance);
+        f->pnew[i] = 10.0f;
+        f->level[i] = 10.0f;
+        f->level_target[i] = 10.0f;
+    }
+}
+
+/**
+ * @brief Copia lo stato iniziale dei nodi di verifica
+ */
+static void fleet_snapshot(fleet_t *dst, const fleet_t *src)
+{
+    size_t n = src->count;
+    memcpy(dst->target, src->target, n * sizeof(float));
+    memcpy(dst->perc_min, src->perc_min, n * sizeof(float));
+    memcpy(dst->distance, src->distance, n * sizeof(float));
+    memcpy(dst->power_efficiency, src->power_efficiency, n * sizeof(float));
+    memcpy(dst->transparency, src->transparency, n * sizeof(float));
+    memcpy(dst->dimm_step, src->dimm_step, n * sizeof(float));
+    memcpy(dst->emax, src->emax, n * sizeof(float));
+    memcpy(dst->pnew, src->pnew, n * sizeof(float));
+    memcpy(dst->level, src->level, n * sizeof(float));
+    memcpy(dst->level_target, src->level_target, n * sizeof(float));
+    memcpy(dst->window, src->window, n * sizeof(float));
+    memcpy(dst->lamp_gain, src->lamp_gain, n * sizeof(float));
+}
+
+static double fleet_energy_kwh(const fleet_t *f, double watt_per_level)
+{
+    double level_cycles = 0.0;
+    for (uint32_t i = 0; i < f->count; i++) {
+        level_cycles += f->energy[i];
+    }
+    return level_cycles * watt_per_level * FLEET_CYCLE_S / 3600.0 / 1000.0;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t nodes = 30000, days = 30, seed = 12345u, stride = 997;
+    int threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:d:j:s:v:")) != -1) {
+        switch (opt) {
+        case 'n': nodes = (uint32_t)strtoul(optarg, NULL, 0); break;
+        case 'd': days = (uint32_t)strtoul(optarg, NULL, 0); break;
+        case 'j': threads = atoi(optarg); break;
+        case 's': seed = (uint32_t)strtoul(optarg, NULL, 0); break;
+        case 'v': stride = (uint32_t)strtoul(optarg, NULL, 0); break;
+        default:
+            fprintf(stderr, "uso: %s [-n nodi] [-d giorni] [-j thread] [-s seed] [-v passo]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (nodes == 0 || days == 0) return 1;
+    if (stride == 0) stride = 1;
+    if (threads < 1) threads = 1;
+    if (threads > FLEET_MAX_THREADS) threads = FLEET_MAX_THREADS;
+
+    fleet_weather_t weather;
+    fleet_t current, proposed, initial;
+    const char *names[] = { "Config attuale", "Nuovo default" };
+    fleet_t *fleets[] = { &current, &proposed };
+    double kwh[2];
+    uint32_t checked = 0, mismatches = 0;
+
+    fleet_weather(&weather, days, seed);
+    fleet_create(&current, nodes);
+    fleet_create(&proposed, nodes);
+    fleet_create(&initial, nodes);
+
+    printf("Flotta %lu nodi, %lu giorni (%lu cicli da %d s), %d thread, blocchi da %d\n",
+           (unsigned long)nodes, (unsigned long)days, (unsigned long)weather.cycles,
+           FLEET_CYCLE_S, threads, FLEET_BLOCK);
+
+    for (int k = 0; k < 2; k++) {
+        fleet_populate(fleets[k], seed * 31u + 7u, k == 1);
+        fleet_snapshot(&initial, fleets[k]);
+
+        double elapsed = fleet_run(fleets[k], &weather, threads);
+        double steps = (double)nodes * weather.cycles;
+        kwh[k] = fleet_energy_kwh(fleets[k], 1.0);
+
+        // Verifica bit per bit su un campione di nodi
+        uint32_t bad = 0, n = 0;
+        for (uint32_t i = 0; i < nodes; i += stride, n++) {
+            if (!fleet_verify_node(fleets[k], &initial, i, &weather)) bad++;
+        }
+        checked += n;
+        mismatches += bad;
+
+        printf("%-15s %8.2f s  %8.1f M passi-nodo/s  %7.1f M passi-controllo/s  "
+               "energia %.1f kWh (1 W/livello)  verifica %lu/%lu\n",
+               names[k], elapsed, steps / elapsed / 1e6,
+               steps / FLEET_ALGO_AVG / elapsed / 1e6, kwh[k],
+               (unsigned long)(n - bad), (unsigned long)n);
+    }
+
+    printf("\nVariazione energia con il nuovo default: %+.1f%%\n",
+           100.0 * (kwh[1] - kwh[0]) / kwh[0]);
+
+    fleet_destroy(&current);
+    fleet_destroy(&proposed);
+    fleet_destroy(&initial);
+    free(weather.window_lux);
+
+    if (mismatches) {
+        printf("ERRORE: %lu nodi su %lu differiscono dal riferimento scalare\n",
+               (unsigned long)mismatches, (unsigned long)checked);
+        return 1;
+    }
+    printf("Kernel SoA identico bit per bit ad algo_core_step su %lu nodi\n",
+           (unsigned long)checked);
+    return 0;
+}
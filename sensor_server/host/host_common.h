@@ -0,0 +1,195 @@
+/**
+ * Firmware: ECOLUMIERE BLE MESH ESP32
+ * Modulo: Host Common - Supporto comune ai tool di simulazione su PC
+ * Descrizione: Generatore pseudo-casuale deterministico, tempo, CRC, risposta
+ *              del sensore di luce e modello della stanza (lampade, sensori,
+ *              luce naturale) condivisi dai simulatori in host/. Solo header,
+ *              nessuna dipendenza ESP-IDF. Compilazione ed esecuzione dei
+ *              tool: README.md.
+ */
+
+#ifndef HOST_COMMON_H
+#define HOST_COMMON_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
+#include <time.h>
+
+/************************************************
+ * GENERATORE PSEUDO-CASUALE                   *
+ ************************************************/
+
+/**
+ * @brief Stato del generatore xorshift32 (mai zero)
+ */
+typedef struct {
+    uint32_t state;
+} host_rng_t;
+
+static inline void host_rng_seed(host_rng_t *rng, uint32_t seed)
+{
+    rng->state = seed ? seed : 0x9E3779B9u;
+}
+
+static inline uint32_t host_rng_next(host_rng_t *rng)
+{
+    uint32_t x = rng->state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    rng->state = x;
+    return x;
+}
+
+/**
+ * @brief Numero uniforme in [0, 1)
+ */
+static inline float host_rng_uniform(host_rng_t *rng)
+{
+    return (float)(host_rng_next(rng) >> 8) / 16777216.0f;
+}
+
+/**
+ * @brief Numero gaussiano a media nulla e varianza unitaria (Box-Muller)
+ */
+static inline float host_rng_gauss(host_rng_t *rng)
+{
+    float u1 = host_rng_uniform(rng);
+    float u2 = host_rng_uniform(rng);
+    if (u1 < 1e-7f) u1 = 1e-7f;
+    return sqrtf(-2.0f * logf(u1)) * cosf(6.2831853f * u2);
+}
+
+/************************************************
+ * TEMPO                                       *
+ ************************************************/
+
+/**
+ * @brief Tempo monotono in secondi (misure di prestazione dei tool)
+ */
+static inline double host_time_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/************************************************
+ * CRC                                         *
+ ************************************************/
+
+/**
+ * @brief CRC-16 compatibile con esp_rom_crc16_le (poly 0x1021 riflesso)
+ * @desc Stessa convenzione della ROM: valore iniziale e risultato invertiti,
+ *       quindi host_crc16_le(0xFFFF, ...) coincide con il CRC dei blob salvati.
+ */
+static inline uint16_t host_crc16_le(uint16_t crc, const uint8_t *buf, uint32_t len)
+{
+    crc = ~crc;
+    for (uint32_t i = 0; i < len; i++) {
+        crc ^= buf[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 1) ? (uint16_t)((crc >> 1) ^ 0x8408) : (uint16_t)(crc >> 1);
+        }
+    }
+    return (uint16_t)~crc;
+}
+
+/************************************************
+ * MODELLO DELLA STANZA                        *
+ ************************************************/
+
+#define HOST_ROOM_MAX_NODES     64
+#define HOST_LAMP_LUX_PER_LEVEL 18.75f  // POWER_EFFICIENCY: lux per livello a 1 m
+#define HOST_LAMP_HEIGHT_M      2.0f    // Altezza lampade sul piano di lavoro
+#define HOST_WINDOW_DECAY_M     3.0f    // Decadimento luce naturale dalla finestra
+
+/**
+ * @brief Stanza con lampade a griglia e finestra sul lato y = 0
+ * @field count: Numero di nodi (una lampada e un sensore per nodo)
+ * @field x/y: Posizione dei nodi (m)
+ * @field gain: Lux al sensore i per livello PWM della lampada j
+ */
+typedef struct {
+    int count;
+    float x[HOST_ROOM_MAX_NODES];
+    float y[HOST_ROOM_MAX_NODES];
+    float gain[HOST_ROOM_MAX_NODES][HOST_ROOM_MAX_NODES];
+} host_room_t;
+
+/**
+ * @brief Costruisce una stanza a griglia cols x rows con passo spacing
+ * @desc Il guadagno segue la legge del coseno: a distanza orizzontale nulla
+ *       vale HOST_LAMP_LUX_PER_LEVEL, come il modello fisico del firmware.
+ */
+static inline void host_room_grid(host_room_t *room, int cols, int rows, float spacing)
+{
+    const float h = HOST_LAMP_HEIGHT_M;
+
+    room->count = cols * rows;
+    for (int r = 0; r < rows; r++) {
+        for (int c = 0; c < cols; c++) {
+            int i = r * cols + c;
+            room->x[i] = spacing * (0.5f + c);
+            room->y[i] = spacing * (0.5f + r);
+        }
+    }
+
+    for (int i = 0; i < room->count; i++) {
+        for (int j = 0; j < room->count; j++) {
+            float dx = room->x[i] - room->x[j];
+            float dy = room->y[i] - room->y[j];
+            float d2 = dx * dx + dy * dy + h * h;
+            room->gain[i][j] = HOST_LAMP_LUX_PER_LEVEL * (h * h * h) / (d2 * sqrtf(d2));
+        }
+    }
+}
+
+/**
+ * @brief Luce naturale al nodo i con illuminamento in finestra window_lux
+ */
+static inline float host_room_natural(const host_room_t *room, int i, float window_lux)
+{
+    return window_lux * expf(-room->y[i] / HOST_WINDOW_DECAY_M);
+}
+
+/**
+ * @brief Luce prodotta dalle lampade al nodo i con i livelli indicati
+ */
+static inline float host_room_lamp(const host_room_t *room, int i, const float *levels)
+{
+    float lux = 0.0f;
+    for (int j = 0; j < room->count; j++) {
+        lux += room->gain[i][j] * levels[j];
+    }
+    return lux;
+}
+
+/************************************************
+ * SENSORE DI LUCE                             *
+ ************************************************/
+
+#define HOST_ADC_MAX_CODE       4095
+#define HOST_ADC_LSB_V          (3.3 / 4096.0)
+#define HOST_SENSOR_R_OHM       22000.0
+
+/**
+ * @brief Lux dalla media ADC con la formula di luxmeter_pickup (senza offset)
+ */
+static inline double host_lux_from_code(double code)
+{
+    double measure = ((HOST_ADC_MAX_CODE - code) * HOST_ADC_LSB_V) / HOST_SENSOR_R_OHM;
+    return pow(10.0, measure / 10e-6);
+}
+
+/**
+ * @brief Codice ADC (non arrotondato) che il sensore produce a lux
+ */
+static inline double host_code_from_lux(double lux)
+{
+    if (lux < 1.0) lux = 1.0;
+    return HOST_ADC_MAX_CODE - log10(lux) * 10e-6 * HOST_SENSOR_R_OHM / HOST_ADC_LSB_V;
+}
+
+#endif // HOST_COMMON_H
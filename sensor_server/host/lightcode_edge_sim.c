@@ -0,0 +1,225 @@
+/**
+ * Firmware: ECOLUMIERE BLE MESH ESP32
+ * Tool host: Lightcode Edge Sim - Decodifica del codice ottico dai fronti
+ * Descrizione: Sintetizza forme d'onda del sensore digitale (bit NRZ a
+ *              periodo variabile, codici ripetuti, jitter dei fronti e
+ *              impulsi spuri) come liste di fronti in µs, come le registra la
+ *              ISR di lightcode.c. Ogni lista viene decodificata direttamente
+ *              (light_code_decode_runs) e, campionata ogni 15 µs come il
+ *              polling originale, con filtro e scansione Nordic
+ *              (light_code_filter + light_code_decode_samples): i due codici
+ *              devono coincidere. Riporta tempi di decodifica e numero di
+ *              interruzioni contro le callback del polling.
+ *
+ * Compilazione (da sensor_server/host):
+ *   gcc -O2 -Wall -I../ecolumiere -o lightcode_edge_sim lightcode_edge_sim.c \
+ *       ../ecolumiere/lightcode_decode.c -lm
+ *
+ * Uso: ./lightcode_edge_sim [forme_d_onda] [seed]
+ *
+ * Ipotesi: campionatore ideale sulla griglia di 15 µs dall'armamento, storia
+ * del filtro uguale al livello all'armamento, fronti a risoluzione di 1 µs
+ * (esp_timer_get_time nella ISR). Una decodifica per slot device ID: con
+ * SLOT_COUNT 10 da 500 ms e divisore 1, una ogni 5 s.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "host_common.h"
+#include "lightcode_decode.h"
+
+/************************************************
+ * PARAMETRI DI SIMULAZIONE                    *
+ ************************************************/
+
+#define SIM_DEFAULT_WAVES       200000
+#define SIM_BIT_MIN_US          60
+#define SIM_BIT_MAX_US          160
+#define SIM_JITTER_US           4
+#define SIM_GLITCH_PROB         0.05f   // Per bit
+#define SIM_GLITCH_MAX_US       25
+#define SIM_CODE_PROB           0.5f    // Forme d'onda con codice ripetuto
+#define SIM_CODE_BITS           8
+#define SIM_DECODE_PERIOD_S     5.0     // Slot device ID
+#define SIM_MAX_EDGES           256
+
+/************************************************
+ * FORME D'ONDA                                *
+ ************************************************/
+
+/**
+ * @brief Forma d'onda: livello iniziale e istanti dei fronti (µs dall'armamento)
+ */
+typedef struct {
+    uint8_t first_level;
+    uint32_t count;
+    uint32_t edge_us[SIM_MAX_EDGES];
+} sim_wave_t;
+
+static void sim_push_edge(sim_wave_t *wave, uint32_t t_us)
+{
+    if (wave->count >= SIM_MAX_EDGES) return;
+    if (wave->count && t_us <= wave->edge_us[wave->count - 1]) return;  // Fronti sovrapposti dal jitter
+    if (t_us == 0) return;
+    wave->edge_us[wave->count++] = t_us;
+}
+
+/**
+ * @brief Bit NRZ a periodo costante, casuali o da un codice ripetuto
+ */
+static void sim_make_wave(host_rng_t *rng, sim_wave_t *wave)
+{
+    double bit_us = SIM_BIT_MIN_US + (SIM_BIT_MAX_US - SIM_BIT_MIN_US) * host_rng_uniform(rng);
+    bool coded = host_rng_uniform(rng) < SIM_CODE_PROB;
+    uint8_t code = (uint8_t)host_rng_next(rng);
+    double t = -bit_us * host_rng_uniform(rng);
+    uint32_t bit = host_rng_next(rng) % SIM_CODE_BITS;
+    uint8_t level = 0;
+
+    memset(wave, 0, sizeof(*wave));
+
+    for (int n = 0; t < LIGHT_CODE_CAPTURE_US + bit_us; n++, bit++, t += bit_us) {
+        uint8_t next = coded ? (code >> (SIM_CODE_BITS - 1 - bit % SIM_CODE_BITS)) & 1
+                             : (uint8_t)(host_rng_next(rng) & 1);
+
+        if (t <= 0.0) {
+            level = next;
+            wave->first_level = level;
+        } else if (next != level) {
+            double jitter = SIM_JITTER_US * (2.0 * host_rng_uniform(rng) - 1.0);
+            sim_push_edge(wave, (uint32_t)(t + jitter + 0.5));
+            level = next;
+        }
+
+        // Impulso spurio dentro il bit
+        if (host_rng_uniform(rng) < SIM_GLITCH_PROB) {
+            double at = t + bit_us * (0.2 + 0.6 * host_rng_uniform(rng));
+            uint32_t width = 1 + host_rng_next(rng) % SIM_GLITCH_MAX_US;
+            if (at > 0.0) {
+                sim_push_edge(wave, (uint32_t)at);
+                sim_push_edge(wave, (uint32_t)at + width);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Lista di fronti come la registra la ISR (ferma a fine finestra o a buffer pieno)
+ */
+static void sim_capture_runs(const sim_wave_t *wave, light_code_runs_t *runs)
+{
+    uint32_t last = 0;
+
+    memset(runs, 0, sizeof(*runs));
+    runs->first_level = wave->first_level;
+
+    for (uint32_t i = 0; i < wave->count; i++) {
+        uint32_t run = wave->edge_us[i] - last;
+        runs->run_us[runs->count++] = (run > UINT16_MAX) ? UINT16_MAX : (uint16_t)run;
+        last = wave->edge_us[i];
+
+        if (wave->edge_us[i] >= LIGHT_CODE_CAPTURE_US) break;
+        if (runs->count >= LIGHT_CODE_MAX_RUNS) {
+            runs->overflow = true;
+            break;
+        }
+    }
+}
+
+/**
+ * @brief Coda del polling: un campione ogni LIGHT_CODE_SAMPLE_US dall'armamento
+ */
+static void sim_sample(const sim_wave_t *wave, uint8_t *queue)
+{
+    uint8_t level = wave->first_level;
+    uint32_t e = 0;
+
+    for (uint32_t k = 0; k < SENSE_QUEUE_SIZE; k++) {
+        uint32_t t = k * LIGHT_CODE_SAMPLE_US;
+        while (e < wave->count && wave->edge_us[e] <= t) {
+            level ^= 1;
+            e++;
+        }
+        queue[k] = level;
+    }
+}
+
+/************************************************
+ * MAIN                                        *
+ ************************************************/
+
+int main(int argc, char **argv)
+{
+    int waves = (argc > 1) ? atoi(argv[1]) : SIM_DEFAULT_WAVES;
+    uint32_t seed = (argc > 2) ? (uint32_t)strtoul(argv[2], NULL, 0) : 1;
+    static sim_wave_t wave;
+    static light_code_runs_t *runs;
+    static uint8_t (*queues)[SENSE_QUEUE_SIZE];
+    static uint8_t *decoded;
+
+    host_rng_t rng;
+    host_rng_seed(&rng, seed);
+
+    runs = calloc(waves, sizeof(*runs));
+    queues = calloc(waves, sizeof(*queues));
+    decoded = calloc(waves, 1);
+    if (!runs || !queues || !decoded) return 1;
+
+    // Corpus: forme d'onda come lista di fronti e come coda campionata
+    uint64_t edges = 0;
+    int overflows = 0;
+    for (int w = 0; w < waves; w++) {
+        sim_make_wave(&rng, &wave);
+        sim_capture_runs(&wave, &runs[w]);
+        sim_sample(&wave, queues[w]);
+        edges += runs[w].count;
+        overflows += runs[w].overflow;
+    }
+
+    // Decodifica dai fronti
+    double t0 = host_time_s();
+    for (int w = 0; w < waves; w++) {
+        decoded[w] = light_code_decode_runs(&runs[w]);
+    }
+    double t_runs = host_time_s() - t0;
+
+    // Decodifica dalla coda campionata (filtro + scansione originali)
+    int mismatches = 0, valid = 0;
+    t0 = host_time_s();
+    for (int w = 0; w < waves; w++) {
+        uint8_t history[MEAN_SIZE];
+        memset(history, runs[w].first_level, sizeof(history));
+        light_code_filter(queues[w], history);
+        uint8_t code = light_code_decode_samples(queues[w]);
+
+        if (code != decoded[w] && !runs[w].overflow) {
+            if (mismatches++ < 5) {
+                printf("Differenza forma d'onda %d: fronti 0x%02X, campioni 0x%02X\n", w, decoded[w], code);
+            }
+        }
+        valid += (code != 0);
+    }
+    double t_samples = host_time_s() - t0;
+
+    printf("%d forme d'onda, seed %u: %d codici validi (%.1f%%), %d overflow\n",
+           waves, seed, valid, 100.0 * valid / waves, overflows);
+    printf("Decodifica fronti contro campioni: %d differenze\n\n", mismatches);
+
+    printf("Tempo su PC per acquisizione\n");
+    printf("  filtro + scansione campioni  %7.1f ns\n", 1e9 * t_samples / waves);
+    printf("  decodifica dei fronti        %7.1f ns  (%.1fx)\n", 1e9 * t_runs / waves, t_samples / t_runs);
+
+    double edges_per_capture = (double)edges / waves;
+    printf("\nInterruzioni contro polling (una acquisizione ogni %.0f s)\n", SIM_DECODE_PERIOD_S);
+    printf("  polling a %d us            %8d callback/s, sempre attive\n",
+           LIGHT_CODE_SAMPLE_US, 1000000 / LIGHT_CODE_SAMPLE_US);
+    printf("  fronti                      %8.1f ISR per acquisizione, %.2f ISR/s\n",
+           edges_per_capture, edges_per_capture / SIM_DECODE_PERIOD_S);
+
+    free(runs);
+    free(queues);
+    free(decoded);
+    return mismatches ? 1 : 0;
+}
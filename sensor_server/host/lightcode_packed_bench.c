@@ -0,0 +1,150 @@
+/**
+ * Firmware: ECOLUMIERE BLE MESH ESP32
+ * Tool host: Lightcode Packed Bench - Coda a byte contro coda compatta
+ * Descrizione: Genera un corpus di code di campioni del sensore digitale
+ *              (bit NRZ a periodo variabile, codici ripetuti, impulsi spuri,
+ *              livelli costanti) e le passa al filtro e alla scansione
+ *              originali a un byte per campione (light_code_filter +
+ *              light_code_decode_samples) e a quelli della coda compatta a
+ *              32 campioni per parola (light_code_filter_packed +
+ *              light_code_decode_packed), con la storia del filtro portata da
+ *              un frame al successivo. I codici devono coincidere frame per
+ *              frame; riporta tempo e cicli per frame dei due percorsi.
+ *
+ * Compilazione (da sensor_server/host):
+ *   gcc -O2 -Wall -I../ecolumiere -o lightcode_packed_bench lightcode_packed_bench.c \
+ *       ../ecolumiere/lightcode_decode.c -lm
+ *
+ * Uso: ./lightcode_packed_bench [frame] [seed]
+ *
+ * Ipotesi: cicli del contatore TSC su x86-64 (frequenza nominale), 0 su altre
+ * architetture. Sul dispositivo lo stesso confronto gira col comando
+ * LIGHTBENCH (cicli CPU di esp_cpu_get_cycle_count).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "host_common.h"
+#include "lightcode_decode.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define SIM_CYCLES()            __rdtsc()
+#else
+#define SIM_CYCLES()            0
+#endif
+
+/************************************************
+ * PARAMETRI DI SIMULAZIONE                    *
+ ************************************************/
+
+#define SIM_DEFAULT_FRAMES      200000
+#define SIM_PERIOD_MIN          4.0     // Campioni per bit
+#define SIM_PERIOD_MAX          11.0
+#define SIM_GLITCH_PROB         0.03f   // Per campione
+#define SIM_CONSTANT_PROB       0.1f    // Frame a livello costante
+#define SIM_CODE_PROB           0.5f    // Frame con codice ripetuto
+
+/************************************************
+ * CORPUS                                      *
+ ************************************************/
+
+static void sim_make_queue(host_rng_t *rng, uint8_t *queue)
+{
+    if (host_rng_uniform(rng) < SIM_CONSTANT_PROB) {
+        memset(queue, host_rng_next(rng) & 1, SENSE_QUEUE_SIZE);
+        return;
+    }
+
+    double period = SIM_PERIOD_MIN + (SIM_PERIOD_MAX - SIM_PERIOD_MIN) * host_rng_uniform(rng);
+    double phase = period * host_rng_uniform(rng);
+    bool coded = host_rng_uniform(rng) < SIM_CODE_PROB;
+    uint8_t code = (uint8_t)host_rng_next(rng);
+    uint32_t bit = host_rng_next(rng) % 8;
+    uint8_t level = (uint8_t)(host_rng_next(rng) & 1);
+    int last_cell = -1;
+
+    for (uint32_t i = 0; i < SENSE_QUEUE_SIZE; i++) {
+        int cell = (int)((i + phase) / period);
+        if (cell != last_cell) {
+            level = coded ? (code >> (7 - bit++ % 8)) & 1 : (uint8_t)(host_rng_next(rng) & 1);
+            last_cell = cell;
+        }
+        queue[i] = (host_rng_uniform(rng) < SIM_GLITCH_PROB) ? !level : level;
+    }
+}
+
+/************************************************
+ * MAIN                                        *
+ ************************************************/
+
+int main(int argc, char **argv)
+{
+    int frames = (argc > 1) ? atoi(argv[1]) : SIM_DEFAULT_FRAMES;
+    uint32_t seed = (argc > 2) ? (uint32_t)strtoul(argv[2], NULL, 0) : 1;
+
+    host_rng_t rng;
+    host_rng_seed(&rng, seed);
+
+    uint8_t (*queues)[SENSE_QUEUE_SIZE] = calloc(frames, sizeof(*queues));
+    uint32_t (*packed)[LIGHT_CODE_QUEUE_WORDS] = calloc(frames, sizeof(*packed));
+    uint8_t *code_bytes = calloc(frames, 1);
+    uint8_t *code_packed = calloc(frames, 1);
+    if (!queues || !packed || !code_bytes || !code_packed) return 1;
+
+    for (int f = 0; f < frames; f++) {
+        sim_make_queue(&rng, queues[f]);
+        light_code_pack(queues[f], packed[f]);
+    }
+
+    // Coda a byte (originale Nordic)
+    uint8_t history[MEAN_SIZE] = { 0 };
+    double t0 = host_time_s();
+    uint64_t c0 = SIM_CYCLES();
+    for (int f = 0; f < frames; f++) {
+        light_code_filter(queues[f], history);
+        code_bytes[f] = light_code_decode_samples(queues[f]);
+    }
+    uint64_t c_bytes = SIM_CYCLES() - c0;
+    double t_bytes = host_time_s() - t0;
+
+    // Coda compatta
+    uint32_t packed_history = 0;
+    t0 = host_time_s();
+    c0 = SIM_CYCLES();
+    for (int f = 0; f < frames; f++) {
+        light_code_filter_packed(packed[f], &packed_history);
+        code_packed[f] = light_code_decode_packed(packed[f]);
+    }
+    uint64_t c_packed = SIM_CYCLES() - c0;
+    double t_packed = host_time_s() - t0;
+
+    // Stessi codici frame per frame, e stessa coda filtrata
+    int mismatches = 0, filtered_diff = 0, valid = 0;
+    for (int f = 0; f < frames; f++) {
+        uint32_t repacked[LIGHT_CODE_QUEUE_WORDS];
+        light_code_pack(queues[f], repacked);
+        filtered_diff += memcmp(repacked, packed[f], sizeof(repacked)) != 0;
+
+        if (code_bytes[f] != code_packed[f] && mismatches++ < 5) {
+            printf("Differenza frame %d: byte 0x%02X, compatta 0x%02X\n", f, code_bytes[f], code_packed[f]);
+        }
+        valid += (code_bytes[f] != 0);
+    }
+
+    printf("%d frame, seed %u: %d codici validi (%.1f%%)\n", frames, seed, valid, 100.0 * valid / frames);
+    printf("Differenze: %d codici, %d code filtrate\n\n", mismatches, filtered_diff);
+    printf("%-24s  %10s  %14s  %s\n", "percorso", "ns/frame", "cicli/frame", "coda");
+    printf("%-24s  %10.1f  %14.0f  %3zu byte\n", "byte (Nordic)", 1e9 * t_bytes / frames,
+           (double)c_bytes / frames, (size_t)SENSE_QUEUE_SIZE);
+    printf("%-24s  %10.1f  %14.0f  %3zu byte  (%.1fx)\n", "compatta (clz)", 1e9 * t_packed / frames,
+           (double)c_packed / frames, LIGHT_CODE_QUEUE_WORDS * sizeof(uint32_t), t_bytes / t_packed);
+
+    free(queues);
+    free(packed);
+    free(code_bytes);
+    free(code_packed);
+    return (mismatches || filtered_diff) ? 1 : 0;
+}
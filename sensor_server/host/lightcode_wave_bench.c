@@ -0,0 +1,483 @@
+/**
+ * Firmware: ECOLUMIERE BLE MESH ESP32
+ * Tool host: Lightcode Wave Bench - Decodifica ottica su forme d'onda sintetiche
+ * Descrizione: Sintetizza l'uscita del sensore digitale a risoluzione di 1 µs:
+ *              trasmettitore (codice a 7 bit NRZ ripetuto oppure trame
+ *              lightframe in ripetizione) con deriva del periodo di bit,
+ *              jitter dei fronti e distorsione del duty, più sfarfallio della
+ *              luce ambiente a 100/120 Hz e rumore del sensore, confrontati
+ *              con la soglia del comparatore. Lo stesso segnale passa per i
+ *              percorsi di light_code_pickup() + light_code_check() del
+ *              firmware: polling ogni LIGHT_CODE_SAMPLE_US (coda compatta,
+ *              light_code_filter_packed + light_code_decode_packed) e
+ *              acquisizione a fronti, con lightcode_capture.c compilato così
+ *              com'è su una sorgente light_code_io_if_t simulata: ogni fronte
+ *              chiama light_code_on_edge() come la ISR, poi light_code_pickup(),
+ *              light_code_check() e light_code_get_frame() per le trame.
+ *              Riporta successi, codici errati, falsi positivi a
+ *              trasmettitore spento e tempo di decodifica per frame.
+ *
+ * Compilazione (da sensor_server/host):
+ *   gcc -O2 -Wall -I../ecolumiere -o lightcode_wave_bench lightcode_wave_bench.c \
+ *       ../ecolumiere/lightcode_capture.c ../ecolumiere/lightcode_decode.c \
+ *       ../ecolumiere/lightframe.c -lm
+ *
+ * Uso: ./lightcode_wave_bench [-n forme_d_onda] [-s seed] [-b bit_us] [-d deriva_%]
+ *          [-j jitter_us] [-f sfarfallio_hz] [-a ampiezza_sfarfallio] [-u duty_us]
+ *          [-r rumore]
+ *
+ * Ipotesi: ampiezze relative al codice (0 = spento, 1 = acceso, soglia a 0.5
+ * con isteresi SIM_HYSTERESIS, componente continua dell'ambiente già tolta
+ * dalla soglia), rumore gaussiano
+ * filtrato dalla banda del sensore (costante di tempo SIM_SENSOR_TAU_US),
+ * deriva uniforme in ±d% per forma d'onda, nessuna latenza della ISR, timer
+ * di sistema vicino al ritorno a zero dei 32 bit (SIM_CLOCK_START_US). Il
+ * riferimento del codice a 7 bit è la decodifica dello stesso codice, alla
+ * stessa fase, senza disturbi né deriva: le forme d'onda che non decodificano
+ * nemmeno così sono escluse. Periodo di campionamento e costanti del
+ * decodificatore vengono da lightcode_capture.h: ricompilando
+ * con valori diversi il confronto si ripete sugli stessi segnali (stesso seed).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "host_common.h"
+#include "lightcode_capture.h"
+
+/************************************************
+ * PARAMETRI DI SIMULAZIONE                    *
+ ************************************************/
+
+#define SIM_DEFAULT_WAVES       5000    // Per tipo di forma d'onda
+#define SIM_BATCH               500     // Forme d'onda decodificate per misura di tempo
+#define SIM_PRE_US              64      // Segnale prima dell'armamento (storia del filtro)
+#define SIM_SENSOR_TAU_US       5.0     // Banda del sensore sul rumore
+#define SIM_HYSTERESIS          0.1     // Isteresi del comparatore (soglie 0.4 / 0.6)
+#define SIM_CODE_BITS           8
+#define SIM_FRAME_IDLE_UNITS    2       // Riposo alto fra due trame ripetute
+#define SIM_MAX_EDGES           2048    // Fronti registrati per finestra di trame
+#define SIM_WINDOW_US           (LIGHT_CODE_FRAME_WINDOW_US)
+#define SIM_BUFFER_US           (SIM_PRE_US + SIM_WINDOW_US)
+#define SIM_CLOCK_START_US      0xFFFFF000u     // Armamento poco prima del ritorno a zero
+
+typedef enum {
+    SIM_TX_CODE,        ///< Codice a 7 bit NRZ ripetuto
+    SIM_TX_FRAME,       ///< Trame lightframe ripetute
+    SIM_TX_OFF,         ///< Nessun trasmettitore: solo ambiente e rumore
+    SIM_TX_KINDS
+} sim_tx_t;
+
+/**
+ * @brief Disturbi del canale (da riga di comando)
+ */
+typedef struct {
+    double bit_us;          // Periodo di bit del codice a 7 bit
+    double drift;           // Errore massimo del periodo di bit (frazione)
+    double jitter_us;       // Deviazione standard dei fronti
+    double flicker_hz;      // Sfarfallio dell'ambiente (0 = assente)
+    double flicker_amp;     // Ampiezza dello sfarfallio
+    double duty_us;         // Allungamento dei livelli alti
+    double noise;           // Deviazione standard del rumore
+} sim_params_t;
+
+/**
+ * @brief Ingressi dei decodificatori per una forma d'onda
+ * @field packed/history: Coda compatta del polling e storia del filtro
+ * @field first_level: Livello del pin all'armamento
+ * @field edge_us: Istanti dei fronti dall'armamento, fino a capture_us
+ */
+typedef struct {
+    uint32_t packed[LIGHT_CODE_QUEUE_WORDS];
+    uint32_t history;
+    uint8_t first_level;
+    uint16_t edge_count;
+    uint32_t edge_us[SIM_MAX_EDGES];
+    uint32_t capture_us;
+    uint8_t expected_code;
+    uint16_t expected_id;
+} sim_capture_t;
+
+/**
+ * @brief Risultati di un percorso di decodifica
+ */
+typedef struct {
+    uint32_t tries;         // Forme d'onda con trasmettitore e riferimento valido
+    uint32_t success;
+    uint32_t wrong;
+    uint32_t off_tries;     // Forme d'onda a trasmettitore spento
+    uint32_t false_pos;
+    double seconds;
+    uint32_t decodes;
+} sim_result_t;
+
+/************************************************
+ * SORGENTE DEL SENSORE (light_code_io_if_t)   *
+ ************************************************/
+
+static uint32_t sim_io_now_us;
+static uint8_t sim_io_level;
+static bool sim_io_irq;
+
+static uint8_t sim_io_read_level(void)
+{
+    return sim_io_level;
+}
+
+static uint32_t sim_io_now(void)
+{
+    return sim_io_now_us;
+}
+
+static void sim_io_edge_irq(bool enable)
+{
+    sim_io_irq = enable;
+}
+
+static void sim_io_nop(void)
+{
+}
+
+static const light_code_io_if_t sim_io = {
+    .name = "sim",
+    .read_level = sim_io_read_level,
+    .now_us = sim_io_now,
+    .edge_irq = sim_io_edge_irq,
+    .lock = sim_io_nop,
+    .unlock = sim_io_nop,
+};
+
+/************************************************
+ * CANALE                                      *
+ ************************************************/
+
+/**
+ * @brief Livello del trasmettitore per ogni µs del buffer (0 = SIM_PRE_US prima dell'armamento)
+ * @param ideal: Senza deriva, jitter e distorsione (riferimento)
+ */
+static void sim_render_tx(host_rng_t *rng, const sim_params_t *p, sim_tx_t kind, uint32_t value,
+                          double phase, double scale, bool ideal, uint8_t *tx)
+{
+    double edges[SIM_BUFFER_US / 20 + 64];
+    uint8_t levels[SIM_BUFFER_US / 20 + 64];
+    uint32_t n = 0;
+    double t = -phase;
+
+    if (kind == SIM_TX_OFF) {
+        memset(tx, value & 1, SIM_BUFFER_US);
+        return;
+    }
+
+    // Livelli del trasmettitore come coppie (inizio, livello)
+    if (kind == SIM_TX_CODE) {
+        double bit_us = p->bit_us * scale;
+        for (uint32_t bit = 0; t < SIM_BUFFER_US && n + 1 < sizeof(levels); bit++, t += bit_us) {
+            edges[n] = t;
+            levels[n++] = (value >> (SIM_CODE_BITS - 1 - bit % SIM_CODE_BITS)) & 1;
+        }
+    } else {
+        uint16_t run_us[LIGHT_FRAME_MAX_RUNS];
+        uint16_t runs = light_frame_encode((uint16_t)value, run_us);
+        while (t < SIM_BUFFER_US && n + runs + 1 < sizeof(levels)) {
+            uint8_t level = 1;
+            for (uint16_t r = 0; r < runs; r++, level ^= 1) {
+                edges[n] = t;
+                levels[n++] = level;
+                t += run_us[r] * scale;
+            }
+            edges[n] = t;
+            levels[n++] = 1;
+            t += SIM_FRAME_IDLE_UNITS * LIGHT_FRAME_HALF_US * scale;
+        }
+    }
+    edges[n] = SIM_BUFFER_US + 1.0;
+    levels[n] = levels[n - 1];
+
+    // Fronti: jitter gaussiano, fronti di discesa ritardati della distorsione di duty
+    for (uint32_t i = 1; i < n && !ideal; i++) {
+        if (levels[i] == levels[i - 1]) continue;
+        edges[i] += p->jitter_us * host_rng_gauss(rng) + (levels[i] ? 0.0 : p->duty_us);
+    }
+
+    uint32_t i = 0;
+    for (uint32_t us = 0; us < SIM_BUFFER_US; us++) {
+        while (i + 1 <= n && edges[i + 1] <= (double)us) i++;
+        tx[us] = levels[i];
+    }
+}
+
+/**
+ * @brief Uscita del comparatore: trasmettitore + sfarfallio + rumore contro la soglia
+ */
+static void sim_render_sensor(host_rng_t *rng, const sim_params_t *p, bool ideal, const uint8_t *tx, uint8_t *out)
+{
+    const double alpha = 1.0 / SIM_SENSOR_TAU_US;
+    const double gain = sqrt((2.0 - alpha) / alpha);    // Varianza del rumore filtrato = noise^2
+    double phase = 6.283185307 * host_rng_uniform(rng);
+    double w = 6.283185307 * p->flicker_hz * 1e-6;
+    double lp = 0.0;
+    uint8_t level = tx[0];
+
+    for (uint32_t us = 0; us < SIM_BUFFER_US; us++) {
+        double x = tx[us];
+        if (!ideal) {
+            if (p->noise > 0.0) {
+                lp += alpha * (gain * p->noise * host_rng_gauss(rng) - lp);
+                x += lp;
+            }
+            if (p->flicker_hz > 0.0) {
+                x += p->flicker_amp * sin(w * us + phase);
+            }
+        }
+        level = level ? (x > 0.5 - SIM_HYSTERESIS) : (x > 0.5 + SIM_HYSTERESIS);
+        out[us] = level;
+    }
+}
+
+/**
+ * @brief Ingressi dei decodificatori: coda del polling e fronti per la ISR
+ */
+static void sim_capture(const uint8_t *sensor, uint32_t capture_us, sim_capture_t *cap)
+{
+    const uint8_t *s = sensor + SIM_PRE_US;
+
+    // Polling: un campione ogni LIGHT_CODE_SAMPLE_US, storia dai tre campioni precedenti
+    memset(cap->packed, 0, sizeof(cap->packed));
+    for (uint32_t k = 0; k < SENSE_QUEUE_SIZE; k++) {
+        light_code_pack_sample(cap->packed, k, s[k * LIGHT_CODE_SAMPLE_US]);
+    }
+    cap->history = 0;
+    for (int k = 3; k >= 1; k--) {
+        cap->history = (cap->history << 1) | sensor[SIM_PRE_US - k * LIGHT_CODE_SAMPLE_US];
+    }
+
+    // ISR: fronti dall'armamento al pickup
+    cap->first_level = s[0];
+    cap->edge_count = 0;
+    cap->capture_us = capture_us;
+    for (uint32_t us = 1; us < capture_us && cap->edge_count < SIM_MAX_EDGES; us++) {
+        if (s[us] != s[us - 1]) {
+            cap->edge_us[cap->edge_count++] = us;
+        }
+    }
+}
+
+/**
+ * @brief Acquisizione a fronti del firmware: armamento, ISR a ogni fronte, pickup
+ */
+static void sim_replay(const sim_capture_t *cap)
+{
+    sim_io_now_us = SIM_CLOCK_START_US;
+    sim_io_level = cap->first_level;
+    light_code_reset_queue();
+
+    for (uint16_t e = 0; e < cap->edge_count; e++) {
+        sim_io_now_us = SIM_CLOCK_START_US + cap->edge_us[e];
+        sim_io_level ^= 1;
+        if (sim_io_irq) {
+            light_code_on_edge();
+        }
+    }
+
+    sim_io_now_us = SIM_CLOCK_START_US + cap->capture_us;
+    light_code_pickup();
+}
+
+/**
+ * @brief Codice a 7 bit del segnale ideale (riferimento)
+ */
+static uint8_t sim_reference_code(const uint8_t *sensor)
+{
+    static sim_capture_t cap;
+
+    sim_capture(sensor, LIGHT_CODE_CAPTURE_US, &cap);
+    light_code_filter_packed(cap.packed, &cap.history);
+    return light_code_decode_packed(cap.packed);
+}
+
+/************************************************
+ * DECODIFICA                                  *
+ ************************************************/
+
+static void sim_score(sim_result_t *res, sim_tx_t kind, uint32_t got, uint32_t expected)
+{
+    if (kind == SIM_TX_OFF) {
+        res->off_tries++;
+        res->false_pos += (got != 0);
+        return;
+    }
+    if (expected == 0) return;
+
+    res->tries++;
+    if (got == expected) {
+        res->success++;
+    } else if (got != 0) {
+        res->wrong++;
+    }
+}
+
+/**
+ * @brief Decodifica un lotto con i tre percorsi, misurando il tempo di ciascuno
+ * @desc I percorsi a 7 bit ricevono codici e trasmettitore spento, le trame
+ *       ricevono trame e trasmettitore spento. Il tempo dei fronti e delle
+ *       trame comprende ISR simulate e pickup.
+ */
+static void sim_decode_batch(sim_capture_t *caps, const sim_tx_t *kinds, uint32_t count, sim_result_t *res)
+{
+    uint32_t got[SIM_BATCH];
+
+    // Polling: filtro + scansione della coda compatta
+    double t0 = host_time_s();
+    for (uint32_t i = 0; i < count; i++) {
+        if (kinds[i] == SIM_TX_FRAME) continue;
+        light_code_filter_packed(caps[i].packed, &caps[i].history);
+        got[i] = light_code_decode_packed(caps[i].packed);
+        res[0].decodes++;
+    }
+    res[0].seconds += host_time_s() - t0;
+    for (uint32_t i = 0; i < count; i++) {
+        if (kinds[i] != SIM_TX_FRAME) sim_score(&res[0], kinds[i], got[i], caps[i].expected_code);
+    }
+
+    // Fronti: light_code_check() sulla lista dei livelli
+    t0 = host_time_s();
+    for (uint32_t i = 0; i < count; i++) {
+        if (kinds[i] == SIM_TX_FRAME) continue;
+        sim_replay(&caps[i]);
+        got[i] = light_code_check();
+        res[1].decodes++;
+    }
+    res[1].seconds += host_time_s() - t0;
+    for (uint32_t i = 0; i < count; i++) {
+        if (kinds[i] != SIM_TX_FRAME) sim_score(&res[1], kinds[i], got[i], caps[i].expected_code);
+    }
+
+    // Trame in streaming dalla ISR, un livello per fronte
+    t0 = host_time_s();
+    for (uint32_t i = 0; i < count; i++) {
+        light_frame_t frame;
+        if (kinds[i] == SIM_TX_CODE) continue;
+        sim_replay(&caps[i]);
+        got[i] = light_code_get_frame(&frame) ? frame.payload : LIGHT_FRAME_ID_NONE;
+        res[2].decodes++;
+    }
+    res[2].seconds += host_time_s() - t0;
+    for (uint32_t i = 0; i < count; i++) {
+        if (kinds[i] != SIM_TX_CODE) sim_score(&res[2], kinds[i], got[i], caps[i].expected_id);
+    }
+}
+
+/************************************************
+ * MAIN                                        *
+ ************************************************/
+
+int main(int argc, char **argv)
+{
+    sim_params_t p = {
+        .bit_us = 135.0,
+        .drift = 0.02,
+        .jitter_us = 3.0,
+        .flicker_hz = 100.0,
+        .flicker_amp = 0.3,
+        .duty_us = 10.0,
+        .noise = 0.05,
+    };
+    uint32_t waves = SIM_DEFAULT_WAVES, seed = 1;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:s:b:d:j:f:a:u:r:")) != -1) {
+        switch (opt) {
+        case 'n': waves = (uint32_t)strtoul(optarg, NULL, 0); break;
+        case 's': seed = (uint32_t)strtoul(optarg, NULL, 0); break;
+        case 'b': p.bit_us = atof(optarg); break;
+        case 'd': p.drift = atof(optarg) / 100.0; break;
+        case 'j': p.jitter_us = atof(optarg); break;
+        case 'f': p.flicker_hz = atof(optarg); break;
+        case 'a': p.flicker_amp = atof(optarg); break;
+        case 'u': p.duty_us = atof(optarg); break;
+        case 'r': p.noise = atof(optarg); break;
+        default:
+            fprintf(stderr, "uso: %s [-n forme_d_onda] [-s seed] [-b bit_us] [-d deriva_%%] [-j jitter_us]\n"
+                            "          [-f sfarfallio_hz] [-a ampiezza_sfarfallio] [-u duty_us] [-r rumore]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (waves == 0 || p.bit_us < 20.0) return 1;
+
+    host_rng_t rng;
+    host_rng_seed(&rng, seed);
+    light_code_capture_init(&sim_io);
+
+    sim_capture_t *caps = calloc(SIM_BATCH, sizeof(*caps));
+    uint8_t *tx = malloc(SIM_BUFFER_US);
+    uint8_t *sensor = malloc(SIM_BUFFER_US);
+    if (!caps || !tx || !sensor) return 1;
+
+    sim_tx_t kinds[SIM_BATCH];
+    sim_result_t res[3];
+    const char *names[3] = { "polling (coda compatta)", "fronti (ISR)", "trame (lightframe)" };
+    uint32_t total = waves * SIM_TX_KINDS, unreadable = 0, filled = 0;
+    memset(res, 0, sizeof(res));
+
+    printf("%lu forme d'onda per tipo, seed %lu, campionamento %d us, trama T = %d us\n",
+           (unsigned long)waves, (unsigned long)seed, LIGHT_CODE_SAMPLE_US, LIGHT_FRAME_HALF_US);
+    printf("Bit %.0f us, deriva ±%.1f%%, jitter %.1f us, duty +%.1f us, sfarfallio %.0f Hz x %.2f, rumore %.2f\n\n",
+           p.bit_us, 100.0 * p.drift, p.jitter_us, p.duty_us, p.flicker_hz, p.flicker_amp, p.noise);
+
+    for (uint32_t w = 0; w < total; w++) {
+        sim_tx_t kind = (sim_tx_t)(w % SIM_TX_KINDS);
+        sim_capture_t *cap = &caps[filled];
+        uint32_t value;
+        double phase, scale = 1.0 + p.drift * (2.0 * host_rng_uniform(&rng) - 1.0);
+
+        if (kind == SIM_TX_CODE) {
+            value = host_rng_next(&rng) & 0xFF;
+            phase = SIM_CODE_BITS * p.bit_us * host_rng_uniform(&rng);
+        } else if (kind == SIM_TX_FRAME) {
+            value = 1 + host_rng_next(&rng) % 0xFFFF;
+            phase = (LIGHT_FRAME_US + SIM_FRAME_IDLE_UNITS * LIGHT_FRAME_HALF_US) * host_rng_uniform(&rng);
+        } else {
+            value = host_rng_next(&rng) & 1;
+            phase = 0.0;
+        }
+
+        cap->expected_code = 0;
+        cap->expected_id = (kind == SIM_TX_FRAME) ? (uint16_t)value : LIGHT_FRAME_ID_NONE;
+        if (kind == SIM_TX_CODE) {
+            sim_render_tx(&rng, &p, kind, value, phase, 1.0, true, tx);
+            sim_render_sensor(&rng, &p, true, tx, sensor);
+            cap->expected_code = sim_reference_code(sensor);
+            unreadable += (cap->expected_code == 0);
+        }
+
+        sim_render_tx(&rng, &p, kind, value, phase, scale, false, tx);
+        sim_render_sensor(&rng, &p, false, tx, sensor);
+        sim_capture(sensor, (kind == SIM_TX_CODE) ? LIGHT_CODE_CAPTURE_US : SIM_WINDOW_US, cap);
+        kinds[filled++] = kind;
+
+        if (filled == SIM_BATCH || w == total - 1) {
+            sim_decode_batch(caps, kinds, filled, res);
+            filled = 0;
+        }
+    }
+
+    printf("Codici a 7 bit non decodificabili anche senza disturbi: %lu su %lu (esclusi)\n\n",
+           (unsigned long)unreadable, (unsigned long)waves);
+    printf("%-24s  %9s  %9s  %9s  %14s  %12s\n", "percorso", "successo", "errati", "persi", "falsi positivi", "ns/frame");
+    for (int k = 0; k < 3; k++) {
+        sim_result_t *r = &res[k];
+        double tries = r->tries ? r->tries : 1;
+        printf("%-24s  %8.2f%%  %8.2f%%  %8.2f%%  %13.2f%%  %12.1f\n", names[k],
+               100.0 * r->success / tries, 100.0 * r->wrong / tries,
+               100.0 * (r->tries - r->success - r->wrong) / tries,
+               r->off_tries ? 100.0 * r->false_pos / r->off_tries : 0.0,
+               r->decodes ? 1e9 * r->seconds / r->decodes : 0.0);
+    }
+
+    free(caps);
+    free(tx);
+    free(sensor);
+    return 0;
+}
@@ -0,0 +1,255 @@
+/**
+ * Firmware: ECOLUMIERE BLE MESH ESP32
+ * Tool host: Lightframe Sim - Trame ottiche con errori iniettati
+ * Descrizione: Trasmette con l'encoder del firmware (lightframe.c) flussi di
+ *              trame con identificativi casuali, separate da riposi alti di
+ *              durata casuale, con jitter dei fronti, distorsione del duty e
+ *              due tipi di errore iniettato: mezzi bit invertiti (violazioni
+ *              Manchester) e bit interi invertiti (codifica valida, solo il
+ *              CRC può accorgersene). Il decodificatore in streaming riceve
+ *              le durate dei livelli come dalla ISR. Riporta trame ricevute,
+ *              trame accettate con identificativo sbagliato e confidenza.
+ *              Misura infine i falsi positivi su ingresso casuale (durate
+ *              casuali, PWM della lampada a 1 kHz) per il decodificatore a
+ *              trame e per il codice a 7 bit originale (light_code_decode_runs).
+ *
+ * Compilazione (da sensor_server/host):
+ *   gcc -O2 -Wall -I../ecolumiere -o lightframe_sim lightframe_sim.c \
+ *       ../ecolumiere/lightframe.c ../ecolumiere/lightcode_decode.c -lm
+ *
+ * Uso: ./lightframe_sim [trame_per_livello] [seed]
+ *
+ * Ipotesi: jitter gaussiano dei fronti 5 µs, livelli alti allungati di 10 µs
+ * (fronti del driver LED), errori indipendenti per mezzo bit o per bit. Il
+ * rumore casuale equivale a un'ora di ingresso senza trasmettitori.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "host_common.h"
+#include "lightframe.h"
+#include "lightcode_decode.h"
+
+/************************************************
+ * PARAMETRI DI SIMULAZIONE                    *
+ ************************************************/
+
+#define SIM_DEFAULT_FRAMES      20000
+#define SIM_JITTER_US           5.0
+#define SIM_DUTY_US             10.0    // Allungamento dei livelli alti
+#define SIM_IDLE_MAX_UNITS      20      // Riposo alto fra due trame
+#define SIM_REPEATS             3       // Trasmissioni consecutive di ogni identificativo
+#define SIM_CONFIRM_REPEATS     2       // Trama confermata: stessa trama ripetuta
+#define SIM_NOISE_SECONDS       3600.0
+#define SIM_NOISE_RUN_MIN_US    10.0
+#define SIM_NOISE_RUN_MAX_US    1000.0
+#define SIM_PWM_PERIOD_US       1000.0
+
+static const double sim_error_rates[] = { 0.0, 1e-3, 3e-3, 1e-2, 3e-2, 1e-1 };
+#define SIM_RATES               (sizeof(sim_error_rates) / sizeof(sim_error_rates[0]))
+
+typedef enum {
+    SIM_FLIP_HALF,      ///< Mezzi bit invertiti
+    SIM_FLIP_BIT,       ///< Bit interi invertiti
+    SIM_FLIP_KINDS
+} sim_flip_t;
+
+static const char *flip_names[SIM_FLIP_KINDS] = { "mezzi bit", "bit interi" };
+
+/************************************************
+ * CANALE                                      *
+ ************************************************/
+
+/**
+ * @brief Ricevitore: livelli con jitter e distorsione, consegnati al decodificatore
+ */
+typedef struct {
+    light_frame_decoder_t dec;
+    uint8_t level;
+    double run_us;
+    double skew_us;     // Spostamento dell'ultimo fronte
+    int received;
+    int confirmed;
+    int wrong;
+    int wrong_confirmed;
+    int confidence_sum;
+    uint16_t expected;
+    uint16_t previous;  // L'ultima trama si chiude al fronte del preambolo successivo
+} sim_rx_t;
+
+static void sim_rx_level(sim_rx_t *rx, host_rng_t *rng, uint8_t level, double duration_us)
+{
+    if (level == rx->level) {
+        rx->run_us += duration_us;
+        return;
+    }
+
+    // Fronte: jitter e allungamento degli alti
+    double skew = SIM_JITTER_US * host_rng_gauss(rng) + (rx->level ? SIM_DUTY_US : 0.0);
+    double measured = rx->run_us + skew - rx->skew_us;
+    rx->skew_us = skew;
+    if (measured < 1.0) measured = 1.0;
+
+    light_frame_t frame;
+    if (light_frame_feed(&rx->dec, rx->level, (uint32_t)(measured + 0.5), &frame)) {
+        if (frame.payload == rx->expected || frame.payload == rx->previous) {
+            rx->received++;
+            rx->confirmed += (frame.repeats >= SIM_CONFIRM_REPEATS);
+            rx->confidence_sum += frame.confidence;
+        } else {
+            rx->wrong++;
+            rx->wrong_confirmed += (frame.repeats >= SIM_CONFIRM_REPEATS);
+        }
+    }
+
+    rx->level = level;
+    rx->run_us = duration_us;
+}
+
+/**
+ * @brief Trasmette una trama come mezzi bit, con errori iniettati
+ */
+static void sim_send_frame(sim_rx_t *rx, host_rng_t *rng, uint16_t payload, sim_flip_t kind, double rate)
+{
+    uint16_t run_us[LIGHT_FRAME_MAX_RUNS];
+    uint16_t runs = light_frame_encode(payload, run_us);
+    uint8_t halves[LIGHT_FRAME_UNITS];
+    uint32_t n = 0;
+    uint8_t level = 1;
+
+    for (uint16_t r = 0; r < runs; r++, level ^= 1) {
+        for (uint32_t u = 0; u < run_us[r] / LIGHT_FRAME_HALF_US; u++) halves[n++] = level;
+    }
+
+    // Errori solo dopo il preambolo
+    for (uint32_t h = 2 * LIGHT_FRAME_SYNC_UNITS; h < n; h++) {
+        if (kind == SIM_FLIP_HALF) {
+            if (host_rng_uniform(rng) < rate) halves[h] ^= 1;
+        } else if (((h - 2 * LIGHT_FRAME_SYNC_UNITS) & 1) == 0 && host_rng_uniform(rng) < rate) {
+            halves[h] ^= 1;
+            halves[h + 1] ^= 1;
+        }
+    }
+
+    rx->previous = rx->expected;
+    rx->expected = payload;
+    for (uint32_t h = 0; h < n; h++) sim_rx_level(rx, rng, halves[h], LIGHT_FRAME_HALF_US);
+}
+
+/************************************************
+ * FALSI POSITIVI                              *
+ ************************************************/
+
+/**
+ * @brief Trame accettate e codici a 7 bit su un'ora di ingresso senza trasmettitori
+ * @param pwm: PWM della lampada con duty casuale invece di durate casuali
+ */
+static void sim_noise(host_rng_t *rng, bool pwm, uint32_t *frames, uint32_t *legacy, uint32_t *captures)
+{
+    light_frame_decoder_t dec;
+    memset(&dec, 0, sizeof(dec));
+    light_frame_decoder_reset(&dec);
+
+    light_code_runs_t capture;
+    double capture_t = 0.0, t = 0.0, duty = 0.5;
+    uint8_t level = 1;
+
+    *frames = *legacy = *captures = 0;
+    memset(&capture, 0, sizeof(capture));
+    capture.first_level = level;
+
+    while (t < SIM_NOISE_SECONDS * 1e6) {
+        double run;
+        if (pwm) {
+            if (level == 1 && host_rng_uniform(rng) < 0.01f) duty = 0.05 + 0.9 * host_rng_uniform(rng);
+            run = SIM_PWM_PERIOD_US * (level ? duty : 1.0 - duty) + SIM_JITTER_US * host_rng_gauss(rng);
+        } else {
+            run = SIM_NOISE_RUN_MIN_US * pow(SIM_NOISE_RUN_MAX_US / SIM_NOISE_RUN_MIN_US, host_rng_uniform(rng));
+        }
+        if (run < 1.0) run = 1.0;
+
+        light_frame_t frame;
+        *frames += light_frame_feed(&dec, level, (uint32_t)run, &frame);
+
+        // Acquisizioni a 7 bit da 1.8 ms una dopo l'altra
+        if (capture.count < LIGHT_CODE_MAX_RUNS) {
+            capture.run_us[capture.count++] = (uint16_t)((t + run - capture_t > UINT16_MAX) ? UINT16_MAX : run);
+        }
+        t += run;
+        level ^= 1;
+        while (t - capture_t >= LIGHT_CODE_CAPTURE_US) {
+            *legacy += light_code_decode_runs(&capture) != 0;
+            (*captures)++;
+            capture_t += LIGHT_CODE_CAPTURE_US;
+            memset(&capture, 0, sizeof(capture));
+            capture.first_level = level;
+            if (t - capture_t < LIGHT_CODE_CAPTURE_US) {
+                capture.run_us[capture.count++] = (uint16_t)(t - capture_t);
+                capture.first_level = !level;
+            }
+        }
+    }
+}
+
+/************************************************
+ * MAIN                                        *
+ ************************************************/
+
+int main(int argc, char **argv)
+{
+    int frames = (argc > 1) ? atoi(argv[1]) : SIM_DEFAULT_FRAMES;
+    uint32_t seed = (argc > 2) ? (uint32_t)strtoul(argv[2], NULL, 0) : 1;
+    uint32_t total_wrong = 0;
+
+    host_rng_t rng;
+    host_rng_seed(&rng, seed);
+
+    printf("%d trame per livello di errore, seed %u, T = %d us, trama %d us\n",
+           frames, seed, LIGHT_FRAME_HALF_US, LIGHT_FRAME_US);
+    printf("Jitter %.0f us, alti allungati di %.0f us, riposo alto 0..%d T fra le trame\n\n",
+           SIM_JITTER_US, SIM_DUTY_US, SIM_IDLE_MAX_UNITS);
+    printf("Ogni identificativo trasmesso %d volte di seguito; confermata = ripetuta almeno %d volte\n\n",
+           SIM_REPEATS, SIM_CONFIRM_REPEATS);
+    printf("%-11s %8s  %10s  %10s  %-17s %10s  %s\n", "errori", "tasso", "ricevute", "confermate",
+           "id errato / conf.", "confidenza", "violazioni / CRC");
+
+    for (int kind = 0; kind < SIM_FLIP_KINDS; kind++) {
+        for (size_t r = 0; r < SIM_RATES; r++) {
+            sim_rx_t rx;
+            memset(&rx, 0, sizeof(rx));
+            light_frame_decoder_reset(&rx.dec);
+            rx.level = 1;
+
+            uint16_t payload = 0;
+            for (int f = 0; f < frames; f++) {
+                if (f % SIM_REPEATS == 0) payload = (uint16_t)(1 + host_rng_next(&rng) % 0xFFFF);
+                sim_send_frame(&rx, &rng, payload, (sim_flip_t)kind, sim_error_rates[r]);
+
+                // Riposo alto, unito al preambolo della trama successiva
+                uint32_t idle = host_rng_next(&rng) % (SIM_IDLE_MAX_UNITS + 1);
+                sim_rx_level(&rx, &rng, 1, idle * LIGHT_FRAME_HALF_US);
+            }
+            sim_rx_level(&rx, &rng, 1, LIGHT_FRAME_US);
+            sim_rx_level(&rx, &rng, 0, LIGHT_FRAME_HALF_US);
+
+            printf("%-11s %8.0e  %9.2f%%  %9.2f%%  %8d / %-6d %10.1f  %u / %u\n", flip_names[kind], sim_error_rates[r],
+                   100.0 * rx.received / frames, 100.0 * rx.confirmed / frames, rx.wrong, rx.wrong_confirmed,
+                   rx.received ? (double)rx.confidence_sum / rx.received : 0.0,
+                   rx.dec.stats.violations, rx.dec.stats.crc_errors);
+            total_wrong += rx.wrong_confirmed;
+        }
+    }
+
+    printf("\nFalsi positivi su %.0f s senza trasmettitori\n", SIM_NOISE_SECONDS);
+    printf("%-22s  %-14s  %s\n", "ingresso", "trame valide", "codici a 7 bit non nulli");
+    for (int pwm = 0; pwm <= 1; pwm++) {
+        uint32_t fp_frames, fp_legacy, captures;
+        sim_noise(&rng, pwm, &fp_frames, &fp_legacy, &captures);
+        printf("%-22s  %-14u  %u su %u acquisizioni (%.2f%%)\n", pwm ? "PWM lampada 1 kHz" : "durate casuali",
+               fp_frames, fp_legacy, captures, 100.0 * fp_legacy / captures);
+    }
+
+    return total_wrong ? 1 : 0;
+}
@@ -0,0 +1,187 @@
+/**
+ * Firmware: ECOLUMIERE BLE MESH ESP32
+ * Tool host: Lux Filter Bench - Stimatori robusti della finestra del luxmeter
+ * Descrizione: Applica gli stimatori del firmware (luxmeter_adc.c: media,
+ *              mediana, media troncata, Hampel) a finestre sintetiche di 45
+ *              campioni: rumore gaussiano, picchi isolati, ondulazione di rete
+ *              a 50 Hz campionata a 100 Hz e rimbalzi del PWM su campioni
+ *              consecutivi. Riporta l'errore rispetto al livello vero e il
+ *              costo per finestra (ns e, su x86, cicli).
+ *
+ * Compilazione (da sensor_server/host):
+ *   gcc -O2 -Wall -I../ecolumiere -o lux_filter_bench lux_filter_bench.c \
+ *       ../ecolumiere/luxmeter_adc.c -lm
+ *
+ * Uso: ./lux_filter_bench [finestre] [seed]
+ *
+ * Ipotesi: livello vero fra i codici 2800 e 3800, rumore 3 LSB. I picchi
+ * colpiscono il 10% dei campioni con +-150..400 codici; i rimbalzi del PWM
+ * spostano di 60 codici un blocco di 4 campioni consecutivi. I cicli su x86
+ * indicano solo il costo relativo: l'ESP32 non ha unità SIMD e il nucleo
+ * intero non ne usa.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "host_common.h"
+#include "luxmeter_adc.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define SIM_HAVE_TSC 1
+#else
+#define SIM_HAVE_TSC 0
+#endif
+
+/************************************************
+ * PARAMETRI DI SIMULAZIONE                    *
+ ************************************************/
+
+#define SIM_DEFAULT_WINDOWS     200000
+#define SIM_CODE_MIN            2800
+#define SIM_CODE_MAX            3800
+#define SIM_NOISE_LSB           3.0f
+#define SIM_SPIKE_PROB          0.10f
+#define SIM_SPIKE_MIN           150
+#define SIM_SPIKE_MAX           400
+#define SIM_RIPPLE_LSB          25.0f   // Ondulazione di rete vista dal sensore
+#define SIM_PWM_BURST           4       // Campioni consecutivi del rimbalzo PWM
+#define SIM_PWM_STEP            60
+
+typedef enum {
+    SIM_CLEAN,
+    SIM_SPIKES,
+    SIM_RIPPLE,
+    SIM_PWM,
+    SIM_SCENARIOS
+} sim_scenario_t;
+
+static const char *scenario_names[SIM_SCENARIOS] = { "rumore", "picchi 10%", "rete 50 Hz", "rimbalzo PWM" };
+
+/************************************************
+ * FINESTRE SINTETICHE                         *
+ ************************************************/
+
+/**
+ * @brief Campione decimato in codici fini, come luxmeter_window_feed
+ */
+static uint16_t sim_clamp(float code)
+{
+    if (code < 0.0f) code = 0.0f;
+    if (code > LUXMETER_ADC_MAX_CODE) code = LUXMETER_ADC_MAX_CODE;
+    return (uint16_t)(code * LUXMETER_CODE_ONE + 0.5f);
+}
+
+/**
+ * @brief Riempie una finestra e restituisce il livello vero
+ */
+static float sim_window(host_rng_t *rng, sim_scenario_t scenario, uint16_t *samples)
+{
+    float level = SIM_CODE_MIN + (SIM_CODE_MAX - SIM_CODE_MIN) * host_rng_uniform(rng);
+    float phase = 6.2831853f * host_rng_uniform(rng);
+    int burst = (int)(host_rng_uniform(rng) * (LUXMETER_WINDOW_SAMPLES - SIM_PWM_BURST));
+
+    for (int i = 0; i < LUXMETER_WINDOW_SAMPLES; i++) {
+        float code = level + SIM_NOISE_LSB * host_rng_gauss(rng);
+
+        switch (scenario) {
+            case SIM_SPIKES:
+                if (host_rng_uniform(rng) < SIM_SPIKE_PROB) {
+                    float spike = SIM_SPIKE_MIN + (SIM_SPIKE_MAX - SIM_SPIKE_MIN) * host_rng_uniform(rng);
+                    code += (host_rng_next(rng) & 1) ? spike : -spike;
+                }
+                break;
+            case SIM_RIPPLE:
+                // 50 Hz a 100 Hz: segno alterno, ampiezza fissata dalla fase
+                code += SIM_RIPPLE_LSB * sinf(phase + 3.14159265f * i);
+                break;
+            case SIM_PWM:
+                if (i >= burst && i < burst + SIM_PWM_BURST) code += SIM_PWM_STEP;
+                break;
+            default:
+                break;
+        }
+        samples[i] = sim_clamp(code);
+    }
+
+    return level;
+}
+
+/************************************************
+ * MAIN                                        *
+ ************************************************/
+
+int main(int argc, char **argv)
+{
+    long windows = (argc > 1) ? atol(argv[1]) : SIM_DEFAULT_WINDOWS;
+    uint32_t seed = (argc > 2) ? (uint32_t)strtoul(argv[2], NULL, 0) : 1;
+
+    printf("%ld finestre per scenario, seed %u - errore in codici ADC (1 codice ~ 0.85%% lux)\n\n",
+           windows, seed);
+    printf("%-14s", "stimatore");
+    for (int s = 0; s < SIM_SCENARIOS; s++) printf("  %-22s", scenario_names[s]);
+    printf("\n%-14s", "");
+    for (int s = 0; s < SIM_SCENARIOS; s++) printf("  %-22s", "rms / p99.9 / max");
+    printf("\n");
+
+    static uint16_t samples[SIM_DEFAULT_WINDOWS][LUXMETER_WINDOW_SAMPLES];
+    static float truth[SIM_DEFAULT_WINDOWS];
+    if (windows > SIM_DEFAULT_WINDOWS) windows = SIM_DEFAULT_WINDOWS;
+
+    double cost_ns[LUXMETER_FILTER_COUNT] = { 0 };
+    double cost_cycles[LUXMETER_FILTER_COUNT] = { 0 };
+
+    for (int f = 0; f < LUXMETER_FILTER_COUNT; f++) {
+        printf("%-14s", luxmeter_filter_name((luxmeter_filter_t)f));
+
+        for (int s = 0; s < SIM_SCENARIOS; s++) {
+            host_rng_t rng;
+            host_rng_seed(&rng, seed * 31u + (uint32_t)s);
+            for (long w = 0; w < windows; w++) truth[w] = sim_window(&rng, (sim_scenario_t)s, samples[w]);
+
+            // Istogramma degli errori a passi di 0.25 codici
+            static uint32_t hist[4096];
+            memset(hist, 0, sizeof(hist));
+            double sq = 0.0;
+            float max_err = 0.0f;
+            uint32_t sink = 0;
+
+            double t0 = host_time_s();
+#if SIM_HAVE_TSC
+            uint64_t c0 = __rdtsc();
+#endif
+            for (long w = 0; w < windows; w++) {
+                uint16_t est = luxmeter_window_estimate(samples[w], (luxmeter_filter_t)f);
+                float err = fabsf((float)est / LUXMETER_CODE_ONE - truth[w]);
+                int bin = (int)(err * 4.0f);
+                hist[bin < 4095 ? bin : 4095]++;
+                sq += (double)err * err;
+                if (err > max_err) max_err = err;
+                sink += est;
+            }
+#if SIM_HAVE_TSC
+            cost_cycles[f] += (double)(__rdtsc() - c0) / windows;
+#endif
+            cost_ns[f] += 1e9 * (host_time_s() - t0) / windows;
+            if (sink == 0) printf(" ");
+
+            uint32_t target = (uint32_t)(0.999 * windows), acc = 0;
+            int p999 = 0;
+            while (p999 < 4095 && (acc += hist[p999]) < target) p999++;
+
+            printf("  %5.2f / %5.2f / %6.1f  ", sqrt(sq / windows), (p999 + 1) / 4.0f, max_err);
+        }
+        printf("\n");
+    }
+
+    printf("\nCosto medio per finestra (stima inclusa l'analisi dell'errore):\n");
+    for (int f = 0; f < LUXMETER_FILTER_COUNT; f++) {
+        printf("  %-10s %7.1f ns", luxmeter_filter_name((luxmeter_filter_t)f), cost_ns[f] / SIM_SCENARIOS);
+        if (SIM_HAVE_TSC) printf("  %7.0f cicli", cost_cycles[f] / SIM_SCENARIOS);
+        printf("\n");
+    }
+
+    return 0;
+}
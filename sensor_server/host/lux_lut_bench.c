@@ -0,0 +1,189 @@
+/**
+ * Firmware: ECOLUMIERE BLE MESH ESP32
+ * Tool host: Lux LUT Bench - Tabella codice ADC → lux contro pow()
+ * Descrizione: Confronta su tutto il campo ADC (0..4095) la conversione a
+ *              tabella del firmware (lux_lut.c, 513 nodi con interpolazione
+ *              sui codici fini) con la formula originale di luxmeter_pickup, che
+ *              memorizza la misura in float e calcola pow(10, x) in doppia
+ *              precisione, anche con la compensazione di offset_map a ogni
+ *              livello PWM. Misura poi il tempo per conversione dei due metodi.
+ *
+ * Compilazione (da sensor_server/host):
+ *   gcc -O2 -Wall -I../ecolumiere -o lux_lut_bench lux_lut_bench.c \
+ *       ../ecolumiere/lux_lut.c -lm
+ *
+ * Uso: ./lux_lut_bench [conversioni]
+ *
+ * Ipotesi: sul PC il double è in hardware; sull'ESP32 pow() in doppia
+ * precisione è emulato in software, quindi il rapporto reale è più alto di
+ * quello misurato qui. Un codice ADC vale circa lo 0.85% di lux.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "host_common.h"
+#include "lux_lut.h"
+
+/************************************************
+ * PARAMETRI DI SIMULAZIONE                    *
+ ************************************************/
+
+#define SIM_DEFAULT_CONVERSIONS 10000000
+#define SIM_REALISTIC_MAX_LUX   200000u // Oltre la luce solare diretta
+#define SIM_LOW_LUX             500u    // Sotto: errore in lux assoluti (troncamento intero)
+#define SIM_INTERP_BOUND        0.0006  // (ln 10^(8 codici))^2 / 8: errore della corda
+#define SIM_LEVELS              33
+
+// offset_map di luxmeter.c
+static const uint8_t offset_map[SIM_LEVELS] = {
+    0, 8, 10, 12, 11, 14, 17, 11, 14, 15, 18, 19, 21, 22, 22, 22,
+    22, 22, 22, 21, 21, 22, 23, 24, 25, 26, 27, 28, 30, 31, 33, 34, 38
+};
+
+/************************************************
+ * FORMULA ORIGINALE                           *
+ ************************************************/
+
+/**
+ * @brief Misura come luxmeter_process_adc_buffer (salvata in float)
+ */
+static float ref_measure(uint16_t code)
+{
+    return (float)(((double)(HOST_ADC_MAX_CODE - code) * HOST_ADC_LSB_V) / HOST_SENSOR_R_OHM);
+}
+
+/**
+ * @brief Lux e offset come luxmeter_pickup prima della tabella
+ * @return false se pow() esce dal campo di uint32_t (conversione indefinita)
+ */
+static bool ref_pickup(uint16_t code, uint16_t pwm_level, uint32_t *lux)
+{
+    double value = pow(10.0, ref_measure(code) / 10e-6);
+    if (value >= (double)UINT32_MAX) return false;
+
+    uint32_t lux_value = (uint32_t)value;
+    uint32_t offset = (offset_map[pwm_level] > lux_value) ? lux_value : offset_map[pwm_level];
+    *lux = lux_value - offset;
+    return true;
+}
+
+/************************************************
+ * MAIN                                        *
+ ************************************************/
+
+int main(int argc, char **argv)
+{
+    long conversions = (argc > 1) ? atol(argv[1]) : SIM_DEFAULT_CONVERSIONS;
+    lux_lut_t lut;
+
+    lux_lut_build(&lut, HOST_ADC_LSB_V, HOST_SENSOR_R_OHM);
+
+    // 1. Accuratezza su tutto il campo, livello 0 (nessun offset)
+    double max_rel = 0.0, max_rel_real = 0.0, sum_rel = 0.0;
+    uint32_t max_abs_low = 0, worst_code = 0;
+    int exact = 0, compared = 0, saturated = 0, realistic = 0, relative = 0, out_of_bound = 0;
+
+    for (int code = 0; code <= HOST_ADC_MAX_CODE; code++) {
+        uint32_t ref, lux = lux_lut_lookup(&lut, (uint16_t)(code << LUX_LUT_FRAC_BITS));
+
+        if (!ref_pickup((uint16_t)code, 0, &ref)) {
+            saturated++;
+            continue;
+        }
+        compared++;
+
+        uint32_t diff = (lux > ref) ? lux - ref : ref - lux;
+        if (diff == 0) exact++;
+        if (diff > 1 + SIM_INTERP_BOUND * ref) out_of_bound++;
+
+        if (ref < SIM_LOW_LUX) {
+            if (diff > max_abs_low) max_abs_low = diff;
+            continue;
+        }
+
+        double rel = (double)diff / ref;
+        sum_rel += rel;
+        relative++;
+        if (rel > max_rel) max_rel = rel;
+
+        if (ref <= SIM_REALISTIC_MAX_LUX) {
+            realistic++;
+            if (rel > max_rel_real) {
+                max_rel_real = rel;
+                worst_code = (uint32_t)code;
+            }
+        }
+    }
+
+    printf("Tabella: %d nodi, un nodo ogni %d codici, %zu byte\n\n",
+           LUX_LUT_KNOTS, LUX_LUT_STEP, sizeof(lut.knots));
+    printf("Accuratezza contro pow() su %d codici confrontabili (%d oltre UINT32_MAX):\n",
+           compared, saturated);
+    printf("  identici                    %d (%.1f%%)\n", exact, 100.0 * exact / compared);
+    printf("  sotto %u lux               errore massimo %u lux\n", SIM_LOW_LUX, max_abs_low);
+    printf("  da %u lux in su            errore relativo medio %.3f%%, massimo %.3f%%\n",
+           SIM_LOW_LUX, 100.0 * sum_rel / relative, 100.0 * max_rel);
+    printf("  da %u a %u lux (%d codici)  massimo %.3f%% al codice %u\n",
+           SIM_LOW_LUX, SIM_REALISTIC_MAX_LUX, realistic, 100.0 * max_rel_real, worst_code);
+    printf("  oltre 1 lux + %.2f%%        %d codici\n", 100.0 * SIM_INTERP_BOUND, out_of_bound);
+
+    // 2. Compensazione di offset a ogni livello PWM
+    uint32_t offset_diff_max = 0;
+    int offset_mismatch = 0;
+    for (int level = 0; level < SIM_LEVELS; level++) {
+        for (int code = 0; code <= HOST_ADC_MAX_CODE; code++) {
+            uint32_t ref;
+            if (!ref_pickup((uint16_t)code, (uint16_t)level, &ref)) continue;
+
+            uint32_t lux = lux_lut_compensated(&lut, (uint16_t)(code << LUX_LUT_FRAC_BITS), offset_map[level]);
+            uint32_t plain = lux_lut_lookup(&lut, (uint16_t)(code << LUX_LUT_FRAC_BITS));
+            uint32_t plain_ref = 0;
+            ref_pickup((uint16_t)code, 0, &plain_ref);
+
+            // Scarto dovuto alla compensazione, oltre a quello della tabella
+            int32_t extra = (int32_t)(lux - ref) - (int32_t)(plain - plain_ref);
+            if (ref > 0 && lux > 0 && extra != 0) offset_mismatch++;
+            if ((uint32_t)abs(extra) > offset_diff_max) offset_diff_max = (uint32_t)abs(extra);
+        }
+    }
+    printf("\nCompensazione offset_map su %d livelli: %d differenze oltre la tabella "
+           "(solo vicino a zero lux), massimo %u lux\n", SIM_LEVELS, offset_mismatch, offset_diff_max);
+
+    // 3. Tempo per conversione
+    uint16_t *codes = malloc(4096 * sizeof(uint16_t));
+    host_rng_t rng;
+    host_rng_seed(&rng, 1);
+    for (int i = 0; i < 4096; i++) codes[i] = (uint16_t)(2700 + host_rng_next(&rng) % 1396);
+
+    volatile uint32_t sink = 0;
+    uint32_t acc = 0;
+    double t0 = host_time_s();
+    for (long i = 0; i < conversions; i++) {
+        acc += (uint32_t)pow(10.0, ref_measure(codes[i & 4095]) / 10e-6);
+    }
+    double t_pow = host_time_s() - t0;
+    sink = acc;
+
+    acc = 0;
+    t0 = host_time_s();
+    for (long i = 0; i < conversions; i++) {
+        acc += lux_lut_lookup(&lut, (uint16_t)(codes[i & 4095] << LUX_LUT_FRAC_BITS));
+    }
+    double t_lut = host_time_s() - t0;
+    sink += acc;
+    (void)sink;
+
+    double t_build0 = host_time_s();
+    for (int i = 0; i < 1000; i++) lux_lut_build(&lut, HOST_ADC_LSB_V, HOST_SENSOR_R_OHM);
+    double t_build = (host_time_s() - t_build0) / 1000.0;
+
+    printf("\nTempo su PC (%ld conversioni, codici fra 1 e 100k lux):\n", conversions);
+    printf("  pow() double   %6.1f ns/conversione\n", 1e9 * t_pow / conversions);
+    printf("  tabella        %6.1f ns/conversione  (%.1fx)\n",
+           1e9 * t_lut / conversions, t_pow / t_lut);
+    printf("  costruzione    %6.1f us una tantum\n", 1e6 * t_build);
+
+    free(codes);
+    return (out_of_bound == 0) ? 0 : 1;
+}
@@ -0,0 +1,131 @@
+/**
+ * Firmware: ECOLUMIERE BLE MESH ESP32
+ * Tool host: Lux Resolution Sim - Risoluzione del luxmeter a bassa luce
+ * Descrizione: Passa alla finestra del firmware (luxmeter_adc.c) conversioni
+ *              rumorose alla frequenza della scansione continua, con luce
+ *              casuale (log-uniforme) in bande da crepuscolo a piena luce, e
+ *              confronta i lux della tabella (lux_lut.c) letti dal codice fine
+ *              della finestra con quelli letti dal solo codice intero, come
+ *              prima dei codici fini. Riporta errore medio e massimo per banda
+ *              e il passo fra due letture adiacenti.
+ *
+ * Compilazione (da sensor_server/host):
+ *   gcc -O2 -Wall -I../ecolumiere -o lux_resolution_sim lux_resolution_sim.c \
+ *       ../ecolumiere/luxmeter_adc.c ../ecolumiere/lux_lut.c -lm
+ *
+ * Uso: ./lux_resolution_sim [finestre_per_banda] [seed]
+ *
+ * Ipotesi: luce costante durante la finestra, rumore del sensore 2 LSB per
+ * conversione, stimatore Hampel. L'uscita in lux resta intera (troncata),
+ * quindi sotto circa 100 lux il passo di 1 lux domina comunque. Il sensore è
+ * logaritmico (1 codice ~ 0.85% lux) e occupa 2.2..3.3 V fra 1 e 100k lux:
+ * solo l'attenuazione da 12 dB ne copre il campo.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "host_common.h"
+#include "luxmeter_adc.h"
+#include "lux_lut.h"
+
+/************************************************
+ * PARAMETRI DI SIMULAZIONE                    *
+ ************************************************/
+
+#define SIM_RATE_HZ             19310   // LUX_ADC_LUX_RATE_HZ
+#define SIM_FRAME               965     // Conversioni luce per frame da 50 ms
+#define SIM_NOISE_LSB           2.0
+#define SIM_DEFAULT_WINDOWS     200
+
+// Bande di luce [min, max) in lux
+static const double sim_bands[][2] = {
+    { 10.0, 100.0 }, { 100.0, 300.0 }, { 300.0, 1000.0 }, { 1000.0, 10000.0 }, { 10000.0, 80000.0 }
+};
+#define SIM_BANDS               (sizeof(sim_bands) / sizeof(sim_bands[0]))
+
+/************************************************
+ * FINESTRA                                    *
+ ************************************************/
+
+/**
+ * @brief Una finestra completa a luce costante
+ * @return Codice fine stimato dalla finestra
+ */
+static uint16_t sim_window(host_rng_t *rng, luxmeter_window_t *window, double code_truth)
+{
+    static uint16_t frame[SIM_FRAME];
+
+    luxmeter_window_reset(window);
+    for (;;) {
+        for (uint32_t i = 0; i < SIM_FRAME; i++) {
+            double code = code_truth + SIM_NOISE_LSB * host_rng_gauss(rng);
+            if (code < 0.0) code = 0.0;
+            if (code > HOST_ADC_MAX_CODE) code = HOST_ADC_MAX_CODE;
+            frame[i] = (uint16_t)(code + 0.5);
+        }
+        if (luxmeter_window_feed(window, frame, SIM_FRAME) != 0) return window->mean;
+    }
+}
+
+/************************************************
+ * MAIN                                        *
+ ************************************************/
+
+int main(int argc, char **argv)
+{
+    int windows = (argc > 1) ? atoi(argv[1]) : SIM_DEFAULT_WINDOWS;
+    uint32_t seed = (argc > 2) ? (uint32_t)strtoul(argv[2], NULL, 0) : 1;
+    static luxmeter_window_t window;
+    lux_lut_t lut;
+    int worse = 0;
+
+    host_rng_t rng;
+    host_rng_seed(&rng, seed);
+    lux_lut_build(&lut, HOST_ADC_LSB_V, HOST_SENSOR_R_OHM);
+    luxmeter_window_init(&window, SIM_RATE_HZ);
+    luxmeter_window_set_filter(&window, LUXMETER_FILTER_HAMPEL);
+
+    printf("%d finestre per banda, %d Hz, rumore %.0f LSB, seed %u\n", windows, SIM_RATE_HZ, SIM_NOISE_LSB, seed);
+    printf("Errore relativo dei lux (medio / massimo) e passo fra letture adiacenti al centro della banda\n\n");
+    printf("%-14s  %-30s  %-30s\n", "lux", "codice intero", "codice fine");
+
+    for (size_t b = 0; b < SIM_BANDS; b++) {
+        double lo = sim_bands[b][0], hi = sim_bands[b][1];
+        double sum[2] = { 0 }, max[2] = { 0 };
+
+        for (int n = 0; n < windows; n++) {
+            double truth = lo * pow(hi / lo, host_rng_uniform(&rng));
+            uint16_t fine = sim_window(&rng, &window, host_code_from_lux(truth));
+
+            // Codice intero: la stessa stima arrotondata al codice ADC
+            uint16_t whole = (uint16_t)(((fine + LUXMETER_CODE_ONE / 2) >> LUXMETER_CODE_FRAC_BITS) << LUXMETER_CODE_FRAC_BITS);
+            uint32_t lux[2] = { lux_lut_lookup(&lut, whole), lux_lut_lookup(&lut, fine) };
+
+            for (int k = 0; k < 2; k++) {
+                double err = fabs(lux[k] - truth) / truth;
+                sum[k] += err;
+                if (err > max[k]) max[k] = err;
+            }
+        }
+
+        // Passo al centro della banda: codice adiacente o 1 lux dell'uscita intera
+        double mid = sqrt(lo * hi), code_mid = host_code_from_lux(mid);
+        double step[2] = {
+            host_lux_from_code(code_mid - 1.0) - mid,
+            host_lux_from_code(code_mid - 1.0 / LUXMETER_CODE_ONE) - mid
+        };
+
+        printf("%5.0f..%-6.0f ", lo, hi);
+        for (int k = 0; k < 2; k++) {
+            if (step[k] < 1.0) step[k] = 1.0;
+            printf("  %5.2f%% / %5.2f%%  passo %5.2f%%", 100.0 * sum[k] / windows, 100.0 * max[k], 100.0 * step[k] / mid);
+        }
+        printf("\n");
+
+        if (sum[1] > sum[0]) worse = 1;
+    }
+
+    return worse;
+}
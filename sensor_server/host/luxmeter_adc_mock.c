@@ -0,0 +1,345 @@
+/**
+ * Firmware: ECOLUMIERE BLE MESH ESP32
+ * Tool host: Luxmeter ADC Mock - Sorgente ADC simulata per la finestra del luxmeter
+ * Descrizione: Implementa luxmeter_adc_if_t su PC e consegna alla finestra del
+ *              firmware (luxmeter_adc.c) flussi di codici registrati o
+ *              sintetici, a frame come il driver continuo. Verifica che la
+ *              sorgente a 100 Hz dia esattamente le medie dell'algoritmo
+ *              originale (buffer da 45, media 20..42, parte intera del
+ *              codice fine) con qualunque
+ *              suddivisione in frame, poi confronta oneshot da timer e
+ *              continua a 20 kHz su una lampada con PWM a 1 kHz: errore sui
+ *              lux della finestra e callback al secondo.
+ *
+ * Compilazione (da sensor_server/host):
+ *   gcc -O2 -Wall -I../ecolumiere -o luxmeter_adc_mock luxmeter_adc_mock.c \
+ *       ../ecolumiere/luxmeter_adc.c -lm
+ *
+ * Uso: ./luxmeter_adc_mock [seed]
+ *      ./luxmeter_adc_mock registrazione.txt [conversioni_al_secondo]
+ *      La registrazione contiene un codice ADC a 12 bit per riga; senza
+ *      conversioni_al_secondo si assume il driver continuo (20 kHz).
+ *
+ * Ipotesi: timer software e LEDC derivano dallo stesso quarzo, quindi la
+ * lettura oneshot cade sempre alla stessa fase del PWM (più 30 us di jitter
+ * del timer daemon); la fase iniziale è casuale a ogni avvio. Rumore del
+ * sensore 2 LSB. Riferimento: lux della media di tutte le conversioni della
+ * parte mediata della finestra.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "host_common.h"
+#include "luxmeter_adc.h"
+
+/************************************************
+ * PARAMETRI DI SIMULAZIONE                    *
+ ************************************************/
+
+#define SIM_CONT_RATE_HZ        20000   // LUX_ADC_SAMPLE_FREQ_HZ
+#define SIM_CONT_FRAME          1000    // LUX_ADC_FRAME_CONV
+#define SIM_PWM_HZ              1000.0
+#define SIM_PWM_LEVELS          32
+#define SIM_NATURAL_LUX         100.0
+#define SIM_NOISE_LSB           2.0f
+#define SIM_TIMER_JITTER_US     30.0f
+#define SIM_SECONDS             45      // 100 finestre
+#define SIM_RUNS                20      // Avvii con fase PWM diversa
+#define SIM_EQ_SAMPLES          100000  // Campioni della verifica di equivalenza
+#define SIM_EQ_MAX_FRAME        44      // Al più una finestra completata per frame
+#define SIM_MAX_WINDOWS         4096
+#define SIM_MAX_RECORD          (4 * 1024 * 1024)
+
+/************************************************
+ * SORGENTE MOCK                               *
+ ************************************************/
+
+/**
+ * @brief Stato della sorgente simulata
+ * @field frame: Conversioni per callback (0 = casuale 1..SIM_EQ_MAX_FRAME)
+ * @field callbacks: Callback consegnate (risvegli della CPU)
+ */
+typedef struct {
+    luxmeter_adc_cb_t cb;
+    bool running;
+    uint32_t frame;
+    uint32_t callbacks;
+    host_rng_t rng;
+} mock_state_t;
+
+static mock_state_t mock;
+
+static bool mock_init(luxmeter_adc_cb_t cb)
+{
+    mock.cb = cb;
+    mock.callbacks = 0;
+    return true;
+}
+
+static bool mock_start(void)
+{
+    mock.running = true;
+    return true;
+}
+
+static void mock_stop(void)
+{
+    mock.running = false;
+}
+
+static luxmeter_adc_if_t mock_source = {
+    .name = "mock",
+    .rate_hz = SIM_CONT_RATE_HZ,
+    .init = mock_init,
+    .start = mock_start,
+    .stop = mock_stop,
+};
+
+/**
+ * @brief Consegna un flusso di codici a frame come il driver
+ */
+static void mock_deliver(const uint16_t *codes, uint32_t count)
+{
+    uint32_t pos = 0;
+
+    while (mock.running && pos < count) {
+        uint32_t n = mock.frame ? mock.frame : 1 + (host_rng_next(&mock.rng) % SIM_EQ_MAX_FRAME);
+        if (n > count - pos) n = count - pos;
+        mock.cb(codes + pos, n);
+        mock.callbacks++;
+        pos += n;
+    }
+}
+
+/************************************************
+ * LUXMETER (LATO FIRMWARE)                    *
+ ************************************************/
+
+static luxmeter_window_t window;
+static uint16_t window_means[SIM_MAX_WINDOWS];
+static uint32_t window_count;
+
+static void sim_on_codes(const uint16_t *codes, uint32_t count)
+{
+    if (luxmeter_window_feed(&window, codes, count) && window_count < SIM_MAX_WINDOWS) {
+        window_means[window_count++] = window.mean;
+    }
+}
+
+static void sim_attach(uint32_t rate_hz, uint32_t frame, uint32_t seed)
+{
+    mock_source.rate_hz = rate_hz;
+    mock.frame = frame;
+    host_rng_seed(&mock.rng, seed);
+    luxmeter_window_init(&window, mock_source.rate_hz);
+    window_count = 0;
+    mock_source.init(sim_on_codes);
+    mock_source.start();
+}
+
+/**
+ * @brief Algoritmo originale: buffer da 45 campioni, media intera 20..42
+ */
+typedef struct {
+    int samples_buffer[LUXMETER_WINDOW_SAMPLES];
+    int sample_count;
+} ref_luxmeter_t;
+
+static bool ref_feed(ref_luxmeter_t *ref, uint16_t code, uint32_t *mean)
+{
+    ref->samples_buffer[ref->sample_count++] = code;
+    if (ref->sample_count < LUXMETER_WINDOW_SAMPLES) return false;
+
+    uint32_t samples_mean = 0;
+    uint16_t valid_samples_count = 0;
+    for (uint16_t i = 20; i <= 42; i++) {
+        samples_mean += (uint32_t)ref->samples_buffer[i];
+        valid_samples_count++;
+    }
+    *mean = samples_mean / valid_samples_count;
+    ref->sample_count = 0;
+    return true;
+}
+
+/************************************************
+ * SEGNALE SINTETICO                           *
+ ************************************************/
+
+/**
+ * @brief Codice ADC istantaneo con lampada in PWM
+ * @param t_s: Istante della conversione
+ * @param phase: Fase del PWM all'avvio (0..1)
+ */
+static uint16_t sim_code(host_rng_t *rng, double t_s, double phase, int level)
+{
+    double duty = (double)level / SIM_PWM_LEVELS;
+    double peak = HOST_LAMP_LUX_PER_LEVEL * SIM_PWM_LEVELS;
+    double cycle = t_s * SIM_PWM_HZ + phase;
+    bool on = (cycle - floor(cycle)) < duty;
+
+    double code = host_code_from_lux(SIM_NATURAL_LUX + (on ? peak : 0.0));
+    code += SIM_NOISE_LSB * host_rng_gauss(rng);
+    if (code < 0.0) code = 0.0;
+    if (code > HOST_ADC_MAX_CODE) code = HOST_ADC_MAX_CODE;
+    return (uint16_t)(code + 0.5);
+}
+
+/**
+ * @brief Errore di un avvio: oneshot o continua contro il riferimento
+ * @param err_rel: Errore relativo medio sui lux delle finestre
+ * @param err_max: Errore relativo massimo
+ */
+static void sim_run(bool continuous, int level, double phase, uint32_t seed,
+                    double *err_rel, double *err_max, uint32_t *callbacks)
+{
+    static uint16_t codes[SIM_CONT_RATE_HZ * SIM_SECONDS];
+    const uint32_t total = SIM_CONT_RATE_HZ * SIM_SECONDS;
+    const uint32_t per_sample = SIM_CONT_RATE_HZ / LUXMETER_SAMPLE_HZ;
+    host_rng_t rng;
+    host_rng_seed(&rng, seed);
+
+    for (uint32_t i = 0; i < total; i++) {
+        codes[i] = sim_code(&rng, (double)i / SIM_CONT_RATE_HZ, phase, level);
+    }
+
+    if (continuous) {
+        sim_attach(SIM_CONT_RATE_HZ, SIM_CONT_FRAME, seed);
+        mock_deliver(codes, total);
+    } else {
+        // Timer da 10 ms: una conversione alla stessa fase del PWM, con jitter
+        sim_attach(LUXMETER_SAMPLE_HZ, 1, seed);
+        for (uint32_t k = 0; k < total / per_sample; k++) {
+            double t = k * 0.01 + SIM_TIMER_JITTER_US * 1e-6 * fabs(host_rng_gauss(&rng));
+            uint16_t code = sim_code(&rng, t, phase, level);
+            mock_deliver(&code, 1);
+        }
+    }
+    mock_source.stop();
+    *callbacks = mock.callbacks;
+
+    // Riferimento: tutte le conversioni della parte mediata di ogni finestra
+    const uint32_t window_conv = LUXMETER_WINDOW_SAMPLES * per_sample;
+    double sum_err = 0.0;
+    *err_max = 0.0;
+
+    for (uint32_t w = 0; w < window_count; w++) {
+        uint64_t acc = 0;
+        uint32_t first = w * window_conv + LUXMETER_WINDOW_FIRST * per_sample;
+        uint32_t last = w * window_conv + (LUXMETER_WINDOW_LAST + 1) * per_sample;
+        for (uint32_t i = first; i < last; i++) acc += codes[i];
+
+        double truth = host_lux_from_code((double)acc / (last - first));
+        double err = fabs(host_lux_from_code((double)window_means[w] / LUXMETER_CODE_ONE) - truth) / truth;
+        sum_err += err;
+        if (err > *err_max) *err_max = err;
+    }
+    *err_rel = window_count ? sum_err / window_count : 0.0;
+}
+
+/************************************************
+ * REGISTRAZIONE                               *
+ ************************************************/
+
+static int sim_replay(const char *path, uint32_t rate_hz)
+{
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        fprintf(stderr, "Impossibile aprire %s\n", path);
+        return 1;
+    }
+
+    uint16_t *codes = malloc(SIM_MAX_RECORD * sizeof(uint16_t));
+    uint32_t count = 0;
+    unsigned value;
+    while (count < SIM_MAX_RECORD && fscanf(f, "%u", &value) == 1) {
+        codes[count++] = (uint16_t)(value > HOST_ADC_MAX_CODE ? HOST_ADC_MAX_CODE : value);
+    }
+    fclose(f);
+
+    sim_attach(rate_hz, rate_hz > LUXMETER_SAMPLE_HZ ? SIM_CONT_FRAME : 1, 1);
+    mock_deliver(codes, count);
+    mock_source.stop();
+
+    printf("Registrazione %s: %u conversioni a %u Hz (decimazione %u), %u callback\n\n",
+           path, count, rate_hz, window.decimation, mock.callbacks);
+    for (uint32_t w = 0; w < window_count; w++) {
+        printf("  finestra %4u  media %7.2f  lux %8.1f\n", w, (double)window_means[w] / LUXMETER_CODE_ONE,
+               host_lux_from_code((double)window_means[w] / LUXMETER_CODE_ONE));
+    }
+
+    free(codes);
+    return window_count ? 0 : 1;
+}
+
+/************************************************
+ * MAIN                                        *
+ ************************************************/
+
+int main(int argc, char **argv)
+{
+    if (argc > 1 && strtoul(argv[1], NULL, 0) == 0 && argv[1][0] != '0') {
+        uint32_t rate = (argc > 2) ? (uint32_t)strtoul(argv[2], NULL, 0) : SIM_CONT_RATE_HZ;
+        return sim_replay(argv[1], rate ? rate : SIM_CONT_RATE_HZ);
+    }
+
+    uint32_t seed = (argc > 1) ? (uint32_t)strtoul(argv[1], NULL, 0) : 1;
+    host_rng_t rng;
+    host_rng_seed(&rng, seed);
+
+    // 1. Equivalenza con l'algoritmo originale a 100 Hz, frame casuali
+    static uint16_t codes[SIM_EQ_SAMPLES];
+    for (uint32_t i = 0; i < SIM_EQ_SAMPLES; i++) codes[i] = (uint16_t)(host_rng_next(&rng) & 0xFFF);
+
+    sim_attach(LUXMETER_SAMPLE_HZ, 0, seed);
+    mock_deliver(codes, SIM_EQ_SAMPLES);
+    mock_source.stop();
+
+    ref_luxmeter_t ref = { .sample_count = 0 };
+    uint32_t ref_windows = 0, equal = 0, mean;
+    for (uint32_t i = 0; i < SIM_EQ_SAMPLES; i++) {
+        if (ref_feed(&ref, codes[i], &mean)) {
+            if (ref_windows < window_count &&
+                (window_means[ref_windows] >> LUXMETER_CODE_FRAC_BITS) == mean) equal++;
+            ref_windows++;
+        }
+    }
+
+    printf("Equivalenza a %d Hz con frame casuali da 1..%d campioni: %u/%u finestre identiche\n\n",
+           LUXMETER_SAMPLE_HZ, SIM_EQ_MAX_FRAME, equal, ref_windows);
+    bool equivalent = (equal == ref_windows && ref_windows == window_count);
+
+    // 2. Oneshot da timer contro continua su lampada in PWM
+    printf("Lampada PWM %.0f Hz, naturale %.0f lux, %d avvii da %d s (seed %u)\n",
+           SIM_PWM_HZ, SIM_NATURAL_LUX, SIM_RUNS, SIM_SECONDS, seed);
+    printf("livello  oneshot errore medio / peggiore   continua errore medio / peggiore\n");
+
+    uint32_t cb_oneshot = 0, cb_cont = 0;
+    for (int level = 4; level < SIM_PWM_LEVELS; level += 8) {
+        double one_mean = 0.0, one_max = 0.0, cont_mean = 0.0, cont_max = 0.0;
+
+        for (int run = 0; run < SIM_RUNS; run++) {
+            double phase = host_rng_uniform(&rng);
+            uint32_t run_seed = seed * 1000u + (uint32_t)(level * SIM_RUNS + run);
+            double err, err_max;
+
+            sim_run(false, level, phase, run_seed, &err, &err_max, &cb_oneshot);
+            one_mean += err;
+            if (err_max > one_max) one_max = err_max;
+
+            sim_run(true, level, phase, run_seed, &err, &err_max, &cb_cont);
+            cont_mean += err;
+            if (err_max > cont_max) cont_max = err_max;
+        }
+
+        printf("  %2d     %8.1f%% / %6.1f%%               %8.2f%% / %6.2f%%\n", level,
+               100.0 * one_mean / SIM_RUNS, 100.0 * one_max,
+               100.0 * cont_mean / SIM_RUNS, 100.0 * cont_max);
+    }
+
+    printf("\nCallback al secondo: oneshot %.0f (timer daemon + lettura ADC), continua %.0f (ISR DMA)\n",
+           (double)cb_oneshot / SIM_SECONDS, (double)cb_cont / SIM_SECONDS);
+
+    return equivalent ? 0 : 1;
+}
@@ -0,0 +1,261 @@
+/**
+ * Firmware: ECOLUMIERE BLE MESH ESP32
+ * Tool host: Natural Est Sim - Stima della luce naturale senza buio a ogni ciclo
+ * Descrizione: Riproduce una giornata con nuvole, una lampada il cui contributo
+ *              al sensore non è lineare nel livello e deriva nel tempo
+ *              (riscaldamento, cambio di riflettanza della scrivania a metà
+ *              giornata). Confronta lo slot naturale originale, che spegne la
+ *              lampada a ogni misura, con la modalità stima del firmware
+ *              (natural_est.c): errore sulla luce naturale e tempo al buio.
+ *
+ * Compilazione (da sensor_server/host):
+ *   gcc -O2 -Wall -I../ecolumiere -o natural_est_sim natural_est_sim.c \
+ *       ../ecolumiere/natural_est.c -lm
+ *
+ * Uso: ./natural_est_sim [seed]
+ *
+ * Ipotesi: tick da 500 ms, slot naturale ogni 10 s e ambiente ogni 5 s (cadenza
+ * di default), buio di NATURAL_BLANK_TICKS tick (raffica ADC sincronizzata) sia
+ * per le calibrazioni sia per ogni misura senza stima, fade di un livello ogni 8 tick. La misura al buio
+ * vede solo rumore del sensore: l'errore della modalità originale è quindi il
+ * rumore, quello della stima include l'errore di modello.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "host_common.h"
+#include "natural_est.h"
+
+/************************************************
+ * PARAMETRI DI SIMULAZIONE                    *
+ ************************************************/
+
+#define SIM_TICK_MS             500
+#define SIM_SLOT_COUNT          10
+#define SIM_NATURAL_SLOT        2
+#define SIM_ENV_SLOT            6
+#define SIM_NATURAL_CYCLES      2       // natural_divider di default
+#define SIM_FADE_TICKS          8
+#define SIM_BLANK_TICKS         1       // NATURAL_BLANK_TICKS
+#define SIM_START_H             6
+#define SIM_END_H               20
+#define SIM_TICKS               ((SIM_END_H - SIM_START_H) * 3600 * 1000 / SIM_TICK_MS)
+
+#define SIM_WINDOW_PEAK_LUX     2500.0f
+#define SIM_SENSOR_Y_M          3.0f    // Distanza del sensore dalla finestra
+#define SIM_TARGET_LUX          500.0f
+#define SIM_MAX_LEVEL           32
+#define SIM_NOISE_LUX           3.0f
+#define SIM_NOISE_REL           0.01f
+#define SIM_NONLINEARITY        0.006f  // Compressione del flusso ai livelli alti
+#define SIM_THERMAL_DROP        0.08f   // Calo di flusso a lampada calda
+#define SIM_THERMAL_TAU_S       1800.0f
+#define SIM_REFLECT_STEP_H      13.5f   // Cambio di riflettanza della scrivania
+#define SIM_REFLECT_GAIN        1.15f
+
+/************************************************
+ * MODELLO                                     *
+ ************************************************/
+
+/**
+ * @brief Nuvole: attenuazione con passeggiata casuale limitata
+ */
+typedef struct {
+    float cover;
+    host_rng_t rng;
+} sim_sky_t;
+
+static float sim_window_lux(sim_sky_t *sky, float hour)
+{
+    float sun = sinf(3.14159265f * (hour - 6.0f) / 14.0f);
+    if (sun < 0.0f) sun = 0.0f;
+
+    sky->cover += 0.01f * host_rng_gauss(&sky->rng);
+    if (sky->cover < 0.0f) sky->cover = 0.0f;
+    if (sky->cover > 0.7f) sky->cover = 0.7f;
+
+    return SIM_WINDOW_PEAK_LUX * sun * (1.0f - sky->cover);
+}
+
+/**
+ * @brief Contributo reale della lampada al sensore
+ * @param hot: Frazione di riscaldamento raggiunta (0..1)
+ */
+static float sim_lamp_lux(int level, float hot, float hour)
+{
+    float lux = HOST_LAMP_LUX_PER_LEVEL * level * (1.0f - SIM_NONLINEARITY * level);
+    lux *= 1.0f - SIM_THERMAL_DROP * hot;
+    if (hour >= SIM_REFLECT_STEP_H) lux *= SIM_REFLECT_GAIN;
+    return lux;
+}
+
+static uint32_t sim_sensor(host_rng_t *rng, float lux)
+{
+    lux += (SIM_NOISE_LUX + SIM_NOISE_REL * lux) * host_rng_gauss(rng);
+    return (lux > 0.0f) ? (uint32_t)(lux + 0.5f) : 0;
+}
+
+/************************************************
+ * SIMULAZIONE                                 *
+ ************************************************/
+
+/**
+ * @brief Risultati di una giornata
+ */
+typedef struct {
+    uint32_t blanked_ticks;
+    uint32_t blank_events;
+    uint32_t natural_samples;
+    double abs_err_sum;
+    float max_err;
+    uint32_t err_hist[64];      // Istogramma errori a passi di 2 lux
+    uint32_t calibrations;
+    float final_gain;
+} sim_result_t;
+
+static float sim_percentile(const sim_result_t *res, float p)
+{
+    uint32_t target = (uint32_t)(p * res->natural_samples);
+    uint32_t acc = 0;
+    for (int i = 0; i < 64; i++) {
+        acc += res->err_hist[i];
+        if (acc >= target) return 2.0f * (i + 1);
+    }
+    return 128.0f;
+}
+
+/**
+ * @brief Esegue la giornata
+ * @param estimation: false = buio a ogni slot naturale, true = natural_est
+ */
+static void sim_run(bool estimation, uint32_t seed, sim_result_t *res)
+{
+    sim_sky_t sky = { .cover = 0.3f };
+    host_rng_t noise;
+    natural_est_t est;
+
+    host_rng_seed(&sky.rng, seed);
+    host_rng_seed(&noise, seed * 7919u + 1u);
+    natural_est_init(&est, 0);
+    memset(res, 0, sizeof(*res));
+
+    int level = 0, target = 0;
+    float hot = 0.0f;
+    float window = 0.0f;
+    uint32_t natural_counter = 0;
+    uint32_t natural_used = 0;
+    int blank_ticks = 0, blank_level = 0;
+    uint32_t blank_natural = UINT32_MAX;
+    uint32_t last_env = UINT32_MAX;
+    int last_env_level = 0;
+
+    for (uint32_t tick = 0; tick < SIM_TICKS; tick++) {
+        uint32_t now_ms = tick * SIM_TICK_MS;
+        float hour = SIM_START_H + now_ms / 3600000.0f;
+
+        if (tick % 20 == 0) window = sim_window_lux(&sky, hour);
+        float natural_true = window * expf(-SIM_SENSOR_Y_M / HOST_WINDOW_DECAY_M);
+
+        bool dark = blank_ticks > 0;
+        hot += ((level > 0 ? 1.0f : 0.0f) - hot) * (SIM_TICK_MS / 1000.0f) / SIM_THERMAL_TAU_S;
+
+        if (tick % SIM_FADE_TICKS == 0) {
+            if (level < target) level++;
+            if (level > target) level--;
+        }
+
+        if (dark) {
+            res->blanked_ticks++;
+            if (--blank_ticks == 0) {
+                blank_natural = sim_sensor(&noise, natural_true);
+                natural_used = blank_natural;
+                float err = fabsf((float)blank_natural - natural_true);
+                res->abs_err_sum += err;
+                if (err > res->max_err) res->max_err = err;
+                res->err_hist[(int)(err / 2.0f) < 63 ? (int)(err / 2.0f) : 63]++;
+                res->natural_samples++;
+            }
+        }
+
+        // Slot elaborati un tick su due, come tick_divider di default
+        if (tick % 2 != 0) continue;
+        int slot = (tick / 2) % SIM_SLOT_COUNT;
+
+        if (slot == SIM_NATURAL_SLOT && ++natural_counter >= SIM_NATURAL_CYCLES) {
+            natural_counter = 0;
+
+            if (!estimation || (blank_ticks == 0 && natural_est_need_blank(&est, level, now_ms))) {
+                blank_ticks = SIM_BLANK_TICKS;
+                blank_level = level;
+                res->blank_events++;
+            } else if (last_env != UINT32_MAX) {
+                uint32_t estimate;
+                if (natural_est_estimate(&est, last_env_level, last_env, &estimate)) {
+                    natural_used = estimate;
+                    float err = fabsf((float)estimate - natural_true);
+                    res->abs_err_sum += err;
+                    if (err > res->max_err) res->max_err = err;
+                    res->err_hist[(int)(err / 2.0f) < 63 ? (int)(err / 2.0f) : 63]++;
+                    res->natural_samples++;
+                }
+            }
+        }
+
+        if (slot == SIM_ENV_SLOT && blank_ticks == 0) {
+            uint32_t env = sim_sensor(&noise, natural_true + sim_lamp_lux(level, hot, hour));
+
+            if (estimation && blank_natural != UINT32_MAX) {
+                if (blank_level == level) {
+                    natural_est_calibrate(&est, level, env, blank_natural, now_ms);
+                }
+                blank_natural = UINT32_MAX;
+            }
+            last_env = env;
+            last_env_level = level;
+
+            // Regolatore semplice: livello che porta naturale + lampada al target
+            float missing = SIM_TARGET_LUX - (float)natural_used;
+            target = (missing > 0.0f) ? (int)(missing / HOST_LAMP_LUX_PER_LEVEL + 0.5f) : 0;
+            if (target > SIM_MAX_LEVEL) target = SIM_MAX_LEVEL;
+        }
+    }
+
+    res->calibrations = est.calibrations;
+    res->final_gain = est.gain;
+}
+
+static void sim_print(const char *name, const sim_result_t *res)
+{
+    printf("%-10s  buio %6.1f s (%5.2f%%) in %5u eventi  |  errore medio %5.1f lux, "
+           "p95 %5.1f, max %5.1f  (%u campioni)\n",
+           name, res->blanked_ticks * SIM_TICK_MS / 1000.0f,
+           100.0f * res->blanked_ticks / SIM_TICKS, res->blank_events,
+           res->natural_samples ? res->abs_err_sum / res->natural_samples : 0.0,
+           sim_percentile(res, 0.95f), res->max_err, res->natural_samples);
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t seed = (argc > 1) ? (uint32_t)strtoul(argv[1], NULL, 0) : 1;
+    sim_result_t measured, estimated;
+
+    sim_run(false, seed, &measured);
+    sim_run(true, seed, &estimated);
+
+    printf("Giornata %d:00-%d:00, target %.0f lux, seed %u\n\n",
+           SIM_START_H, SIM_END_H, SIM_TARGET_LUX, seed);
+    sim_print("ORIGINALE", &measured);
+    sim_print("STIMA", &estimated);
+
+    printf("\nStima: %u calibrazioni, guadagno appreso %.2f lux/livello (nominale %.2f)\n",
+           estimated.calibrations, estimated.final_gain, HOST_LAMP_LUX_PER_LEVEL);
+    if (measured.blanked_ticks > 0) {
+        printf("Riduzione del tempo al buio: %.1f%% (%u -> %u eventi di sfarfallio)\n",
+               100.0f * (1.0f - (float)estimated.blanked_ticks / measured.blanked_ticks),
+               measured.blank_events, estimated.blank_events);
+    }
+
+    return 0;
+}
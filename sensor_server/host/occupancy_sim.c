@@ -0,0 +1,299 @@
+/**
+ * Firmware: ECOLUMIERE BLE MESH ESP32
+ * Tool host: Occupancy Sim - Dimmerazione in base alla presenza
+ * Descrizione: Riproduce una giornata d'ufficio con una traccia di presenza
+ *              (arrivo, pausa pranzo, riunione, persone ferme alla scrivania)
+ *              e l'uscita di un PIR che resta alto qualche secondo dopo ogni
+ *              movimento. Il nodo usa la macchina a stati del firmware
+ *              (occupancy.c) e il passo algo_core_step, con le stesse azioni
+ *              immediate di ecolumiere_occupancy_update. Confronta energia e
+ *              comfort con la lampada senza sensore e misura il ritardo fra
+ *              l'ultimo movimento e il raggiungimento del livello di standby.
+ *
+ * Compilazione (da sensor_server/host):
+ *   gcc -O2 -Wall -I../ecolumiere -o occupancy_sim occupancy_sim.c \
+ *       ../ecolumiere/occupancy.c ../ecolumiere/algo_core.c -lm
+ *
+ * Uso: ./occupancy_sim [hold_s grazia_s standby_s] [seed]
+ *
+ * Ipotesi: un ciclo di campionamento ogni 5 s, algoritmo ogni 10 cicli a
+ * regime e ogni 2 cicli nei 60 s successivi a una transizione (FAST), fade di
+ * un livello per ciclo, macchina a stati aggiornata ogni PIR_TICK_MS.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "host_common.h"
+#include "algo_core.h"
+#include "occupancy.h"
+#include "config.h"
+
+/************************************************
+ * PARAMETRI DI SIMULAZIONE                    *
+ ************************************************/
+
+#define SIM_TICK_MS             1000    // PIR_TICK_MS
+#define SIM_CYCLE_TICKS         5       // Ciclo slot da 5 s
+#define SIM_ALGO_CYCLES_STABLE  10
+#define SIM_ALGO_CYCLES_FAST    2
+#define SIM_FAST_HOLD_MS        (60 * 1000)
+#define SIM_START_H             7
+#define SIM_END_H               21
+
+#define SIM_PIR_HIGH_MS         4000    // Uscita PIR alta dopo ogni movimento
+#define SIM_MOTION_PROB         (1.0f / 30.0f)  // Probabilità di movimento al secondo
+#define SIM_STILL_PROB          (1.0f / 1800.0f) // Inizio di un periodo immobile
+#define SIM_STILL_MIN_S         60
+#define SIM_STILL_MAX_S         240
+
+#define SIM_TARGET_LUX          400
+#define SIM_DIMM_STEP           0.1f
+#define SIM_PERC_MIN            0.01f
+#define SIM_COMFORT_FRACTION    0.9f    // Sotto il 90% della lampada senza PIR = discomfort
+#define SIM_SECONDS             ((SIM_END_H - SIM_START_H) * 3600)
+
+/**
+ * @brief Intervalli di presenza (ore del giorno)
+ */
+static const float sim_presence[][2] = {
+    { 8.50f, 12.50f },
+    { 13.25f, 15.00f },
+    { 15.70f, 17.75f },
+};
+
+#define SIM_PRESENCE_COUNT (sizeof(sim_presence) / sizeof(sim_presence[0]))
+
+/************************************************
+ * STRUTTURE                                   *
+ ************************************************/
+
+typedef struct {
+    double energy;          // Somma livelli / LIGHT_MAX_LEVEL (per secondo)
+    uint32_t present_s;
+    uint32_t absent_s;
+    uint32_t discomfort_s;  // Presenti con meno del 90% della luce di riferimento
+    uint32_t standby_s;     // Assenti con lampada a livello di standby
+    uint32_t max_standby_state_s;  // Ultimo movimento → stato STANDBY
+    uint32_t max_standby_delay_s;  // Ultimo movimento → livello di standby (dopo il fade)
+    uint32_t max_restore_s; // Rientro → comfort ristabilito
+    uint32_t transitions;
+} sim_metrics_t;
+
+/************************************************
+ * SIMULAZIONE                                 *
+ ************************************************/
+
+static bool sim_is_present(float t_h)
+{
+    for (size_t i = 0; i < SIM_PRESENCE_COUNT; i++) {
+        if (t_h >= sim_presence[i][0] && t_h < sim_presence[i][1]) return true;
+    }
+    return false;
+}
+
+static float sim_window_lux(float t_h)
+{
+    // Giornata con massimo a mezzogiorno, buio prima delle 7 e dopo le 19
+    float x = (t_h - 7.0f) / 12.0f;
+    if (x <= 0.0f || x >= 1.0f) return 0.0f;
+    return 320.0f * sinf(3.14159265f * x);
+}
+
+/**
+ * @brief Esegue la giornata con o senza sensore di presenza
+ * @param reference: Illuminamento al secondo senza PIR (scritto se !use_pir)
+ */
+static void sim_run(const occupancy_config_t *config, bool use_pir, uint32_t seed,
+                    float *reference, sim_metrics_t *metrics)
+{
+    host_rng_t rng;
+    occupancy_sm_t sm;
+    algo_data_t algo;
+    uint32_t start_ms = SIM_START_H * 3600000u;
+    uint32_t end_ms = SIM_END_H * 3600000u;
+    uint32_t pir_until = 0, still_until = 0, last_fast_ms = 0;
+    uint32_t last_motion_ms = 0, return_ms = 0, cycle = 0;
+    float level = 0.0f, target_level = 0.0f, occupied_level = 0.0f;
+    bool was_present = false, waiting_standby = false, waiting_restore = false;
+    float standby_level = config->standby_perc_min * LIGHT_MAX_LEVEL;
+
+    host_rng_seed(&rng, seed);
+    memset(metrics, 0, sizeof(*metrics));
+
+    occupancy_init(&sm, start_ms);
+    sm.config = *config;
+
+    memset(&algo, 0, sizeof(algo));
+    algo.power_efficiency = HOST_LAMP_LUX_PER_LEVEL;
+    algo.distance = 1.0f;
+    algo.in_pl = 1;
+    algo.transparency = 1.0f;
+    algo.dimm_step = SIM_DIMM_STEP;
+    algo.emax = (float)LIGHT_MAX_LEVEL * HOST_LAMP_LUX_PER_LEVEL;
+
+    for (uint32_t now = start_ms; now < end_ms; now += SIM_TICK_MS) {
+        float t_h = (float)now / 3600000.0f;
+        bool present = sim_is_present(t_h);
+
+        // Traccia di movimento: le persone ferme non attivano il PIR
+        if (present) {
+            if (now >= still_until && host_rng_uniform(&rng) < SIM_STILL_PROB) {
+                uint32_t still_s = SIM_STILL_MIN_S +
+                    (uint32_t)(host_rng_uniform(&rng) * (SIM_STILL_MAX_S - SIM_STILL_MIN_S));
+                still_until = now + still_s * 1000;
+            }
+            if (!was_present || (now >= still_until && host_rng_uniform(&rng) < SIM_MOTION_PROB)) {
+                pir_until = now + SIM_PIR_HIGH_MS;
+                last_motion_ms = now;
+            }
+        }
+
+        if (present && !was_present) {
+            return_ms = now;
+            waiting_restore = true;
+        }
+        if (!present && was_present) {
+            waiting_standby = true;
+        }
+        was_present = present;
+
+        // Replica di ecolumiere_occupancy_update
+        if (use_pir) {
+            occupancy_state_t previous = sm.state;
+            if (occupancy_step(&sm, now < pir_until, now)) {
+                metrics->transitions++;
+                if (sm.state == OCCUPANCY_STANDBY) {
+                    uint32_t state_s = (now - sm.last_motion_ms) / 1000;
+                    if (state_s > metrics->max_standby_state_s) metrics->max_standby_state_s = state_s;
+                }
+                if (previous == OCCUPANCY_OCCUPIED) {
+                    occupied_level = algo.pnew;
+                }
+                if (sm.state == OCCUPANCY_OCCUPIED && algo.pnew < occupied_level) {
+                    algo.pnew = occupied_level;
+                } else if (sm.state == OCCUPANCY_STANDBY && algo.pnew > standby_level) {
+                    algo.pnew = standby_level;
+                }
+                target_level = (float)(uint32_t)algo.pnew;  // pwm_set_duty_cycle, poi fade
+                last_fast_ms = now;
+            }
+        }
+
+        float natural = sim_window_lux(t_h);
+
+        // Ciclo slot: misura e passo di controllo
+        if ((now / SIM_TICK_MS) % SIM_CYCLE_TICKS == 0) {
+            uint32_t algo_cycles = (now - last_fast_ms < SIM_FAST_HOLD_MS) ?
+                                   SIM_ALGO_CYCLES_FAST : SIM_ALGO_CYCLES_STABLE;
+
+            if (++cycle % algo_cycles == 0) {
+                algo.target_lux = SIM_TARGET_LUX;
+                algo.perc_min = SIM_PERC_MIN;
+                if (use_pir) {
+                    occupancy_modulate(&sm, &algo.target_lux, &algo.perc_min);
+                }
+                // Divisore ALGO_AVG_LAST = 2 x ALGO_AVG: medie dimezzate come nel firmware
+                algo.enatural = natural / 2.0f;
+                algo.eenv = (natural + level * HOST_LAMP_LUX_PER_LEVEL) / 2.0f;
+                algo_core_step(&algo);
+                target_level = (float)(uint32_t)algo.pnew;
+            }
+
+            // Fade: un livello per ciclo verso il target
+            if (level < target_level) level = fminf(level + 1.0f, target_level);
+            else if (level > target_level) level = fmaxf(level - 1.0f, target_level);
+        }
+
+        // Metriche al secondo
+        float lux = natural + level * HOST_LAMP_LUX_PER_LEVEL;
+        uint32_t second = (now - start_ms) / 1000;
+        metrics->energy += level / LIGHT_MAX_LEVEL;
+
+        if (!use_pir) {
+            reference[second] = lux;
+        }
+
+        if (present) {
+            metrics->present_s++;
+            if (lux < SIM_COMFORT_FRACTION * reference[second]) {
+                metrics->discomfort_s++;
+            } else if (waiting_restore) {
+                uint32_t restore_s = (now - return_ms) / 1000;
+                if (restore_s > metrics->max_restore_s) metrics->max_restore_s = restore_s;
+                waiting_restore = false;
+            }
+        } else {
+            metrics->absent_s++;
+            if (level <= standby_level + 0.5f) {
+                metrics->standby_s++;
+                if (waiting_standby) {
+                    uint32_t delay_s = (now - last_motion_ms) / 1000;
+                    if (delay_s > metrics->max_standby_delay_s) metrics->max_standby_delay_s = delay_s;
+                    waiting_standby = false;
+                }
+            }
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+    occupancy_sm_t defaults;
+    uint32_t seed = 12345u;
+
+    occupancy_init(&defaults, 0);
+
+    if (argc >= 4) {
+        if (!occupancy_set_times(&defaults, (uint32_t)atoi(argv[1]) * 1000,
+                                 (uint32_t)atoi(argv[2]) * 1000, (uint32_t)atoi(argv[3]) * 1000)) {
+            fprintf(stderr, "tempi non validi: serve hold <= grazia <= standby\n");
+            return 1;
+        }
+        if (argc > 4) seed = (uint32_t)strtoul(argv[4], NULL, 0);
+    } else if (argc == 2) {
+        seed = (uint32_t)strtoul(argv[1], NULL, 0);
+    }
+
+    const occupancy_config_t *config = &defaults.config;
+    static float reference[SIM_SECONDS];
+    sim_metrics_t base, occ;
+
+    sim_run(config, false, seed, reference, &base);
+    sim_run(config, true, seed, reference, &occ);
+
+    printf("Giornata %d:00-%d:00, target %d lux (seed %u)\n",
+           SIM_START_H, SIM_END_H, SIM_TARGET_LUX, seed);
+    printf("Tempi presenza: hold %lu s, grazia %lu s, standby %lu s\n",
+           (unsigned long)(config->hold_ms / 1000), (unsigned long)(config->grace_ms / 1000),
+           (unsigned long)(config->standby_ms / 1000));
+    printf("Presenza %.2f h, assenza %.2f h\n\n", occ.present_s / 3600.0, occ.absent_s / 3600.0);
+
+    printf("%-10s %12s %14s %14s %16s %12s\n",
+           "Modo", "Energia %", "Sotto rif. s", "Standby ass. %", "Livello stby s", "Rientro s");
+    printf("%-10s %12.1f %14lu %14.1f %16s %12s\n", "SENZA PIR",
+           100.0 * base.energy / (base.present_s + base.absent_s),
+           (unsigned long)base.discomfort_s,
+           100.0 * base.standby_s / base.absent_s, "-", "-");
+    printf("%-10s %12.1f %14lu %14.1f %16lu %12lu\n", "PRESENZA",
+           100.0 * occ.energy / (occ.present_s + occ.absent_s),
+           (unsigned long)occ.discomfort_s,
+           100.0 * occ.standby_s / occ.absent_s,
+           (unsigned long)occ.max_standby_delay_s, (unsigned long)occ.max_restore_s);
+
+    printf("\nRisparmio energetico: %.1f%%, transizioni: %lu\n",
+           100.0 * (1.0 - occ.energy / base.energy), (unsigned long)occ.transitions);
+
+    // Verifica: lo stato STANDBY deve arrivare entro il tempo configurato
+    uint32_t limit_s = config->standby_ms / 1000 + SIM_TICK_MS / 1000;
+    if (occ.max_standby_state_s > limit_s) {
+        printf("ERRORE: standby dopo %lu s (limite %lu s)\n",
+               (unsigned long)occ.max_standby_state_s, (unsigned long)limit_s);
+        return 1;
+    }
+    printf("Standby dopo al massimo %lu s (limite %lu s), livello raggiunto col fade in %lu s\n",
+           (unsigned long)occ.max_standby_state_s, (unsigned long)limit_s,
+           (unsigned long)occ.max_standby_delay_s);
+    return 0;
+}
@@ -0,0 +1,196 @@
+/**
+ * Firmware: ECOLUMIERE BLE MESH ESP32
+ * Tool host: Offset Cal Sim - Tabella di compensazione del luxmeter per dispositivo
+ * Descrizione: Genera dispositivi con guadagno della lampada, buio e scarto
+ *              di misura diversi (gradino di accoppiamento alla prima
+ *              accensione, dispersione che cresce come la radice del livello,
+ *              curvatura del sensore), esegue la scansione al buio del
+ *              firmware (offset_cal.c) e confronta su letture nuove lo scarto
+ *              dalla risposta lineare della lampada senza compensazione, con
+ *              offset_map di fabbrica e con la tabella calibrata.
+ *
+ * Compilazione (da sensor_server/host):
+ *   gcc -O2 -Wall -I../ecolumiere -o offset_cal_sim offset_cal_sim.c \
+ *       ../ecolumiere/offset_cal.c -lm
+ *
+ * Uso: ./offset_cal_sim [dispositivi] [seed]
+ *
+ * Ipotesi: la luce media della lampada è lineare nel duty, quindi lo scarto
+ * da una retta è errore di misura. Rumore per raffica 0.5 lux + 0.5%, tre
+ * raffiche per livello come OFFSET_CAL_BURSTS, buio stabile durante i 40 s
+ * della scansione. Lo scarto è misurato rispetto alla retta del dispositivo
+ * (quella che il commissioning stimerebbe), livelli 1..8 come "basso lux".
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "host_common.h"
+#include "offset_cal.h"
+
+/************************************************
+ * PARAMETRI DI SIMULAZIONE                    *
+ ************************************************/
+
+#define SIM_DEFAULT_DEVICES     1000
+#define SIM_GAIN_MIN            8.0f    // Lux per livello al sensore
+#define SIM_GAIN_MAX            25.0f
+#define SIM_DARK_MAX            5.0f
+#define SIM_STEP_MAX            10.0f   // Gradino alla prima accensione
+#define SIM_LEAK_MAX            6.0f    // Dispersione * sqrt(livello)
+#define SIM_CURVE_MAX           4.0f    // Curvatura al centro della scala
+#define SIM_NOISE_LUX           0.5f
+#define SIM_NOISE_REL           0.005f
+#define SIM_LOW_LEVELS          8
+
+// offset_map di luxmeter.c
+static const int16_t factory_map[OFFSET_CAL_LEVELS] = {
+    0, 8, 10, 12, 11, 14, 17, 11, 14, 15, 18, 19, 21, 22, 22, 22,
+    22, 22, 22, 21, 21, 22, 23, 24, 25, 26, 27, 28, 30, 31, 33, 34, 38
+};
+
+typedef enum {
+    SIM_RAW,
+    SIM_FACTORY,
+    SIM_CALIBRATED,
+    SIM_TABLES
+} sim_table_t;
+
+static const char *table_names[SIM_TABLES] = { "nessuna", "offset_map di fabbrica", "calibrata" };
+
+/**
+ * @brief Dispositivo simulato
+ */
+typedef struct {
+    float gain;
+    float dark;
+    float step;
+    float leak;
+    float curve;
+} sim_device_t;
+
+/************************************************
+ * SENSORE                                     *
+ ************************************************/
+
+static float sim_bias(const sim_device_t *dev, int level)
+{
+    if (level == 0) return 0.0f;
+    return dev->step + dev->leak * sqrtf((float)level) +
+           dev->curve * level * (32 - level) / 256.0f;
+}
+
+/**
+ * @brief Lettura non compensata: media di OFFSET_CAL_BURSTS raffiche (intere come il LUT)
+ */
+static float sim_read(host_rng_t *rng, const sim_device_t *dev, int level)
+{
+    float truth = dev->dark + dev->gain * level + sim_bias(dev, level);
+    float sum = 0.0f;
+
+    for (int b = 0; b < OFFSET_CAL_BURSTS; b++) {
+        float lux = truth + (SIM_NOISE_LUX + SIM_NOISE_REL * truth) * host_rng_gauss(rng);
+        sum += (lux > 0.0f) ? floorf(lux) : 0.0f;
+    }
+    return sum / OFFSET_CAL_BURSTS;
+}
+
+/**
+ * @brief Scarto per livello delle letture compensate dalla loro retta per il buio
+ */
+static void sim_nonlinearity(const float *lux, const int16_t *offset, float *residual)
+{
+    double sum_ly = 0.0, sum_ll = 0.0;
+
+    for (int level = 1; level < OFFSET_CAL_LEVELS; level++) {
+        sum_ly += level * (lux[level] - offset[level] - lux[0]);
+        sum_ll += (double)level * level;
+    }
+    float gain = (float)(sum_ly / sum_ll);
+
+    for (int level = 0; level < OFFSET_CAL_LEVELS; level++) {
+        residual[level] = lux[level] - offset[level] - lux[0] - gain * level;
+    }
+}
+
+/************************************************
+ * MAIN                                        *
+ ************************************************/
+
+int main(int argc, char **argv)
+{
+    int devices = (argc > 1) ? atoi(argv[1]) : SIM_DEFAULT_DEVICES;
+    uint32_t seed = (argc > 2) ? (uint32_t)strtoul(argv[2], NULL, 0) : 1;
+    static const int16_t zero[OFFSET_CAL_LEVELS] = { 0 };
+
+    host_rng_t rng;
+    host_rng_seed(&rng, seed);
+
+    double sq_low[SIM_TABLES] = { 0 }, sq_all[SIM_TABLES] = { 0 };
+    float max_low[SIM_TABLES] = { 0 };
+    int accepted = 0, status_count[OFFSET_CAL_STATUS_COUNT] = { 0 };
+    double rms_fit = 0.0;
+
+    for (int d = 0; d < devices; d++) {
+        sim_device_t dev = {
+            .gain = SIM_GAIN_MIN + (SIM_GAIN_MAX - SIM_GAIN_MIN) * host_rng_uniform(&rng),
+            .dark = SIM_DARK_MAX * host_rng_uniform(&rng),
+            .step = SIM_STEP_MAX * host_rng_uniform(&rng),
+            .leak = SIM_LEAK_MAX * host_rng_uniform(&rng),
+            .curve = SIM_CURVE_MAX * (2.0f * host_rng_uniform(&rng) - 1.0f),
+        };
+
+        // Scansione del firmware
+        float scan[OFFSET_CAL_POINTS];
+        for (uint8_t step = 0; step < OFFSET_CAL_POINTS; step++) {
+            scan[step] = sim_read(&rng, &dev, offset_cal_level_at(step));
+        }
+
+        offset_cal_table_t table;
+        offset_cal_result_t result;
+        offset_cal_fit(scan, factory_map, &table, &result);
+        status_count[result.status]++;
+        if (result.status != OFFSET_CAL_OK) continue;
+        accepted++;
+        rms_fit += result.rms;
+
+        int16_t calibrated[OFFSET_CAL_LEVELS];
+        memcpy(calibrated, table.offset, sizeof(calibrated));
+        const int16_t *tables[SIM_TABLES] = { zero, factory_map, calibrated };
+
+        // Verifica su letture nuove
+        float fresh[OFFSET_CAL_LEVELS];
+        for (int level = 0; level < OFFSET_CAL_LEVELS; level++) fresh[level] = sim_read(&rng, &dev, level);
+
+        for (int t = 0; t < SIM_TABLES; t++) {
+            float residual[OFFSET_CAL_LEVELS];
+            sim_nonlinearity(fresh, tables[t], residual);
+
+            for (int level = 1; level < OFFSET_CAL_LEVELS; level++) {
+                double r2 = (double)residual[level] * residual[level];
+                sq_all[t] += r2;
+                if (level <= SIM_LOW_LEVELS) {
+                    sq_low[t] += r2;
+                    if (fabsf(residual[level]) > max_low[t]) max_low[t] = fabsf(residual[level]);
+                }
+            }
+        }
+    }
+
+    printf("%d dispositivi, seed %u: %d tabelle accettate", devices, seed, accepted);
+    for (int s = 1; s < OFFSET_CAL_STATUS_COUNT; s++) {
+        if (status_count[s]) printf(", %d %s", status_count[s], offset_cal_status_name((offset_cal_status_t)s));
+    }
+    printf("\nScarto medio in scansione dopo l'arrotondamento: %.2f lux\n\n", accepted ? rms_fit / accepted : 0.0);
+
+    printf("Scarto dalla risposta lineare su letture nuove (lux)\n");
+    printf("%-24s  %-26s  %s\n", "tabella", "livelli 1..8 rms / max", "livelli 1..32 rms");
+    for (int t = 0; t < SIM_TABLES; t++) {
+        printf("%-24s  %8.2f / %6.2f            %8.2f\n", table_names[t],
+               sqrt(sq_low[t] / (accepted * SIM_LOW_LEVELS)), max_low[t],
+               sqrt(sq_all[t] / (accepted * (OFFSET_CAL_LEVELS - 1))));
+    }
+
+    return (accepted == devices) ? 0 : 1;
+}
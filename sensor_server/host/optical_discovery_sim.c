@@ -0,0 +1,255 @@
+/**
+ * Firmware: ECOLUMIERE BLE MESH ESP32
+ * Tool host: Optical Discovery Sim - Scoperta dei vicini ottici della stanza
+ * Descrizione: Più nodi in una stanza a griglia (host_room) eseguono il
+ *              protocollo a gettone del firmware (optical_discovery.c) con tick
+ *              da 500 ms sfasati e messaggi di gruppo con latenza e perdite.
+ *              La lampada di turno trasmette le proprie trame; ogni
+ *              acquisizione degli altri nodi decodifica una trama con una
+ *              probabilità che dipende dall'ampiezza della modulazione al
+ *              sensore (guadagno lampada → sensore per l'escursione piena) e
+ *              fallisce se due lampade trasmettono insieme. Alla fine
+ *              confronta il grafo di adiacenza delle tabelle con quello vero.
+ *
+ * Compilazione (da sensor_server/host):
+ *   gcc -O2 -Wall -I../ecolumiere -o optical_discovery_sim optical_discovery_sim.c \
+ *       ../ecolumiere/optical_discovery.c -lm
+ *
+ * Uso: ./optical_discovery_sim [colonne righe] [perdita_%] [seed]
+ *
+ * Ipotesi: comparatore del sensore digitale con soglia logistica sull'ampiezza
+ * della modulazione (50% di trame decodificate a SIM_THRESHOLD_LUX), latenza
+ * mesh 20-120 ms, acquisizione istantanea al tick. Un vicino è "vero" se la probabilità
+ * di decodifica è almeno del 50%. Il nodo promotore è l'ultimo della griglia.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "host_common.h"
+#include "optical_discovery.h"
+
+/************************************************
+ * PARAMETRI DI SIMULAZIONE                    *
+ ************************************************/
+
+#define SIM_STEP_MS             5
+#define SIM_TICK_MS             500
+#define SIM_SPACING_M           2.5f
+#define SIM_SWING_LEVELS        32      // Escursione della modulazione (livelli)
+#define SIM_THRESHOLD_LUX       50.0f   // Ampiezza con metà delle trame decodificate
+#define SIM_WIDTH_LUX           8.0f    // Larghezza della soglia logistica
+#define SIM_LATENCY_MIN_MS      20
+#define SIM_LATENCY_MAX_MS      120
+#define SIM_MAX_MSGS            512
+#define SIM_LIMIT_MS            (180 * 1000)
+#define SIM_ADDR_BASE           0x0010
+
+/**
+ * @brief Gettone in transito verso un nodo
+ */
+typedef struct {
+    uint32_t deliver_ms;
+    int to;
+    uint8_t session;
+    uint8_t index;
+    uint8_t count;
+    uint16_t members[OPTICAL_DISCOVERY_MAX_MEMBERS];
+} sim_msg_t;
+
+typedef struct {
+    optical_discovery_t od;
+    bool transmit;
+    uint32_t tick_phase_ms;
+    bool done;
+} sim_node_t;
+
+static host_room_t room;
+static sim_node_t nodes[HOST_ROOM_MAX_NODES];
+static uint16_t addr[HOST_ROOM_MAX_NODES];
+static sim_msg_t msgs[SIM_MAX_MSGS];
+static int msg_count;
+static host_rng_t rng;
+static float loss;
+static uint32_t sent, lost, collisions;
+
+/************************************************
+ * MESH E CANALE OTTICO                        *
+ ************************************************/
+
+static void sim_broadcast(int from, const optical_discovery_t *od, uint32_t now_ms)
+{
+    for (int i = 0; i < room.count; i++) {
+        if (i == from) continue;
+        sent++;
+        if (host_rng_uniform(&rng) < loss) {
+            lost++;
+            continue;
+        }
+        if (msg_count >= SIM_MAX_MSGS) continue;
+
+        sim_msg_t *msg = &msgs[msg_count++];
+        msg->deliver_ms = now_ms + SIM_LATENCY_MIN_MS +
+                          (uint32_t)(host_rng_uniform(&rng) * (SIM_LATENCY_MAX_MS - SIM_LATENCY_MIN_MS));
+        msg->to = i;
+        msg->session = od->session;
+        msg->index = od->index;
+        msg->count = od->count;
+        memcpy(msg->members, od->members, sizeof(msg->members));
+    }
+}
+
+static void sim_apply(int n, uint8_t actions, uint32_t now_ms)
+{
+    sim_node_t *node = &nodes[n];
+
+    if (actions & OPTICAL_DISCOVERY_ACT_ROLE) node->transmit = node->od.transmit;
+    if (actions & OPTICAL_DISCOVERY_ACT_SEND) sim_broadcast(n, &node->od, now_ms);
+    if (actions & OPTICAL_DISCOVERY_ACT_DONE) node->done = true;
+}
+
+/**
+ * @brief Probabilità che il sensore i decodifichi una trama della lampada j
+ */
+static float sim_decode_prob(int i, int j)
+{
+    float swing = room.gain[i][j] * SIM_SWING_LEVELS;
+    return 1.0f / (1.0f + expf(-(swing - SIM_THRESHOLD_LUX) / SIM_WIDTH_LUX));
+}
+
+/**
+ * @brief Acquisizione del nodo i: trama della lampada che trasmette, se leggibile
+ * @desc Due lampade leggibili insieme sovrappongono i fronti: nessuna trama.
+ */
+static uint16_t sim_capture(int i, uint8_t *confidence)
+{
+    uint16_t payload = 0;
+    int seen = 0;
+
+    for (int j = 0; j < room.count; j++) {
+        if (j == i || !nodes[j].transmit) continue;
+        float p = sim_decode_prob(i, j);
+        if (host_rng_uniform(&rng) >= p) continue;
+        payload = addr[j];
+        *confidence = (uint8_t)(40.0f + 60.0f * p * host_rng_uniform(&rng));
+        seen++;
+    }
+
+    if (seen > 1) {
+        collisions++;
+        return 0;
+    }
+    return payload;
+}
+
+/************************************************
+ * MAIN                                        *
+ ************************************************/
+
+int main(int argc, char **argv)
+{
+    int cols = (argc > 2) ? atoi(argv[1]) : 3;
+    int rows = (argc > 2) ? atoi(argv[2]) : 3;
+    loss = (argc > 3) ? (float)atof(argv[3]) / 100.0f : 0.0f;
+    uint32_t seed = (argc > 4) ? (uint32_t)strtoul(argv[4], NULL, 0) : 1;
+
+    if (cols * rows < 1 || cols * rows > OPTICAL_DISCOVERY_MAX_MEMBERS) {
+        fprintf(stderr, "Massimo %d nodi per stanza\n", OPTICAL_DISCOVERY_MAX_MEMBERS);
+        return 1;
+    }
+
+    host_rng_seed(&rng, seed);
+    host_room_grid(&room, cols, rows, SIM_SPACING_M);
+
+    for (int i = 0; i < room.count; i++) {
+        addr[i] = SIM_ADDR_BASE + (uint16_t)(room.count - 1 - i) * 3;  // Indirizzi non ordinati
+        optical_discovery_init(&nodes[i].od, addr[i]);
+        nodes[i].tick_phase_ms = (uint32_t)(host_rng_uniform(&rng) * SIM_TICK_MS) / SIM_STEP_MS * SIM_STEP_MS;
+    }
+
+    // Il promotore avvia la sessione e invia il gettone del primo passo
+    int initiator = room.count - 1;
+    optical_discovery_start(&nodes[initiator].od, addr, (uint8_t)room.count, 0x5A, 0);
+    sim_apply(initiator, OPTICAL_DISCOVERY_ACT_ROLE | OPTICAL_DISCOVERY_ACT_SEND, 0);
+
+    uint32_t now_ms = 0, finished_ms = 0;
+    int done = 0;
+
+    for (now_ms = 0; now_ms < SIM_LIMIT_MS && done < room.count; now_ms += SIM_STEP_MS) {
+        for (int m = 0; m < msg_count; ) {
+            if (msgs[m].deliver_ms <= now_ms) {
+                sim_msg_t msg = msgs[m];
+                msgs[m] = msgs[--msg_count];
+                uint8_t act = optical_discovery_on_token(&nodes[msg.to].od, msg.session, msg.members,
+                                                         msg.count, msg.index, now_ms);
+                sim_apply(msg.to, act, now_ms);
+            } else {
+                m++;
+            }
+        }
+
+        for (int i = 0; i < room.count; i++) {
+            sim_node_t *node = &nodes[i];
+            if (node->done || (now_ms % SIM_TICK_MS) != node->tick_phase_ms) continue;
+
+            // Acquisizione (solo in ricezione) poi tick, come il task del firmware
+            uint8_t confidence = 0;
+            uint16_t payload = node->transmit ? 0 : sim_capture(i, &confidence);
+            uint8_t act = optical_discovery_tick(&node->od, now_ms, !node->transmit,
+                                                 payload, confidence);
+            sim_apply(i, act, now_ms);
+        }
+
+        // La fine arriva dal tick o dal gettone: conta i nodi, non gli eventi
+        int finished = 0;
+        for (int i = 0; i < room.count; i++) finished += nodes[i].done;
+        if (finished > done) {
+            done = finished;
+            finished_ms = now_ms;
+        }
+    }
+
+    printf("Stanza %dx%d (passo %.1f m), perdita messaggi %.0f%% (%u/%u persi), seed %u\n",
+           cols, rows, SIM_SPACING_M, 100.0f * loss, lost, sent, seed);
+    printf("Durata: %.1f s (%d turni da %d ms), collisioni ottiche %u\n\n", finished_ms / 1000.0f,
+           room.count, OPTICAL_DISCOVERY_STEP_MS, collisions);
+
+    int correct = 0, missed = 0, spurious = 0, asymmetric = 0;
+    bool seen[HOST_ROOM_MAX_NODES][HOST_ROOM_MAX_NODES] = { { false } };
+
+    printf("Tabelle: intensità %% (probabilità vera %%), * = vicino\n");
+    for (int i = 0; i < room.count; i++) {
+        optical_discovery_table_t table;
+        optical_discovery_get_table(&nodes[i].od, &table);
+        printf("  0x%04X %-6s", addr[i], nodes[i].od.state == OPTICAL_DISCOVERY_DONE ? "OK" : "FALLITA");
+
+        for (int k = 0; k < table.count; k++) {
+            int j = 0;
+            while (j < room.count && addr[j] != table.addr[k]) j++;
+            if (j == i) {
+                printf("      --      ");
+                continue;
+            }
+
+            bool neighbor = (table.neighbor_mask & (1U << k)) != 0;
+            bool truth = sim_decode_prob(i, j) >= 0.5f;
+            seen[i][j] = neighbor;
+            correct += (neighbor == truth);
+            missed += (truth && !neighbor);
+            spurious += (!truth && neighbor);
+            printf(" %3u%%(%3.0f%%)%c ", table.strength[k], 100.0f * sim_decode_prob(i, j), neighbor ? '*' : ' ');
+        }
+        printf("\n");
+    }
+
+    for (int i = 0; i < room.count; i++) {
+        for (int j = i + 1; j < room.count; j++) asymmetric += (seen[i][j] != seen[j][i]);
+    }
+
+    int pairs = room.count * (room.count - 1);
+    printf("\nCoppie ordinate %d: corrette %d, vicini persi %d, vicini spuri %d, archi asimmetrici %d\n",
+           pairs, correct, missed, spurious, asymmetric);
+
+    return (done == room.count && missed == 0 && spurious == 0) ? 0 : 1;
+}
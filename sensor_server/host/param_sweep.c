@@ -0,0 +1,568 @@
+/**
+ * Firmware: ECOLUMIERE BLE MESH ESP32
+ * Tool host: Param Sweep - Ricerca parallela dei parametri algo_config_data_t
+ * Descrizione: Simula una stanza (modello a griglia o traccia registrata di
+ *              luce naturale) per ogni combinazione di dimm_step, perc_min,
+ *              distance, transparency, efficiency e ordini delle medie,
+ *              usando la catena del firmware di algo_core.c (medie a blocchi,
+ *              divisore ALGO_AVG_LAST, algo_core_step) più il fade. Le combinazioni vengono
+ *              distribuite su tutti i core. Stampa il fronte di Pareto
+ *              energia / errore di comfort e il blob algo_config_data_t
+ *              (con CRC) della configurazione consigliata.
+ *
+ * Compilazione (da sensor_server/host):
+ *   gcc -O2 -Wall -pthread -I../ecolumiere -o param_sweep param_sweep.c \
+ *       ../ecolumiere/algo_core.c -lm
+ *
+ * Uso: ./param_sweep [opzioni]
+ *   -r N        ricerca casuale su N combinazioni (default: griglia completa)
+ *   -t file     traccia CSV "secondi,lux_finestra" al posto del giorno sintetico
+ *   -H ore      durata del giorno sintetico (default 9)
+ *   -c perc     errore di comfort massimo per la scelta (default 10 %)
+ *   -T lux      target (default 400)
+ *   -g CxR,m    griglia della stanza (default 3x2,2.5)
+ *   -j N        numero di thread (default: tutti i core)
+ *   -s seed     seme di rumore e ricerca casuale
+ *   -o file     scrive il blob binario algo_config_data_t
+ *
+ * Ipotesi: le lampade reali seguono il modello host_room (18.75 lux per
+ * livello a piombo), distance/transparency/efficiency sono i valori
+ * configurati nel firmware e possono quindi differire dalla stanza reale.
+ * Gli ordini delle medie non fanno parte di algo_config_data_t: vengono
+ * suggeriti a parte per i profili di media.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "host_common.h"
+#include "algo_core.h"
+#include "ecolumiere.h"
+#include "config.h"
+
+/************************************************
+ * PARAMETRI DI SIMULAZIONE                    *
+ ************************************************/
+
+#define SWEEP_CYCLE_MS          5000    // Un ciclo di SLOT_COUNT slot da 500 ms
+#define SWEEP_WARMUP_H          1.0f
+#define SWEEP_NATURAL_DIVIDER   2
+#define SWEEP_NOISE             0.03f
+#define SWEEP_MAX_THREADS       64
+#define SWEEP_TRACE_MAX         100000
+#define SWEEP_CRC_INIT_VALUE    0xFFFF  // CONFIG_CRC_INIT_VALUE
+
+/************************************************
+ * SPAZIO DI RICERCA                           *
+ ************************************************/
+
+static const float grid_dimm_step[] = { 0.05f, 0.1f, 0.2f, 0.3f, 0.5f };
+static const float grid_perc_min[] = { 0.01f, 0.05f, 0.1f, 0.2f };
+static const float grid_distance[] = { 0.8f, 1.0f, 1.25f, 1.5f };
+static const float grid_transparency[] = { 0.8f, 0.9f, 1.0f };
+static const float grid_efficiency[] = { 12.0f, 15.0f, 18.75f, 22.0f };
+static const uint8_t grid_order[] = { 5, 10, 25, 50 };
+static const uint8_t grid_algo_avg[] = { 2, 5, 10 };
+
+#define GRID_LEN(a) (sizeof(a) / sizeof((a)[0]))
+
+/************************************************
+ * STRUTTURE                                   *
+ ************************************************/
+
+/**
+ * @brief Combinazione candidata e risultato della simulazione
+ * @field order: Ordine delle medie naturale e ambiente
+ * @field algo_avg: Medie accumulate prima del passo (divisore 2 x algo_avg)
+ * @field energy: Livello medio / LIGHT_MAX_LEVEL (%)
+ * @field comfort: Errore medio |E - T| / T (%)
+ * @field pareto: Non dominata
+ */
+typedef struct {
+    float dimm_step;
+    float perc_min;
+    float distance;
+    float transparency;
+    float efficiency;
+    uint8_t order;
+    uint8_t algo_avg;
+    float energy;
+    float comfort;
+    bool pareto;
+} sweep_candidate_t;
+
+typedef struct {
+    measure_avg_t natural;
+    measure_avg_t env;
+    algo_avg_t algo_avg;
+    algo_data_t algo;
+    float level;
+    uint32_t target;
+} sweep_node_t;
+
+/**
+ * @brief Scenario condiviso (sola lettura durante la ricerca)
+ */
+typedef struct {
+    host_room_t room;
+    uint32_t target_lux;
+    uint32_t cycles;
+    uint32_t warmup;
+    uint32_t seed;
+    float *window_lux;      // Luce in finestra per ciclo
+} sweep_scenario_t;
+
+typedef struct {
+    const sweep_scenario_t *scenario;
+    sweep_candidate_t *candidates;
+    uint32_t count;
+    uint32_t next;          // Indice condiviso, incremento atomico
+} sweep_work_t;
+
+/************************************************
+ * CATENA DEL FIRMWARE                         *
+ ************************************************/
+
+/**
+ * @brief Passi 4, 6-8 di ecolumiere_algo_process (senza medie live né fusione)
+ */
+static void sweep_algo_process(sweep_node_t *node, const sweep_candidate_t *c)
+{
+    if (!algo_core_avg_add(&node->algo_avg, (uint32_t)node->natural.measure, (uint32_t)node->env.measure)) {
+        return;
+    }
+
+    algo_core_avg_compute(&node->algo_avg, &node->algo, 2u * c->algo_avg);
+    algo_core_avg_load(&node->algo, &node->algo_avg);
+    algo_core_step(&node->algo);
+
+    node->target = (uint32_t)node->algo.pnew;
+}
+
+static void sweep_node_init(sweep_node_t *node, const sweep_candidate_t *c, uint32_t target_lux)
+{
+    memset(node, 0, sizeof(*node));
+    node->natural.size = c->order;
+    node->env.size = c->order;
+    node->algo_avg.size = c->algo_avg;
+
+    node->algo.target_lux = target_lux;
+    node->algo.power_efficiency = c->efficiency;
+    node->algo.distance = c->distance;
+    node->algo.in_pl = 1;
+    node->algo.transparency = c->transparency;
+    node->algo.dimm_step = c->dimm_step;
+    node->algo.perc_min = c->perc_min;
+    node->algo.emax = ((float)LIGHT_MAX_LEVEL * c->efficiency * c->transparency) /
+                      (c->distance * c->distance);
+    node->algo.pnew = 10.0f;
+    node->target = 10;
+    node->level = 10.0f;
+}
+
+static uint32_t sweep_sensor(host_rng_t *rng, float lux)
+{
+    float value = lux * (1.0f + SWEEP_NOISE * host_rng_gauss(rng));
+    return (value > 0.0f) ? (uint32_t)value : 0;
+}
+
+/**
+ * @brief Simula lo scenario con una combinazione e ne calcola le metriche
+ * @desc Il rumore usa lo stesso seme per ogni candidato: tutte le combinazioni
+ *       vedono la stessa sequenza di disturbi.
+ */
+static void sweep_evaluate(const sweep_scenario_t *s, sweep_candidate_t *c)
+{
+    sweep_node_t nodes[HOST_ROOM_MAX_NODES];
+    float levels[HOST_ROOM_MAX_NODES];
+    const host_room_t *room = &s->room;
+    host_rng_t rng;
+    double energy = 0.0, comfort = 0.0;
+    uint32_t samples = 0;
+
+    host_rng_seed(&rng, s->seed);
+    for (int i = 0; i < room->count; i++) {
+        sweep_node_init(&nodes[i], c, s->target_lux);
+    }
+
+    for (uint32_t cycle = 0; cycle < s->cycles; cycle++) {
+        float window = s->window_lux[cycle];
+
+        for (int i = 0; i < room->count; i++) {
+            levels[i] = nodes[i].level;
+        }
+
+        for (int i = 0; i < room->count; i++) {
+            sweep_node_t *node = &nodes[i];
+            float natural = host_room_natural(room, i, window);
+            float env = natural + host_room_lamp(room, i, levels);
+
+            if (cycle % SWEEP_NATURAL_DIVIDER == 0) {
+                algo_core_measure_push(&node->natural, sweep_sensor(&rng, natural));
+            }
+
+            // handle_env_light_slot + chiamata aggiuntiva a fine finestra
+            bool wrapped = algo_core_measure_push(&node->env, sweep_sensor(&rng, env));
+            sweep_algo_process(node, c);
+            if (wrapped) {
+                sweep_algo_process(node, c);
+            }
+
+            // Fade: un livello per ciclo verso il target
+            if (node->level < node->target) node->level += 1.0f;
+            else if (node->level > node->target) node->level -= 1.0f;
+        }
+
+        if (cycle < s->warmup) continue;
+
+        for (int i = 0; i < room->count; i++) {
+            levels[i] = nodes[i].level;
+        }
+        for (int i = 0; i < room->count; i++) {
+            float lux = host_room_natural(room, i, window) + host_room_lamp(room, i, levels);
+            comfort += fabsf(lux - (float)s->target_lux) / (float)s->target_lux;
+            energy += levels[i] / LIGHT_MAX_LEVEL;
+        }
+        samples += room->count;
+    }
+
+    c->energy = (float)(100.0 * energy / samples);
+    c->comfort = (float)(100.0 * comfort / samples);
+}
+
+/************************************************
+ * ESECUZIONE PARALLELA                        *
+ ************************************************/
+
+static void *sweep_worker(void *arg)
+{
+    sweep_work_t *work = (sweep_work_t *)arg;
+
+    for (;;) {
+        uint32_t index = __atomic_fetch_add(&work->next, 1, __ATOMIC_RELAXED);
+        if (index >= work->count) break;
+        sweep_evaluate(work->scenario, &work->candidates[index]);
+    }
+    return NULL;
+}
+
+static void sweep_run(sweep_work_t *work, int threads)
+{
+    pthread_t ids[SWEEP_MAX_THREADS];
+
+    for (int i = 0; i < threads; i++) {
+        pthread_create(&ids[i], NULL, sweep_worker, work);
+    }
+    for (int i = 0; i < threads; i++) {
+        pthread_join(ids[i], NULL);
+    }
+}
+
+/************************************************
+ * SPAZIO DI RICERCA E FRONTE DI PARETO        *
+ ************************************************/
+
+static uint32_t sweep_grid_size(void)
+{
+    return GRID_LEN(grid_dimm_step) * GRID_LEN(grid_perc_min) * GRID_LEN(grid_distance) *
+           GRID_LEN(grid_transparency) * GRID_LEN(grid_efficiency) *
+           GRID_LEN(grid_order) * GRID_LEN(grid_algo_avg);
+}
+
+/**
+ * @brief Decodifica l'indice della griglia in una combinazione
+ */
+static void sweep_grid_candidate(uint32_t index, sweep_candidate_t *c)
+{
+    memset(c, 0, sizeof(*c));
+    c->dimm_step = grid_dimm_step[index % GRID_LEN(grid_dimm_step)];
+    index /= GRID_LEN(grid_dimm_step);
+    c->perc_min = grid_perc_min[index % GRID_LEN(grid_perc_min)];
+    index /= GRID_LEN(grid_perc_min);
+    c->distance = grid_distance[index % GRID_LEN(grid_distance)];
+    index /= GRID_LEN(grid_distance);
+    c->transparency = grid_transparency[index % GRID_LEN(grid_transparency)];
+    index /= GRID_LEN(grid_transparency);
+    c->efficiency = grid_efficiency[index % GRID_LEN(grid_efficiency)];
+    index /= GRID_LEN(grid_efficiency);
+    c->order = grid_order[index % GRID_LEN(grid_order)];
+    index /= GRID_LEN(grid_order);
+    c->algo_avg = grid_algo_avg[index % GRID_LEN(grid_algo_avg)];
+}
+
+/**
+ * @brief Combinazione casuale negli estremi della griglia
+ */
+static void sweep_random_candidate(host_rng_t *rng, sweep_candidate_t *c)
+{
+    #define SWEEP_PICK(a) ((a)[0] + host_rng_uniform(rng) * ((a)[GRID_LEN(a) - 1] - (a)[0]))
+
+    memset(c, 0, sizeof(*c));
+    c->dimm_step = SWEEP_PICK(grid_dimm_step);
+    c->perc_min = SWEEP_PICK(grid_perc_min);
+    c->distance = SWEEP_PICK(grid_distance);
+    c->transparency = SWEEP_PICK(grid_transparency);
+    c->efficiency = SWEEP_PICK(grid_efficiency);
+    c->order = (uint8_t)(SWEEP_PICK(grid_order) + 0.5f);
+    c->algo_avg = (uint8_t)(SWEEP_PICK(grid_algo_avg) + 0.5f);
+
+    #undef SWEEP_PICK
+}
+
+static int sweep_compare_energy(const void *a, const void *b)
+{
+    const sweep_candidate_t *ca = (const sweep_candidate_t *)a;
+    const sweep_candidate_t *cb = (const sweep_candidate_t *)b;
+
+    if (ca->energy != cb->energy) return (ca->energy < cb->energy) ? -1 : 1;
+    if (ca->comfort != cb->comfort) return (ca->comfort < cb->comfort) ? -1 : 1;
+    return 0;
+}
+
+/**
+ * @brief Marca i candidati non dominati (ordinati per energia crescente)
+ * @return Numero di punti sul fronte
+ */
+static uint32_t sweep_pareto(sweep_candidate_t *c, uint32_t count)
+{
+    float best_comfort = 1e30f;
+    uint32_t front = 0;
+
+    qsort(c, count, sizeof(*c), sweep_compare_energy);
+
+    for (uint32_t i = 0; i < count; i++) {
+        c[i].pareto = (c[i].comfort < best_comfort);
+        if (c[i].pareto) {
+            best_comfort = c[i].comfort;
+            front++;
+        }
+    }
+    return front;
+}
+
+/************************************************
+ * SCENARIO                                    *
+ ************************************************/
+
+/**
+ * @brief Giorno sintetico: andamento lento più nuvole a passeggiata casuale
+ */
+static void sweep_synthetic_day(sweep_scenario_t *s, float hours)
+{
+    host_rng_t rng;
+    float cloud = 1.0f;
+
+    host_rng_seed(&rng, s->seed ^ 0xA5A5A5A5u);
+    s->cycles = (uint32_t)(hours * 3600.0f * 1000.0f / SWEEP_CYCLE_MS);
+    s->window_lux = (float *)malloc(s->cycles * sizeof(float));
+
+    for (uint32_t cycle = 0; cycle < s->cycles; cycle++) {
+        float t_h = (float)cycle * SWEEP_CYCLE_MS / 3600000.0f;
+        cloud += 0.02f * host_rng_gauss(&rng);
+        if (cloud < 0.3f) cloud = 0.3f;
+        if (cloud > 1.2f) cloud = 1.2f;
+        s->window_lux[cycle] = (350.0f + 250.0f * sinf(t_h * 0.5f)) * cloud;
+    }
+}
+
+/**
+ * @brief Carica una traccia "secondi,lux" e la ricampiona a un valore per ciclo
+ */
+static bool sweep_load_trace(sweep_scenario_t *s, const char *path)
+{
+    static float t[SWEEP_TRACE_MAX], lux[SWEEP_TRACE_MAX];
+    char line[128];
+    uint32_t n = 0;
+    FILE *f = fopen(path, "r");
+
+    if (f == NULL) return false;
+    while (n < SWEEP_TRACE_MAX && fgets(line, sizeof(line), f)) {
+        if (sscanf(line, "%f,%f", &t[n], &lux[n]) == 2) n++;
+    }
+    fclose(f);
+    if (n < 2) return false;
+
+    s->cycles = (uint32_t)((t[n - 1] - t[0]) * 1000.0f / SWEEP_CYCLE_MS);
+    s->window_lux = (float *)malloc(s->cycles * sizeof(float));
+
+    uint32_t k = 0;
+    for (uint32_t cycle = 0; cycle < s->cycles; cycle++) {
+        float ts = t[0] + (float)cycle * SWEEP_CYCLE_MS / 1000.0f;
+        while (k + 2 < n && t[k + 1] < ts) k++;
+        float span = t[k + 1] - t[k];
+        float w = (span > 0.0f) ? (ts - t[k]) / span : 0.0f;
+        if (w < 0.0f) w = 0.0f;
+        if (w > 1.0f) w = 1.0f;
+        s->window_lux[cycle] = lux[k] + w * (lux[k + 1] - lux[k]);
+    }
+    return true;
+}
+
+/************************************************
+ * BLOB DI CONFIGURAZIONE                      *
+ ************************************************/
+
+static void sweep_make_blob(const sweep_candidate_t *c, uint32_t target_lux, algo_config_data_t *blob)
+{
+    memset(blob, 0, sizeof(*blob));
+    blob->target_lux = target_lux;
+    blob->efficiency = c->efficiency;
+    blob->distance = c->distance;
+    blob->in_pl = 1;
+    blob->dimm_step = c->dimm_step;
+    blob->perc_min = c->perc_min;
+    blob->transparency = c->transparency;
+    blob->current_pwm_level = 0;
+    blob->crc = host_crc16_le(SWEEP_CRC_INIT_VALUE, (const uint8_t *)blob,
+                              sizeof(algo_config_data_t) - sizeof(uint16_t));
+}
+
+int main(int argc, char **argv)
+{
+    static sweep_scenario_t scenario;
+    sweep_work_t work;
+    uint32_t random_count = 0;
+    float hours = 9.0f, comfort_max = 10.0f;
+    const char *trace = NULL, *out = NULL;
+    int cols = 3, rows = 2, threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    float spacing = 2.5f;
+    int opt;
+
+    scenario.target_lux = 400;
+    scenario.seed = 12345u;
+
+    while ((opt = getopt(argc, argv, "r:t:H:c:T:g:j:s:o:")) != -1) {
+        switch (opt) {
+        case 'r': random_count = (uint32_t)strtoul(optarg, NULL, 0); break;
+        case 't': trace = optarg; break;
+        case 'H': hours = (float)atof(optarg); break;
+        case 'c': comfort_max = (float)atof(optarg); break;
+        case 'T': scenario.target_lux = (uint32_t)strtoul(optarg, NULL, 0); break;
+        case 'g':
+            if (sscanf(optarg, "%dx%d,%f", &cols, &rows, &spacing) != 3 ||
+                cols * rows < 1 || cols * rows > HOST_ROOM_MAX_NODES) {
+                fprintf(stderr, "griglia non valida: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 'j': threads = atoi(optarg); break;
+        case 's': scenario.seed = (uint32_t)strtoul(optarg, NULL, 0); break;
+        case 'o': out = optarg; break;
+        default:
+            fprintf(stderr, "uso: %s [-r N] [-t traccia.csv] [-H ore] [-c comfort%%] "
+                            "[-T lux] [-g CxR,m] [-j thread] [-s seed] [-o blob.bin]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (threads < 1) threads = 1;
+    if (threads > SWEEP_MAX_THREADS) threads = SWEEP_MAX_THREADS;
+
+    host_room_grid(&scenario.room, cols, rows, spacing);
+
+    if (trace != NULL) {
+        if (!sweep_load_trace(&scenario, trace)) {
+            fprintf(stderr, "traccia non valida: %s\n", trace);
+            return 1;
+        }
+    } else {
+        sweep_synthetic_day(&scenario, hours);
+    }
+    scenario.warmup = (uint32_t)(SWEEP_WARMUP_H * 3600.0f * 1000.0f / SWEEP_CYCLE_MS);
+    if (scenario.cycles <= scenario.warmup) {
+        fprintf(stderr, "scenario troppo corto: servono più di %.1f h\n", SWEEP_WARMUP_H);
+        return 1;
+    }
+
+    // Candidati: griglia completa o campionamento casuale
+    work.scenario = &scenario;
+    work.next = 0;
+    work.count = random_count ? random_count : sweep_grid_size();
+    work.candidates = (sweep_candidate_t *)malloc(work.count * sizeof(sweep_candidate_t));
+
+    host_rng_t rng;
+    host_rng_seed(&rng, scenario.seed * 2654435761u);
+    for (uint32_t i = 0; i < work.count; i++) {
+        if (random_count) {
+            sweep_random_candidate(&rng, &work.candidates[i]);
+        } else {
+            sweep_grid_candidate(i, &work.candidates[i]);
+        }
+    }
+
+    printf("Stanza %dx%d nodi, passo %.1f m, %s %.1f h, target %lu lux\n",
+           cols, rows, spacing, trace ? "traccia" : "giorno sintetico",
+           scenario.cycles * (float)SWEEP_CYCLE_MS / 3600000.0f,
+           (unsigned long)scenario.target_lux);
+    printf("%s: %lu combinazioni su %d thread\n", random_count ? "Ricerca casuale" : "Griglia",
+           (unsigned long)work.count, threads);
+
+    double t0 = host_time_s();
+    sweep_run(&work, threads);
+    double elapsed = host_time_s() - t0;
+    double node_steps = (double)work.count * scenario.cycles * scenario.room.count;
+
+    printf("Tempo %.2f s, %.1f M passi-nodo/s\n\n", elapsed, node_steps / elapsed / 1e6);
+
+    // Fronte di Pareto
+    uint32_t front = sweep_pareto(work.candidates, work.count);
+    const sweep_candidate_t *choice = NULL;
+
+    printf("Fronte di Pareto (%lu punti):\n", (unsigned long)front);
+    printf("%9s %9s %9s %8s %8s %8s %9s %6s %5s\n", "Energia%", "Comfort%",
+           "dimm", "perc_min", "dist", "transp", "effic.", "ordine", "algo");
+    for (uint32_t i = 0; i < work.count; i++) {
+        const sweep_candidate_t *c = &work.candidates[i];
+        if (!c->pareto) continue;
+        printf("%9.2f %9.2f %9.3f %8.3f %8.2f %8.2f %9.2f %6u %5u\n",
+               c->energy, c->comfort, c->dimm_step, c->perc_min, c->distance,
+               c->transparency, c->efficiency, c->order, c->algo_avg);
+
+        // Primo punto (energia minima) entro il limite di comfort
+        if (choice == NULL && c->comfort <= comfort_max) choice = c;
+    }
+
+    if (choice == NULL) {
+        // Nessun punto entro il limite: il più vicino al target
+        for (uint32_t i = 0; i < work.count; i++) {
+            if (work.candidates[i].pareto) choice = &work.candidates[i];
+        }
+        printf("\nNessuna combinazione entro %.1f%% di errore: scelta quella più accurata\n",
+               comfort_max);
+    }
+
+    algo_config_data_t blob;
+    sweep_make_blob(choice, scenario.target_lux, &blob);
+
+    printf("\nConfigurazione consigliata (energia %.2f%%, comfort %.2f%%):\n",
+           choice->energy, choice->comfort);
+    printf("  target_lux=%lu efficiency=%.2f distance=%.2f in_pl=%lu\n",
+           (unsigned long)blob.target_lux, blob.efficiency, blob.distance,
+           (unsigned long)blob.in_pl);
+    printf("  dimm_step=%.3f perc_min=%.3f transparency=%.2f crc=0x%04X\n",
+           blob.dimm_step, blob.perc_min, blob.transparency, blob.crc);
+    printf("  ordini medie: naturale/ambiente %u, algoritmo %u (divisore %u)\n",
+           choice->order, choice->algo_avg, 2u * choice->algo_avg);
+    printf("  blob algo_config_data_t (%zu byte): ", sizeof(blob));
+    for (size_t i = 0; i < sizeof(blob); i++) {
+        printf("%02X", ((const uint8_t *)&blob)[i]);
+    }
+    printf("\n");
+
+    if (out != NULL) {
+        FILE *f = fopen(out, "wb");
+        if (f == NULL || fwrite(&blob, sizeof(blob), 1, f) != 1) {
+            fprintf(stderr, "scrittura fallita: %s\n", out);
+            if (f) fclose(f);
+            return 1;
+        }
+        fclose(f);
+        printf("  scritto in %s\n", out);
+    }
+
+    free(work.candidates);
+    free(scenario.window_lux);
+    return 0;
+}
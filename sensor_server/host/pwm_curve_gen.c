@@ -0,0 +1,141 @@
+/**
+ * Firmware: ECOLUMIERE BLE MESH ESP32
+ * Tool host: PWM Curve Gen - Tabelle percettive del dimming
+ * Descrizione: Genera le due tabelle costanti di pwmcontroller.c:
+ *              pwm_dim_duty (livello logico 0..PWM_DIM_LEVELS → duty LEDC a
+ *              13 bit, luminosità CIE 1931 L* → Y) e pwm_level_dim (livello
+ *              di regolazione 0..LIGHT_MAX_LEVEL → livello logico con il duty
+ *              più vicino a quello lineare storico level * 8191 / 32). Senza
+ *              argomenti confronta i gradini della scala lineare a 33 livelli
+ *              con quelli della scala percettiva nella parte bassa, come
+ *              variazione di L* per gradino.
+ *
+ * Compilazione (da sensor_server/host):
+ *   gcc -O2 -Wall -o pwm_curve_gen pwm_curve_gen.c -lm
+ *
+ * Uso: ./pwm_curve_gen [tabelle]
+ *
+ * Ipotesi: flusso della lampada proporzionale al duty (driver LED lineare),
+ * L* proporzionale al livello logico (L* = 100 * dim / PWM_DIM_LEVELS).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdint.h>
+
+/************************************************
+ * PARAMETRI DI SIMULAZIONE                    *
+ ************************************************/
+
+// Stessi valori di pwmcontroller.h (l'header dipende da ESP-IDF)
+#define PWM_DIM_LEVELS          256
+#define LIGHT_MAX_LEVEL         32
+#define PWM_MAX_VALUE           8191
+
+#define SIM_LOW_END_DIM         64      // Parte bassa confrontata (25% di L*)
+#define SIM_PER_LINE            10      // Valori per riga nella tabella generata
+
+static uint16_t dim_duty[PWM_DIM_LEVELS + 1];
+static uint16_t level_dim[LIGHT_MAX_LEVEL + 1];
+
+/************************************************
+ * CURVA CIE 1931                              *
+ ************************************************/
+
+/**
+ * @brief Luminanza relativa (0..1) per una chiarezza L* (0..100)
+ */
+static double cie_y(double lstar)
+{
+    if (lstar <= 8.0) return lstar / 903.3;
+    double t = (lstar + 16.0) / 116.0;
+    return t * t * t;
+}
+
+/**
+ * @brief Chiarezza L* (0..100) per una luminanza relativa (0..1)
+ */
+static double cie_lstar(double y)
+{
+    if (y <= 0.008856) return 903.3 * y;
+    return 116.0 * cbrt(y) - 16.0;
+}
+
+static void build_tables(void)
+{
+    for (int d = 0; d <= PWM_DIM_LEVELS; d++) {
+        double y = cie_y(100.0 * d / PWM_DIM_LEVELS);
+        dim_duty[d] = (uint16_t)lround(y * PWM_MAX_VALUE);
+    }
+
+    for (int l = 0; l <= LIGHT_MAX_LEVEL; l++) {
+        int linear = l * PWM_MAX_VALUE / LIGHT_MAX_LEVEL;
+        int best = 0;
+        for (int d = 1; d <= PWM_DIM_LEVELS; d++) {
+            if (abs(dim_duty[d] - linear) < abs(dim_duty[best] - linear)) best = d;
+        }
+        level_dim[l] = (uint16_t)best;
+    }
+}
+
+static void print_table(const char *name, const uint16_t *table, int count)
+{
+    printf("static const uint16_t %s[%d] = {", name, count);
+    for (int i = 0; i < count; i++) {
+        printf("%s%5u%s", (i % SIM_PER_LINE) ? " " : "\n    ", table[i], (i + 1 < count) ? "," : "");
+    }
+    printf("\n};\n\n");
+}
+
+/************************************************
+ * MAIN                                        *
+ ************************************************/
+
+int main(int argc, char **argv)
+{
+    build_tables();
+
+    if (argc > 1 && strcmp(argv[1], "tabelle") == 0) {
+        print_table("pwm_dim_duty", dim_duty, PWM_DIM_LEVELS + 1);
+        print_table("pwm_level_dim", level_dim, LIGHT_MAX_LEVEL + 1);
+        return 0;
+    }
+
+    for (int d = 1; d <= PWM_DIM_LEVELS; d++) {
+        if (dim_duty[d] <= dim_duty[d - 1]) {
+            fprintf(stderr, "Curva non crescente al livello %d\n", d);
+            return 1;
+        }
+    }
+
+    printf("Scala lineare (%d livelli): gradini nella parte bassa\n", LIGHT_MAX_LEVEL + 1);
+    printf("  livello  duty  dY/Y     dL*\n");
+    for (int l = 1; l <= 4; l++) {
+        double y0 = (double)(l - 1) / LIGHT_MAX_LEVEL, y1 = (double)l / LIGHT_MAX_LEVEL;
+        printf("  %2d      %5d  %5.1f%%  %5.2f\n", l, l * PWM_MAX_VALUE / LIGHT_MAX_LEVEL,
+               y0 > 0 ? 100.0 * (y1 - y0) / y0 : 100.0, cie_lstar(y1) - cie_lstar(y0));
+    }
+
+    printf("\nScala percettiva (%d livelli): gradini fino a dim %d\n", PWM_DIM_LEVELS + 1, SIM_LOW_END_DIM);
+    double worst_l = 0.0;
+    for (int d = 1; d <= SIM_LOW_END_DIM; d++) {
+        double y0 = (double)dim_duty[d - 1] / PWM_MAX_VALUE, y1 = (double)dim_duty[d] / PWM_MAX_VALUE;
+        double dl = cie_lstar(y1) - cie_lstar(y0);
+        if (dl > worst_l) worst_l = dl;
+    }
+    printf("  primo gradino: duty %u (L* %.2f)\n", dim_duty[1], cie_lstar((double)dim_duty[1] / PWM_MAX_VALUE));
+    printf("  gradino massimo: dL* %.2f (duty quantizzato a 13 bit)\n", worst_l);
+
+    double worst_err = 0.0;
+    for (int l = 1; l <= LIGHT_MAX_LEVEL; l++) {
+        int linear = l * PWM_MAX_VALUE / LIGHT_MAX_LEVEL;
+        double err = 100.0 * fabs((double)dim_duty[level_dim[l]] - linear) / linear;
+        if (err > worst_err) worst_err = err;
+    }
+    printf("\nLivelli di regolazione sulla scala percettiva: scarto massimo dal duty lineare %.2f%%\n",
+           worst_err);
+
+    return 0;
+}
@@ -0,0 +1,237 @@
+/**
+ * Firmware: ECOLUMIERE BLE MESH ESP32
+ * Tool host: Room Matrix Sim - Misura della matrice di interazione fra lampade
+ * Descrizione: Più nodi in una stanza condividono lo stesso campo luminoso
+ *              (host_room: legge del coseno fra ogni lampada e ogni sensore più
+ *              luce naturale che deriva lentamente). Ogni nodo esegue il
+ *              protocollo a gettone del firmware (room_matrix.c) con tick da
+ *              500 ms sfasati, letture mediate su una finestra ADC da 450 ms e
+ *              messaggi di gruppo con latenza e perdite. Alla fine confronta le
+ *              righe misurate con la matrice vera.
+ *
+ * Compilazione (da sensor_server/host):
+ *   gcc -O2 -Wall -I../ecolumiere -o room_matrix_sim room_matrix_sim.c \
+ *       ../ecolumiere/room_matrix.c -lm
+ *
+ * Uso: ./room_matrix_sim [colonne righe] [perdita_%] [seed]
+ *
+ * Ipotesi: lampade applicate subito (pwm_hold_level), latenza mesh 20-120 ms,
+ * rumore del sensore 1 lux + 1%, luce naturale che varia del 5% durante la
+ * misura. Il nodo promotore è l'ultimo della griglia.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "host_common.h"
+#include "room_matrix.h"
+
+/************************************************
+ * PARAMETRI DI SIMULAZIONE                    *
+ ************************************************/
+
+#define SIM_STEP_MS             10
+#define SIM_TICK_MS             500
+#define SIM_ADC_WINDOW          45      // Campioni da 10 ms nella finestra ADC
+#define SIM_SPACING_M           2.5f
+#define SIM_WINDOW_LUX          60.0f   // Sera: poca luce naturale
+#define SIM_NATURAL_DRIFT       0.05f
+#define SIM_NOISE_LUX           1.0f
+#define SIM_NOISE_REL           0.01f
+#define SIM_LATENCY_MIN_MS      20
+#define SIM_LATENCY_MAX_MS      120
+#define SIM_MAX_MSGS            512
+#define SIM_LIMIT_MS            (120 * 1000)
+#define SIM_ADDR_BASE           0x0010
+
+/**
+ * @brief Gettone in transito verso un nodo
+ */
+typedef struct {
+    uint32_t deliver_ms;
+    int to;
+    uint8_t session;
+    uint8_t index;
+    uint8_t count;
+    uint16_t lit;
+    uint16_t members[ROOM_MATRIX_MAX_MEMBERS];
+} sim_msg_t;
+
+typedef struct {
+    room_matrix_t rm;
+    float level;
+    float window[SIM_ADC_WINDOW];
+    int window_pos;
+    uint32_t tick_phase_ms;
+    bool done;
+} sim_node_t;
+
+static host_room_t room;
+static sim_node_t nodes[HOST_ROOM_MAX_NODES];
+static sim_msg_t msgs[SIM_MAX_MSGS];
+static int msg_count;
+static host_rng_t rng;
+static float loss;
+static uint32_t sent, lost;
+
+/************************************************
+ * MESH E CAMPO LUMINOSO                       *
+ ************************************************/
+
+static void sim_broadcast(int from, const room_matrix_t *rm, uint32_t now_ms)
+{
+    for (int i = 0; i < room.count; i++) {
+        if (i == from) continue;
+        sent++;
+        if (host_rng_uniform(&rng) < loss) {
+            lost++;
+            continue;
+        }
+        if (msg_count >= SIM_MAX_MSGS) continue;
+
+        sim_msg_t *msg = &msgs[msg_count++];
+        msg->deliver_ms = now_ms + SIM_LATENCY_MIN_MS +
+                          (uint32_t)(host_rng_uniform(&rng) * (SIM_LATENCY_MAX_MS - SIM_LATENCY_MIN_MS));
+        msg->to = i;
+        msg->session = rm->session;
+        msg->index = rm->index;
+        msg->count = rm->count;
+        msg->lit = rm->lit;
+        memcpy(msg->members, rm->members, sizeof(msg->members));
+    }
+}
+
+static void sim_apply(int n, uint8_t actions, uint32_t now_ms)
+{
+    sim_node_t *node = &nodes[n];
+
+    if (actions & ROOM_MATRIX_ACT_LEVEL) node->level = node->rm.level;
+    if (actions & ROOM_MATRIX_ACT_SEND) sim_broadcast(n, &node->rm, now_ms);
+    if (actions & ROOM_MATRIX_ACT_DONE) node->done = true;
+}
+
+static float sim_sensor_lux(int i, float window_lux)
+{
+    float levels[HOST_ROOM_MAX_NODES];
+    for (int j = 0; j < room.count; j++) levels[j] = nodes[j].level;
+
+    float lux = host_room_natural(&room, i, window_lux) + host_room_lamp(&room, i, levels);
+    return lux + (SIM_NOISE_LUX + SIM_NOISE_REL * lux) * host_rng_gauss(&rng);
+}
+
+static float sim_adc_mean(const sim_node_t *node)
+{
+    float sum = 0.0f;
+    for (int k = 0; k < SIM_ADC_WINDOW; k++) sum += node->window[k];
+    return sum / SIM_ADC_WINDOW;
+}
+
+/************************************************
+ * MAIN                                        *
+ ************************************************/
+
+int main(int argc, char **argv)
+{
+    int cols = (argc > 2) ? atoi(argv[1]) : 3;
+    int rows = (argc > 2) ? atoi(argv[2]) : 2;
+    loss = (argc > 3) ? (float)atof(argv[3]) / 100.0f : 0.0f;
+    uint32_t seed = (argc > 4) ? (uint32_t)strtoul(argv[4], NULL, 0) : 1;
+
+    if (cols * rows < 1 || cols * rows > ROOM_MATRIX_MAX_MEMBERS) {
+        fprintf(stderr, "Massimo %d nodi per stanza\n", ROOM_MATRIX_MAX_MEMBERS);
+        return 1;
+    }
+
+    host_rng_seed(&rng, seed);
+    host_room_grid(&room, cols, rows, SIM_SPACING_M);
+
+    uint16_t members[ROOM_MATRIX_MAX_MEMBERS];
+    for (int i = 0; i < room.count; i++) {
+        members[i] = SIM_ADDR_BASE + (uint16_t)(room.count - 1 - i) * 3;  // Indirizzi non ordinati
+        room_matrix_init(&nodes[i].rm, members[i]);
+        nodes[i].tick_phase_ms = (uint32_t)(host_rng_uniform(&rng) * SIM_TICK_MS) / SIM_STEP_MS * SIM_STEP_MS;
+    }
+
+    // Il promotore avvia la sessione e invia il gettone del buio iniziale
+    int initiator = room.count - 1;
+    room_matrix_start(&nodes[initiator].rm, members, (uint8_t)room.count, 0x5A, 0);
+    sim_apply(initiator, ROOM_MATRIX_ACT_LEVEL | ROOM_MATRIX_ACT_SEND, 0);
+
+    uint32_t now_ms = 0, finished_ms = 0;
+    int done = 0;
+
+    for (now_ms = 0; now_ms < SIM_LIMIT_MS && done < room.count; now_ms += SIM_STEP_MS) {
+        float window_lux = SIM_WINDOW_LUX * (1.0f + SIM_NATURAL_DRIFT * now_ms / 60000.0f);
+
+        for (int m = 0; m < msg_count; ) {
+            if (msgs[m].deliver_ms <= now_ms) {
+                sim_msg_t msg = msgs[m];
+                msgs[m] = msgs[--msg_count];
+                uint8_t act = room_matrix_on_token(&nodes[msg.to].rm, msg.session, msg.members,
+                                                   msg.count, msg.index, msg.lit, now_ms);
+                sim_apply(msg.to, act, now_ms);
+            } else {
+                m++;
+            }
+        }
+
+        for (int i = 0; i < room.count; i++) {
+            sim_node_t *node = &nodes[i];
+            node->window[node->window_pos] = sim_sensor_lux(i, window_lux);
+            node->window_pos = (node->window_pos + 1) % SIM_ADC_WINDOW;
+
+            if (node->done || (now_ms % SIM_TICK_MS) != node->tick_phase_ms) continue;
+
+            uint8_t act = room_matrix_tick(&node->rm, now_ms, sim_adc_mean(node));
+            sim_apply(i, act, now_ms);
+            if (node->done) {
+                done++;
+                finished_ms = now_ms;
+            }
+        }
+    }
+
+    printf("Stanza %dx%d (passo %.1f m), perdita messaggi %.0f%% (%u/%u persi), seed %u\n",
+           cols, rows, SIM_SPACING_M, 100.0f * loss, lost, sent, seed);
+    printf("Durata: %.1f s (%d passi da %d ms)\n\n", finished_ms / 1000.0f,
+           room.count + 2, ROOM_MATRIX_STEP_MS);
+
+    double err_sum = 0.0, diag_err = 0.0;
+    float err_max = 0.0f;
+    int valid = 0, missing = 0;
+
+    printf("Righe misurate (vere) in lux per livello:\n");
+    for (int i = 0; i < room.count; i++) {
+        const room_matrix_t *rm = &nodes[i].rm;
+        printf("  0x%04X %-6s", rm->self, rm->state == ROOM_MATRIX_DONE ? "OK" : "FALLITA");
+
+        for (int k = 0; k < rm->count; k++) {
+            // Colonna k = lampada con indirizzo members[k]
+            int j = 0;
+            while (j < room.count && members[j] != rm->members[k]) j++;
+            float truth = room.gain[i][j];
+
+            if (rm->coef_mask & (1U << k)) {
+                float err = fabsf(rm->coef[k] - truth);
+                err_sum += err;
+                if (err > err_max) err_max = err;
+                if (i == j) diag_err += err / truth;
+                valid++;
+                printf(" %6.2f(%5.2f)", rm->coef[k], truth);
+            } else {
+                missing++;
+                printf("     --(%5.2f)", truth);
+            }
+        }
+        printf("\n");
+    }
+
+    printf("\nCoefficienti misurati %d, mancanti %d\n", valid, missing);
+    if (valid > 0) {
+        printf("Errore assoluto medio %.3f lux/livello, massimo %.3f, diagonale %.1f%%\n",
+               err_sum / valid, err_max, 100.0 * diag_err / room.count);
+    }
+
+    return (done == room.count) ? 0 : 1;
+}
@@ -0,0 +1,278 @@
+/**
+ * Firmware: ECOLUMIERE BLE MESH ESP32
+ * Tool host: Room Sim - Simulazione multi-nodo della fusione lux nella stanza
+ * Descrizione: Più nodi nella stessa stanza condividono la luce delle lampade
+ *              vicine. Ogni nodo replica la catena del firmware (medie a
+ *              blocchi, media algoritmo con divisore ALGO_AVG_LAST, passo
+ *              algo_core_step, fade di un livello per slot) e scambia le
+ *              misure filtrate come farebbe via mesh (periodo 30 s, perdita
+ *              pacchetti). Confronta fusione OFF / MEDIA / MEDIANA con la
+ *              stessa sequenza di nuvole, ombre locali e rumore.
+ *
+ * Compilazione (da sensor_server/host):
+ *   gcc -O2 -Wall -I../ecolumiere -o room_sim room_sim.c \
+ *       ../ecolumiere/neighbor.c ../ecolumiere/algo_core.c -lm
+ *
+ * Uso: ./room_sim [ore_simulate] [seed]
+ *
+ * Ipotesi: profilo medie STABLE (50/50/10, divisore 20), slot ambiente ogni
+ * ciclo da 5 s e naturale ogni 2 cicli, misura naturale a lampada spenta.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "host_common.h"
+#include "algo_core.h"
+#include "neighbor.h"
+#include "config.h"
+
+/************************************************
+ * PARAMETRI DI SIMULAZIONE                    *
+ ************************************************/
+
+#define SIM_CYCLE_MS            5000    // Un ciclo di SLOT_COUNT slot da 500 ms
+#define SIM_COLS                3
+#define SIM_ROWS                2
+#define SIM_SPACING_M           2.5f
+#define SIM_WARMUP_H            1.0f
+
+#define SIM_NATURAL_ORDER       50      // Profilo STABLE
+#define SIM_ENV_ORDER           50
+#define SIM_NATURAL_DIVIDER     2
+#define SIM_ALGO_AVG            10
+#define SIM_ALGO_AVG_LAST       20
+
+#define SIM_SHARE_CYCLES        6       // ECL_LUX_SHARE_PERIOD_MS / SIM_CYCLE_MS
+#define SIM_LOSS_PROB           0.10f   // Perdita pacchetti mesh
+#define SIM_NOISE               0.03f   // Rumore sensore relativo
+#define SIM_SHADOW_NODE         1       // Nodo soggetto a ombre locali
+#define SIM_SHADOW_FACTOR       0.4f
+#define SIM_SHADOW_START_PROB   (1.0f / 720.0f)
+
+#define SIM_TARGET_LUX          400
+#define SIM_DIMM_STEP           0.1f
+#define SIM_PERC_MIN            0.01f
+
+/************************************************
+ * STRUTTURE                                   *
+ ************************************************/
+
+typedef struct {
+    measure_avg_t natural;
+    measure_avg_t env;
+    algo_avg_t algo_avg;
+    algo_data_t algo;
+    neighbor_table_t table;
+    float level;          // Livello applicato alla lampada (dopo il fade)
+    uint32_t target;      // Livello richiesto dall'algoritmo
+    int last_dir;
+} sim_node_t;
+
+typedef struct {
+    double level_travel;  // Somma |Δlivello| applicato
+    uint32_t reversals;   // Inversioni del verso di regolazione
+    double uniformity;    // Somma di min/media
+    double comfort;       // Somma di |E - target| / target
+    double energy;        // Somma livelli / LIGHT_MAX_LEVEL
+    uint32_t samples;
+} sim_metrics_t;
+
+/************************************************
+ * CATENA DEL FIRMWARE                         *
+ ************************************************/
+
+/**
+ * @brief Replica ecolumiere_algo_process (senza medie live)
+ */
+static void sim_algo_process(sim_node_t *node, neighbor_fusion_t mode, uint32_t now_ms)
+{
+    uint32_t natural, env = (uint32_t)node->env.measure;
+
+    neighbor_fuse(&node->table, mode, (uint32_t)node->natural.measure, now_ms, &natural);
+
+    if (!algo_core_avg_add(&node->algo_avg, natural, env)) {
+        return;
+    }
+
+    algo_core_avg_compute(&node->algo_avg, &node->algo, SIM_ALGO_AVG_LAST);
+    algo_core_avg_load(&node->algo, &node->algo_avg);
+    algo_core_step(&node->algo);
+
+    node->target = (uint32_t)node->algo.pnew;
+}
+
+static void sim_node_init(sim_node_t *node)
+{
+    memset(node, 0, sizeof(*node));
+    node->natural.size = SIM_NATURAL_ORDER;
+    node->env.size = SIM_ENV_ORDER;
+    node->algo_avg.size = SIM_ALGO_AVG;
+    neighbor_table_init(&node->table);
+
+    node->algo.target_lux = SIM_TARGET_LUX;
+    node->algo.power_efficiency = HOST_LAMP_LUX_PER_LEVEL;
+    node->algo.distance = 1.0f;
+    node->algo.in_pl = 1;
+    node->algo.transparency = 1.0f;
+    node->algo.dimm_step = SIM_DIMM_STEP;
+    node->algo.perc_min = SIM_PERC_MIN;
+    node->algo.emax = (float)LIGHT_MAX_LEVEL * HOST_LAMP_LUX_PER_LEVEL;
+    node->algo.pnew = 10.0f;
+    node->target = 10;
+    node->level = 10.0f;
+}
+
+/************************************************
+ * SIMULAZIONE                                 *
+ ************************************************/
+
+static uint32_t sim_sensor(host_rng_t *rng, float lux, float shadow)
+{
+    float value = lux * shadow * (1.0f + SIM_NOISE * host_rng_gauss(rng));
+    return (value > 0.0f) ? (uint32_t)value : 0;
+}
+
+static void sim_run(const host_room_t *room, neighbor_fusion_t mode, float hours,
+                    uint32_t seed, sim_metrics_t *metrics)
+{
+    static sim_node_t nodes[HOST_ROOM_MAX_NODES];
+    float levels[HOST_ROOM_MAX_NODES];
+    host_rng_t env_rng, noise_rng, net_rng;
+    uint32_t cycles = (uint32_t)(hours * 3600.0f * 1000.0f / SIM_CYCLE_MS);
+    uint32_t warmup = (uint32_t)(SIM_WARMUP_H * 3600.0f * 1000.0f / SIM_CYCLE_MS);
+    uint32_t shadow_left = 0;
+    float cloud = 1.0f;
+
+    // Stessa sequenza di disturbi per ogni metodo di fusione
+    host_rng_seed(&env_rng, seed);
+    host_rng_seed(&noise_rng, seed * 7919u + 1u);
+    host_rng_seed(&net_rng, seed * 104729u + 3u);
+
+    memset(metrics, 0, sizeof(*metrics));
+    for (int i = 0; i < room->count; i++) {
+        sim_node_init(&nodes[i]);
+    }
+
+    for (uint32_t cycle = 0; cycle < cycles; cycle++) {
+        uint32_t now_ms = cycle * SIM_CYCLE_MS;
+        float t_h = (float)now_ms / 3600000.0f;
+
+        // Luce in finestra: andamento lento più nuvole a passeggiata casuale
+        cloud += 0.02f * host_rng_gauss(&env_rng);
+        if (cloud < 0.3f) cloud = 0.3f;
+        if (cloud > 1.2f) cloud = 1.2f;
+        float window_lux = (350.0f + 250.0f * sinf(t_h * 0.5f)) * cloud;
+
+        // Ombre locali sul sensore di un nodo (persona, arredo)
+        if (shadow_left == 0 && host_rng_uniform(&env_rng) < SIM_SHADOW_START_PROB) {
+            shadow_left = 120 + (uint32_t)(host_rng_uniform(&env_rng) * 360.0f);
+        }
+
+        for (int i = 0; i < room->count; i++) {
+            levels[i] = nodes[i].level;
+        }
+
+        for (int i = 0; i < room->count; i++) {
+            sim_node_t *node = &nodes[i];
+            float shadow = (i == SIM_SHADOW_NODE && shadow_left) ? SIM_SHADOW_FACTOR : 1.0f;
+            float natural = host_room_natural(room, i, window_lux);
+            float env = natural + host_room_lamp(room, i, levels);
+
+            if (cycle % SIM_NATURAL_DIVIDER == 0) {
+                algo_core_measure_push(&node->natural, sim_sensor(&noise_rng, natural, shadow));
+            }
+
+            bool wrapped = algo_core_measure_push(&node->env, sim_sensor(&noise_rng, env, shadow));
+
+            // handle_env_light_slot + chiamata aggiuntiva a fine finestra
+            sim_algo_process(node, mode, now_ms);
+            if (wrapped) {
+                sim_algo_process(node, mode, now_ms);
+            }
+
+            // Pubblicazione verso la stanza, sfasata per nodo
+            if ((cycle + (uint32_t)i) % SIM_SHARE_CYCLES == 0) {
+                for (int j = 0; j < room->count; j++) {
+                    if (j == i || host_rng_uniform(&net_rng) < SIM_LOSS_PROB) continue;
+                    neighbor_table_update(&nodes[j].table, (uint16_t)(i + 1),
+                                          (uint32_t)node->natural.measure,
+                                          (uint32_t)node->env.measure, -60, now_ms);
+                }
+            }
+        }
+
+        if (shadow_left) shadow_left--;
+
+        // Fade: un livello per ciclo verso il target (apply_fade)
+        for (int i = 0; i < room->count; i++) {
+            sim_node_t *node = &nodes[i];
+            float before = node->level;
+            int dir = 0;
+
+            if (node->level < node->target) { node->level += 1.0f; dir = 1; }
+            else if (node->level > node->target) { node->level -= 1.0f; dir = -1; }
+
+            if (cycle >= warmup) {
+                metrics->level_travel += fabsf(node->level - before);
+                if (dir != 0 && node->last_dir != 0 && dir != node->last_dir) {
+                    metrics->reversals++;
+                }
+            }
+            if (dir != 0) node->last_dir = dir;
+        }
+
+        if (cycle < warmup) continue;
+
+        // Illuminamento reale ai nodi (senza ombre né rumore)
+        float sum = 0.0f, min = 1e9f, comfort = 0.0f, energy = 0.0f;
+        for (int i = 0; i < room->count; i++) {
+            levels[i] = nodes[i].level;
+        }
+        for (int i = 0; i < room->count; i++) {
+            float lux = host_room_natural(room, i, window_lux) + host_room_lamp(room, i, levels);
+            sum += lux;
+            if (lux < min) min = lux;
+            comfort += fabsf(lux - SIM_TARGET_LUX) / SIM_TARGET_LUX;
+            energy += levels[i] / LIGHT_MAX_LEVEL;
+        }
+        metrics->uniformity += min / (sum / room->count);
+        metrics->comfort += comfort / room->count;
+        metrics->energy += energy / room->count;
+        metrics->samples++;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    float hours = (argc > 1) ? (float)atof(argv[1]) : 9.0f;
+    uint32_t seed = (argc > 2) ? (uint32_t)strtoul(argv[2], NULL, 0) : 12345u;
+    static const char *names[] = { "OFF", "MEDIA", "MEDIANA" };
+    host_room_t room;
+
+    if (hours <= SIM_WARMUP_H) {
+        fprintf(stderr, "ore_simulate deve essere > %.1f\n", SIM_WARMUP_H);
+        return 1;
+    }
+
+    host_room_grid(&room, SIM_COLS, SIM_ROWS, SIM_SPACING_M);
+    float node_hours = (hours - SIM_WARMUP_H) * room.count;
+
+    printf("Stanza %dx%d nodi, passo %.1f m, %.1f h simulate (seed %u)\n",
+           SIM_COLS, SIM_ROWS, SIM_SPACING_M, hours, seed);
+    printf("%-8s %14s %14s %10s %12s %10s\n",
+           "Fusione", "Δliv/nodo/h", "Inv./nodo/h", "U0 min/m", "|E-T|/T %", "Energia %");
+
+    for (int mode = NEIGHBOR_FUSION_OFF; mode <= NEIGHBOR_FUSION_MEDIAN; mode++) {
+        sim_metrics_t m;
+        sim_run(&room, (neighbor_fusion_t)mode, hours, seed, &m);
+
+        printf("%-8s %14.2f %14.2f %10.3f %12.1f %10.1f\n", names[mode],
+               m.level_travel / node_hours, m.reversals / node_hours,
+               m.uniformity / m.samples, 100.0 * m.comfort / m.samples,
+               100.0 * m.energy / m.samples);
+    }
+
+    return 0;
+}
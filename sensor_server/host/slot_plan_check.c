@@ -0,0 +1,156 @@
+/**
+ * Firmware: ECOLUMIERE BLE MESH ESP32
+ * Tool host: Slot Plan Check - Copertura degli slot con cadenze variabili
+ * Descrizione: Esegue la pianificazione degli slot del firmware (slot_plan.c)
+ *              tick per tick per tutte le fasi di regolazione, con i profili
+ *              FAST e STABLE fissi e con cambi di profilo decisi nello slot
+ *              di regolazione, come fa ecolumiere_algo_process. Verifica che
+ *              device ID, misura naturale e misura ambiente siano serviti
+ *              almeno ogni N cicli (N = divisore più lento fra i profili) e
+ *              che l'acquisizione ottica venga armata esattamente prima degli
+ *              slot device ID serviti.
+ *
+ * Compilazione (da sensor_server/host):
+ *   gcc -O2 -Wall -I../ecolumiere -o slot_plan_check slot_plan_check.c \
+ *       ../ecolumiere/slot_plan.c
+ *
+ * Uso: ./slot_plan_check
+ *
+ * Ipotesi: nessun buio di calibrazione (rinvia solo la misura ambiente, già
+ * fuori dal salto dei tick); cadenze dei profili copiate da ecolumiere.c.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "slot_plan.h"
+
+/************************************************
+ * PARAMETRI DI SIMULAZIONE                    *
+ ************************************************/
+
+#define SIM_CYCLES              200
+#define SIM_SWITCH_MAX          5       // Cambi di profilo ogni 1..5 cicli
+#define SIM_TASKS               3
+
+// Stesse cadenze di algo_avg_profiles in ecolumiere.c
+static const pwm_slot_rate_t sim_profiles[2] = {
+    { .tick_divider = 1, .device_id_divider = 4, .natural_divider = 1, .env_divider = 1 },   // FAST
+    { .tick_divider = 2, .device_id_divider = 4, .natural_divider = 2, .env_divider = 1 }    // STABLE
+};
+static const char *sim_profile_names[2] = { "FAST", "STABLE" };
+
+static const uint8_t sim_task_bits[SIM_TASKS] = { SLOT_TASK_DEVICE_ID, SLOT_TASK_NATURAL, SLOT_TASK_ENV };
+static const char *sim_task_names[SIM_TASKS] = { "device ID", "naturale", "ambiente" };
+
+/************************************************
+ * SIMULAZIONE                                 *
+ ************************************************/
+
+/**
+ * @brief Esito di una sequenza: distanza massima in cicli fra due servizi
+ */
+typedef struct {
+    uint32_t max_gap[SIM_TASKS];
+    uint32_t served[SIM_TASKS];
+    uint32_t arm_errors;
+} sim_result_t;
+
+/**
+ * @brief Esegue SIM_CYCLES cicli per una fase
+ * @param start: Profilo iniziale
+ * @param switch_cycles: Cambio di profilo ogni N servizi ambiente (0 = mai)
+ */
+static void sim_run(uint8_t phase, int start, int switch_cycles, sim_result_t *res)
+{
+    slot_plan_t plan;
+    uint8_t control_slot = slot_plan_control_slot(phase);
+    int profile = start;
+    int env_count = 0;
+    uint32_t last[SIM_TASKS];
+    bool armed = false;
+
+    memset(res, 0, sizeof(*res));
+    slot_plan_init(&plan, &sim_profiles[profile]);
+    for (int t = 0; t < SIM_TASKS; t++) last[t] = 0;
+
+    for (uint32_t tick = 0; tick < SIM_CYCLES * SLOT_COUNT; tick++) {
+        uint8_t slot = tick % SLOT_COUNT;
+
+        // Come slot_timer_callback: regolazione, poi slot di misura
+        uint8_t tasks = slot_plan_control_tick(&plan, slot, control_slot, true);
+        if ((tasks & SLOT_TASK_ENV) && switch_cycles > 0 && ++env_count % switch_cycles == 0) {
+            profile ^= 1;
+            slot_plan_set_rate(&plan, &sim_profiles[profile]);
+        }
+        tasks |= slot_plan_measure_tick(&plan, slot);
+
+        if (armed != ((tasks & SLOT_TASK_DEVICE_ID) != 0)) res->arm_errors++;
+
+        for (int t = 0; t < SIM_TASKS; t++) {
+            if (!(tasks & sim_task_bits[t])) continue;
+            uint32_t gap = (tick - last[t] + SLOT_COUNT - 1) / SLOT_COUNT;
+            if (res->served[t] > 0 && gap > res->max_gap[t]) res->max_gap[t] = gap;
+            last[t] = tick;
+            res->served[t]++;
+        }
+
+        armed = slot_plan_device_id_due(&plan, (uint8_t)((slot + 1) % SLOT_COUNT));
+    }
+}
+
+/**
+ * @brief Distanza massima ammessa: il divisore più lento fra i due profili
+ */
+static uint32_t sim_gap_limit(int task)
+{
+    uint32_t limit = 0;
+    for (int p = 0; p < 2; p++) {
+        const pwm_slot_rate_t *r = &sim_profiles[p];
+        uint32_t div = (task == 0) ? r->device_id_divider : (task == 1) ? r->natural_divider : r->env_divider;
+        if (div > limit) limit = div;
+    }
+    return limit;
+}
+
+/************************************************
+ * MAIN                                        *
+ ************************************************/
+
+int main(void)
+{
+    int failures = 0;
+
+    printf("%-7s %-5s %-7s %12s %12s %12s %8s\n",
+           "Inizio", "Fase", "Cambio", "ID (cicli)", "NAT (cicli)", "ENV (cicli)", "Armo");
+
+    for (int start = 0; start < 2; start++) {
+        for (int switch_cycles = 0; switch_cycles <= SIM_SWITCH_MAX; switch_cycles++) {
+            for (uint8_t phase = 0; phase < PWM_CONTROL_PHASES; phase++) {
+                sim_result_t res;
+                bool ok = true;
+
+                sim_run(phase, start, switch_cycles, &res);
+
+                for (int t = 0; t < SIM_TASKS; t++) {
+                    if (res.served[t] < 2 || res.max_gap[t] > sim_gap_limit(t)) {
+                        fprintf(stderr, "Slot %s non servito: inizio %s, fase %u, cambio ogni %d\n",
+                                sim_task_names[t], sim_profile_names[start], phase, switch_cycles);
+                        ok = false;
+                    }
+                }
+                if (res.arm_errors > 0) ok = false;
+                if (!ok) failures++;
+
+                printf("%-7s %-5u %-7d %12u %12u %12u %8s\n",
+                       sim_profile_names[start], phase, switch_cycles,
+                       res.max_gap[0], res.max_gap[1], res.max_gap[2],
+                       res.arm_errors ? "ERRORE" : "ok");
+            }
+        }
+    }
+
+    printf("\n%s: %d sequenze fuori limite (ID <= %u, NAT <= %u, ENV <= %u cicli)\n",
+           failures ? "FALLITO" : "OK", failures, sim_gap_limit(0), sim_gap_limit(1), sim_gap_limit(2));
+    return failures ? 1 : 0;
+}
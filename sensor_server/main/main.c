@@ -16,6 +16,11 @@
 #include "slave_role.h"
 #include "ble_mesh_ecolumiere.h"
 #include "scheduler.h"
+#include "pwmcontroller.h"
+#include "commissioning.h"
+#include "offset_cal_task.h"
+#include "luxmeter.h"
+#include "lightcode.h"
 
 static const char *TAG = "MAIN_ECOLUMIERE";
 
@@ -120,9 +125,84 @@ void serial_control_task(void *pvParameters) {
                     ESP_LOGI(TAG, "💡 Esempio: ALGO_TEST 100 50 200");
                 }
             }
+            else if(strncmp(comando, "FUSION", 6) == 0) {
+                // Formato: FUSION <0=off|1=media|2=mediana>
+                unsigned int mode;
+                if (sscanf(comando, "FUSION %u", &mode) == 1 && mode <= 2) {
+                    ecolumiere_set_neighbor_fusion((uint8_t)mode);
+                } else {
+                    ESP_LOGI(TAG, "❌ Formato: FUSION <0=off|1=media|2=mediana>");
+                }
+            }
+            else if(strncmp(comando, "OCC", 3) == 0) {
+                // Formato: OCC <hold_s> <grazia_s> <standby_s> (0 = invariato)
+                unsigned long hold, grace, standby;
+                if (sscanf(comando, "OCC %lu %lu %lu", &hold, &grace, &standby) != 3 ||
+                    !ecolumiere_set_occupancy_times(hold, grace, standby)) {
+                    ESP_LOGI(TAG, "❌ Formato: OCC <hold_s> <grazia_s> <standby_s> (crescenti)");
+                }
+            }
+            else if(strncmp(comando, "NATEST", 6) == 0) {
+                // Formato: NATEST <0=misura a ogni slot|1=stima>
+                unsigned int enable;
+                if (sscanf(comando, "NATEST %u", &enable) == 1 && enable <= 1) {
+                    pwm_set_natural_estimation(enable == 1);
+                } else {
+                    ESP_LOGI(TAG, "❌ Formato: NATEST <0=misura|1=stima>");
+                }
+            }
+            else if(strncmp(comando, "LUXFILTER", 9) == 0) {
+                // Formato: LUXFILTER <0=media|1=mediana|2=troncata|3=hampel>
+                unsigned int filter;
+                if (sscanf(comando, "LUXFILTER %u", &filter) != 1 ||
+                    !luxmeter_set_filter((luxmeter_filter_t)filter)) {
+                    ESP_LOGI(TAG, "❌ Formato: LUXFILTER <0=media|1=mediana|2=troncata|3=hampel>");
+                }
+            }
+            else if(strncmp(comando, "SETTLE", 6) == 0) {
+                // Formato: SETTLE <ms> (assestamento delle raffiche di misura)
+                unsigned int settle_ms;
+                if (sscanf(comando, "SETTLE %u", &settle_ms) == 1) {
+                    pwm_set_measure_settle((uint16_t)settle_ms);
+                } else {
+                    ESP_LOGI(TAG, "❌ Formato: SETTLE <ms>");
+                }
+            }
+            else if(strcmp(comando, "COMMISSION") == 0) {
+                // Lampada in stanza buia: scansione dei livelli e stima dei parametri
+                if (commissioning_start(NULL) != ESP_OK) {
+                    ESP_LOGI(TAG, "❌ Commissioning già in corso");
+                }
+            }
+            else if(strcmp(comando, "OFFSETCAL") == 0) {
+                // Stanza buia: tabella di compensazione del luxmeter su tutti i livelli
+                if (offset_cal_start(NULL) != ESP_OK) {
+                    ESP_LOGI(TAG, "❌ Commissioning già in corso");
+                }
+            }
+            else if(strcmp(comando, "ROOMCAL") == 0) {
+                // Misura della matrice di stanza con questo nodo come promotore
+                if (ble_mesh_ecolumiere_room_matrix_start() != ESP_OK) {
+                    ESP_LOGI(TAG, "❌ Nodo non provisionato");
+                }
+            }
+            else if(strcmp(comando, "OPTDISC") == 0) {
+                // Scoperta dei vicini ottici della stanza con questo nodo come promotore
+                if (ble_mesh_ecolumiere_optical_discovery_start() != ESP_OK) {
+                    ESP_LOGI(TAG, "❌ Nodo non provisionato");
+                }
+            }
+            else if(strcmp(comando, "LIGHTCODE") == 0) {
+                // Statistiche e carico CPU dell'acquisizione del codice ottico
+                light_code_log_stats();
+            }
+            else if(strcmp(comando, "LIGHTBENCH") == 0) {
+                // Cicli di filtro + decodifica: coda a byte contro coda compatta
+                light_code_bench(1000);
+            }
             else {
                 ESP_LOGW(TAG, "❌ Comando non valido!");
-                ESP_LOGI(TAG, "💡 Comandi: ON, OFF, BLINK, STATUS, TEST, RESET, ALGO_STATUS, ALGO_TEST");
+                ESP_LOGI(TAG, "💡 Comandi: ON, OFF, BLINK, STATUS, TEST, RESET, ALGO_STATUS, ALGO_TEST, FUSION, OCC, NATEST, LUXFILTER, SETTLE, COMMISSION, OFFSETCAL, ROOMCAL, OPTDISC, LIGHTCODE, LIGHTBENCH");
             }
         }
         vTaskDelay(10 / portTICK_PERIOD_MS);